@@ -0,0 +1,328 @@
+// Бенчмарк конвейера загрузки страницы: токенизация, разбор в Rust,
+// снимок DOM со стилями через FFI, простой рендерер и раскладка.
+// Каждый этап прогоняется на корпусе bench/corpus (малая, средняя и
+// большая страница ~5 МБ), результат - p50/p99 одного прогона и МБ/с по p50.
+//
+//   heavenly_bench [--filter подстрока] [--corpus каталог] [--json]
+//
+// Окно и виджеты не создаются, поэтому дисплей не нужен.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "arena_resource.h"
+#include "html_document.h"
+#include "html_tokenizer.h"
+#include "layout_engine.h"
+#include "logger.h"
+#include "simple_html_renderer.h"
+
+// FFI интерфейсы для Rust
+extern "C" {
+    HtmlParser* html_parse_new();
+    void html_parse_free(HtmlParser* parser);
+    bool html_parse_bytes(HtmlParser* parser, const uint8_t* data, size_t len);
+}
+
+#ifndef HEAVENLY_BENCH_CORPUS
+#define HEAVENLY_BENCH_CORPUS "bench/corpus"
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Не меньше MIN_SAMPLES прогонов и не меньше TARGET_TIME на случай;
+    // MAX_SAMPLES ограничивает быстрые случаи на малой странице
+    constexpr size_t WARMUP_RUNS = 2;
+    constexpr size_t MIN_SAMPLES = 10;
+    constexpr size_t MAX_SAMPLES = 200;
+    constexpr double TARGET_TIME = 1.0;
+
+    constexpr size_t LARGE_PAGE_SIZE = 5 * 1024 * 1024;
+    constexpr float LAYOUT_WIDTH = 1024.0f;
+
+    struct Corpus {
+        std::string name;
+        std::string html;
+    };
+
+    struct Result {
+        std::string name;
+        std::string corpus;
+        size_t bytes;
+        size_t samples;
+        double p50;
+        double p99;
+    };
+
+    // Один прогон возвращает свое время в секундах: подготовка
+    // (например, разбор перед раскладкой) в замер не входит
+    using Run = std::function<double(const std::string& html)>;
+
+    struct Case {
+        const char* name;
+        Run run;
+    };
+
+    template <typename F>
+    double timed(F&& body) {
+        auto start = Clock::now();
+        body();
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    std::unique_ptr<HtmlDocument> parse_document(const std::string& html) {
+        HtmlParser* parser = html_parse_new();
+        if (!parser) {
+            return nullptr;
+        }
+        std::unique_ptr<HtmlDocument> document;
+        if (html_parse_bytes(parser, reinterpret_cast<const uint8_t*>(html.data()), html.size())) {
+            document = HtmlDocument::from_parser(parser);
+        }
+        html_parse_free(parser);
+        return document;
+    }
+
+    std::vector<Case> make_cases() {
+        std::vector<Case> cases;
+
+        cases.push_back({"tokenize", [](const std::string& html) {
+            size_t count = 0;
+            double time = timed([&] {
+                HtmlTokenizer tokenizer(html);
+                HtmlToken token;
+                while (tokenizer.next(token)) {
+                    count++;
+                }
+            });
+            if (count == 0) {
+                std::fprintf(stderr, "tokenize: нет токенов\n");
+            }
+            return time;
+        }});
+
+        cases.push_back({"rust_parse", [](const std::string& html) {
+            HtmlParser* parser = html_parse_new();
+            double time = timed([&] {
+                html_parse_bytes(parser, reinterpret_cast<const uint8_t*>(html.data()), html.size());
+            });
+            html_parse_free(parser);
+            return time;
+        }});
+
+        // Снимок строится вместе с каскадом стилей - как в DocumentPipeline
+        cases.push_back({"ffi_snapshot", [](const std::string& html) {
+            HtmlParser* parser = html_parse_new();
+            html_parse_bytes(parser, reinterpret_cast<const uint8_t*>(html.data()), html.size());
+            std::unique_ptr<HtmlDocument> document;
+            double time = timed([&] {
+                document = HtmlDocument::from_parser(parser);
+            });
+            html_parse_free(parser);
+            return time;
+        }});
+
+        cases.push_back({"parse_to_document", [](const std::string& html) {
+            std::unique_ptr<HtmlDocument> document;
+            return timed([&] {
+                document = parse_document(html);
+            });
+        }});
+
+        // parse_html останавливается на MAX_ELEMENTS элементах: это цена
+        // первого экрана, МБ/с здесь не пропускная способность
+        cases.push_back({"simple_parse", [](const std::string& html) {
+            SimpleHtmlRenderer renderer;
+            return timed([&] {
+                renderer.parse_html(html);
+            });
+        }});
+
+        // Первая раскладка страницы: свежий движок (кэш ширин пуст)
+        // и список отображения на арене, как у PageView
+        cases.push_back({"layout", [](const std::string& html) {
+            std::unique_ptr<HtmlDocument> document = parse_document(html);
+            if (!document) {
+                std::fprintf(stderr, "layout: документ не разобран\n");
+                return 0.0;
+            }
+            ApproximateMetrics metrics;
+            ArenaResource arena;
+            double time = timed([&] {
+                LayoutEngine engine(metrics);
+                DisplayList display_list(&arena);
+                engine.layout(*document, LAYOUT_WIDTH, display_list);
+            });
+            return time;
+        }});
+
+        return cases;
+    }
+
+    bool read_file(const std::string& path, std::string& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        out = buffer.str();
+        return true;
+    }
+
+    // Большая страница собирается из тела средней: ~5 МБ в репозитории
+    // не храним, а разметка остается той же по составу
+    std::string make_large_page(const std::string& medium) {
+        size_t body_open = medium.find("<body");
+        size_t body_start = body_open == std::string::npos ? std::string::npos : medium.find('>', body_open);
+        size_t body_end = medium.rfind("</body>");
+        if (body_start == std::string::npos || body_end == std::string::npos || body_end <= body_start) {
+            return std::string();
+        }
+        body_start++;
+
+        std::string_view head(medium.data(), body_start);
+        std::string_view body(medium.data() + body_start, body_end - body_start);
+        std::string_view tail(medium.data() + body_end, medium.size() - body_end);
+
+        std::string page;
+        page.reserve(LARGE_PAGE_SIZE + medium.size());
+        page.append(head);
+        while (page.size() + tail.size() < LARGE_PAGE_SIZE) {
+            page.append(body);
+        }
+        page.append(tail);
+        return page;
+    }
+
+    bool load_corpus(const std::string& dir, std::vector<Corpus>& corpus) {
+        std::string small;
+        std::string medium;
+        if (!read_file(dir + "/small.html", small) || !read_file(dir + "/medium.html", medium)) {
+            std::fprintf(stderr, "Не найден корпус в %s\n", dir.c_str());
+            return false;
+        }
+        std::string large = make_large_page(medium);
+        if (large.empty()) {
+            std::fprintf(stderr, "medium.html без <body>: большая страница не собрана\n");
+            return false;
+        }
+        corpus.push_back({"small", std::move(small)});
+        corpus.push_back({"medium", std::move(medium)});
+        corpus.push_back({"large", std::move(large)});
+        return true;
+    }
+
+    // Ранговый перцентиль по отсортированной выборке
+    double percentile(const std::vector<double>& sorted, double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    Result measure(const Case& bench_case, const Corpus& corpus) {
+        for (size_t i = 0; i < WARMUP_RUNS; i++) {
+            bench_case.run(corpus.html);
+        }
+
+        std::vector<double> samples;
+        double total = 0.0;
+        while (samples.size() < MAX_SAMPLES && (samples.size() < MIN_SAMPLES || total < TARGET_TIME)) {
+            double time = bench_case.run(corpus.html);
+            samples.push_back(time);
+            total += time;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        return Result{bench_case.name, corpus.name, corpus.html.size(), samples.size(),
+                      percentile(samples, 0.50), percentile(samples, 0.99)};
+    }
+
+    double megabytes_per_second(const Result& result) {
+        return result.p50 > 0.0 ? result.bytes / (1024.0 * 1024.0) / result.p50 : 0.0;
+    }
+
+    void print_table(const std::vector<Result>& results) {
+        std::printf("%-18s %-7s %10s %8s %11s %11s %10s\n",
+                    "case", "corpus", "bytes", "samples", "p50, ms", "p99, ms", "MB/s");
+        for (const Result& result : results) {
+            std::printf("%-18s %-7s %10zu %8zu %11.3f %11.3f %10.1f\n",
+                        result.name.c_str(), result.corpus.c_str(), result.bytes, result.samples,
+                        result.p50 * 1000.0, result.p99 * 1000.0, megabytes_per_second(result));
+        }
+    }
+
+    void print_json(const std::vector<Result>& results) {
+        std::printf("[");
+        for (size_t i = 0; i < results.size(); i++) {
+            const Result& result = results[i];
+            std::printf("%s\n  {\"case\":\"%s\",\"corpus\":\"%s\",\"bytes\":%zu,\"samples\":%zu,"
+                        "\"p50_ms\":%.4f,\"p99_ms\":%.4f,\"mb_per_s\":%.2f}",
+                        i ? "," : "", result.name.c_str(), result.corpus.c_str(), result.bytes,
+                        result.samples, result.p50 * 1000.0, result.p99 * 1000.0,
+                        megabytes_per_second(result));
+        }
+        std::printf("\n]\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string filter;
+    std::string corpus_dir = HEAVENLY_BENCH_CORPUS;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (std::strcmp(argv[i], "--corpus") == 0 && i + 1 < argc) {
+            corpus_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else {
+            std::fprintf(stderr, "Использование: %s [--filter подстрока] [--corpus каталог] [--json]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Corpus> corpus;
+    if (!load_corpus(corpus_dir, corpus)) {
+        return 1;
+    }
+
+    // Отладочные записи рендереров на время замеров не нужны: остаются
+    // только предупреждения и ошибки
+    logging::set_level(LogLevel::Warn);
+
+    std::vector<Result> results;
+    for (const Case& bench_case : make_cases()) {
+        for (const Corpus& page : corpus) {
+            std::string full_name = std::string(bench_case.name) + "/" + page.name;
+            if (!filter.empty() && full_name.find(filter) == std::string::npos) {
+                continue;
+            }
+            if (!json) {
+                std::fprintf(stderr, "%s...\n", full_name.c_str());
+            }
+            results.push_back(measure(bench_case, page));
+        }
+    }
+
+    logging::flush();
+
+    if (json) {
+        print_json(results);
+    } else {
+        print_table(results);
+    }
+    return 0;
+}
@@ -1,10 +1,412 @@
 #include "memory.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+// Заголовок перед каждым учтенным блоком: данные начинаются через offset
+// байт от начала выделенного блока, заголовок - последние 16 байт перед ними
+typedef struct {
+    size_t size;
+    uint32_t offset;
+    uint16_t tab;
+    uint8_t subsystem;
+    uint8_t magic;
+} AllocationHeader;
+
+#define ALLOCATION_HEADER_SIZE 16
+#define ALLOCATION_MAGIC 0xA5
+
+_Static_assert(sizeof(AllocationHeader) == ALLOCATION_HEADER_SIZE, "заголовок должен занимать 16 байт");
+
+// Каждый набор счетчиков в своей кэш-линии: потоки, работающие на разные
+// подсистемы, не мешают друг другу
+typedef struct {
+    _Alignas(64) atomic_size_t live_bytes;
+    atomic_size_t peak_bytes;
+    atomic_uint_fast64_t allocations;
+    atomic_uint_fast64_t frees;
+} AtomicCounters;
+
+static AtomicCounters subsystem_counters[MEMORY_SUBSYSTEM_COUNT];
+static AtomicCounters tab_counters[MEMORY_MAX_TABS];
+static AtomicCounters total_counters;
+static atomic_bool tab_open[MEMORY_MAX_TABS];
+
+static _Thread_local uint8_t thread_subsystem = MEMORY_OTHER;
+static _Thread_local uint16_t thread_tab = MEMORY_NO_TAB;
+
+static void counters_add(AtomicCounters* counters, size_t size) {
+    size_t live = atomic_fetch_add_explicit(&counters->live_bytes, size, memory_order_relaxed) + size;
+    atomic_fetch_add_explicit(&counters->allocations, 1, memory_order_relaxed);
+
+    size_t peak = atomic_load_explicit(&counters->peak_bytes, memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&counters->peak_bytes, &peak, live,
+                                                  memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+static void counters_sub(AtomicCounters* counters, size_t size) {
+    atomic_fetch_sub_explicit(&counters->live_bytes, size, memory_order_relaxed);
+    atomic_fetch_add_explicit(&counters->frees, 1, memory_order_relaxed);
+}
+
+static void counters_load(AtomicCounters* counters, MemoryCounters* out) {
+    out->live_bytes = atomic_load_explicit(&counters->live_bytes, memory_order_relaxed);
+    out->peak_bytes = atomic_load_explicit(&counters->peak_bytes, memory_order_relaxed);
+    out->allocations = atomic_load_explicit(&counters->allocations, memory_order_relaxed);
+    out->frees = atomic_load_explicit(&counters->frees, memory_order_relaxed);
+}
+
+static void account_alloc(const AllocationHeader* header) {
+    counters_add(&subsystem_counters[header->subsystem], header->size);
+    counters_add(&tab_counters[header->tab], header->size);
+    counters_add(&total_counters, header->size);
+}
+
+static void account_free(const AllocationHeader* header) {
+    counters_sub(&subsystem_counters[header->subsystem], header->size);
+    counters_sub(&tab_counters[header->tab], header->size);
+    counters_sub(&total_counters, header->size);
+}
+
+static AllocationHeader* header_of(const void* ptr) {
+    return (AllocationHeader*)((uintptr_t)ptr - ALLOCATION_HEADER_SIZE);
+}
+
+void memory_set_thread_tags(MemorySubsystem subsystem, unsigned tab) {
+    thread_subsystem = (unsigned)subsystem < MEMORY_SUBSYSTEM_COUNT ? (uint8_t)subsystem : MEMORY_OTHER;
+    thread_tab = tab < MEMORY_MAX_TABS ? (uint16_t)tab : MEMORY_NO_TAB;
+}
+
+void memory_get_thread_tags(MemorySubsystem* subsystem, unsigned* tab) {
+    if (subsystem) {
+        *subsystem = (MemorySubsystem)thread_subsystem;
+    }
+    if (tab) {
+        *tab = thread_tab;
+    }
+}
+
+void* memory_alloc(size_t size, size_t align) {
+    size_t offset = ALLOCATION_HEADER_SIZE;
+    if (align > offset) {
+        offset = align;
+    }
+    if (size > SIZE_MAX - offset) {
+        return NULL;
+    }
+
+    void* block;
+    if (offset == ALLOCATION_HEADER_SIZE) {
+        block = malloc(size + offset);
+    } else {
+        // aligned_alloc требует размер, кратный выравниванию
+        size_t total = size + offset;
+        if (total > SIZE_MAX - (offset - 1)) {
+            return NULL;
+        }
+        block = aligned_alloc(offset, (total + offset - 1) & ~(offset - 1));
+    }
+    if (!block) {
+        return NULL;
+    }
+
+    void* ptr = (char*)block + offset;
+    AllocationHeader* header = header_of(ptr);
+    header->size = size;
+    header->offset = (uint32_t)offset;
+    header->tab = thread_tab;
+    header->subsystem = thread_subsystem;
+    header->magic = ALLOCATION_MAGIC;
+    account_alloc(header);
+    return ptr;
+}
+
+void* memory_realloc(void* ptr, size_t size) {
+    if (!ptr) {
+        return memory_alloc(size, 0);
+    }
+
+    AllocationHeader* header = header_of(ptr);
+    if (header->offset != ALLOCATION_HEADER_SIZE) {
+        // Выровненный блок realloc не сохранит выравнивание - копируем
+        void* moved = memory_alloc(size, header->offset);
+        if (moved) {
+            memcpy(moved, ptr, header->size < size ? header->size : size);
+            memory_free(ptr);
+        }
+        return moved;
+    }
+    if (size > SIZE_MAX - ALLOCATION_HEADER_SIZE) {
+        return NULL;
+    }
+
+    // Блок остается за теми же метками, что и при первом выделении
+    AllocationHeader old = *header;
+    void* block = realloc((char*)ptr - ALLOCATION_HEADER_SIZE, size + ALLOCATION_HEADER_SIZE);
+    if (!block) {
+        return NULL;
+    }
+    account_free(&old);
+
+    ptr = (char*)block + ALLOCATION_HEADER_SIZE;
+    header = header_of(ptr);
+    header->size = size;
+    account_alloc(header);
+    return ptr;
+}
+
+void memory_free(void* ptr) {
+    if (!ptr) {
+        return;
+    }
+    AllocationHeader* header = header_of(ptr);
+    account_free(header);
+    free((char*)ptr - header->offset);
+}
+
+size_t memory_allocation_size(const void* ptr) {
+    return ptr ? header_of(ptr)->size : 0;
+}
+
+static void external_header(MemorySubsystem subsystem, unsigned tab, size_t size, AllocationHeader* header) {
+    header->size = size;
+    header->offset = 0;
+    header->tab = tab < MEMORY_MAX_TABS ? (uint16_t)tab : MEMORY_NO_TAB;
+    header->subsystem = (unsigned)subsystem < MEMORY_SUBSYSTEM_COUNT ? (uint8_t)subsystem : MEMORY_OTHER;
+    header->magic = ALLOCATION_MAGIC;
+}
+
+void memory_charge(MemorySubsystem subsystem, unsigned tab, size_t size) {
+    AllocationHeader header;
+    external_header(subsystem, tab, size, &header);
+    account_alloc(&header);
+}
+
+void memory_uncharge(MemorySubsystem subsystem, unsigned tab, size_t size) {
+    AllocationHeader header;
+    external_header(subsystem, tab, size, &header);
+    account_free(&header);
+}
+
+int memory_get_subsystem_counters(MemorySubsystem subsystem, MemoryCounters* counters) {
+    if ((unsigned)subsystem >= MEMORY_SUBSYSTEM_COUNT || !counters) {
+        return 0;
+    }
+    counters_load(&subsystem_counters[subsystem], counters);
+    return 1;
+}
+
+int memory_get_tab_counters(unsigned tab, MemoryCounters* counters) {
+    if (tab >= MEMORY_MAX_TABS || !counters) {
+        return 0;
+    }
+    counters_load(&tab_counters[tab], counters);
+    return 1;
+}
+
+void memory_get_total_counters(MemoryCounters* counters) {
+    if (counters) {
+        counters_load(&total_counters, counters);
+    }
+}
+
+unsigned memory_tab_open(void) {
+    for (unsigned tab = 1; tab < MEMORY_MAX_TABS; tab++) {
+        bool expected = false;
+        if (atomic_compare_exchange_strong(&tab_open[tab], &expected, true)) {
+            // Живые байты закрытой вкладки еще могут освобождаться - их не трогаем
+            AtomicCounters* counters = &tab_counters[tab];
+            atomic_store_explicit(&counters->peak_bytes,
+                                  atomic_load_explicit(&counters->live_bytes, memory_order_relaxed),
+                                  memory_order_relaxed);
+            atomic_store_explicit(&counters->allocations, 0, memory_order_relaxed);
+            atomic_store_explicit(&counters->frees, 0, memory_order_relaxed);
+            return tab;
+        }
+    }
+    return MEMORY_NO_TAB;
+}
+
+void memory_tab_close(unsigned tab) {
+    if (tab != MEMORY_NO_TAB && tab < MEMORY_MAX_TABS) {
+        atomic_store(&tab_open[tab], false);
+    }
+}
+
+int memory_tab_is_open(unsigned tab) {
+    return tab < MEMORY_MAX_TABS && atomic_load(&tab_open[tab]);
+}
 
 void* custom_malloc(size_t size) {
-    return malloc(size);
+    return memory_alloc(size, 0);
 }
 
 void custom_free(void* ptr) {
-    free(ptr);
+    memory_free(ptr);
+}
+
+// Заголовок блока; данные идут сразу за ним
+typedef struct ArenaBlock {
+    struct ArenaBlock* next;
+    size_t size;
+} ArenaBlock;
+
+struct MemoryArena {
+    // Текущий блок - первый в списке
+    ArenaBlock* blocks;
+    // Свободная часть текущего блока
+    uintptr_t cursor;
+    uintptr_t limit;
+    // Размер следующего обычного блока
+    size_t next_block_size;
+    ArenaStats stats;
+};
+
+static uintptr_t block_data(ArenaBlock* block) {
+    return (uintptr_t)(block + 1);
+}
+
+static uintptr_t align_up(uintptr_t value, size_t align) {
+    return (value + (align - 1)) & ~(uintptr_t)(align - 1);
+}
+
+static ArenaBlock* arena_new_block(MemoryArena* arena, size_t size) {
+    ArenaBlock* block = (ArenaBlock*)memory_alloc(sizeof(ArenaBlock) + size, 0);
+    if (!block) {
+        return NULL;
+    }
+    block->size = size;
+    arena->stats.bytes_reserved += size;
+    arena->stats.block_count++;
+    return block;
+}
+
+// Делает блок текущим
+static void arena_push_block(MemoryArena* arena, ArenaBlock* block) {
+    block->next = arena->blocks;
+    arena->blocks = block;
+    arena->cursor = block_data(block);
+    arena->limit = block_data(block) + block->size;
+}
+
+static void arena_account(MemoryArena* arena, size_t size) {
+    arena->stats.bytes_used += size;
+    arena->stats.allocation_count++;
+    if (arena->stats.bytes_used > arena->stats.peak_bytes_used) {
+        arena->stats.peak_bytes_used = arena->stats.bytes_used;
+    }
+}
+
+MemoryArena* arena_create(size_t block_size) {
+    MemoryArena* arena = (MemoryArena*)calloc(1, sizeof(MemoryArena));
+    if (!arena) {
+        return NULL;
+    }
+    arena->next_block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK_SIZE;
+    // Первый блок выделяется при первом запросе: пустая арена ничего не стоит
+    return arena;
+}
+
+void arena_destroy(MemoryArena* arena) {
+    if (!arena) {
+        return;
+    }
+    ArenaBlock* block = arena->blocks;
+    while (block) {
+        ArenaBlock* next = block->next;
+        memory_free(block);
+        block = next;
+    }
+    free(arena);
+}
+
+void* arena_alloc(MemoryArena* arena, size_t size, size_t align) {
+    if (!arena) {
+        return NULL;
+    }
+    if (align < sizeof(void*)) {
+        align = sizeof(void*);
+    }
+    if (size == 0) {
+        size = 1;
+    }
+
+    uintptr_t start = align_up(arena->cursor, align);
+    if (!arena->blocks || start + size > arena->limit) {
+        // С запасом на выравнивание начала данных блока
+        size_t needed = size + align;
+
+        if (needed > arena->next_block_size) {
+            // Крупный запрос получает отдельный блок. Он ставится за текущим,
+            // чтобы не терять остаток текущего блока
+            ArenaBlock* block = arena_new_block(arena, needed);
+            if (!block) {
+                return NULL;
+            }
+            if (arena->blocks) {
+                block->next = arena->blocks->next;
+                arena->blocks->next = block;
+                arena_account(arena, size);
+                return (void*)align_up(block_data(block), align);
+            }
+            arena_push_block(arena, block);
+        } else {
+            ArenaBlock* block = arena_new_block(arena, arena->next_block_size);
+            if (!block) {
+                return NULL;
+            }
+            if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE) {
+                arena->next_block_size *= 2;
+            }
+            arena_push_block(arena, block);
+        }
+        start = align_up(arena->cursor, align);
+    }
+
+    arena->cursor = start + size;
+    arena_account(arena, size);
+    return (void*)start;
+}
+
+void arena_reset(MemoryArena* arena) {
+    if (!arena || !arena->blocks) {
+        return;
+    }
+
+    ArenaBlock* largest = arena->blocks;
+    for (ArenaBlock* block = arena->blocks->next; block; block = block->next) {
+        if (block->size > largest->size) {
+            largest = block;
+        }
+    }
+
+    ArenaBlock* block = arena->blocks;
+    while (block) {
+        ArenaBlock* next = block->next;
+        if (block != largest) {
+            memory_free(block);
+        }
+        block = next;
+    }
+
+    largest->next = NULL;
+    arena->blocks = largest;
+    arena->cursor = block_data(largest);
+    arena->limit = block_data(largest) + largest->size;
+
+    arena->stats.bytes_used = 0;
+    arena->stats.allocation_count = 0;
+    arena->stats.bytes_reserved = largest->size;
+    arena->stats.block_count = 1;
+}
+
+void arena_get_stats(const MemoryArena* arena, ArenaStats* stats) {
+    if (!arena || !stats) {
+        return;
+    }
+    *stats = arena->stats;
 }
@@ -2,14 +2,107 @@
 #define MEMORY_H
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Учет памяти. Каждое выделение через memory_alloc помечается подсистемой
+// и вкладкой текущего потока; метки хранятся в заголовке блока, поэтому
+// освобождение из другого потока списывается туда же, где выделялось.
+// Тот же набор меток использует счетный аллокатор Rust (src/rust/src/memory.rs):
+// номера подсистем должны совпадать.
+typedef enum {
+    MEMORY_OTHER = 0,
+    MEMORY_NETWORK,
+    MEMORY_PARSER,
+    MEMORY_RENDERER,
+    MEMORY_CACHE,
+    MEMORY_IMAGES,
+    MEMORY_SUBSYSTEM_COUNT
+} MemorySubsystem;
+
+// Вкладка 0 - память самого браузера, не относящаяся ни к одной вкладке
+#define MEMORY_NO_TAB 0
+#define MEMORY_MAX_TABS 64
+
+typedef struct {
+    size_t live_bytes;
+    size_t peak_bytes;
+    uint64_t allocations;
+    uint64_t frees;
+} MemoryCounters;
+
+// Метки текущего потока для следующих выделений
+void memory_set_thread_tags(MemorySubsystem subsystem, unsigned tab);
+void memory_get_thread_tags(MemorySubsystem* subsystem, unsigned* tab);
+
+// Выделение с учетом; освобождать только memory_free.
+// align - степень двойки, 0 - обычное выравнивание malloc
+void* memory_alloc(size_t size, size_t align);
+void* memory_realloc(void* ptr, size_t size);
+void memory_free(void* ptr);
+// Размер, запрошенный при выделении
+size_t memory_allocation_size(const void* ptr);
+
+// Память чужого аллокатора (например, пиксели GdkPixbuf из g_malloc),
+// которую нужно видеть в счетчиках: memory_charge при получении,
+// memory_uncharge с теми же метками и размером при освобождении
+void memory_charge(MemorySubsystem subsystem, unsigned tab, size_t size);
+void memory_uncharge(MemorySubsystem subsystem, unsigned tab, size_t size);
+
+// Счетчики выделений C и C++; false - неверный номер
+int memory_get_subsystem_counters(MemorySubsystem subsystem, MemoryCounters* counters);
+int memory_get_tab_counters(unsigned tab, MemoryCounters* counters);
+void memory_get_total_counters(MemoryCounters* counters);
+
+// Номер для новой вкладки (1..MEMORY_MAX_TABS-1), 0 - свободных нет.
+// Номера закрытых вкладок переиспользуются, пик и число выделений при
+// этом начинаются заново
+unsigned memory_tab_open(void);
+void memory_tab_close(unsigned tab);
+int memory_tab_is_open(unsigned tab);
+
+// memory_alloc/memory_free с выравниванием malloc
 void* custom_malloc(size_t size);
 void custom_free(void* ptr);
 
+// Арена (bump-аллокатор): память выдается сдвигом указателя внутри
+// крупных блоков и освобождается только вся сразу. Подходит для данных
+// с общим временем жизни - например, всего, что относится к одной
+// загруженной странице. Не потокобезопасна.
+typedef struct MemoryArena MemoryArena;
+
+typedef struct {
+    // Выдано вызывающим (с учетом выравнивания)
+    size_t bytes_used;
+    // Занято блоками у системы
+    size_t bytes_reserved;
+    // Максимум bytes_used с момента создания
+    size_t peak_bytes_used;
+    size_t allocation_count;
+    size_t block_count;
+} ArenaStats;
+
+// block_size - размер первого блока, 0 - по умолчанию. Следующие блоки
+// растут вдвое до ARENA_MAX_BLOCK_SIZE; запросы крупнее блока получают
+// отдельный блок
+#define ARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+#define ARENA_MAX_BLOCK_SIZE (4 * 1024 * 1024)
+
+MemoryArena* arena_create(size_t block_size);
+void arena_destroy(MemoryArena* arena);
+
+// align - степень двойки; NULL только при нехватке памяти
+void* arena_alloc(MemoryArena* arena, size_t size, size_t align);
+
+// Забывает все выданное. Самый большой блок остается для повторного
+// использования, остальные возвращаются системе
+void arena_reset(MemoryArena* arena);
+
+void arena_get_stats(const MemoryArena* arena, ArenaStats* stats);
+
 #ifdef __cplusplus
 }
 #endif
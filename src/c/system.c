@@ -1,9 +1,14 @@
 #include "system.h"
+#include "memory.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <errno.h>
 #ifdef __linux__
 #include <sys/sysinfo.h>
 #elif defined(__APPLE__)
@@ -62,7 +67,7 @@ void print_system_info(const SystemInfo* info) {
 void* safe_malloc(size_t size) {
     if (size == 0) return NULL;
     
-    void* ptr = malloc(size);
+    void* ptr = memory_alloc(size, 0);
     if (ptr == NULL) {
         fprintf(stderr, "Ошибка выделения памяти: %zu байт\n", size);
         exit(1);
@@ -73,21 +78,22 @@ void* safe_malloc(size_t size) {
 void* safe_calloc(size_t nmemb, size_t size) {
     if (nmemb == 0 || size == 0) return NULL;
     
-    void* ptr = calloc(nmemb, size);
+    void* ptr = nmemb <= SIZE_MAX / size ? memory_alloc(nmemb * size, 0) : NULL;
     if (ptr == NULL) {
         fprintf(stderr, "Ошибка выделения памяти: %zu x %zu байт\n", nmemb, size);
         exit(1);
     }
+    memset(ptr, 0, nmemb * size);
     return ptr;
 }
 
 void* safe_realloc(void* ptr, size_t size) {
     if (size == 0) {
-        free(ptr);
+        memory_free(ptr);
         return NULL;
     }
     
-    void* new_ptr = realloc(ptr, size);
+    void* new_ptr = memory_realloc(ptr, size);
     if (new_ptr == NULL) {
         fprintf(stderr, "Ошибка изменения размера памяти: %zu байт\n", size);
         exit(1);
@@ -97,7 +103,7 @@ void* safe_realloc(void* ptr, size_t size) {
 
 void safe_free(void* ptr) {
     if (ptr != NULL) {
-        free(ptr);
+        memory_free(ptr);
     }
 }
 
@@ -153,6 +159,95 @@ int write_file(const char* path, const char* data, size_t size) {
     return (bytes_written == size) ? 0 : -1;
 }
 
+int write_file_atomic(const char* path, const char* data, size_t size) {
+    // Имя временного файла уникально и между потоками процесса: два потока,
+    // пишущие один путь, не должны делить один временный файл
+    static atomic_uint tmp_counter;
+    unsigned serial = atomic_fetch_add(&tmp_counter, 1);
+    size_t path_len = strlen(path);
+    char* tmp_path = (char*)safe_malloc(path_len + 48);
+    snprintf(tmp_path, path_len + 48, "%s.tmp.%d.%u", path, (int)getpid(), serial);
+    
+    int result = write_file(tmp_path, data, size);
+    if (result == 0 && rename(tmp_path, path) != 0) {
+        result = -1;
+    }
+    if (result != 0) {
+        unlink(tmp_path);
+    }
+    
+    safe_free(tmp_path);
+    return result;
+}
+
+int make_directories(const char* path) {
+    size_t path_len = strlen(path);
+    if (path_len == 0) {
+        return -1;
+    }
+    char* buffer = (char*)safe_malloc(path_len + 1);
+    memcpy(buffer, path, path_len + 1);
+    
+    // Создаем каждый префикс пути по очереди
+    for (char* p = buffer + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char saved = *p;
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                safe_free(buffer);
+                return -1;
+            }
+            *p = saved;
+            if (saved == '\0') {
+                break;
+            }
+        }
+    }
+    
+    safe_free(buffer);
+    return 0;
+}
+
+int map_file(const char* path, MappedFile* mapped) {
+    mapped->data = NULL;
+    mapped->size = 0;
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    
+    void* data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // Отображение остается валидным и после закрытия дескриптора
+    close(fd);
+    if (data == MAP_FAILED) {
+        return -1;
+    }
+    
+    mapped->data = data;
+    mapped->size = (size_t)st.st_size;
+    return 0;
+}
+
+void unmap_file(MappedFile* mapped) {
+    if (mapped->data) {
+        munmap((void*)mapped->data, mapped->size);
+    }
+    mapped->data = NULL;
+    mapped->size = 0;
+}
+
 int get_process_id(void) {
     return getpid();
 }
@@ -22,7 +22,7 @@ typedef struct {
 SystemInfo get_system_info(void);
 void print_system_info(const SystemInfo* info);
 
-// Функции для работы с памятью
+// Функции для работы с памятью: учитываются (см. memory.h), освобождать только safe_free
 void* safe_malloc(size_t size);
 void* safe_calloc(size_t nmemb, size_t size);
 void* safe_realloc(void* ptr, size_t size);
@@ -34,6 +34,21 @@ size_t file_size(const char* path);
 int read_file(const char* path, char** buffer, size_t* size);
 int write_file(const char* path, const char* data, size_t size);
 
+// Запись через временный файл и rename: читатели видят либо старое, либо новое содержимое
+int write_file_atomic(const char* path, const char* data, size_t size);
+// Создает каталог вместе с недостающими родителями (как mkdir -p)
+int make_directories(const char* path);
+
+// Файл, отображенный в память только для чтения
+typedef struct {
+    const void* data;
+    size_t size;
+} MappedFile;
+
+// Отображает файл целиком; для пустого файла data = NULL, size = 0
+int map_file(const char* path, MappedFile* mapped);
+void unmap_file(MappedFile* mapped);
+
 // Функции для работы с процессами
 int get_process_id(void);
 int get_thread_id(void);
@@ -0,0 +1,184 @@
+#include "trace.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Кольцо событий одного потока. Мьютекс кольца берет только сам поток
+// и экспорт, поэтому при записи он почти всегда свободен
+typedef struct TraceRing {
+    pthread_mutex_t lock;
+    // Всего записано с последней очистки; позиция записи - written % емкость
+    uint64_t written;
+    uint32_t tid;
+    char thread_name[32];
+    // Поток завершился: кольцо хранит его события до следующей очистки
+    atomic_bool thread_alive;
+    struct TraceRing* next;
+    TraceEvent events[TRACE_RING_CAPACITY];
+} TraceRing;
+
+static atomic_int trace_enabled_flag;
+static atomic_uint next_tid = 1;
+
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing* rings;
+
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t ring_key;
+
+static _Thread_local TraceRing* thread_ring;
+static _Thread_local uint64_t thread_navigation = TRACE_NO_NAVIGATION;
+static _Thread_local char pending_thread_name[32];
+
+static void ring_thread_exit(void* ring) {
+    atomic_store_explicit(&((TraceRing*)ring)->thread_alive, 0, memory_order_release);
+}
+
+static void create_ring_key(void) {
+    pthread_key_create(&ring_key, ring_thread_exit);
+}
+
+// Кольцо текущего потока, создается при первой записи. Память колец не
+// учитывается в memory.h: трасса не относится ни к одной вкладке
+static TraceRing* current_ring(void) {
+    if (thread_ring) {
+        return thread_ring;
+    }
+
+    TraceRing* ring = calloc(1, sizeof(TraceRing));
+    if (!ring) {
+        return NULL;
+    }
+    pthread_mutex_init(&ring->lock, NULL);
+    ring->tid = atomic_fetch_add_explicit(&next_tid, 1, memory_order_relaxed);
+    if (pending_thread_name[0]) {
+        memcpy(ring->thread_name, pending_thread_name, sizeof(ring->thread_name));
+    } else {
+        snprintf(ring->thread_name, sizeof(ring->thread_name), "thread-%u", ring->tid);
+    }
+    atomic_init(&ring->thread_alive, 1);
+
+    pthread_once(&ring_key_once, create_ring_key);
+    pthread_setspecific(ring_key, ring);
+
+    pthread_mutex_lock(&rings_lock);
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_lock);
+
+    thread_ring = ring;
+    return ring;
+}
+
+void trace_set_enabled(int enabled) {
+    atomic_store_explicit(&trace_enabled_flag, enabled ? 1 : 0, memory_order_relaxed);
+}
+
+int trace_is_enabled(void) {
+    return atomic_load_explicit(&trace_enabled_flag, memory_order_relaxed);
+}
+
+uint64_t trace_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+uint32_t trace_thread_id(void) {
+    TraceRing* ring = current_ring();
+    return ring ? ring->tid : 0;
+}
+
+void trace_set_thread_name(const char* name) {
+    strncpy(pending_thread_name, name, sizeof(pending_thread_name) - 1);
+    pending_thread_name[sizeof(pending_thread_name) - 1] = '\0';
+
+    if (thread_ring) {
+        pthread_mutex_lock(&thread_ring->lock);
+        memcpy(thread_ring->thread_name, pending_thread_name, sizeof(thread_ring->thread_name));
+        pthread_mutex_unlock(&thread_ring->lock);
+    }
+}
+
+void trace_set_navigation(uint64_t navigation) {
+    thread_navigation = navigation;
+}
+
+uint64_t trace_get_navigation(void) {
+    return thread_navigation;
+}
+
+void trace_record_navigation(const char* name, const char* category, uint64_t start_ns,
+                             uint64_t end_ns, uint64_t navigation, uint64_t bytes) {
+    if (!trace_is_enabled()) {
+        return;
+    }
+    TraceRing* ring = current_ring();
+    if (!ring) {
+        return;
+    }
+
+    pthread_mutex_lock(&ring->lock);
+    TraceEvent* event = &ring->events[ring->written % TRACE_RING_CAPACITY];
+    event->name = name;
+    event->category = category;
+    event->start_ns = start_ns;
+    event->duration_ns = end_ns > start_ns ? end_ns - start_ns : 0;
+    event->navigation = navigation;
+    event->bytes = bytes;
+    ring->written++;
+    pthread_mutex_unlock(&ring->lock);
+}
+
+void trace_record(const char* name, const char* category, uint64_t start_ns, uint64_t end_ns,
+                  uint64_t bytes) {
+    trace_record_navigation(name, category, start_ns, end_ns, thread_navigation, bytes);
+}
+
+size_t trace_collect(TraceThreadFn visit_thread, TraceVisitFn visit_event, void* user_data) {
+    size_t count = 0;
+
+    pthread_mutex_lock(&rings_lock);
+    for (TraceRing* ring = rings; ring; ring = ring->next) {
+        pthread_mutex_lock(&ring->lock);
+        uint64_t first = ring->written > TRACE_RING_CAPACITY ? ring->written - TRACE_RING_CAPACITY : 0;
+        TraceThreadInfo info = {ring->tid, ring->thread_name, first};
+
+        if (visit_thread) {
+            visit_thread(&info, user_data);
+        }
+        for (uint64_t i = first; i < ring->written; i++) {
+            if (visit_event) {
+                visit_event(&info, &ring->events[i % TRACE_RING_CAPACITY], user_data);
+            }
+            count++;
+        }
+        pthread_mutex_unlock(&ring->lock);
+    }
+    pthread_mutex_unlock(&rings_lock);
+
+    return count;
+}
+
+void trace_clear(void) {
+    pthread_mutex_lock(&rings_lock);
+    TraceRing** link = &rings;
+    while (*link) {
+        TraceRing* ring = *link;
+        // Кольца завершившихся потоков больше никто не заполнит
+        if (!atomic_load_explicit(&ring->thread_alive, memory_order_acquire)) {
+            *link = ring->next;
+            pthread_mutex_destroy(&ring->lock);
+            free(ring);
+            continue;
+        }
+        pthread_mutex_lock(&ring->lock);
+        ring->written = 0;
+        pthread_mutex_unlock(&ring->lock);
+        link = &ring->next;
+    }
+    pthread_mutex_unlock(&rings_lock);
+}
@@ -0,0 +1,79 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Трассировка этапов загрузки страницы. Каждый поток пишет завершенные
+// отрезки в свое кольцо (старые события затираются новыми), экспорт
+// собирает кольца всех потоков. Пока трассировка выключена, запись
+// стоит одной атомарной загрузки. Rust ведет такие же кольца у себя
+// (src/rust/src/trace.rs) на той же шкале времени - CLOCK_MONOTONIC.
+//
+// Имена и категории - строковые константы: кольцо хранит указатели.
+
+// Событий в кольце одного потока
+#define TRACE_RING_CAPACITY 4096
+// Без навигации: событие не относится ни к одной загрузке
+#define TRACE_NO_NAVIGATION 0
+
+typedef struct {
+    const char* name;
+    const char* category;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+    // Номер навигации, к которой относится событие
+    uint64_t navigation;
+    // Объем данных этапа (байты тела, картинки), 0 - не указан
+    uint64_t bytes;
+} TraceEvent;
+
+typedef struct {
+    uint32_t tid;
+    const char* thread_name;
+    // Затерто из-за переполнения кольца с последней очистки
+    uint64_t dropped;
+} TraceThreadInfo;
+
+void trace_set_enabled(int enabled);
+int trace_is_enabled(void);
+
+// Монотонное время в наносекундах
+uint64_t trace_now_ns(void);
+
+// Номер текущего потока в трассе (кольцо создается при первом вызове).
+// Rust записывает события этого потока под тем же номером, если C++
+// передал его через trace_rust_bind_thread
+uint32_t trace_thread_id(void);
+
+// Имя текущего потока в трассе (копируется, до 31 символа)
+void trace_set_thread_name(const char* name);
+
+// Навигация текущего потока: события без явного номера получают ее
+void trace_set_navigation(uint64_t navigation);
+uint64_t trace_get_navigation(void);
+
+// Завершенный отрезок [start_ns, end_ns) текущего потока
+void trace_record(const char* name, const char* category, uint64_t start_ns, uint64_t end_ns,
+                  uint64_t bytes);
+void trace_record_navigation(const char* name, const char* category, uint64_t start_ns,
+                             uint64_t end_ns, uint64_t navigation, uint64_t bytes);
+
+// Обход событий всех потоков; события одного потока идут по порядку записи.
+// Возвращает число событий
+typedef void (*TraceVisitFn)(const TraceThreadInfo* thread, const TraceEvent* event, void* user_data);
+typedef void (*TraceThreadFn)(const TraceThreadInfo* thread, void* user_data);
+size_t trace_collect(TraceThreadFn visit_thread, TraceVisitFn visit_event, void* user_data);
+
+// Очистить кольца всех потоков
+void trace_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,40 @@
+#include "arena_resource.h"
+#include <new>
+
+ArenaResource::ArenaResource(size_t block_size)
+    : arena(arena_create(block_size))
+{
+    if (!arena) {
+        throw std::bad_alloc();
+    }
+}
+
+ArenaResource::~ArenaResource() {
+    arena_destroy(arena);
+}
+
+void ArenaResource::reset() {
+    arena_reset(arena);
+}
+
+ArenaStats ArenaResource::stats() const {
+    ArenaStats result = {};
+    arena_get_stats(arena, &result);
+    return result;
+}
+
+void* ArenaResource::do_allocate(size_t bytes, size_t alignment) {
+    void* p = arena_alloc(arena, bytes, alignment);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void ArenaResource::do_deallocate(void*, size_t, size_t) {
+    // Память возвращается только вся сразу
+}
+
+bool ArenaResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include "memory.h"
+
+// Арена из src/c/memory.c в виде std::pmr::memory_resource: контейнеры
+// std::pmr, построенные на ней, выделяют память сдвигом указателя, а
+// освобождение отдельных объектов ничего не делает. Вся память
+// возвращается разом - при reset() или уничтожении ресурса, поэтому
+// ресурс должен пережить все контейнеры, которые им пользуются.
+// Не потокобезопасен, как и сама арена.
+class ArenaResource : public std::pmr::memory_resource {
+public:
+    explicit ArenaResource(size_t block_size = ARENA_DEFAULT_BLOCK_SIZE);
+    ~ArenaResource() override;
+
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+
+    // Все выданное становится недействительным
+    void reset();
+
+    ArenaStats stats() const;
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+private:
+    MemoryArena* arena;
+};
@@ -1,7 +1,8 @@
 #include "browser.h"
 #include "browser_styles.h"
 #include "rust_html_renderer.h"
-#include <iostream>
+#include "logger.h"
+#include <algorithm>
 #include <gtk/gtk.h>
 
 Browser::Browser() 
@@ -11,46 +12,61 @@ Browser::Browser()
     , address_bar(nullptr)
     , status_bar(nullptr)
     , content_view(nullptr)
-    , html_parser(nullptr)
     , css_parser(nullptr)
     , html_renderer(nullptr)
-    , javascript_enabled(true)
-    , cookies_enabled(true)
-    , popups_blocked(true)
-    , https_only(false)
-    , current_fetch_handle(nullptr)
-    , loading_timer_id(0)
+    , engine(nullptr)
+    , memory_tab(MEMORY_NO_TAB)
+    , pipeline(nullptr)
+    , current_stream(nullptr)
+    , first_paint_done(false)
+    , trace_navigation(TRACE_NO_NAVIGATION)
+    , navigation_start_ns(0)
+    , first_paint_traced(false)
+    , stream_event_pending(false)
 {
     // Инициализируем Rust парсеры
-    html_parser = html_parse_new();
     // css_parser = css_parse_new(); // TODO: Добавить CSS парсер
     
+    engine = new BrowserEngine();
+    
     // Инициализируем Rust HTML рендерер
     html_renderer = new RustHtmlRenderer();
+    html_renderer->set_link_handler([this](const std::string& href) {
+        // Ссылки считаются от адреса документа: после перенаправлений и <base>
+        const std::shared_ptr<const HtmlDocument>& document = html_renderer->current_document();
+        std::string base = document && !document->base_url().empty() ? document->base_url() : current_url;
+        std::string url = BrowserEngine::resolve_link(base, href);
+        if (!url.empty()) {
+            navigate(url);
+        }
+    });
     
-    user_agent = "HeavenlyWebGu/1.0 (X11; Linux x86_64) AppleWebKit/537.36";
+    pipeline = new DocumentPipeline(engine->disk_cache(), [this](const DocumentLoad& load) {
+        MemoryScope scope(MEMORY_RENDERER, memory_tab);
+        commit_document(load);
+    });
 }
 
 Browser::~Browser() {
-    // Останавливаем таймер загрузки
-    if (loading_timer_id > 0) {
-        g_source_remove(loading_timer_id);
-    }
-    
-    // Очищаем асинхронную загрузку
-    if (current_fetch_handle) {
-        // TODO: Отменить загрузку если возможно
-        current_fetch_handle = nullptr;
+    // Отменяем загрузки: после network_stream_free уведомлений больше
+    // не будет, остается снять уже запланированный обработчик
+    cancel_loading();
+    while (g_idle_remove_by_data(this)) {
     }
     
-    if (html_parser) {
-        html_parse_free(html_parser);
+    // Пул дожидается своих задач: после этого к дисковому кэшу никто не обращается
+    if (pipeline) {
+        delete pipeline;
     }
     
     if (html_renderer) {
         delete html_renderer;
     }
     
+    if (engine) {
+        delete engine;
+    }
+    
     // Очищаем GTK виджеты
     if (main_window) {
         gtk_widget_destroy(main_window);
@@ -60,7 +76,7 @@ Browser::~Browser() {
 bool Browser::initialize() {
     // Инициализируем GTK
     if (!gtk_init_check(nullptr, nullptr)) {
-        std::cerr << "Ошибка инициализации GTK" << std::endl;
+        LOG_ERROR("browser") << "Ошибка инициализации GTK";
         return false;
     }
     
@@ -149,7 +165,7 @@ void Browser::setup_ui() {
     g_signal_connect(back_button, "clicked", G_CALLBACK(on_back_clicked), this);
     g_signal_connect(forward_button, "clicked", G_CALLBACK(on_forward_clicked), this);
     g_signal_connect(reload_button, "clicked", G_CALLBACK(on_refresh_clicked), this);
-    g_signal_connect(stop_button, "clicked", G_CALLBACK(on_navigate_clicked), this);
+    g_signal_connect(stop_button, "clicked", G_CALLBACK(on_stop_clicked), this);
     g_signal_connect(navigate_button, "clicked", G_CALLBACK(on_navigate_clicked), this);
     
     // Подключаем сигнал адресной строки
@@ -172,6 +188,10 @@ void Browser::create_web_view() {
     GtkWidget* scrolled_window = gtk_scrolled_window_new(nullptr, nullptr);
     gtk_container_add(GTK_CONTAINER(scrolled_window), content_view);
     
+    // Память страниц вкладки считается под ее номером
+    memory_tab = memory_accounting::open_tab();
+    g_object_set_data(G_OBJECT(scrolled_window), "memory-tab", GUINT_TO_POINTER(memory_tab));
+    
     gtk_notebook_append_page(GTK_NOTEBOOK(notebook), scrolled_window, gtk_label_new("Новая вкладка"));
 }
 
@@ -188,6 +208,11 @@ void Browser::create_new_tab() {
     // Создаем заголовок вкладки
     GtkWidget* tab_label = gtk_label_new("Новая вкладка");
     
+    // Свой номер у каждой вкладки: по нему отменяются ее загрузки и
+    // считается ее память
+    unsigned tab = memory_accounting::open_tab();
+    g_object_set_data(G_OBJECT(tab_container), "memory-tab", GUINT_TO_POINTER(tab));
+    
     // Добавляем вкладку в notebook
     gtk_notebook_append_page(GTK_NOTEBOOK(notebook), tab_container, tab_label);
     
@@ -211,33 +236,30 @@ void Browser::navigate(const std::string& url) {
 }
 
 void Browser::navigate_async(const std::string& url) {
-    // Останавливаем предыдущую загрузку
-    if (loading_timer_id > 0) {
-        g_source_remove(loading_timer_id);
-        loading_timer_id = 0;
-    }
+    MemoryScope scope(MEMORY_RENDERER, memory_tab);
+    
+    // Останавливаем предыдущую загрузку; ее документ, если он еще
+    // собирается в фоне, показан не будет
+    pipeline->begin_navigation();
+    cancel_loading();
+    
+    // Все этапы загрузки, включая картинки страницы, получают номер навигации
+    trace_navigation = tracing::next_navigation();
+    navigation_start_ns = trace_now_ns();
+    first_paint_traced = false;
+    tracing::set_thread_navigation(trace_navigation);
     
     // Проверяем кэш
-    if (is_cached(url)) {
+    if (std::shared_ptr<const HtmlDocument> cached = engine->cached_page(url)) {
         update_status_bar("Загружаем из кэша: " + url);
         
         // Показываем прогресс загрузки
         show_loading_progress(true);
         update_loading_progress(0.8);
         
-        // Рендерим кэшированную страницу
-        if (html_renderer->parse_from_rust(html_parser)) {
-            GtkWidget* scrolled_window = gtk_widget_get_parent(content_view);
-            if (scrolled_window) {
-                gtk_container_remove(GTK_CONTAINER(scrolled_window), content_view);
-                
-                GtkWidget* rendered_content = html_renderer->render_to_widget();
-                if (rendered_content) {
-                    content_view = rendered_content;
-                    gtk_container_add(GTK_CONTAINER(scrolled_window), content_view);
-                    gtk_widget_show_all(scrolled_window);
-                }
-            }
+        // Кэш хранит уже разобранный документ: сразу к рендерингу, без парсера и FFI
+        if (html_renderer->load_document(cached)) {
+            present_rendered_content();
         }
         
         update_loading_progress(1.0);
@@ -258,13 +280,31 @@ void Browser::navigate_async(const std::string& url) {
     update_loading_progress(0.1);
     update_status_bar("Начинаем загрузку: " + url);
     
-    // Запускаем асинхронную загрузку
-    current_fetch_handle = network_fetch_url_async(url.c_str());
+    // Если есть сохраненная копия, запрос условный: при 304 тело не скачивается
+    FetchValidators validators = {nullptr, nullptr};
+    // Запись копируется: строки должны жить до запуска загрузки
+    DiskCacheEntry entry;
+    if (engine->disk_cache().lookup(url, entry)) {
+        if (!entry.etag.empty()) {
+            validators.etag = entry.etag.c_str();
+        }
+        if (!entry.last_modified.empty()) {
+            validators.last_modified = entry.last_modified.c_str();
+        }
+    }
+    
+    // Запускаем потоковую загрузку: HTML разбирается по мере поступления.
+    // Задачи загрузки и разбора наследуют метки памяти этого потока
+    MemoryScope fetch_scope(MEMORY_NETWORK);
+    current_stream = network_fetch_html_stream(url.c_str(), &validators, on_stream_notify, this);
     pending_url = url;
+    first_paint_done = false;
     
-    if (current_fetch_handle) {
-        // Запускаем таймер для проверки прогресса
-        loading_timer_id = g_timeout_add(100, on_loading_timer, this);
+    if (current_stream) {
+        // Первый частичный снимок DOM пригодится для раннего рендеринга
+        network_stream_request_preview(current_stream);
+        
+        // Дальше страница обрабатывается по уведомлениям из потоков загрузки
         update_loading_progress(0.2);
         update_status_bar("Загружаем HTML: " + url);
     } else {
@@ -275,112 +315,212 @@ void Browser::navigate_async(const std::string& url) {
     }
 }
 
-gboolean Browser::on_loading_timer(gpointer data) {
+// Вызывается из потоков загрузки: только планирует обработку в главном цикле.
+// Пока обработчик не отработал, повторные уведомления схлопываются.
+void Browser::on_stream_notify(void* user_data) {
+    Browser* browser = static_cast<Browser*>(user_data);
+    if (!browser->stream_event_pending.exchange(true)) {
+        g_idle_add(on_stream_event, browser);
+    }
+}
+
+gboolean Browser::on_stream_event(gpointer data) {
     Browser* browser = static_cast<Browser*>(data);
+    // Сбрасываем до обработки, чтобы не потерять события, пришедшие во время нее
+    browser->stream_event_pending.store(false);
+    MemoryScope scope(MEMORY_PARSER, browser->memory_tab);
     browser->check_loading_progress();
-    return TRUE; // Продолжаем таймер
+    return G_SOURCE_REMOVE;
 }
 
 void Browser::check_loading_progress() {
-    if (!current_fetch_handle) {
-        loading_timer_id = 0;
+    if (!current_stream) {
         return;
     }
     
-    int status = network_fetch_url_check(current_fetch_handle);
+    int status = network_stream_check(current_stream);
     
     if (status == 1) { // Загрузка завершена
-        g_source_remove(loading_timer_id);
-        loading_timer_id = 0;
+        update_loading_progress(0.8);
+        update_status_bar("Рендерим страницу: " + pending_url);
         
-        update_loading_progress(0.6);
-        update_status_bar("Парсим HTML: " + pending_url);
+        // Разбор, стили и запись на диск уходят в фоновый поток,
+        // интерфейс остается отзывчивым; результат придет в commit_document
+        pipeline->finish_stream(current_stream, pending_url);
+        current_stream = nullptr;
+    } else if (status == 2) { // Сохраненная копия актуальна (304)
+        std::string document_url = stream_url();
+        network_stream_free(current_stream);
+        current_stream = nullptr;
         
-        // Получаем результат
-        char* html_content = network_fetch_url_result(current_fetch_handle);
-        current_fetch_handle = nullptr;
+        engine->disk_cache().mark_fresh(pending_url);
+        pipeline->load_from_disk(pending_url, DocumentSource::DiskRevalidated, document_url);
+    } else if (status == -1) { // Ошибка
+        network_stream_free(current_stream);
+        current_stream = nullptr;
         
-        if (html_content) {
-            std::cout << "HTML загружен асинхронно, длина: " << strlen(html_content) << std::endl;
-            
-            update_loading_progress(0.8);
-            update_status_bar("Рендерим страницу: " + pending_url);
-            
-            // Парсим HTML через Rust
-            if (html_parse_string(html_parser, html_content)) {
-                std::cout << "HTML успешно распарсен через Rust, рендерим..." << std::endl;
-                
-                // Передаем данные от Rust парсера в рендерер
-                if (html_renderer->parse_from_rust(html_parser)) {
-                    // Очищаем текущий контент
-                    GtkWidget* scrolled_window = gtk_widget_get_parent(content_view);
-                    if (scrolled_window) {
-                        gtk_container_remove(GTK_CONTAINER(scrolled_window), content_view);
-                        
-                        // Создаем новый рендеринг
-                        GtkWidget* rendered_content = html_renderer->render_to_widget();
-                        if (rendered_content) {
-                            std::cout << "Контент отрендерен, добавляем в окно..." << std::endl;
-                            content_view = rendered_content;
-                            gtk_container_add(GTK_CONTAINER(scrolled_window), content_view);
-                            gtk_widget_show_all(scrolled_window);
-                            
-                            // Принудительно обновляем UI
-                            gtk_widget_queue_draw(scrolled_window);
-                            gtk_widget_queue_draw(content_view);
-                        } else {
-                            std::cout << "Ошибка: рендеринг вернул nullptr" << std::endl;
-                            display_content("Ошибка рендеринга страницы");
-                        }
-                    } else {
-                        std::cout << "Ошибка: не найден scrolled_window" << std::endl;
-                        display_content("Ошибка: не найден контейнер для контента");
-                    }
+        // Без сети показываем сохраненную копию, если она есть
+        pipeline->load_from_disk(pending_url, DocumentSource::DiskOffline);
+    } else {
+        // Еще загружается: показываем частично разобранный документ, как только
+        // в нем появится что-то видимое
+        if (!first_paint_done) {
+            const HtmlSnapshot* preview = network_stream_take_preview(current_stream);
+            if (preview) {
+                std::unique_ptr<HtmlDocument> document = HtmlDocument::adopt(preview);
+                if (document) {
+                    document->set_document_url(stream_url());
+                }
+                if (html_renderer->load_document(std::move(document))) {
+                    first_paint_done = present_rendered_content();
+                    update_status_bar("Загружаем HTML: " + pending_url);
                 } else {
-                    std::cout << "Ошибка рендеринга HTML" << std::endl;
-                    display_content("Ошибка рендеринга HTML");
+                    network_stream_request_preview(current_stream);
                 }
-            } else {
-                std::cout << "Ошибка парсинга HTML через Rust" << std::endl;
-                display_content("Ошибка парсинга HTML через Rust");
             }
-            
-            // Кэшируем страницу
-            std::string html_str(html_content);
-            cache_page(pending_url, html_str, "");
-            
-            string_free(html_content);
-            
-            update_loading_progress(1.0);
-            update_status_bar("Загрузка завершена: " + pending_url);
-        } else {
-            // Ошибка загрузки
-            display_content("Ошибка загрузки страницы: " + pending_url);
-            update_status_bar("Ошибка загрузки: " + pending_url);
         }
         
-        // Скрываем прогресс бар через небольшую задержку
-        g_timeout_add(1000, [](gpointer data) -> gboolean {
-            Browser* browser = static_cast<Browser*>(data);
-            browser->show_loading_progress(false);
-            return G_SOURCE_REMOVE;
-        }, this);
+        report_download_progress();
+    }
+}
+
+// Адрес ответа текущей загрузки после перенаправлений; до ответа - набранный
+std::string Browser::stream_url() const {
+    char* url = current_stream ? network_stream_final_url(current_stream) : nullptr;
+    if (!url) {
+        return pending_url;
+    }
+    std::string result(url);
+    string_free(url);
+    return result;
+}
+
+// Прогресс по реально полученным байтам. Загрузка занимает диапазон 0.2..0.8,
+// остаток - разбор и рендеринг
+void Browser::report_download_progress() {
+    if (!progress_bar || !gtk_widget_get_visible(progress_bar)) {
+        return;
+    }
+    
+    uint64_t received = 0;
+    uint64_t total = 0;
+    network_stream_progress(current_stream, &received, &total);
+    
+    std::string text = std::to_string(received / 1024) + " КБ";
+    if (total > 0) {
+        double fraction = std::min(1.0, static_cast<double>(received) / static_cast<double>(total));
+        gtk_progress_bar_set_fraction(GTK_PROGRESS_BAR(progress_bar), 0.2 + fraction * 0.6);
+        text += " из " + std::to_string(total / 1024) + " КБ";
+    } else {
+        // Размер неизвестен (нет Content-Length)
+        gtk_progress_bar_pulse(GTK_PROGRESS_BAR(progress_bar));
+    }
+    gtk_progress_bar_set_text(GTK_PROGRESS_BAR(progress_bar), text.c_str());
+}
+
+// Главный поток: документ собран в фоне, остается показать его
+void Browser::commit_document(const DocumentLoad& load) {
+    const std::string& url = load.url;
+    trace_record("navigation", "navigation", navigation_start_ns, trace_now_ns(), load.body_len);
+    
+    if (load.document) {
+        cache_page(url, load.document);
+    }
+    
+    switch (load.source) {
+    case DocumentSource::Network:
+        // Тела нет - ошибка загрузки; тело есть, а документа нет - ошибка разбора
+        if (load.body_len == 0 && !load.document) {
+            display_content("Ошибка загрузки страницы: " + url);
+            update_status_bar("Ошибка загрузки: " + url);
+            break;
+        }
+        LOG_INFO("browser") << "HTML загружен потоково, длина: " << load.body_len;
         
-    } else if (status == -1) { // Ошибка
-        g_source_remove(loading_timer_id);
-        loading_timer_id = 0;
-        current_fetch_handle = nullptr;
+        if (html_renderer->load_document(load.document)) {
+            if (!present_rendered_content()) {
+                display_content("Ошибка рендеринга страницы");
+            }
+        } else if (!first_paint_done) {
+            LOG_ERROR("browser") << "Ошибка рендеринга HTML";
+            display_content("Ошибка рендеринга HTML");
+        }
         
-        display_content("Ошибка загрузки страницы: " + pending_url);
-        update_status_bar("Ошибка загрузки: " + pending_url);
-        show_loading_progress(false);
-    } else {
-        // Еще загружается, обновляем прогресс
-        static int progress_step = 0;
-        progress_step = (progress_step + 1) % 20;
-        double progress = 0.2 + (progress_step * 0.02); // От 0.2 до 0.6
-        update_loading_progress(progress);
+        update_loading_progress(1.0);
+        update_status_bar("Загрузка завершена: " + url);
+        break;
+        
+    case DocumentSource::DiskRevalidated:
+        if (load.document && html_renderer->load_document(load.document) && present_rendered_content()) {
+            update_status_bar("Загружено из дискового кэша: " + url);
+        } else {
+            // Копия пропала с диска - загружаем заново без условий
+            engine->disk_cache().remove(url);
+            navigate_async(url);
+            return;
+        }
+        break;
+        
+    case DocumentSource::DiskOffline:
+        if (load.document && html_renderer->load_document(load.document) && present_rendered_content()) {
+            update_status_bar("Сеть недоступна, показана сохраненная копия: " + url);
+        } else {
+            display_content("Ошибка загрузки страницы: " + url);
+            update_status_bar("Ошибка загрузки: " + url);
+        }
+        break;
+    }
+    
+    MemoryUsage usage = memory_accounting::tab(memory_tab);
+    if (usage.live_bytes() > memory_accounting::TAB_BUDGET) {
+        LOG_WARN("memory") << "Вкладка превысила бюджет памяти: " << usage.live_bytes() / (1024 * 1024)
+                  << " МБ из " << memory_accounting::TAB_BUDGET / (1024 * 1024) << " МБ";
+    }
+    
+    // Скрываем прогресс бар через небольшую задержку
+    g_timeout_add(1000, [](gpointer data) -> gboolean {
+        Browser* browser = static_cast<Browser*>(data);
+        browser->show_loading_progress(false);
+        return G_SOURCE_REMOVE;
+    }, this);
+}
+
+// Заменяет содержимое вкладки результатом рендерера
+bool Browser::present_rendered_content() {
+    GtkWidget* scrolled_window = nullptr;
+    if (content_view) {
+        scrolled_window = gtk_widget_get_parent(content_view);
+    }
+    if (!scrolled_window) {
+        LOG_ERROR("browser") << "Ошибка: не найден scrolled_window";
+        return false;
+    }
+    
+    TraceSpan span("renderer", "widget_build");
+    GtkWidget* rendered_content = html_renderer->render_to_widget();
+    if (!rendered_content) {
+        LOG_ERROR("browser") << "Ошибка: рендеринг вернул nullptr";
+        return false;
     }
+    
+    gtk_container_remove(GTK_CONTAINER(scrolled_window), content_view);
+    content_view = rendered_content;
+    gtk_container_add(GTK_CONTAINER(scrolled_window), content_view);
+    gtk_widget_show_all(scrolled_window);
+    span.end();
+    
+    // Первая отрисовка навигации: от начала загрузки до кадра на экране
+    if (tracing::enabled() && !first_paint_traced) {
+        first_paint_traced = true;
+        g_signal_connect_after(content_view, "draw", G_CALLBACK(on_first_draw), this);
+    }
+    return true;
+}
+
+gboolean Browser::on_first_draw(GtkWidget* widget, cairo_t*, Browser* browser) {
+    g_signal_handlers_disconnect_by_func(widget, reinterpret_cast<gpointer>(on_first_draw), browser);
+    trace_record("first_paint", "navigation", browser->navigation_start_ns, trace_now_ns(), 0);
+    return FALSE;
 }
 
 void Browser::reload() {
@@ -390,9 +530,28 @@ void Browser::reload() {
 }
 
 void Browser::stop() {
+    cancel_loading();
+    show_loading_progress(false);
     update_status_bar("Остановлено");
 }
 
+// Отменяет все загрузки вкладки: документ, его картинки и упреждающие
+// загрузки. Ждущие запросы снимаются с очереди, у начатых сразу
+// закрываются соединения
+void Browser::cancel_loading() {
+    if (current_stream) {
+        network_stream_free(current_stream);
+        current_stream = nullptr;
+    }
+    // Вкладка без номера - общая для всех непомеченных запросов
+    if (memory_tab != MEMORY_NO_TAB) {
+        network_cancel_tab(memory_tab);
+    }
+    if (html_renderer) {
+        html_renderer->cancel_image_loads();
+    }
+}
+
 void Browser::go_back() {
     // TODO: Реализовать историю
     update_status_bar("Назад");
@@ -418,27 +577,57 @@ void Browser::switch_tab(int tab_index) {
 }
 
 void Browser::set_user_agent(const std::string& user_agent) {
-    this->user_agent = user_agent;
+    engine->settings().user_agent = user_agent;
 }
 
 void Browser::enable_javascript(bool enable) {
-    javascript_enabled = enable;
+    engine->settings().javascript_enabled = enable;
 }
 
 void Browser::enable_cookies(bool enable) {
-    cookies_enabled = enable;
+    engine->settings().cookies_enabled = enable;
 }
 
 void Browser::block_popups(bool block) {
-    popups_blocked = block;
+    engine->settings().popups_blocked = block;
 }
 
 void Browser::enable_https_only(bool enable) {
-    https_only = enable;
+    engine->settings().https_only = enable;
 }
 
 void Browser::show_developer_tools() {
-    update_status_bar("Инструменты разработчика");
+    PageCacheStatus cache = engine->page_cache_status();
+    const LruCacheStats& stats = cache.stats;
+    update_status_bar("Инструменты разработчика | кэш страниц: " +
+                      std::to_string(cache.count) + " стр., " +
+                      std::to_string(cache.size_bytes / 1024) + " из " +
+                      std::to_string(cache.budget_bytes / 1024) + " КБ, попаданий " +
+                      std::to_string(stats.hits) + ", промахов " + std::to_string(stats.misses) +
+                      ", вытеснено " + std::to_string(stats.evictions) +
+                      " | память вкладки: " + std::to_string(memory_accounting::tab(memory_tab).live_bytes() / 1024) +
+                      " КБ, всего: " + std::to_string(memory_accounting::total().live_bytes() / 1024) + " КБ");
+    
+    // Полный отчет по подсистемам и вкладкам - в файл: в запись журнала
+    // он не помещается
+    std::string memory_path = memory_accounting::report_path();
+    if (!memory_path.empty()) {
+        if (memory_accounting::write_json(memory_path)) {
+            LOG_INFO("memory") << "Отчет о памяти записан: " << memory_path;
+        } else {
+            LOG_ERROR("memory") << "Не удалось записать отчет о памяти: " << memory_path;
+        }
+    }
+    
+    // Трасса этапов загрузки на текущий момент
+    std::string trace_path = tracing::output_path();
+    if (tracing::enabled() && !trace_path.empty()) {
+        if (tracing::write_chrome_json(trace_path)) {
+            LOG_INFO("trace") << "Трасса записана: " << trace_path;
+        } else {
+            LOG_ERROR("trace") << "Не удалось записать трассу: " << trace_path;
+        }
+    }
 }
 
 void Browser::update_address_bar() {
@@ -540,10 +729,18 @@ bool Browser::handle_key_shortcut(guint keyval, GdkModifierType state) {
         return TRUE;
     }
     
-    // Escape - убрать фокус с адресной строки
+    // F12 - инструменты разработчика
+    if (keyval == GDK_KEY_F12) {
+        show_developer_tools();
+        return TRUE;
+    }
+
+    // Escape - убрать фокус с адресной строки, иначе остановить загрузку
     if (keyval == GDK_KEY_Escape) {
         if (gtk_widget_has_focus(address_bar)) {
             gtk_widget_grab_focus(main_window);
+        } else if (current_stream) {
+            stop();
         }
         return TRUE;
     }
@@ -552,22 +749,17 @@ bool Browser::handle_key_shortcut(guint keyval, GdkModifierType state) {
 }
 
 // Проверка кэша
-bool Browser::is_cached(const std::string& url) {
-    return page_cache.find(url) != page_cache.end();
+bool Browser::is_cached(const std::string& url) const {
+    return engine->is_cached(url);
 }
 
 // Кэширование страницы
-void Browser::cache_page(const std::string& url, const std::string& content, const std::string& parsed) {
-    // Ограничиваем размер кэша
-    if (page_cache.size() > 50) {
-        // Удаляем старые записи
-        auto it = page_cache.begin();
-        page_cache.erase(it);
-        parsed_cache.erase(it->first);
-    }
-    
-    page_cache[url] = content;
-    parsed_cache[url] = parsed;
+void Browser::cache_page(const std::string& url, std::shared_ptr<const HtmlDocument> document) {
+    engine->cache_page(url, std::move(document));
+}
+
+void Browser::set_page_cache_budget(size_t budget_bytes) {
+    engine->set_page_cache_budget(budget_bytes);
 }
 
 // Показать/скрыть прогресс загрузки
@@ -615,12 +807,12 @@ void Browser::on_address_bar_activated(GtkEntry* entry, Browser* browser) {
 // Обработчики событий
 void Browser::on_back_clicked(GtkButton* button, Browser* browser) {
     // TODO: Реализовать навигацию назад
-    std::cout << "Кнопка 'Назад' нажата" << std::endl;
+    LOG_DEBUG("browser") << "Кнопка 'Назад' нажата";
 }
 
 void Browser::on_forward_clicked(GtkButton* button, Browser* browser) {
     // TODO: Реализовать навигацию вперед
-    std::cout << "Кнопка 'Вперед' нажата" << std::endl;
+    LOG_DEBUG("browser") << "Кнопка 'Вперед' нажата";
 }
 
 void Browser::on_refresh_clicked(GtkButton* button, Browser* browser) {
@@ -631,6 +823,10 @@ void Browser::on_refresh_clicked(GtkButton* button, Browser* browser) {
     }
 }
 
+void Browser::on_stop_clicked(GtkButton* button, Browser* browser) {
+    browser->stop();
+}
+
 void Browser::on_new_tab_clicked(GtkButton* button, Browser* browser) {
     browser->create_new_tab();
 }
@@ -650,14 +846,29 @@ void Browser::on_address_bar_activate(GtkEntry* entry, Browser* browser) {
 }
 
 void Browser::on_page_added(GtkNotebook* notebook, GtkWidget* child, guint page_num, Browser* browser) {
-    std::cout << "Добавлена вкладка " << page_num << std::endl;
+    LOG_DEBUG("browser") << "Добавлена вкладка " << page_num;
 }
 
 void Browser::on_page_removed(GtkNotebook* notebook, GtkWidget* child, guint page_num, Browser* browser) {
-    std::cout << "Удалена вкладка " << page_num << std::endl;
+    LOG_DEBUG("browser") << "Удалена вкладка " << page_num;
+    unsigned tab = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(child), "memory-tab"));
+    // Вкладка без номера - общая для всех непомеченных запросов, ее не
+    // отменить и не закрыть
+    if (tab == MEMORY_NO_TAB) {
+        return;
+    }
+    // Загрузки закрытой вкладки больше никому не нужны
+    network_cancel_tab(tab);
+    memory_accounting::close_tab(tab);
 }
 
 void Browser::on_switch_page(GtkNotebook* notebook, GtkWidget* page, guint page_num, Browser* browser) {
-    std::cout << "Переключение на вкладку " << page_num << std::endl;
+    LOG_DEBUG("browser") << "Переключение на вкладку " << page_num;
+    // Загрузки скрытых вкладок уступают очередь загрузкам видимой. Номер 0
+    // снял бы активную вкладку: у страницы без номера приоритеты не меняются
+    unsigned tab = GPOINTER_TO_UINT(g_object_get_data(G_OBJECT(page), "memory-tab"));
+    if (tab != MEMORY_NO_TAB) {
+        network_scheduler_set_active_tab(tab);
+    }
     // TODO: Обновить адресную строку и контент
 }
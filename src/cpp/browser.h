@@ -1,10 +1,17 @@
 #pragma once
 
 #include <string>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <vector>
+#include <map>
 #include <gtk/gtk.h>
 #include "rust_html_renderer.h"
+#include "browser_engine.h"
+#include "document_pipeline.h"
+#include "memory_accounting.h"
+#include "tracing.h"
 
 // FFI интерфейсы для Rust
 extern "C" {
@@ -14,23 +21,60 @@ extern "C" {
     HtmlParser* html_parse_new();
     void html_parse_free(HtmlParser* parser);
     char* html_parse_string(HtmlParser* parser, const char* html);
+    bool html_parse_bytes(HtmlParser* parser, const uint8_t* data, size_t len);
     
     // Новые функции для работы с элементами
     size_t html_get_element_count(HtmlParser* parser);
     char* html_get_element_tag_name(HtmlParser* parser, size_t index);
+    uint16_t html_get_element_tag_atom(HtmlParser* parser, size_t index);
     char* html_get_element_text(HtmlParser* parser, size_t index);
     char* html_get_element_attribute(HtmlParser* parser, size_t element_index, const char* attr_name);
     size_t html_get_element_attribute_count(HtmlParser* parser, size_t element_index);
     char* html_get_element_attribute_name(HtmlParser* parser, size_t element_index, size_t attr_index);
     
+    // Структура дерева DOM: индекс узла или UINT32_MAX
+    uint32_t html_get_element_parent(HtmlParser* parser, size_t index);
+    uint32_t html_get_element_first_child(HtmlParser* parser, size_t index);
+    uint32_t html_get_element_next_sibling(HtmlParser* parser, size_t index);
+    
     char* network_fetch_url(const char* url);
-    char* network_fetch_image(const char* url);
     
     // Асинхронные сетевые функции
     struct AsyncFetchHandle;
     AsyncFetchHandle* network_fetch_url_async(const char* url);
     int network_fetch_url_check(AsyncFetchHandle* handle);
     char* network_fetch_url_result(AsyncFetchHandle* handle);
+    // Отменяет загрузку и освобождает handle
+    void network_fetch_url_cancel(AsyncFetchHandle* handle);
+    
+    // Потоковая загрузка: тело разбирается по мере поступления
+    struct StreamingFetch;
+    typedef void (*StreamNotifyFn)(void* user_data);
+    // Валидаторы сохраненной копии для условного запроса; поля могут быть NULL
+    struct FetchValidators {
+        const char* etag;
+        const char* last_modified;
+    };
+    StreamingFetch* network_fetch_html_stream(const char* url, const FetchValidators* validators,
+                                              StreamNotifyFn notify, void* user_data);
+    // 0 - загружается, 1 - готово, 2 - не изменилось (304), -1 - ошибка
+    int network_stream_check(StreamingFetch* stream);
+    uint16_t network_stream_http_status(StreamingFetch* stream);
+    // Адрес ответа после перенаправлений (string_free), NULL - ответа еще нет
+    char* network_stream_final_url(StreamingFetch* stream);
+    char* network_stream_etag(StreamingFetch* stream);
+    char* network_stream_last_modified(StreamingFetch* stream);
+    void network_stream_progress(StreamingFetch* stream, uint64_t* received, uint64_t* total);
+    void network_stream_request_preview(StreamingFetch* stream);
+    const HtmlSnapshot* network_stream_take_preview(StreamingFetch* stream);
+    uint8_t* network_stream_finish(StreamingFetch* stream, HtmlParser* parser, size_t* body_len);
+    void network_stream_free(StreamingFetch* stream);
+    void network_bytes_free(uint8_t* data, size_t len);
+    // Запросы этой вкладки (номер в учете памяти) планировщик загрузок
+    // пропускает вперед запросов остальных
+    void network_scheduler_set_active_tab(uint32_t tab);
+    // Отменяет все запросы вкладки: документ, картинки, упреждающие загрузки
+    void network_cancel_tab(uint32_t tab);
     
     void string_free(char* ptr);
 }
@@ -71,8 +115,13 @@ public:
     void update_loading_progress(double progress);
     
     // Кэширование
-    bool is_cached(const std::string& url);
-    void cache_page(const std::string& url, const std::string& content, const std::string& parsed);
+    bool is_cached(const std::string& url) const;
+    void cache_page(const std::string& url, std::shared_ptr<const HtmlDocument> document);
+    void set_page_cache_budget(size_t budget_bytes);
+    LruCacheStats page_cache_stats() const { return engine->page_cache_status().stats; }
+    
+    // Движок без интерфейса: кэши, настройки, загрузка документов
+    BrowserEngine& get_engine() { return *engine; }
     
 private:
     // GTK виджеты
@@ -85,28 +134,32 @@ private:
     GtkWidget* progress_bar;
     
     // Rust компоненты
-    HtmlParser* html_parser;
     CssParser* css_parser;
     
     // HTML рендерер
     RustHtmlRenderer* html_renderer;
     
+    // Движок: настройки, кэш разобранных страниц и дисковый кэш
+    BrowserEngine* engine;
+    
     // Состояние браузера
     std::string current_url;
-    std::string user_agent;
-    bool javascript_enabled;
-    bool cookies_enabled;
-    bool popups_blocked;
-    bool https_only;
-    
-    // Кэш для быстрой загрузки
-    std::map<std::string, std::string> page_cache;
-    std::map<std::string, std::string> parsed_cache;
+    // Номер вкладки в учете памяти (memory_accounting.h)
+    unsigned memory_tab;
     
     // Асинхронная загрузка
-    AsyncFetchHandle* current_fetch_handle;
+    // Дочитывание, разбор и снимок DOM в фоновых потоках
+    DocumentPipeline* pipeline;
+    StreamingFetch* current_stream;
     std::string pending_url;
-    guint loading_timer_id;
+    bool first_paint_done;
+    // Навигация в трассе (tracing.h) и ее начало по trace_now_ns()
+    uint64_t trace_navigation;
+    uint64_t navigation_start_ns;
+    // Для текущей навигации уже ждем первую отрисовку
+    bool first_paint_traced;
+    // Уже запланирован idle-обработчик событий загрузки
+    std::atomic<bool> stream_event_pending;
     
     // Приватные методы
     void setup_ui();
@@ -116,16 +169,24 @@ private:
     void update_address_bar();
     void update_status_bar(const std::string& message);
     void display_content(const std::string& content);
+    bool present_rendered_content();
     
     // Асинхронная загрузка
     void navigate_async(const std::string& url);
+    void cancel_loading();
+    std::string stream_url() const;
     void check_loading_progress();
-    static gboolean on_loading_timer(gpointer data);
+    void report_download_progress();
+    void commit_document(const DocumentLoad& load);
+    static void on_stream_notify(void* user_data);
+    static gboolean on_stream_event(gpointer data);
+    static gboolean on_first_draw(GtkWidget* widget, cairo_t* cr, Browser* browser);
     
     // Обработчики событий
     static void on_back_clicked(GtkButton* button, Browser* browser);
     static void on_forward_clicked(GtkButton* button, Browser* browser);
     static void on_refresh_clicked(GtkButton* button, Browser* browser);
+    static void on_stop_clicked(GtkButton* button, Browser* browser);
     static void on_new_tab_clicked(GtkButton* button, Browser* browser);
     static void on_close_tab_clicked(GtkButton* button, Browser* browser);
     static void on_address_bar_activate(GtkEntry* entry, Browser* browser);
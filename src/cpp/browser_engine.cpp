@@ -0,0 +1,174 @@
+#include "browser_engine.h"
+#include "memory_accounting.h"
+#include "tracing.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    bool read_local_file(const std::string& path, std::string& out) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        out.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        return true;
+    }
+}
+
+BrowserEngine::BrowserEngine()
+    : page_cache(DEFAULT_PAGE_CACHE_BUDGET)
+    , disk(nullptr)
+{
+    disk = new DiskCache();
+}
+
+BrowserEngine::~BrowserEngine() {
+    if (disk) {
+        delete disk;
+    }
+}
+
+std::shared_ptr<const HtmlDocument> BrowserEngine::cached_page(const std::string& url) {
+    std::lock_guard<std::mutex> lock(page_cache_mutex);
+    const std::shared_ptr<const HtmlDocument>* cached = page_cache.get(url);
+    return cached ? *cached : nullptr;
+}
+
+bool BrowserEngine::is_cached(const std::string& url) const {
+    std::lock_guard<std::mutex> lock(page_cache_mutex);
+    return page_cache.contains(url);
+}
+
+void BrowserEngine::cache_page(const std::string& url, std::shared_ptr<const HtmlDocument> document) {
+    if (!document) {
+        return;
+    }
+    // Учитываем и ключ: на длинных URL с короткими страницами он заметен
+    size_t size = url.size() + document->byte_size();
+    std::lock_guard<std::mutex> lock(page_cache_mutex);
+    page_cache.put(url, std::move(document), size);
+}
+
+void BrowserEngine::set_page_cache_budget(size_t budget_bytes) {
+    std::lock_guard<std::mutex> lock(page_cache_mutex);
+    page_cache.set_budget(budget_bytes);
+}
+
+PageCacheStatus BrowserEngine::page_cache_status() const {
+    std::lock_guard<std::mutex> lock(page_cache_mutex);
+    PageCacheStatus status;
+    status.count = page_cache.count();
+    status.size_bytes = page_cache.size_bytes();
+    status.budget_bytes = page_cache.budget_bytes();
+    status.stats = page_cache.stats();
+    return status;
+}
+
+std::shared_ptr<const HtmlDocument> BrowserEngine::build_document(const uint8_t* data, size_t len,
+                                                                  const std::string& url, LoadTimings& timings) {
+    MemoryScope scope(MEMORY_PARSER);
+    std::unique_ptr<HtmlDocument> document;
+
+    HtmlParser* parser = html_parse_new();
+    auto start = Clock::now();
+    TraceSpan parse_span("parser", "parse");
+    parse_span.set_bytes(len);
+    bool parsed = html_parse_bytes(parser, data, len);
+    parse_span.end();
+    timings.parse = seconds_since(start);
+
+    if (parsed) {
+        start = Clock::now();
+        // Стили и сборка снимка видны внутри отдельными отрезками Rust
+        TraceSpan span("ffi", "ffi_transfer");
+        document = HtmlDocument::from_parser(parser);
+        if (document) {
+            document->set_document_url(url);
+        }
+        span.end();
+        timings.style = seconds_since(start);
+    }
+    html_parse_free(parser);
+    return document;
+}
+
+PageLoad BrowserEngine::load_page(const std::string& url) {
+    PageLoad load;
+    load.url = url;
+
+    if ((load.document = cached_page(url))) {
+        load.from_page_cache = true;
+        return load;
+    }
+
+    // Тело: файл для file://, иначе сеть
+    std::string body;
+    // Адрес ответа после перенаправлений: от него считаются ссылки и картинки
+    std::string document_url = url;
+    bool fetched = false;
+    auto start = Clock::now();
+    TraceSpan fetch_span("network", "fetch");
+    if (url.rfind("file://", 0) == 0) {
+        MemoryScope scope(MEMORY_NETWORK);
+        fetched = read_local_file(url.substr(std::strlen("file://")), body);
+    } else {
+        MemoryScope scope(MEMORY_NETWORK);
+        size_t len = 0;
+        char* final_url = nullptr;
+        // Байты как есть: страница с NUL или в однобайтовой кодировке не ломает пакет
+        if (uint8_t* data = network_fetch_bytes(url.c_str(), &len, &final_url)) {
+            body.assign(reinterpret_cast<const char*>(data), len);
+            network_bytes_free(data, len);
+            fetched = true;
+        }
+        if (final_url) {
+            document_url = final_url;
+            string_free(final_url);
+        }
+    }
+    fetch_span.set_bytes(body.size());
+    fetch_span.end();
+    load.timings.fetch = seconds_since(start);
+
+    if (fetched) {
+        load.body_len = body.size();
+        load.document = build_document(reinterpret_cast<const uint8_t*>(body.data()), body.size(), document_url,
+                                       load.timings);
+        if (!load.document) {
+            load.error = "ошибка разбора";
+        }
+    } else {
+        // Без сети разбираем сохраненную копию прямо из mmap
+        std::unique_ptr<MappedBody> saved = disk->open(url);
+        if (saved) {
+            load.offline_copy = true;
+            load.body_len = saved->size();
+            load.document = build_document(saved->data(), saved->size(), url, load.timings);
+        }
+        if (!load.document) {
+            load.error = "ошибка загрузки";
+        }
+    }
+
+    cache_page(url, load.document);
+    return load;
+}
+
+std::string BrowserEngine::resolve_link(const std::string& base, const std::string& href) {
+    if (href.empty() || href[0] == '#' || href.rfind("javascript:", 0) == 0 ||
+        href.rfind("mailto:", 0) == 0) {
+        return std::string();
+    }
+    // Разбор URL общий с Rust; неразбираемый адрес (например, путь к
+    // локальному файлу без схемы) остается как есть
+    std::string url = resolve_url(base, href);
+    return url.empty() ? href : url;
+}
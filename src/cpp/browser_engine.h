@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "disk_cache.h"
+#include "html_document.h"
+#include "lru_cache.h"
+
+// FFI интерфейсы для Rust
+extern "C" {
+    HtmlParser* html_parse_new();
+    void html_parse_free(HtmlParser* parser);
+    bool html_parse_bytes(HtmlParser* parser, const uint8_t* data, size_t len);
+
+    // Тело как есть (network_bytes_free) и адрес после перенаправлений (string_free)
+    uint8_t* network_fetch_bytes(const char* url, size_t* len, char** final_url);
+    void network_bytes_free(uint8_t* data, size_t len);
+    void string_free(char* ptr);
+}
+
+// Настройки, общие для всех вкладок
+struct EngineSettings {
+    std::string user_agent = "HeavenlyWebGu/1.0 (X11; Linux x86_64) AppleWebKit/537.36";
+    bool javascript_enabled = true;
+    bool cookies_enabled = true;
+    bool popups_blocked = true;
+    bool https_only = false;
+};
+
+// Время этапов синхронной загрузки, в секундах
+struct LoadTimings {
+    double fetch = 0.0;
+    double parse = 0.0;
+    // Каскад стилей и сборка снимка DOM - один вызов FFI
+    double style = 0.0;
+};
+
+// Итог синхронной загрузки страницы
+struct PageLoad {
+    std::string url;
+    // nullptr - документ получить не удалось, причина в error
+    std::shared_ptr<const HtmlDocument> document;
+    std::string error;
+    size_t body_len = 0;
+    // Документ взят из кэша разобранных страниц
+    bool from_page_cache = false;
+    // Сеть недоступна, разобрана сохраненная копия с диска
+    bool offline_copy = false;
+    LoadTimings timings;
+};
+
+struct PageCacheStatus {
+    size_t count = 0;
+    size_t size_bytes = 0;
+    size_t budget_bytes = 0;
+    LruCacheStats stats;
+};
+
+// Движок без интерфейса: настройки, кэши страниц и синхронная загрузка
+// документа (сеть, разбор, стили). Не зависит от GTK: окно браузера
+// (Browser) строится поверх него, а headless-режим использует его напрямую
+// из нескольких потоков, поэтому кэш разобранных страниц защищен мьютексом.
+class BrowserEngine {
+public:
+    static constexpr size_t DEFAULT_PAGE_CACHE_BUDGET = 32 * 1024 * 1024;
+
+    BrowserEngine();
+    ~BrowserEngine();
+
+    BrowserEngine(const BrowserEngine&) = delete;
+    BrowserEngine& operator=(const BrowserEngine&) = delete;
+
+    EngineSettings& settings() { return engine_settings; }
+    const EngineSettings& settings() const { return engine_settings; }
+
+    DiskCache& disk_cache() { return *disk; }
+
+    // Кэш разобранных страниц
+    std::shared_ptr<const HtmlDocument> cached_page(const std::string& url);
+    bool is_cached(const std::string& url) const;
+    void cache_page(const std::string& url, std::shared_ptr<const HtmlDocument> document);
+    void set_page_cache_budget(size_t budget_bytes);
+    PageCacheStatus page_cache_status() const;
+
+    // Загружает и разбирает страницу в вызывающем потоке: кэш страниц,
+    // затем сеть (или файл для file://), при ошибке сети - копия с диска.
+    // Можно вызывать из нескольких потоков одновременно
+    PageLoad load_page(const std::string& url);
+
+    // Абсолютный URL ссылки относительно страницы; пустая строка - переходить не нужно
+    static std::string resolve_link(const std::string& base, const std::string& href);
+
+private:
+    // Разбирает тело в документ; время разбора и стилей - в timings
+    // url - адрес документа, от него считаются относительные адреса
+    static std::shared_ptr<const HtmlDocument> build_document(const uint8_t* data, size_t len,
+                                                              const std::string& url, LoadTimings& timings);
+
+    EngineSettings engine_settings;
+
+    // URL -> неизменяемый снимок DOM, вытеснение по LRU в пределах бюджета.
+    // Документы разделяются с рендерером без копирования
+    mutable std::mutex page_cache_mutex;
+    LruCache<std::string, std::shared_ptr<const HtmlDocument>> page_cache;
+    // Постоянный кэш тел страниц между запусками
+    DiskCache* disk;
+};
@@ -1,5 +1,5 @@
 #include "browser_styles.h"
-#include <iostream>
+#include "logger.h"
 
 GtkCssProvider* BrowserStyles::css_provider = nullptr;
 bool BrowserStyles::css_initialized = false;
@@ -16,7 +16,7 @@ void BrowserStyles::init_css_provider() {
     gtk_css_provider_load_from_data(css_provider, css.c_str(), css.length(), &error);
     
     if (error) {
-        std::cerr << "Ошибка загрузки CSS: " << error->message << std::endl;
+        LOG_ERROR("styles") << "Ошибка загрузки CSS: " << error->message;
         g_error_free(error);
     } else {
         // Применяем стили глобально
@@ -0,0 +1,338 @@
+#include "disk_cache.h"
+#include "logger.h"
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+#include <sstream>
+#include <vector>
+#include <dirent.h>
+#include <unistd.h>
+
+namespace {
+    constexpr const char* INDEX_HEADER = "HWGDC 1";
+
+    // Разделители формата индекса не должны попасть в поля
+    std::string sanitize(const std::string& value) {
+        std::string result = value;
+        std::replace_if(result.begin(), result.end(),
+                        [](char c) { return c == '\t' || c == '\n' || c == '\r'; }, ' ');
+        return result;
+    }
+
+    std::vector<std::string> split(const std::string& line, char separator) {
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (true) {
+            size_t end = line.find(separator, start);
+            if (end == std::string::npos) {
+                fields.push_back(line.substr(start));
+                return fields;
+            }
+            fields.push_back(line.substr(start, end - start));
+            start = end + 1;
+        }
+    }
+
+    int64_t now() {
+        return static_cast<int64_t>(std::time(nullptr));
+    }
+}
+
+DiskCache::DiskCache(const std::string& directory, uint64_t budget_bytes)
+    : directory(directory)
+    , budget(budget_bytes)
+    , total_size(0)
+    , index_dirty(false)
+    , last_flush(0)
+{
+    if (make_directories((directory + "/objects").c_str()) != 0) {
+        LOG_WARN("cache") << "Дисковый кэш недоступен: " << directory;
+        return;
+    }
+    load_index();
+    remove_orphan_objects();
+}
+
+DiskCache::~DiskCache() {
+    flush();
+}
+
+std::string DiskCache::default_directory() {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return std::string(xdg) + "/heavenly-webgu";
+    }
+    const char* home = getenv("HOME");
+    if (home && *home) {
+        return std::string(home) + "/.cache/heavenly-webgu";
+    }
+    return "/tmp/heavenly-webgu-cache";
+}
+
+std::string DiskCache::object_path(const std::string& hash) const {
+    return directory + "/objects/" + hash.substr(0, 2) + "/" + hash;
+}
+
+bool DiskCache::lookup(const std::string& url, DiskCacheEntry& entry) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(url);
+    if (it == entries.end()) {
+        return false;
+    }
+    entry = it->second;
+    return true;
+}
+
+std::unique_ptr<MappedBody> DiskCache::open(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(url);
+    if (it == entries.end()) {
+        return nullptr;
+    }
+
+    MappedFile mapped;
+    if (map_file(object_path(it->second.hash).c_str(), &mapped) != 0) {
+        // Файл пропал или поврежден - запись больше не нужна
+        remove_locked(url);
+        return nullptr;
+    }
+
+    it->second.last_used = now();
+    index_dirty = true;
+    return std::make_unique<MappedBody>(mapped);
+}
+
+bool DiskCache::store(const std::string& url, const uint8_t* data, size_t len,
+                      const std::string& etag, const std::string& last_modified) {
+    // URL - ключ строки индекса и не может содержать его разделители
+    if (len > budget || url.find_first_of("\t\r\n") != std::string::npos) {
+        return false;
+    }
+
+    char* hash_hex = security_calculate_hash(data, len);
+    if (!hash_hex) {
+        return false;
+    }
+    std::string hash(hash_hex);
+    string_free(hash_hex);
+
+    // Тело пишется без замка. Объекты удаляются только под замком, поэтому
+    // под ним наличие файла проверяется еще раз: пока шла запись, другой
+    // поток мог удалить этот же объект как никем не используемый
+    if (!write_object(hash, data, len)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!write_object(hash, data, len)) {
+        return false;
+    }
+    // Новая ссылка берется до снятия старой: при том же хэше файл остается
+    retain_object(hash);
+    auto it = entries.find(url);
+    if (it != entries.end()) {
+        std::string old_hash = it->second.hash;
+        total_size -= it->second.size;
+        entries.erase(it);
+        release_object(old_hash);
+    }
+
+    DiskCacheEntry entry;
+    entry.hash = hash;
+    entry.etag = sanitize(etag);
+    entry.last_modified = sanitize(last_modified);
+    entry.size = len;
+    entry.last_used = now();
+    entries[url] = entry;
+    total_size += len;
+
+    evict_to_budget(url);
+    index_dirty = true;
+    // Индекс переписывается целиком, поэтому не на каждую запись: при
+    // аварийном выходе теряются только последние секунды (тела без записи в
+    // индексе убирает load_index)
+    if (now() - last_flush >= INDEX_FLUSH_INTERVAL) {
+        flush_locked();
+    }
+    return true;
+}
+
+bool DiskCache::write_object(const std::string& hash, const uint8_t* data, size_t len) const {
+    // Одинаковое содержимое уже лежит на диске - переписывать не нужно
+    std::string path = object_path(hash);
+    if (file_exists(path.c_str())) {
+        return true;
+    }
+    std::string shard = directory + "/objects/" + hash.substr(0, 2);
+    if (make_directories(shard.c_str()) != 0 ||
+        write_file_atomic(path.c_str(), reinterpret_cast<const char*>(data), len) != 0) {
+        LOG_WARN("cache") << "Ошибка записи в дисковый кэш: " << path;
+        return false;
+    }
+    return true;
+}
+
+void DiskCache::mark_fresh(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(url);
+    if (it != entries.end()) {
+        it->second.last_used = now();
+        index_dirty = true;
+    }
+}
+
+void DiskCache::remove(const std::string& url) {
+    std::lock_guard<std::mutex> lock(mutex);
+    remove_locked(url);
+}
+
+void DiskCache::remove_locked(const std::string& url) {
+    auto it = entries.find(url);
+    if (it == entries.end()) {
+        return;
+    }
+    std::string hash = it->second.hash;
+    total_size -= it->second.size;
+    entries.erase(it);
+    release_object(hash);
+    index_dirty = true;
+}
+
+void DiskCache::retain_object(const std::string& hash) {
+    object_refs[hash]++;
+}
+
+void DiskCache::release_object(const std::string& hash) {
+    auto it = object_refs.find(hash);
+    if (it == object_refs.end()) {
+        return;
+    }
+    if (--it->second == 0) {
+        object_refs.erase(it);
+        unlink(object_path(hash).c_str());
+    }
+}
+
+void DiskCache::evict_to_budget(const std::string& keep_url) {
+    if (total_size <= budget) {
+        return;
+    }
+
+    // Вытеснение редкое, поэтому просто сортируем по времени использования
+    std::vector<std::pair<int64_t, std::string>> by_age;
+    by_age.reserve(entries.size());
+    for (const auto& entry : entries) {
+        by_age.emplace_back(entry.second.last_used, entry.first);
+    }
+    std::sort(by_age.begin(), by_age.end());
+
+    for (const auto& candidate : by_age) {
+        if (total_size <= budget) {
+            break;
+        }
+        if (candidate.second != keep_url) {
+            remove_locked(candidate.second);
+        }
+    }
+}
+
+void DiskCache::load_index() {
+    std::string index_path = directory + "/index";
+    if (!file_exists(index_path.c_str())) {
+        return;
+    }
+
+    char* buffer = nullptr;
+    size_t size = 0;
+    if (read_file(index_path.c_str(), &buffer, &size) != 0) {
+        return;
+    }
+    std::string content(buffer, size);
+    safe_free(buffer);
+
+    std::istringstream stream(content);
+    std::string line;
+    if (!std::getline(stream, line) || line != INDEX_HEADER) {
+        LOG_WARN("cache") << "Неизвестный формат индекса дискового кэша, начинаем с пустого";
+        return;
+    }
+
+    // url \t hash \t size \t last_used \t etag \t last_modified
+    while (std::getline(stream, line)) {
+        std::vector<std::string> fields = split(line, '\t');
+        if (fields.size() != 6 || fields[1].size() < 2) {
+            continue;
+        }
+
+        DiskCacheEntry entry;
+        entry.hash = fields[1];
+        entry.size = std::strtoull(fields[2].c_str(), nullptr, 10);
+        entry.last_used = std::strtoll(fields[3].c_str(), nullptr, 10);
+        entry.etag = fields[4];
+        entry.last_modified = fields[5];
+
+        auto previous = entries.find(fields[0]);
+        if (previous != entries.end()) {
+            // Повтор строки: старая ссылка снимается, файл без ссылок уберет remove_orphan_objects
+            total_size -= previous->second.size;
+            if (--object_refs[previous->second.hash] == 0) {
+                object_refs.erase(previous->second.hash);
+            }
+        }
+        total_size += entry.size;
+        object_refs[entry.hash]++;
+        entries[fields[0]] = entry;
+    }
+}
+
+// Тела, которых нет в индексе (запись не успела попасть в него до
+// аварийного выхода), и брошенные временные файлы
+void DiskCache::remove_orphan_objects() {
+    std::string objects = directory + "/objects";
+    DIR* root = opendir(objects.c_str());
+    if (!root) {
+        return;
+    }
+    while (dirent* shard = readdir(root)) {
+        if (shard->d_name[0] == '.') {
+            continue;
+        }
+        std::string shard_path = objects + "/" + shard->d_name;
+        DIR* files = opendir(shard_path.c_str());
+        if (!files) {
+            continue;
+        }
+        while (dirent* file = readdir(files)) {
+            if (file->d_name[0] != '.' && !object_refs.count(file->d_name)) {
+                unlink((shard_path + "/" + file->d_name).c_str());
+            }
+        }
+        closedir(files);
+    }
+    closedir(root);
+}
+
+void DiskCache::flush() {
+    std::lock_guard<std::mutex> lock(mutex);
+    flush_locked();
+}
+
+void DiskCache::flush_locked() {
+    if (!index_dirty) {
+        return;
+    }
+
+    std::string content = std::string(INDEX_HEADER) + "\n";
+    for (const auto& entry : entries) {
+        content += entry.first + "\t" + entry.second.hash + "\t" +
+                   std::to_string(entry.second.size) + "\t" +
+                   std::to_string(entry.second.last_used) + "\t" +
+                   entry.second.etag + "\t" + entry.second.last_modified + "\n";
+    }
+
+    std::string index_path = directory + "/index";
+    if (write_file_atomic(index_path.c_str(), content.data(), content.size()) == 0) {
+        index_dirty = false;
+    }
+    last_flush = now();
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include "system.h"
+
+// FFI интерфейсы для Rust
+extern "C" {
+    // SHA-256 в hex, освобождается через string_free
+    char* security_calculate_hash(const uint8_t* data, size_t len);
+    void string_free(char* ptr);
+}
+
+// Запись индекса дискового кэша
+struct DiskCacheEntry {
+    // SHA-256 тела: имя файла с содержимым, одинаковые тела хранятся один раз
+    std::string hash;
+    // Валидаторы для условного запроса (могут быть пустыми)
+    std::string etag;
+    std::string last_modified;
+    uint64_t size = 0;
+    // Время последнего использования (unix time), по нему идет вытеснение
+    int64_t last_used = 0;
+};
+
+// Тело записи, отображенное в память; отображение живет вместе с объектом
+class MappedBody {
+public:
+    explicit MappedBody(const MappedFile& mapped) : mapped(mapped) {}
+    ~MappedBody() { unmap_file(&mapped); }
+
+    MappedBody(const MappedBody&) = delete;
+    MappedBody& operator=(const MappedBody&) = delete;
+
+    const uint8_t* data() const { return static_cast<const uint8_t*>(mapped.data); }
+    size_t size() const { return mapped.size; }
+
+private:
+    MappedFile mapped;
+};
+
+// Постоянный HTTP кэш страниц.
+//
+// Раскладка каталога:
+//   index               - URL -> хэш тела, валидаторы, размер, время использования
+//   objects/ab/abcd...  - тела ответов, имя файла - SHA-256 содержимого
+// Тела читаются через mmap и передаются парсеру без копирования.
+// Методы можно вызывать из любого потока: запись и разбор страниц идут
+// в фоновом конвейере, пока главный поток проверяет валидаторы.
+class DiskCache {
+public:
+    static constexpr uint64_t DEFAULT_BUDGET = 256ull * 1024 * 1024;
+    static constexpr int64_t INDEX_FLUSH_INTERVAL = 5;
+
+    explicit DiskCache(const std::string& directory = default_directory(),
+                       uint64_t budget_bytes = DEFAULT_BUDGET);
+    ~DiskCache();
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    // $XDG_CACHE_HOME/heavenly-webgu или ~/.cache/heavenly-webgu
+    static std::string default_directory();
+
+    // Копия записи: сама запись может измениться в другом потоке
+    bool lookup(const std::string& url, DiskCacheEntry& entry) const;
+
+    // Отображает тело записи в память; nullptr, если записи или файла нет
+    std::unique_ptr<MappedBody> open(const std::string& url);
+
+    bool store(const std::string& url, const uint8_t* data, size_t len,
+               const std::string& etag, const std::string& last_modified);
+
+    // Сервер подтвердил актуальность копии (304)
+    void mark_fresh(const std::string& url);
+
+    void remove(const std::string& url);
+
+    // Сохраняет индекс, если он изменился. store пишет индекс не чаще
+    // раза в INDEX_FLUSH_INTERVAL секунд, остальное дописывает flush
+    void flush();
+
+    uint64_t size_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return total_size;
+    }
+    size_t count() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    std::string object_path(const std::string& hash) const;
+    // Записывает тело под именем хэша, если такого файла еще нет
+    bool write_object(const std::string& hash, const uint8_t* data, size_t len) const;
+    void load_index();
+    void remove_orphan_objects();
+    // Вытесняет давно не использованные записи, кроме keep_url
+    void evict_to_budget(const std::string& keep_url);
+    // Учет ссылок записей на объекты: файл удаляется с последней ссылкой
+    void retain_object(const std::string& hash);
+    void release_object(const std::string& hash);
+    // Версии без захвата mutex, для вызова изнутри других методов
+    void remove_locked(const std::string& url);
+    void flush_locked();
+
+    std::string directory;
+    uint64_t budget;
+    uint64_t total_size;
+    std::unordered_map<std::string, DiskCacheEntry> entries;
+    // Хэш тела -> число записей с ним
+    std::unordered_map<std::string, uint32_t> object_refs;
+    bool index_dirty;
+    // Время последней записи индекса (unix time)
+    int64_t last_flush;
+    // Защищает индекс; хэширование и запись тела идут без него
+    mutable std::mutex mutex;
+};
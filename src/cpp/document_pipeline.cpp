@@ -0,0 +1,197 @@
+#include "document_pipeline.h"
+#include "tracing.h"
+
+namespace {
+    // Забирает строку, выделенную в Rust; NULL превращается в пустую строку
+    std::string take_rust_string(char* value) {
+        if (!value) {
+            return std::string();
+        }
+        std::string result(value);
+        string_free(value);
+        return result;
+    }
+
+    // Адрес документа задается до того, как он станет общим
+    std::shared_ptr<const HtmlDocument> with_url(std::unique_ptr<HtmlDocument> document, const DocumentLoad& load) {
+        if (document) {
+            document->set_document_url(load.document_url.empty() ? load.url : load.document_url);
+        }
+        return document;
+    }
+}
+
+// Задача создается в главном потоке, выполняется в пуле и возвращается
+// в главный поток через очередь ready
+struct DocumentPipeline::Job {
+    uint64_t navigation;
+    // Вкладка, начавшая загрузку: память документа считается за ней
+    unsigned memory_tab;
+    // Навигация в трассе (tracing.h)
+    uint64_t trace_navigation;
+    DocumentLoad load;
+    // Только для загрузки из сети; освобождается в пуле
+    StreamingFetch* stream;
+};
+
+DocumentPipeline::DocumentPipeline(DiskCache& disk_cache, CommitHandler on_commit)
+    : disk_cache(disk_cache)
+    , on_commit(std::move(on_commit))
+    , pool(nullptr)
+    , drain_scheduled(false)
+    , navigation(0)
+{
+    // Одновременно обычно обрабатывается один документ; второй поток
+    // позволяет не ждать, пока досчитается брошенная навигация
+    pool = g_thread_pool_new(run_job, this, 2, FALSE, nullptr);
+}
+
+DocumentPipeline::~DocumentPipeline() {
+    // Незапущенные задачи увидят смену навигации и сразу завершатся
+    navigation.fetch_add(1);
+    g_thread_pool_free(pool, FALSE, TRUE);
+
+    while (g_idle_remove_by_data(this)) {
+    }
+
+    Job* job = nullptr;
+    while (ready.pop(job)) {
+        delete job;
+    }
+}
+
+void DocumentPipeline::begin_navigation() {
+    navigation.fetch_add(1);
+}
+
+void DocumentPipeline::finish_stream(StreamingFetch* stream, const std::string& url) {
+    DocumentLoad load;
+    load.source = DocumentSource::Network;
+    load.url = url;
+    submit(new Job{navigation.load(), MEMORY_NO_TAB, TRACE_NO_NAVIGATION, std::move(load), stream});
+}
+
+void DocumentPipeline::load_from_disk(const std::string& url, DocumentSource source,
+                                      const std::string& document_url) {
+    DocumentLoad load;
+    load.source = source;
+    load.url = url;
+    load.document_url = document_url;
+    submit(new Job{navigation.load(), MEMORY_NO_TAB, TRACE_NO_NAVIGATION, std::move(load), nullptr});
+}
+
+void DocumentPipeline::submit(Job* job) {
+    memory_get_thread_tags(nullptr, &job->memory_tab);
+    job->trace_navigation = trace_get_navigation();
+    g_thread_pool_push(pool, job, nullptr);
+}
+
+bool DocumentPipeline::is_current(const Job* job) const {
+    return job->navigation == navigation.load();
+}
+
+// Поток пула: разбор, стили и снимок DOM; готовый документ - в очередь
+void DocumentPipeline::run_job(gpointer data, gpointer user_data) {
+    Job* job = static_cast<Job*>(data);
+    DocumentPipeline* pipeline = static_cast<DocumentPipeline*>(user_data);
+
+    if (!pipeline->is_current(job)) {
+        if (job->stream) {
+            network_stream_free(job->stream);
+        }
+        delete job;
+        return;
+    }
+
+    {
+        MemoryScope scope(MEMORY_PARSER, job->memory_tab);
+        trace_set_thread_name("document-pipeline");
+        TraceNavigationScope trace_scope(job->trace_navigation);
+        if (job->stream) {
+            pipeline->build_from_stream(job);
+        } else {
+            pipeline->build_from_disk(job);
+        }
+    }
+
+    pipeline->ready.push(job);
+    // Пока drain не отработал, повторно в главный цикл не стучимся
+    if (!pipeline->drain_scheduled.exchange(true)) {
+        g_idle_add(drain, pipeline);
+    }
+}
+
+void DocumentPipeline::build_from_stream(Job* job) {
+    StreamingFetch* stream = job->stream;
+    job->stream = nullptr;
+
+    // Заголовки ответа нужны дисковому кэшу, читаем их до освобождения потока
+    uint16_t http_status = network_stream_http_status(stream);
+    std::string etag = take_rust_string(network_stream_etag(stream));
+    std::string last_modified = take_rust_string(network_stream_last_modified(stream));
+    job->load.document_url = take_rust_string(network_stream_final_url(stream));
+
+    // Документ уже разобран в потоке загрузки, забираем его в свой парсер
+    HtmlParser* parser = html_parse_new();
+    size_t body_len = 0;
+    TraceSpan finish_span("parser", "stream_finish");
+    uint8_t* body = network_stream_finish(stream, parser, &body_len);
+    finish_span.set_bytes(body_len);
+    finish_span.end();
+
+    if (body) {
+        // На диск попадают только успешные ответы
+        if (http_status == 200) {
+            MemoryScope scope(MEMORY_CACHE);
+            TraceSpan span("cache", "disk_store");
+            span.set_bytes(body_len);
+            disk_cache.store(job->load.url, body, body_len, etag, last_modified);
+        }
+        network_bytes_free(body, body_len);
+
+        job->load.body_len = body_len;
+        // Стили и сборка снимка видны внутри отдельными отрезками Rust
+        TraceSpan span("ffi", "ffi_transfer");
+        job->load.document = with_url(HtmlDocument::from_parser(parser), job->load);
+    }
+
+    html_parse_free(parser);
+}
+
+// Тело разбирается прямо из mmap
+void DocumentPipeline::build_from_disk(Job* job) {
+    std::unique_ptr<MappedBody> body = disk_cache.open(job->load.url);
+    if (!body) {
+        return;
+    }
+
+    HtmlParser* parser = html_parse_new();
+    TraceSpan parse_span("parser", "parse");
+    parse_span.set_bytes(body->size());
+    bool parsed = html_parse_bytes(parser, body->data(), body->size());
+    parse_span.end();
+    if (parsed) {
+        job->load.body_len = body->size();
+        TraceSpan span("ffi", "ffi_transfer");
+        job->load.document = with_url(HtmlDocument::from_parser(parser), job->load);
+    }
+    html_parse_free(parser);
+}
+
+// Главный поток
+gboolean DocumentPipeline::drain(gpointer data) {
+    DocumentPipeline* pipeline = static_cast<DocumentPipeline*>(data);
+    // Сбрасываем до разбора очереди, чтобы не потерять результат,
+    // добавленный во время обработки
+    pipeline->drain_scheduled.store(false);
+
+    Job* job = nullptr;
+    while (pipeline->ready.pop(job)) {
+        // Навигация могла смениться, пока документ собирался
+        if (pipeline->is_current(job)) {
+            pipeline->on_commit(job->load);
+        }
+        delete job;
+    }
+    return G_SOURCE_REMOVE;
+}
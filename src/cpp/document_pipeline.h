@@ -0,0 +1,106 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <gtk/gtk.h>
+#include "disk_cache.h"
+#include "html_document.h"
+#include "lockfree_queue.h"
+#include "memory_accounting.h"
+
+// FFI интерфейсы для Rust
+extern "C" {
+    struct StreamingFetch;
+
+    HtmlParser* html_parse_new();
+    void html_parse_free(HtmlParser* parser);
+    bool html_parse_bytes(HtmlParser* parser, const uint8_t* data, size_t len);
+
+    uint16_t network_stream_http_status(StreamingFetch* stream);
+    char* network_stream_etag(StreamingFetch* stream);
+    char* network_stream_last_modified(StreamingFetch* stream);
+    char* network_stream_final_url(StreamingFetch* stream);
+    uint8_t* network_stream_finish(StreamingFetch* stream, HtmlParser* parser, size_t* body_len);
+    void network_stream_free(StreamingFetch* stream);
+    void network_bytes_free(uint8_t* data, size_t len);
+    void string_free(char* ptr);
+}
+
+// Откуда пришел документ: от этого зависит, что делать при ошибке
+enum class DocumentSource {
+    Network,
+    // Сервер ответил 304, показывается сохраненная копия
+    DiskRevalidated,
+    // Сеть недоступна, показывается сохраненная копия
+    DiskOffline,
+};
+
+// Итог фоновой обработки, передается в главный поток
+struct DocumentLoad {
+    DocumentSource source = DocumentSource::Network;
+    std::string url;
+    // Адрес ответа после перенаправлений, если он отличается от url
+    std::string document_url;
+    // nullptr - документ получить не удалось
+    std::shared_ptr<const HtmlDocument> document;
+    size_t body_len = 0;
+};
+
+// Конвейер загрузки документа вне главного потока.
+//
+// Сеть и потоковый разбор уже идут в потоках Rust; сюда уходит все, что
+// раньше оставалось на главном потоке после загрузки: дочитывание потока,
+// разбор сохраненной копии, каскад стилей и сборка снимка DOM, хэширование
+// и запись тела в дисковый кэш. Готовый документ возвращается в главный
+// цикл через очередь без блокировок; главный поток только подставляет его
+// в рендерер. Раскладка остается в виджете страницы: она и так ограничена
+// видимой областью и идет порциями по мере прокрутки.
+//
+// Каждая навигация получает номер; результаты прежних навигаций, в том
+// числе еще не начатые задачи, отбрасываются.
+class DocumentPipeline {
+public:
+    using CommitHandler = std::function<void(const DocumentLoad& load)>;
+
+    DocumentPipeline(DiskCache& disk_cache, CommitHandler on_commit);
+    ~DocumentPipeline();
+
+    DocumentPipeline(const DocumentPipeline&) = delete;
+    DocumentPipeline& operator=(const DocumentPipeline&) = delete;
+
+    // Начинает новую навигацию; результаты прежних больше не придут
+    void begin_navigation();
+
+    // Загрузка завершена: конвейер забирает поток и освобождает его сам
+    void finish_stream(StreamingFetch* stream, const std::string& url);
+
+    // Разбирает сохраненную копию страницы. document_url - адрес ответа
+    // после перенаправлений, если он известен
+    void load_from_disk(const std::string& url, DocumentSource source, const std::string& document_url = std::string());
+
+private:
+    struct Job;
+
+    void submit(Job* job);
+    bool is_current(const Job* job) const;
+
+    // Поток пула
+    static void run_job(gpointer data, gpointer user_data);
+    void build_from_stream(Job* job);
+    void build_from_disk(Job* job);
+
+    // Главный поток: раздает готовые результаты
+    static gboolean drain(gpointer data);
+
+    DiskCache& disk_cache;
+    CommitHandler on_commit;
+    GThreadPool* pool;
+
+    LockFreeQueue<Job*> ready;
+    // Обработчик drain уже запланирован; повторные уведомления схлопываются
+    std::atomic<bool> drain_scheduled;
+    std::atomic<uint64_t> navigation;
+};
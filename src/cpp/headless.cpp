@@ -0,0 +1,470 @@
+#include "headless.h"
+#include "arena_resource.h"
+#include "memory_accounting.h"
+#include "tracing.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double seconds_since(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    // Путь без схемы - локальный файл
+    std::string normalize_url(const std::string& url) {
+        if (url.find("://") != std::string::npos) {
+            return url;
+        }
+        return "file://" + url;
+    }
+
+    // Список адресов: по одному в строке, пустые строки и # - пропускаются
+    bool read_url_list(std::istream& in, std::vector<std::string>& urls) {
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t begin = line.find_first_not_of(" \t\r");
+            if (begin == std::string::npos || line[begin] == '#') {
+                continue;
+            }
+            size_t end = line.find_last_not_of(" \t\r");
+            urls.push_back(normalize_url(line.substr(begin, end - begin + 1)));
+        }
+        return !in.bad();
+    }
+
+    void append_collapsed(std::string_view text, std::string& out) {
+        for (char c : text) {
+            bool space = c == ' ' || c == '\n' || c == '\t' || c == '\r';
+            if (space) {
+                if (!out.empty() && out.back() != ' ') {
+                    out += ' ';
+                }
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    // Текст всех потомков узла со схлопнутыми пробелами
+    std::string node_text(const HtmlDocument& document, uint32_t index) {
+        std::string text;
+        std::vector<uint32_t> stack;
+        for (uint32_t child = document.node(index).first_child(); child != HTML_NO_NODE;
+             child = document.node(child).next_sibling()) {
+            stack.push_back(child);
+        }
+        std::reverse(stack.begin(), stack.end());
+
+        while (!stack.empty()) {
+            HtmlNodeView node = document.node(stack.back());
+            stack.pop_back();
+            if (node.is_text()) {
+                append_collapsed(node.text_content(), text);
+                continue;
+            }
+            size_t first = stack.size();
+            for (uint32_t child = node.first_child(); child != HTML_NO_NODE;
+                 child = document.node(child).next_sibling()) {
+                stack.push_back(child);
+            }
+            std::reverse(stack.begin() + static_cast<std::ptrdiff_t>(first), stack.end());
+        }
+
+        if (!text.empty() && text.back() == ' ') {
+            text.pop_back();
+        }
+        return text;
+    }
+
+    // Строки текста в порядке чтения. Все элементы строки стоят на одной
+    // базовой линии и идут в списке подряд; внутри строки - по x
+    void write_text(const DisplayList& display_list, std::string& out) {
+        std::vector<const DisplayItem*> line;
+        float line_baseline = 0.0f;
+        float previous_bottom = -1.0f;
+
+        auto flush = [&]() {
+            if (line.empty()) {
+                return;
+            }
+            std::sort(line.begin(), line.end(),
+                      [](const DisplayItem* a, const DisplayItem* b) { return a->rect.x < b->rect.x; });
+
+            float top = line.front()->rect.y;
+            float bottom = line.front()->rect.bottom();
+            for (const DisplayItem* item : line) {
+                top = std::min(top, item->rect.y);
+                bottom = std::max(bottom, item->rect.bottom());
+            }
+            // Заметный зазор между строками - граница абзаца
+            if (previous_bottom >= 0.0f && top - previous_bottom > (bottom - top) * 0.5f) {
+                out += '\n';
+            }
+
+            float right = line.front()->rect.x;
+            for (const DisplayItem* item : line) {
+                if (item->rect.x > right + 0.5f && !out.empty() && out.back() != ' ' && out.back() != '\n') {
+                    out += ' ';
+                }
+                out.append(display_list.text(*item));
+                right = item->rect.x + item->rect.width;
+            }
+            out += '\n';
+            previous_bottom = bottom;
+            line.clear();
+        };
+
+        for (const DisplayItem& item : display_list.items) {
+            if (item.kind != DisplayItemKind::Text) {
+                continue;
+            }
+            float baseline = item.rect.y + item.baseline;
+            if (!line.empty() && std::fabs(baseline - line_baseline) > 0.5f) {
+                flush();
+            }
+            if (line.empty()) {
+                line_baseline = baseline;
+            }
+            line.push_back(&item);
+        }
+        flush();
+    }
+
+    void write_links(const HtmlDocument& document, const std::string& url, std::string& out) {
+        for (uint32_t index = 0; index < document.node_count(); index++) {
+            HtmlNodeView node = document.node(index);
+            if (node.tag() != TagAtom::A) {
+                continue;
+            }
+            const std::string& base = document.base_url().empty() ? url : document.base_url();
+            std::string target = BrowserEngine::resolve_link(base, std::string(node.attribute("href")));
+            if (target.empty()) {
+                continue;
+            }
+            out += target;
+            out += '\t';
+            out += node_text(document, index);
+            out += '\n';
+        }
+    }
+
+    const char* item_kind_name(DisplayItemKind kind) {
+        switch (kind) {
+        case DisplayItemKind::Text: return "text";
+        case DisplayItemKind::Rect: return "rect";
+        case DisplayItemKind::Image: return "image";
+        case DisplayItemKind::Control: return "control";
+        }
+        return "unknown";
+    }
+
+    void write_layout(const HtmlDocument& document, const DisplayList& display_list, std::string& out) {
+        char buffer[128];
+        std::snprintf(buffer, sizeof(buffer), "size %.0fx%.0f, %zu items\n",
+                      display_list.width, display_list.height, display_list.items.size());
+        out += buffer;
+
+        for (const DisplayItem& item : display_list.items) {
+            std::snprintf(buffer, sizeof(buffer), "%s %.1f %.1f %.1f %.1f", item_kind_name(item.kind),
+                          item.rect.x, item.rect.y, item.rect.width, item.rect.height);
+            out += buffer;
+            switch (item.kind) {
+            case DisplayItemKind::Text:
+            case DisplayItemKind::Image:
+                // Для изображения в text - src
+                out += " \"";
+                out.append(display_list.text(item));
+                out += '"';
+                break;
+            case DisplayItemKind::Control:
+                out += ' ';
+                out.append(document.node(item.node).tag_name());
+                break;
+            case DisplayItemKind::Rect:
+                break;
+            }
+            out += '\n';
+        }
+    }
+
+    void report_page(std::ostream& report, const HeadlessPage& page) {
+        const PageLoad& load = page.load;
+        if (!load.document) {
+            report << "[error] " << load.url << ": " << load.error << std::endl;
+            return;
+        }
+
+        char buffer[256];
+        std::snprintf(buffer, sizeof(buffer),
+                      "fetch %.1f ms, parse %.1f ms, style %.1f ms, layout %.1f ms, total %.1f ms, %zu KB",
+                      load.timings.fetch * 1000.0, load.timings.parse * 1000.0, load.timings.style * 1000.0,
+                      page.layout * 1000.0, page.total * 1000.0, load.body_len / 1024);
+        report << "[ok] " << load.url << ": " << buffer;
+        if (page.peak_bytes) {
+            report << ", peak memory " << page.peak_bytes / 1024 << " KB";
+        }
+        if (load.from_page_cache) {
+            report << " (кэш страниц)";
+        } else if (load.offline_copy) {
+            report << " (сеть недоступна, сохраненная копия)";
+        }
+        report << std::endl;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p) {
+        if (sorted.empty()) {
+            return 0.0;
+        }
+        size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+}
+
+HeadlessRunner::HeadlessRunner(BrowserEngine& engine, const HeadlessOptions& options)
+    : engine(engine)
+    , options(options)
+{
+}
+
+HeadlessPage HeadlessRunner::process(const std::string& url) {
+    HeadlessPage page;
+    auto start = Clock::now();
+
+    // Каждая страница считается в учете памяти отдельной вкладкой
+    // и отдельной навигацией в трассе
+    unsigned tab = memory_accounting::open_tab();
+    {
+        MemoryScope scope(MEMORY_RENDERER, tab);
+        TraceNavigationScope trace_scope(tracing::next_navigation());
+        TraceSpan navigation_span("navigation", "navigation");
+        page.load = engine.load_page(url);
+
+        if (page.load.document) {
+            ApproximateMetrics metrics;
+            ArenaResource arena;
+            DisplayList display_list(&arena);
+            LayoutEngine layout(metrics);
+
+            auto layout_start = Clock::now();
+            TraceSpan layout_span("layout", "layout");
+            layout.layout(*page.load.document, options.width, display_list);
+            layout_span.end();
+            page.layout = seconds_since(layout_start);
+
+            write_output(*page.load.document, display_list, url, page.output);
+        }
+
+        if (tab != MEMORY_NO_TAB) {
+            page.peak_bytes = memory_accounting::tab(tab).peak_bytes();
+        }
+    }
+    page.total = seconds_since(start);
+
+    if (tab != MEMORY_NO_TAB) {
+        memory_accounting::close_tab(tab);
+    }
+    return page;
+}
+
+void HeadlessRunner::write_output(const HtmlDocument& document, const DisplayList& display_list,
+                                  const std::string& url, std::string& out) const {
+    out += "# ";
+    out += url;
+    out += '\n';
+
+    switch (options.output) {
+    case HeadlessOutput::Text:
+        write_text(display_list, out);
+        break;
+    case HeadlessOutput::Links:
+        write_links(document, url, out);
+        break;
+    case HeadlessOutput::Layout:
+        write_layout(document, display_list, out);
+        break;
+    }
+    out += '\n';
+}
+
+int HeadlessRunner::run(std::ostream& out, std::ostream& report) {
+    size_t count = options.urls.size();
+    if (count == 0) {
+        return 0;
+    }
+
+    unsigned jobs = options.jobs ? options.jobs : std::max(1u, std::thread::hardware_concurrency());
+    jobs = static_cast<unsigned>(std::min<size_t>(jobs, count));
+
+    // Потоки берут страницы по очереди, готовые результаты ждут своей
+    // очереди на вывод: порядок вывода совпадает со списком
+    std::vector<HeadlessPage> pages(count);
+    std::vector<bool> ready(count, false);
+    std::mutex mutex;
+    std::condition_variable page_ready;
+    std::atomic<size_t> next(0);
+
+    auto start = Clock::now();
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < jobs; i++) {
+        workers.emplace_back([&]() {
+            trace_set_thread_name("headless-worker");
+            for (;;) {
+                size_t index = next.fetch_add(1);
+                if (index >= count) {
+                    return;
+                }
+                HeadlessPage page = process(options.urls[index]);
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    pages[index] = std::move(page);
+                    ready[index] = true;
+                }
+                page_ready.notify_all();
+            }
+        });
+    }
+
+    size_t failures = 0;
+    std::vector<double> totals;
+    for (size_t index = 0; index < count; index++) {
+        HeadlessPage page;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            page_ready.wait(lock, [&]() { return ready[index]; });
+            page = std::move(pages[index]);
+        }
+
+        out << page.output;
+        out.flush();
+        report_page(report, page);
+        if (page.load.document) {
+            totals.push_back(page.total);
+        } else {
+            failures++;
+        }
+    }
+
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    double elapsed = seconds_since(start);
+    std::sort(totals.begin(), totals.end());
+    char buffer[256];
+    std::snprintf(buffer, sizeof(buffer),
+                  "Страниц: %zu, ошибок: %zu, потоков: %u, время %.2f s (%.1f стр./с), "
+                  "на страницу p50 %.1f ms, p99 %.1f ms",
+                  count, failures, jobs, elapsed, elapsed > 0.0 ? count / elapsed : 0.0,
+                  percentile(totals, 0.50) * 1000.0, percentile(totals, 0.99) * 1000.0);
+    report << buffer << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
+
+bool HeadlessRunner::parse_args(int argc, char* argv[], HeadlessOptions& options, std::string& error) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool has_value = i + 1 < argc;
+
+        if (arg == "--headless") {
+            continue;
+        } else if (arg == "--output" && has_value) {
+            std::string value = argv[++i];
+            if (value == "text") {
+                options.output = HeadlessOutput::Text;
+            } else if (value == "links") {
+                options.output = HeadlessOutput::Links;
+            } else if (value == "layout") {
+                options.output = HeadlessOutput::Layout;
+            } else {
+                error = "Неизвестный формат вывода: " + value;
+                return false;
+            }
+        } else if (arg == "--jobs" && has_value) {
+            int jobs = std::atoi(argv[++i]);
+            if (jobs <= 0) {
+                error = "--jobs: нужно положительное число";
+                return false;
+            }
+            options.jobs = static_cast<unsigned>(jobs);
+        } else if (arg == "--width" && has_value) {
+            float width = static_cast<float>(std::atof(argv[++i]));
+            if (width <= 0.0f) {
+                error = "--width: нужно положительное число";
+                return false;
+            }
+            options.width = width;
+        } else if (arg == "--urls" && has_value) {
+            std::string path = argv[++i];
+            bool ok;
+            if (path == "-") {
+                ok = read_url_list(std::cin, options.urls);
+            } else {
+                std::ifstream file(path);
+                ok = file && read_url_list(file, options.urls);
+            }
+            if (!ok) {
+                error = "Не удалось прочитать список адресов: " + path;
+                return false;
+            }
+        } else if (arg == "--trace" && has_value) {
+            options.trace_path = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            error = "Неизвестный параметр: " + arg;
+            return false;
+        } else {
+            options.urls.push_back(normalize_url(arg));
+        }
+    }
+
+    if (options.urls.empty()) {
+        error = "Не заданы адреса страниц";
+        return false;
+    }
+    return true;
+}
+
+const char* HeadlessRunner::usage() {
+    return "Использование: --headless [--output text|links|layout] [--jobs N] [--width PX]\n"
+           "                [--urls FILE|-] [--trace FILE] [URL|PATH ...]\n"
+           "  Результат по каждой странице - в stdout, время этапов и сводка - в stderr.\n"
+           "  --trace: этапы загрузки всех страниц в формате Chrome trace_event.\n"
+           "  Путь без схемы читается как локальный файл.\n";
+}
+
+int headless_main(int argc, char* argv[]) {
+    HeadlessOptions options;
+    std::string error;
+    if (!HeadlessRunner::parse_args(argc, argv, options, error)) {
+        std::cerr << error << std::endl << HeadlessRunner::usage();
+        return 2;
+    }
+
+    if (options.trace_path.empty()) {
+        options.trace_path = tracing::output_path();
+    }
+    if (!options.trace_path.empty()) {
+        tracing::set_enabled(true);
+    }
+
+    BrowserEngine engine;
+    HeadlessRunner runner(engine, options);
+    int status = runner.run(std::cout, std::cerr);
+
+    if (!options.trace_path.empty() && !tracing::write_chrome_json(options.trace_path)) {
+        std::cerr << "Не удалось записать трассу: " << options.trace_path << std::endl;
+    }
+    return status;
+}
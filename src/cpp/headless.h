@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "browser_engine.h"
+#include "layout_engine.h"
+
+// Что печатать по каждой странице
+enum class HeadlessOutput {
+    // Видимый текст после раскладки, по строкам
+    Text,
+    // Абсолютные адреса ссылок и их текст
+    Links,
+    // Элементы списка отображения с координатами
+    Layout,
+};
+
+struct HeadlessOptions {
+    HeadlessOutput output = HeadlessOutput::Text;
+    // Потоков обработки; 0 - по числу ядер
+    unsigned jobs = 0;
+    float width = 1024.0f;
+    std::vector<std::string> urls;
+    // Куда записать трассу этапов (tracing.h), пусто - без трассировки
+    std::string trace_path;
+};
+
+// Итог обработки одной страницы
+struct HeadlessPage {
+    PageLoad load;
+    double layout = 0.0;
+    double total = 0.0;
+    // Пик памяти страницы: C, C++ и Rust вместе
+    size_t peak_bytes = 0;
+    std::string output;
+};
+
+// Пакетная обработка страниц без экрана и без GTK: загрузка, разбор,
+// стили и раскладка с приблизительными метриками шрифта. Страницы
+// обрабатываются параллельно в пуле потоков; вывод идет в порядке списка,
+// время этапов по каждой странице и сводка - в отдельный поток отчета.
+class HeadlessRunner {
+public:
+    HeadlessRunner(BrowserEngine& engine, const HeadlessOptions& options);
+
+    // 0 - все страницы обработаны, 1 - были ошибки
+    int run(std::ostream& out, std::ostream& report);
+
+    // Разбор аргументов командной строки (после --headless); false - ошибка,
+    // описание в error
+    static bool parse_args(int argc, char* argv[], HeadlessOptions& options, std::string& error);
+    static const char* usage();
+
+private:
+    HeadlessPage process(const std::string& url);
+    void write_output(const HtmlDocument& document, const DisplayList& display_list,
+                      const std::string& url, std::string& out) const;
+
+    BrowserEngine& engine;
+    HeadlessOptions options;
+};
+
+// Точка входа headless-режима: HeavenlyWebGu --headless ... и heavenly_headless
+int headless_main(int argc, char* argv[]);
@@ -0,0 +1,7 @@
+#include "headless.h"
+
+// Сборка без GTK (heavenly_headless): только пакетная обработка страниц,
+// параметры те же, что у HeavenlyWebGu --headless
+int main(int argc, char* argv[]) {
+    return headless_main(argc, argv);
+}
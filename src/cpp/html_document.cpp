@@ -0,0 +1,127 @@
+#include "html_document.h"
+#include "logger.h"
+
+namespace {
+    constexpr uint32_t SNAPSHOT_MAGIC = 0x48574753; // "HWGS"
+    constexpr uint32_t SNAPSHOT_VERSION = 4;
+}
+
+std::string resolve_url(std::string_view base, std::string_view href) {
+    std::string base_copy(base);
+    std::string href_copy(href);
+    char* url = network_resolve_url(base_copy.empty() ? nullptr : base_copy.c_str(), href_copy.c_str());
+    if (!url) {
+        return std::string();
+    }
+    std::string result(url);
+    string_free(url);
+    return result;
+}
+
+std::string_view HtmlNodeView::tag_name() const {
+    return document->string(node->tag);
+}
+
+std::string_view HtmlNodeView::text_content() const {
+    return document->string(node->text);
+}
+
+std::string_view HtmlNodeView::label_text() const {
+    constexpr std::string_view spaces = " \t\n\r\f";
+    std::string_view text = text_content();
+    size_t begin = text.find_first_not_of(spaces);
+    if (begin == std::string_view::npos) {
+        return {};
+    }
+    return text.substr(begin, text.find_last_not_of(spaces) - begin + 1);
+}
+
+const HtmlSnapshotStyle* HtmlNodeView::style() const {
+    if (node->style == HTML_NO_STYLE || node->style >= document->style_count()) {
+        return nullptr;
+    }
+    return &document->style(node->style);
+}
+
+std::string_view HtmlNodeView::attribute_name(size_t index) const {
+    return document->string(document->attr(node->first_attr + index).name);
+}
+
+std::string_view HtmlNodeView::attribute_value(size_t index) const {
+    return document->string(document->attr(node->first_attr + index).value);
+}
+
+std::string_view HtmlNodeView::attribute(std::string_view name) const {
+    for (size_t i = 0; i < node->attr_count; i++) {
+        if (attribute_name(i) == name) {
+            return attribute_value(i);
+        }
+    }
+    return std::string_view();
+}
+
+bool HtmlNodeView::has_attribute(std::string_view name) const {
+    for (size_t i = 0; i < node->attr_count; i++) {
+        if (attribute_name(i) == name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::unique_ptr<HtmlDocument> HtmlDocument::from_parser(HtmlParser* parser) {
+    if (!parser) {
+        return nullptr;
+    }
+
+    return adopt(html_get_snapshot(parser));
+}
+
+std::unique_ptr<HtmlDocument> HtmlDocument::adopt(const HtmlSnapshot* snapshot) {
+    if (!snapshot) {
+        return nullptr;
+    }
+
+    // Защищаемся от рассинхронизации раскладки между Rust и C++
+    if (snapshot->magic != SNAPSHOT_MAGIC || snapshot->version != SNAPSHOT_VERSION) {
+        LOG_ERROR("document") << "Ошибка: несовместимая версия снимка DOM";
+        html_snapshot_free(snapshot);
+        return nullptr;
+    }
+    if (snapshot->tag_table_hash != TAG_TABLE_HASH) {
+        LOG_ERROR("document") << "Ошибка: таблицы атомов тегов в Rust и C++ не совпадают";
+        html_snapshot_free(snapshot);
+        return nullptr;
+    }
+
+    return std::unique_ptr<HtmlDocument>(new HtmlDocument(snapshot));
+}
+
+HtmlDocument::HtmlDocument(const HtmlSnapshot* snapshot)
+    : snapshot(snapshot)
+{
+    const char* base = reinterpret_cast<const char*>(snapshot);
+    nodes = reinterpret_cast<const HtmlSnapshotNode*>(base + snapshot->nodes_offset);
+    attrs = reinterpret_cast<const HtmlSnapshotAttr*>(base + snapshot->attrs_offset);
+    styles = reinterpret_cast<const HtmlSnapshotStyle*>(base + snapshot->styles_offset);
+    strings = base + snapshot->strings_offset;
+}
+
+HtmlDocument::~HtmlDocument() {
+    html_snapshot_free(snapshot);
+}
+
+void HtmlDocument::set_document_url(const std::string& url) {
+    base = url;
+    // Действует только первый <base href> - так же считает и сканер
+    for (size_t index = 0; index < node_count(); index++) {
+        HtmlNodeView element = node(index);
+        if (element.tag() == TagAtom::Base && element.has_attribute("href")) {
+            std::string resolved = resolve_url(url, element.attribute("href"));
+            if (!resolved.empty()) {
+                base = std::move(resolved);
+            }
+            break;
+        }
+    }
+}
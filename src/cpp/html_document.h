@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "tag_atoms.h"
+
+// FFI интерфейсы для Rust: плоский снимок DOM (см. src/rust/src/snapshot.rs)
+extern "C" {
+    struct HtmlParser;
+
+    // Разрешение адресов по правилам WHATWG, как у сканера упреждающей загрузки
+    char* network_resolve_url(const char* base, const char* href);
+    void string_free(char* ptr);
+
+    struct HtmlSnapshotStr {
+        uint32_t offset;
+        uint32_t len;
+    };
+
+    struct HtmlSnapshotNode {
+        HtmlSnapshotStr tag;
+        HtmlSnapshotStr text;
+        uint32_t first_attr;
+        uint32_t attr_count;
+        uint32_t kind;
+        // Структура дерева: индексы узлов, HTML_NO_NODE - нет узла
+        uint32_t parent;
+        uint32_t first_child;
+        uint32_t next_sibling;
+        // Индекс в таблице стилей или HTML_NO_STYLE
+        uint32_t style;
+        // TagAtom; 0 - неизвестный тег, имя есть только в tag
+        uint32_t tag_atom;
+    };
+
+    struct HtmlSnapshotAttr {
+        HtmlSnapshotStr name;
+        HtmlSnapshotStr value;
+    };
+
+    // Вычисленный стиль элемента (каскад считается в Rust, см. src/rust/src/style.rs)
+    struct HtmlSnapshotStyle {
+        float font_size;
+        // 0xRRGGBB
+        uint32_t color;
+        // Вертикальные поля вместе с внутренними отступами
+        float margin_top;
+        float margin_bottom;
+        // Сдвиг содержимого вправо: margin-left + padding-left
+        float indent;
+        // HtmlDisplay
+        uint8_t display;
+        uint8_t bold;
+        uint8_t italic;
+        uint8_t monospace;
+        uint8_t underline;
+        uint8_t preformatted;
+        uint8_t reserved[2];
+    };
+
+    struct HtmlSnapshot {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t total_size;
+        uint32_t node_count;
+        uint32_t attr_count;
+        uint32_t nodes_offset;
+        uint32_t attrs_offset;
+        uint32_t strings_offset;
+        uint32_t strings_len;
+        uint32_t style_count;
+        uint32_t styles_offset;
+        // Должна совпадать с TAG_TABLE_HASH, иначе номера атомов разошлись
+        uint32_t tag_table_hash;
+    };
+
+    const HtmlSnapshot* html_get_snapshot(HtmlParser* parser);
+    void html_snapshot_free(const HtmlSnapshot* snapshot);
+}
+
+constexpr uint32_t HTML_NO_NODE = UINT32_MAX;
+constexpr uint32_t HTML_NO_STYLE = UINT32_MAX;
+
+enum class HtmlNodeKind : uint32_t {
+    Document = 0,
+    Element = 1,
+    Text = 2,
+};
+
+// Значение CSS display после каскада
+enum class HtmlDisplay : uint8_t {
+    None = 0,
+    Inline = 1,
+    Block = 2,
+    ListItem = 3,
+    TableCell = 4,
+};
+
+class HtmlDocument;
+
+// Узел документа: указатели прямо в буфер снимка, строки не копируются.
+// Все string_view завершаются '\0', поэтому data() можно отдавать в GTK.
+class HtmlNodeView {
+public:
+    HtmlNodeView(const HtmlDocument* document, const HtmlSnapshotNode* node)
+        : document(document), node(node) {}
+
+    std::string_view tag_name() const;
+    // Известный тег для switch; у текста, корня и нестандартных тегов - Unknown
+    TagAtom tag() const { return static_cast<TagAtom>(node->tag_atom); }
+    std::string_view text_content() const;
+    // Текст без пробелов по краям: DOM хранит текст как есть, а подписи
+    // кнопок и пунктов списка показываются без них
+    std::string_view label_text() const;
+
+    HtmlNodeKind kind() const { return static_cast<HtmlNodeKind>(node->kind); }
+    bool is_element() const { return kind() == HtmlNodeKind::Element; }
+    bool is_text() const { return kind() == HtmlNodeKind::Text; }
+
+    uint32_t parent() const { return node->parent; }
+    uint32_t first_child() const { return node->first_child; }
+    uint32_t next_sibling() const { return node->next_sibling; }
+
+    // Вычисленный стиль элемента; nullptr у текста и корня документа
+    const HtmlSnapshotStyle* style() const;
+
+    size_t attribute_count() const { return node->attr_count; }
+    std::string_view attribute_name(size_t index) const;
+    std::string_view attribute_value(size_t index) const;
+
+    // Значение атрибута или пустая строка, если атрибута нет
+    std::string_view attribute(std::string_view name) const;
+    bool has_attribute(std::string_view name) const;
+
+private:
+    const HtmlDocument* document;
+    const HtmlSnapshotNode* node;
+};
+
+// Абсолютный URL href относительно base тем же разбором, что в Rust: под
+// этим адресом картинку ищет сканер упреждающей загрузки. Пустая строка -
+// адрес не разбирается
+std::string resolve_url(std::string_view base, std::string_view href);
+
+// Владеет снимком DOM, полученным от Rust, и освобождает его одним вызовом.
+// После создания неизменяем, поэтому один документ можно разделять между
+// вкладками и кэшем через std::shared_ptr<const HtmlDocument>
+class HtmlDocument {
+public:
+    // Забирает снимок у текущего документа парсера; nullptr при ошибке
+    static std::unique_ptr<HtmlDocument> from_parser(HtmlParser* parser);
+    
+    // Принимает владение готовым снимком (например, частичным при потоковой загрузке)
+    static std::unique_ptr<HtmlDocument> adopt(const HtmlSnapshot* snapshot);
+
+    ~HtmlDocument();
+
+    HtmlDocument(const HtmlDocument&) = delete;
+    HtmlDocument& operator=(const HtmlDocument&) = delete;
+
+    size_t node_count() const { return snapshot->node_count; }
+    HtmlNodeView node(size_t index) const { return HtmlNodeView(this, nodes + index); }
+
+    // Размер буфера снимка в байтах
+    size_t byte_size() const { return static_cast<size_t>(snapshot->total_size); }
+
+    std::string_view string(const HtmlSnapshotStr& str) const {
+        return std::string_view(strings + str.offset, str.len);
+    }
+    const HtmlSnapshotAttr& attr(size_t index) const { return attrs[index]; }
+
+    size_t style_count() const { return snapshot->style_count; }
+    const HtmlSnapshotStyle& style(size_t index) const { return styles[index]; }
+
+    // Адрес документа после перенаправлений с учетом первого <base href>;
+    // от него считаются относительные адреса. Пусто - адрес неизвестен
+    const std::string& base_url() const { return base; }
+    // Вызывается до того, как документ станет общим
+    void set_document_url(const std::string& url);
+
+private:
+    explicit HtmlDocument(const HtmlSnapshot* snapshot);
+
+    const HtmlSnapshot* snapshot;
+    const HtmlSnapshotNode* nodes;
+    const HtmlSnapshotAttr* attrs;
+    const HtmlSnapshotStyle* styles;
+    const char* strings;
+    std::string base;
+};
@@ -1,5 +1,5 @@
 #include "html_renderer.h"
-#include <iostream>
+#include "logger.h"
 #include <sstream>
 #include <cctype>
 
@@ -13,7 +13,7 @@ bool HtmlRenderer::parse_json(const std::string& json) {
     // Упрощенный JSON парсер для HTML элементов
     clear();
     
-    std::cout << "Начинаем парсинг JSON, длина: " << json.length() << std::endl;
+    LOG_DEBUG("renderer") << "Начинаем парсинг JSON, длина: " << json.length();
     
     // Ограничиваем количество элементов для производительности
     const size_t MAX_ELEMENTS = 1000;
@@ -42,6 +42,7 @@ bool HtmlRenderer::parse_json(const std::string& json) {
         
         // Извлекаем имя тега
         element.tag_name = json.substr(value_start + 1, value_end - value_start - 1);
+        element.tag = tag_atom(element.tag_name);
         
         // Ищем атрибуты (упрощенно)
         size_t attr_start = json.find("\"attributes\"", tag_pos);
@@ -66,14 +67,14 @@ bool HtmlRenderer::parse_json(const std::string& json) {
             element_count++;
             
             if (element_count % 100 == 0) {
-                std::cout << "Найдено элементов: " << element_count << std::endl;
+                LOG_TRACE("renderer") << "Найдено элементов: " << element_count;
             }
         }
         
         pos = value_end + 1;
     }
     
-    std::cout << "Всего найдено элементов: " << elements.size() << std::endl;
+    LOG_DEBUG("renderer") << "Всего найдено элементов: " << elements.size();
     return !elements.empty();
 }
 
@@ -82,7 +83,7 @@ GtkWidget* HtmlRenderer::render_to_widget() {
         return gtk_label_new("Нет контента для отображения");
     }
     
-    std::cout << "Рендерим " << elements.size() << " элементов" << std::endl;
+    LOG_DEBUG("renderer") << "Рендерим " << elements.size() << " элементов";
     
     // Создаем основной контейнер
     GtkWidget* main_container = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
@@ -105,10 +106,15 @@ GtkWidget* HtmlRenderer::render_to_widget() {
         }
         
         // Пропускаем технические теги
-        if (element.tag_name == "head" || element.tag_name == "script" || 
-            element.tag_name == "style" || element.tag_name == "meta" ||
-            element.tag_name == "link") {
+        switch (element.tag) {
+        case TagAtom::Head:
+        case TagAtom::Script:
+        case TagAtom::Style:
+        case TagAtom::Meta:
+        case TagAtom::Link:
             continue;
+        default:
+            break;
         }
         
         // Создаем виджет для элемента
@@ -131,41 +137,50 @@ GtkWidget* HtmlRenderer::render_to_widget() {
         }
     }
     
-    std::cout << "Отрендерено " << rendered_count << " элементов" << std::endl;
+    LOG_DEBUG("renderer") << "Отрендерено " << rendered_count << " элементов";
     return main_container;
 }
 
 GtkWidget* HtmlRenderer::create_element_widget(const HtmlElement& element) {
     GtkWidget* widget = nullptr;
     
-    if (element.tag_name == "html" || element.tag_name == "body") {
+    switch (element.tag) {
+    case TagAtom::Html:
+    case TagAtom::Body:
         // Контейнер для основного контента
         widget = gtk_box_new(GTK_ORIENTATION_VERTICAL, 2);
-    }
-    else if (element.tag_name == "head") {
+        break;
+        
+    case TagAtom::Head:
         // Пропускаем head
         return nullptr;
-    }
-    else if (element.tag_name == "title") {
+        
+    case TagAtom::Title:
         // Заголовок страницы
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "title");
-    }
-    else if (element.tag_name == "h1" || element.tag_name == "h2" || 
-             element.tag_name == "h3" || element.tag_name == "h4" || 
-             element.tag_name == "h5" || element.tag_name == "h6") {
+        break;
+        
+    case TagAtom::H1:
+    case TagAtom::H2:
+    case TagAtom::H3:
+    case TagAtom::H4:
+    case TagAtom::H5:
+    case TagAtom::H6:
         // Заголовки
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "heading");
-    }
-    else if (element.tag_name == "p") {
+        break;
+        
+    case TagAtom::P:
         // Параграфы
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "paragraph");
         gtk_label_set_line_wrap(GTK_LABEL(widget), TRUE);
         gtk_label_set_line_wrap_mode(GTK_LABEL(widget), PANGO_WRAP_WORD_CHAR);
-    }
-    else if (element.tag_name == "a") {
+        break;
+        
+    case TagAtom::A: {
         // Ссылки
         widget = gtk_link_button_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "link");
@@ -175,8 +190,10 @@ GtkWidget* HtmlRenderer::create_element_widget(const HtmlElement& element) {
         if (it != element.attributes.end()) {
             gtk_link_button_set_uri(GTK_LINK_BUTTON(widget), it->second.c_str());
         }
+        break;
     }
-    else if (element.tag_name == "img") {
+        
+    case TagAtom::Img: {
         // Изображения
         widget = gtk_image_new_from_icon_name("image-x-generic", GTK_ICON_SIZE_DIALOG);
         gtk_widget_set_name(widget, "image");
@@ -187,43 +204,55 @@ GtkWidget* HtmlRenderer::create_element_widget(const HtmlElement& element) {
             // TODO: Загружать реальное изображение
             gtk_image_set_from_icon_name(GTK_IMAGE(widget), "image-x-generic", GTK_ICON_SIZE_DIALOG);
         }
+        break;
     }
-    else if (element.tag_name == "div" || element.tag_name == "span") {
+        
+    case TagAtom::Div:
+    case TagAtom::Span:
         // Контейнеры
         widget = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 2);
         gtk_widget_set_name(widget, "container");
-    }
-    else if (element.tag_name == "ul" || element.tag_name == "ol") {
+        break;
+        
+    case TagAtom::Ul:
+    case TagAtom::Ol:
         // Списки
         widget = gtk_list_box_new();
         gtk_widget_set_name(widget, "list");
-    }
-    else if (element.tag_name == "li") {
+        break;
+        
+    case TagAtom::Li:
         // Элементы списка
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "list-item");
-    }
-    else if (element.tag_name == "table") {
+        break;
+        
+    case TagAtom::Table:
         // Таблицы
         widget = gtk_grid_new();
         gtk_widget_set_name(widget, "table");
-    }
-    else if (element.tag_name == "tr") {
+        break;
+        
+    case TagAtom::Tr:
         // Строки таблицы
         widget = gtk_box_new(GTK_ORIENTATION_HORIZONTAL, 2);
         gtk_widget_set_name(widget, "table-row");
-    }
-    else if (element.tag_name == "td" || element.tag_name == "th") {
+        break;
+        
+    case TagAtom::Td:
+    case TagAtom::Th:
         // Ячейки таблицы
         widget = gtk_label_new(element.text_content.c_str());
-        gtk_widget_set_name(widget, element.tag_name == "th" ? "table-header" : "table-cell");
-    }
-    else if (element.tag_name == "form") {
+        gtk_widget_set_name(widget, element.tag == TagAtom::Th ? "table-header" : "table-cell");
+        break;
+        
+    case TagAtom::Form:
         // Формы
         widget = gtk_box_new(GTK_ORIENTATION_VERTICAL, 5);
         gtk_widget_set_name(widget, "form");
-    }
-    else if (element.tag_name == "input") {
+        break;
+        
+    case TagAtom::Input: {
         // Поля ввода
         auto it = element.attributes.find("type");
         if (it != element.attributes.end()) {
@@ -241,42 +270,51 @@ GtkWidget* HtmlRenderer::create_element_widget(const HtmlElement& element) {
             widget = gtk_entry_new();
         }
         gtk_widget_set_name(widget, "input");
+        break;
     }
-    else if (element.tag_name == "textarea") {
+        
+    case TagAtom::Textarea:
         // Многострочные поля ввода
         widget = gtk_text_view_new();
         gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(widget), GTK_WRAP_WORD_CHAR);
         gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(widget)), 
                                 element.text_content.c_str(), -1);
         gtk_widget_set_name(widget, "textarea");
-    }
-    else if (element.tag_name == "select") {
+        break;
+        
+    case TagAtom::Select:
         // Выпадающие списки
         widget = gtk_combo_box_text_new();
         gtk_widget_set_name(widget, "select");
-    }
-    else if (element.tag_name == "option") {
+        break;
+        
+    case TagAtom::Option:
         // Опции выпадающего списка
         // TODO: Добавлять в родительский select
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "option");
-    }
-    else if (element.tag_name == "button") {
+        break;
+        
+    case TagAtom::Button:
         // Кнопки
         widget = gtk_button_new_with_label(element.text_content.c_str());
         gtk_widget_set_name(widget, "button");
-    }
-    else if (element.tag_name == "br") {
+        break;
+        
+    case TagAtom::Br:
         // Перенос строки
         widget = gtk_label_new("");
         gtk_widget_set_name(widget, "line-break");
-    }
-    else if (element.tag_name == "hr") {
+        break;
+        
+    case TagAtom::Hr:
         // Горизонтальная линия
         widget = gtk_separator_new(GTK_ORIENTATION_HORIZONTAL);
         gtk_widget_set_name(widget, "horizontal-rule");
-    }
-    else if (element.tag_name == "code" || element.tag_name == "pre") {
+        break;
+        
+    case TagAtom::Code:
+    case TagAtom::Pre:
         // Код
         widget = gtk_text_view_new();
         gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(widget), GTK_WRAP_CHAR);
@@ -284,118 +322,103 @@ GtkWidget* HtmlRenderer::create_element_widget(const HtmlElement& element) {
         gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(widget)), 
                                 element.text_content.c_str(), -1);
         gtk_widget_set_name(widget, "code");
-    }
-    else if (element.tag_name == "strong" || element.tag_name == "b") {
+        break;
+        
+    case TagAtom::Strong:
+    case TagAtom::B:
         // Жирный текст
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "bold");
-    }
-    else if (element.tag_name == "em" || element.tag_name == "i") {
+        break;
+        
+    case TagAtom::Em:
+    case TagAtom::I:
         // Курсив
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "italic");
-    }
-    else if (element.tag_name == "u") {
+        break;
+        
+    case TagAtom::U:
         // Подчеркнутый текст
         widget = gtk_label_new(element.text_content.c_str());
         gtk_widget_set_name(widget, "underline");
-    }
-    else if (element.tag_name == "blockquote") {
+        break;
+        
+    case TagAtom::Blockquote: {
         // Цитата
         widget = gtk_frame_new(nullptr);
         GtkWidget* label = gtk_label_new(element.text_content.c_str());
         gtk_container_add(GTK_CONTAINER(widget), label);
         gtk_widget_set_name(widget, "blockquote");
+        break;
     }
-    else {
+        
+    default:
         // Неизвестный тег - отображаем как текст
         if (!element.text_content.empty()) {
             widget = gtk_label_new(element.text_content.c_str());
             gtk_widget_set_name(widget, "unknown");
         }
+        break;
     }
     
     if (widget) {
-        apply_styles(widget, element.tag_name);
+        apply_styles(widget, element.tag);
     }
     
     return widget;
 }
 
-void HtmlRenderer::apply_styles(GtkWidget* widget, const std::string& tag_name) {
+void HtmlRenderer::apply_styles(GtkWidget* widget, TagAtom tag) {
     if (!widget) return;
     
-    // Применяем базовые стили в зависимости от тега
-    if (tag_name == "h1") {
-        gtk_widget_set_margin_start(widget, 10);
-        gtk_widget_set_margin_end(widget, 10);
-        gtk_widget_set_margin_top(widget, 15);
-        gtk_widget_set_margin_bottom(widget, 10);
-    }
-    else if (tag_name == "h2" || tag_name == "h3") {
-        gtk_widget_set_margin_start(widget, 15);
-        gtk_widget_set_margin_end(widget, 15);
-        gtk_widget_set_margin_top(widget, 10);
-        gtk_widget_set_margin_bottom(widget, 5);
-    }
-    else if (tag_name == "p") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 5);
-        gtk_widget_set_margin_bottom(widget, 5);
-    }
-    else if (tag_name == "a") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-    }
-    else if (tag_name == "img") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 10);
-        gtk_widget_set_margin_bottom(widget, 10);
-    }
-    else if (tag_name == "ul" || tag_name == "ol") {
-        gtk_widget_set_margin_start(widget, 30);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 5);
-        gtk_widget_set_margin_bottom(widget, 5);
-    }
-    else if (tag_name == "li") {
-        gtk_widget_set_margin_start(widget, 10);
-        gtk_widget_set_margin_end(widget, 10);
-        gtk_widget_set_margin_top(widget, 2);
-        gtk_widget_set_margin_bottom(widget, 2);
-    }
-    else if (tag_name == "table") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 10);
-        gtk_widget_set_margin_bottom(widget, 10);
-    }
-    else if (tag_name == "form") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 15);
-        gtk_widget_set_margin_bottom(widget, 15);
-    }
-    else if (tag_name == "input" || tag_name == "textarea" || tag_name == "select") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 5);
-        gtk_widget_set_margin_bottom(widget, 5);
-    }
-    else if (tag_name == "button") {
-        gtk_widget_set_margin_start(widget, 20);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 10);
-        gtk_widget_set_margin_bottom(widget, 10);
-    }
-    else if (tag_name == "blockquote") {
-        gtk_widget_set_margin_start(widget, 30);
-        gtk_widget_set_margin_end(widget, 20);
-        gtk_widget_set_margin_top(widget, 10);
-        gtk_widget_set_margin_bottom(widget, 10);
+    // Поля по тегу: слева, справа, сверху, снизу
+    int start = 0, end = 0, top = 0, bottom = 0;
+    switch (tag) {
+    case TagAtom::H1:
+        start = 10; end = 10; top = 15; bottom = 10;
+        break;
+    case TagAtom::H2:
+    case TagAtom::H3:
+        start = 15; end = 15; top = 10; bottom = 5;
+        break;
+    case TagAtom::P:
+        start = 20; end = 20; top = 5; bottom = 5;
+        break;
+    case TagAtom::A:
+        start = 20; end = 20;
+        break;
+    case TagAtom::Img:
+    case TagAtom::Table:
+    case TagAtom::Button:
+        start = 20; end = 20; top = 10; bottom = 10;
+        break;
+    case TagAtom::Ul:
+    case TagAtom::Ol:
+        start = 30; end = 20; top = 5; bottom = 5;
+        break;
+    case TagAtom::Li:
+        start = 10; end = 10; top = 2; bottom = 2;
+        break;
+    case TagAtom::Form:
+        start = 20; end = 20; top = 15; bottom = 15;
+        break;
+    case TagAtom::Input:
+    case TagAtom::Textarea:
+    case TagAtom::Select:
+        start = 20; end = 20; top = 5; bottom = 5;
+        break;
+    case TagAtom::Blockquote:
+        start = 30; end = 20; top = 10; bottom = 10;
+        break;
+    default:
+        return;
     }
+    
+    gtk_widget_set_margin_start(widget, start);
+    gtk_widget_set_margin_end(widget, end);
+    gtk_widget_set_margin_top(widget, top);
+    gtk_widget_set_margin_bottom(widget, bottom);
 }
 
 void HtmlRenderer::clear() {
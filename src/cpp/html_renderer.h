@@ -5,8 +5,12 @@
 #include <map>
 #include <gtk/gtk.h>
 
+#include "tag_atoms.h"
+
 struct HtmlElement {
     std::string tag_name;
+    // Вычисляется один раз при разборе, отрисовка выбирает ветку по нему
+    TagAtom tag = TagAtom::Unknown;
     std::map<std::string, std::string> attributes;
     std::string text_content;
     std::vector<HtmlElement> children;
@@ -33,5 +37,5 @@ private:
     GtkWidget* create_element_widget(const HtmlElement& element);
     
     // Применяет CSS стили
-    void apply_styles(GtkWidget* widget, const std::string& tag_name);
+    void apply_styles(GtkWidget* widget, TagAtom tag);
 };
@@ -0,0 +1,499 @@
+#include "html_tokenizer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define HTML_SCAN_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define HTML_SCAN_NEON 1
+#endif
+
+namespace {
+    const char* find_either_scalar(const char* p, const char* end, char a, char b) {
+        while (p < end && *p != a && *p != b) {
+            p++;
+        }
+        return p;
+    }
+
+#if HTML_SCAN_X86
+    const char* find_either_sse2(const char* p, const char* end, char a, char b) {
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        while (end - p >= 16) {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb));
+            uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(hits));
+            if (mask) {
+                return p + __builtin_ctz(mask);
+            }
+            p += 16;
+        }
+        return find_either_scalar(p, end, a, b);
+    }
+
+    __attribute__((target("avx2")))
+    const char* find_either_avx2(const char* p, const char* end, char a, char b) {
+        const __m256i va = _mm256_set1_epi8(a);
+        const __m256i vb = _mm256_set1_epi8(b);
+        while (end - p >= 32) {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+            __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb));
+            uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+            if (mask) {
+                return p + __builtin_ctz(mask);
+            }
+            p += 32;
+        }
+        return find_either_sse2(p, end, a, b);
+    }
+#endif
+
+#if HTML_SCAN_NEON
+    const char* find_either_neon(const char* p, const char* end, char a, char b) {
+        const uint8x16_t va = vdupq_n_u8(static_cast<uint8_t>(a));
+        const uint8x16_t vb = vdupq_n_u8(static_cast<uint8_t>(b));
+        while (end - p >= 16) {
+            uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+            uint8x16_t hits = vorrq_u8(vceqq_u8(chunk, va), vceqq_u8(chunk, vb));
+            // Сужение до 4 бит на байт дает 64-битную маску без movemask
+            uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+            if (mask) {
+                return p + (__builtin_ctzll(mask) >> 2);
+            }
+            p += 16;
+        }
+        return find_either_scalar(p, end, a, b);
+    }
+#endif
+
+    html_scan::Kernel select_implementation() {
+#if HTML_SCAN_X86
+        if (__builtin_cpu_supports("avx2")) {
+            return {find_either_avx2, "avx2"};
+        }
+        return {find_either_sse2, "sse2"};
+#elif HTML_SCAN_NEON
+        return {find_either_neon, "neon"};
+#else
+        return {find_either_scalar, "scalar"};
+#endif
+    }
+
+    const html_scan::Kernel& scan_implementation() {
+        static const html_scan::Kernel implementation = select_implementation();
+        return implementation;
+    }
+
+    bool is_space(char c) {
+        return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f';
+    }
+
+    bool is_alpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+
+    char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    bool starts_with_lower(std::string_view text, std::string_view prefix) {
+        if (text.size() < prefix.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < prefix.size(); i++) {
+            if (lower(text[i]) != prefix[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Элементы, содержимое которых не разбирается на теги
+    bool has_raw_content(TagAtom tag) {
+        switch (tag) {
+        case TagAtom::Script:
+        case TagAtom::Style:
+        case TagAtom::Xmp:
+        case TagAtom::Iframe:
+        case TagAtom::Noembed:
+        case TagAtom::Noframes:
+        case TagAtom::Noscript:
+        case TagAtom::Textarea:
+        case TagAtom::Title:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Сущности раскрываются только в title и textarea (RCDATA)
+    bool decodes_entities(TagAtom tag) {
+        return tag == TagAtom::Title || tag == TagAtom::Textarea;
+    }
+
+    void append_utf8(std::string& out, uint32_t code) {
+        if (code == 0 || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+            code = 0xFFFD;
+        }
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    struct NamedEntity {
+        std::string_view name;
+        uint32_t code;
+    };
+
+    constexpr NamedEntity NAMED_ENTITIES[] = {
+        {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''},
+        {"nbsp", 0xA0}, {"copy", 0xA9}, {"reg", 0xAE}, {"laquo", 0xAB}, {"raquo", 0xBB},
+        {"mdash", 0x2014}, {"ndash", 0x2013}, {"hellip", 0x2026}, {"trade", 0x2122},
+    };
+}
+
+std::string_view HtmlToken::attribute(std::string_view attribute_name) const {
+    for (const HtmlTokenAttribute& attribute : attributes) {
+        if (attribute.name == attribute_name) {
+            return attribute.value;
+        }
+    }
+    return std::string_view();
+}
+
+HtmlTokenizer::HtmlTokenizer(std::string_view input)
+    : input(input)
+{
+}
+
+bool HtmlTokenizer::next(HtmlToken& token) {
+    token = HtmlToken();
+    while (pos < input.size()) {
+        if (raw_tag != TagAtom::Unknown) {
+            read_raw_text(token);
+            if (!token.text.empty()) {
+                return true;
+            }
+            continue;
+        }
+        if (input[pos] == '<' && read_markup(token)) {
+            return true;
+        }
+        read_text(token);
+        return true;
+    }
+    return false;
+}
+
+// Текст до первого '<', с которого начинается разметка; одиночный '<' - тоже текст
+void HtmlTokenizer::read_text(HtmlToken& token) {
+    const char* begin = input.data() + pos;
+    const char* end = input.data() + input.size();
+    // Первый символ - '<', не начавший разметку, его пропускаем сразу
+    const char* p = *begin == '<' ? begin + 1 : begin;
+    while (true) {
+        p = html_scan::find_either(p, end, '<', '&');
+        if (p == end) {
+            break;
+        }
+        if (*p == '&') {
+            token.has_entities = true;
+            p++;
+            continue;
+        }
+        char next = p + 1 < end ? p[1] : '\0';
+        if (is_alpha(next) || next == '/' || next == '!' || next == '?') {
+            break;
+        }
+        p++;
+    }
+
+    token.kind = HtmlTokenKind::Text;
+    token.text = std::string_view(begin, p - begin);
+    pos = p - input.data();
+}
+
+// Содержимое script/style/textarea до закрывающего тега того же элемента
+void HtmlTokenizer::read_raw_text(HtmlToken& token) {
+    std::string_view end_name = tag_name(raw_tag);
+    const char* begin = input.data() + pos;
+    const char* end = input.data() + input.size();
+    const char* p = begin;
+    while (true) {
+        p = html_scan::find_either(p, end, '<', '<');
+        if (p == end) {
+            break;
+        }
+        std::string_view rest(p, end - p);
+        if (rest.size() > end_name.size() + 2 && rest[1] == '/' &&
+            starts_with_lower(rest.substr(2), end_name)) {
+            char after = rest[2 + end_name.size()];
+            if (is_space(after) || after == '>' || after == '/') {
+                break;
+            }
+        }
+        p++;
+    }
+
+    token.kind = HtmlTokenKind::Text;
+    token.text = std::string_view(begin, p - begin);
+    if (decodes_entities(raw_tag)) {
+        token.has_entities = token.text.find('&') != std::string_view::npos;
+    }
+    pos = p - input.data();
+    raw_tag = TagAtom::Unknown;
+}
+
+// pos стоит на '<'; false, если это не разметка и '<' нужно читать как текст
+bool HtmlTokenizer::read_markup(HtmlToken& token) {
+    std::string_view rest = input.substr(pos);
+    if (rest.size() < 2) {
+        return false;
+    }
+    char next = rest[1];
+
+    if (is_alpha(next)) {
+        read_tag(token, false);
+        return true;
+    }
+    if (next == '/') {
+        if (rest.size() > 2 && is_alpha(rest[2])) {
+            read_tag(token, true);
+            return true;
+        }
+        // "</>" и "</ ..." - мусор, пропускаем как комментарий
+    }
+    if (next != '!' && next != '?' && next != '/') {
+        return false;
+    }
+
+    const char* end = input.data() + input.size();
+    if (rest.substr(0, 4) == "<!--") {
+        // Комментарий до "-->" или "--!>"; '>' ищем SIMD и проверяем, что
+        // перед ним. "<!-->" и "<!--->" - пустой комментарий
+        const char* content = rest.data() + 4;
+        const char* p = content;
+        const char* text_end = end;
+        while (true) {
+            p = html_scan::find_either(p, end, '>', '>');
+            if (p == end) {
+                break;
+            }
+            size_t before = p - content;
+            if (before == 0 || (before == 1 && p[-1] == '-')) {
+                text_end = content;
+                break;
+            }
+            if (before >= 2 && p[-1] == '-' && p[-2] == '-') {
+                text_end = p - 2;
+                break;
+            }
+            if (before >= 3 && p[-1] == '!' && p[-2] == '-' && p[-3] == '-') {
+                text_end = p - 3;
+                break;
+            }
+            p++;
+        }
+        token.kind = HtmlTokenKind::Comment;
+        token.text = std::string_view(content, text_end - content);
+        pos = p == end ? input.size() : p + 1 - input.data();
+        return true;
+    }
+
+    // <!DOCTYPE ...>, <?xml ...?> и прочие конструкции до первого '>'
+    const char* content = rest.data() + 2;
+    const char* p = html_scan::find_either(content, end, '>', '>');
+    token.kind = starts_with_lower(std::string_view(content, p - content), "doctype")
+        ? HtmlTokenKind::Doctype
+        : HtmlTokenKind::Comment;
+    token.text = std::string_view(content, p - content);
+    pos = p == end ? input.size() : p + 1 - input.data();
+    return true;
+}
+
+void HtmlTokenizer::read_tag(HtmlToken& token, bool end_tag) {
+    pos += end_tag ? 2 : 1;
+    size_t name_start = pos;
+    while (pos < input.size() && !is_space(input[pos]) && input[pos] != '/' && input[pos] != '>') {
+        pos++;
+    }
+
+    token.kind = end_tag ? HtmlTokenKind::EndTag : HtmlTokenKind::StartTag;
+    token.name = input.substr(name_start, pos - name_start);
+    token.tag = tag_atom(token.name);
+    read_attributes(token);
+
+    if (end_tag) {
+        token.attributes = {};
+        token.self_closing = false;
+    } else if (!token.self_closing && has_raw_content(token.tag)) {
+        raw_tag = token.tag;
+    }
+}
+
+// Атрибуты до '>' или "/>"; pos после тега
+void HtmlTokenizer::read_attributes(HtmlToken& token) {
+    attributes.clear();
+    const char* end = input.data() + input.size();
+
+    while (pos < input.size()) {
+        char c = input[pos];
+        if (is_space(c)) {
+            pos++;
+            continue;
+        }
+        if (c == '>') {
+            pos++;
+            break;
+        }
+        if (c == '/') {
+            pos++;
+            if (pos < input.size() && input[pos] == '>') {
+                token.self_closing = true;
+                pos++;
+                break;
+            }
+            continue;
+        }
+
+        // Имя атрибута; '=' в начале имени допускается, как в спецификации
+        size_t name_start = pos++;
+        while (pos < input.size() && !is_space(input[pos]) && input[pos] != '=' &&
+               input[pos] != '>' && input[pos] != '/') {
+            pos++;
+        }
+        HtmlTokenAttribute attribute;
+        attribute.name = input.substr(name_start, pos - name_start);
+
+        size_t after_name = pos;
+        while (pos < input.size() && is_space(input[pos])) {
+            pos++;
+        }
+        if (pos >= input.size() || input[pos] != '=') {
+            // Атрибут без значения: пробелы за именем относятся к следующему
+            pos = after_name;
+            attributes.push_back(attribute);
+            continue;
+        }
+        pos++;
+        while (pos < input.size() && is_space(input[pos])) {
+            pos++;
+        }
+
+        if (pos < input.size() && (input[pos] == '"' || input[pos] == '\'')) {
+            char quote = input[pos];
+            const char* value = input.data() + pos + 1;
+            const char* value_end = html_scan::find_either(value, end, quote, quote);
+            attribute.value = std::string_view(value, value_end - value);
+            pos = value_end == end ? input.size() : value_end + 1 - input.data();
+        } else {
+            size_t value_start = pos;
+            while (pos < input.size() && !is_space(input[pos]) && input[pos] != '>') {
+                pos++;
+            }
+            attribute.value = input.substr(value_start, pos - value_start);
+        }
+        attributes.push_back(attribute);
+    }
+
+    token.attributes = std::span<const HtmlTokenAttribute>(attributes.data(), attributes.size());
+}
+
+void decode_entities(std::string_view text, std::string& out) {
+    out.reserve(out.size() + text.size());
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t amp = text.find('&', pos);
+        if (amp == std::string_view::npos) {
+            break;
+        }
+        out.append(text.substr(pos, amp - pos));
+        pos = amp + 1;
+
+        size_t semicolon = text.find(';', pos);
+        // Ссылки длиннее 10 символов не бывают среди поддерживаемых
+        if (semicolon == std::string_view::npos || semicolon - pos > 10 || semicolon == pos) {
+            out += '&';
+            continue;
+        }
+        std::string_view name = text.substr(pos, semicolon - pos);
+
+        bool decoded = false;
+        if (name[0] == '#') {
+            uint32_t code = 0;
+            bool hex = name.size() > 1 && (name[1] == 'x' || name[1] == 'X');
+            size_t digits = hex ? 2 : 1;
+            decoded = name.size() > digits;
+            for (size_t i = digits; i < name.size() && decoded; i++) {
+                char c = name[i];
+                uint32_t digit;
+                if (c >= '0' && c <= '9') {
+                    digit = c - '0';
+                } else if (hex && lower(c) >= 'a' && lower(c) <= 'f') {
+                    digit = lower(c) - 'a' + 10;
+                } else {
+                    decoded = false;
+                    break;
+                }
+                code = code * (hex ? 16 : 10) + digit;
+                if (code > 0x10FFFF) {
+                    code = 0x110000;
+                }
+            }
+            if (decoded) {
+                append_utf8(out, code);
+            }
+        } else {
+            for (const NamedEntity& entity : NAMED_ENTITIES) {
+                if (entity.name == name) {
+                    append_utf8(out, entity.code);
+                    decoded = true;
+                    break;
+                }
+            }
+        }
+
+        if (decoded) {
+            pos = semicolon + 1;
+        } else {
+            out += '&';
+        }
+    }
+    out.append(text.substr(pos));
+}
+
+namespace html_scan {
+    const char* find_either(const char* begin, const char* end, char a, char b) {
+        return scan_implementation().find_either(begin, end, a, b);
+    }
+
+    const char* implementation() {
+        return scan_implementation().name;
+    }
+
+    std::vector<Kernel> kernels() {
+        std::vector<Kernel> result = {{find_either_scalar, "scalar"}};
+#if HTML_SCAN_X86
+        result.push_back({find_either_sse2, "sse2"});
+        if (__builtin_cpu_supports("avx2")) {
+            result.push_back({find_either_avx2, "avx2"});
+        }
+#elif HTML_SCAN_NEON
+        result.push_back({find_either_neon, "neon"});
+#endif
+        return result;
+    }
+}
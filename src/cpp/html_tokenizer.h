@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "tag_atoms.h"
+
+// Быстрый токенизатор HTML без FFI: для локальных и офлайн-документов,
+// где полный разбор в Rust не нужен. Токены - string_view прямо во входной
+// буфер, поэтому на токен ничего не выделяется; буфер должен жить, пока
+// используются токены. Длинные участки (текст, значения атрибутов,
+// комментарии, содержимое script/style) просматриваются SIMD по 16-32 байта.
+
+enum class HtmlTokenKind : uint8_t {
+    StartTag,
+    EndTag,
+    Text,
+    Comment,
+    Doctype,
+};
+
+struct HtmlTokenAttribute {
+    std::string_view name;
+    std::string_view value;
+};
+
+struct HtmlToken {
+    HtmlTokenKind kind = HtmlTokenKind::Text;
+    // Имя тега как в исходнике и его атом (для текста - пустые)
+    std::string_view name;
+    TagAtom tag = TagAtom::Unknown;
+    // Текст, содержимое комментария или doctype; сущности не раскрыты
+    std::string_view text;
+    // Действительны до следующего вызова next()
+    std::span<const HtmlTokenAttribute> attributes;
+    bool self_closing = false;
+    // В тексте есть '&': нужен decode_entities
+    bool has_entities = false;
+
+    // Значение атрибута или пустая строка
+    std::string_view attribute(std::string_view attribute_name) const;
+};
+
+class HtmlTokenizer {
+public:
+    explicit HtmlTokenizer(std::string_view input);
+
+    // Следующий токен; false в конце входа
+    bool next(HtmlToken& token);
+
+private:
+    std::string_view input;
+    size_t pos = 0;
+    // Открыт элемент с сырым содержимым (script, style, textarea...):
+    // до его закрывающего тега все идет текстом
+    TagAtom raw_tag = TagAtom::Unknown;
+    // Переиспользуется между тегами, чтобы не выделять память на каждый
+    std::vector<HtmlTokenAttribute> attributes;
+
+    void read_text(HtmlToken& token);
+    void read_raw_text(HtmlToken& token);
+    bool read_markup(HtmlToken& token);
+    void read_tag(HtmlToken& token, bool end_tag);
+    void read_attributes(HtmlToken& token);
+};
+
+// Раскрывает символьные ссылки (&amp;, &#38;, &#x26; и основные именованные),
+// неизвестные оставляет как есть; результат дописывается в out
+void decode_entities(std::string_view text, std::string& out);
+
+namespace html_scan {
+    // Первый из двух символов в [begin, end) или end. Реализация выбирается
+    // один раз по возможностям процессора: AVX2, SSE2, NEON или скалярная
+    const char* find_either(const char* begin, const char* end, char a, char b);
+
+    // Имя выбранной реализации, для логов
+    const char* implementation();
+
+    using FindEither = const char* (*)(const char* begin, const char* end, char a, char b);
+
+    struct Kernel {
+        FindEither find_either;
+        const char* name;
+    };
+
+    // Все реализации, которые есть в сборке и поддерживает процессор,
+    // первая - скалярная: тесты сверяют с ней остальные
+    std::vector<Kernel> kernels();
+}
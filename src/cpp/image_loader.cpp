@@ -0,0 +1,253 @@
+#include "image_loader.h"
+#include "logger.h"
+#include "memory_accounting.h"
+#include "tracing.h"
+#include <algorithm>
+
+// Задача загрузки одного URL: создается в главном потоке, проходит через
+// сетевой поток Rust и пул декодирования, удаляется в главном потоке
+struct ImageLoader::ImageJob {
+    std::shared_ptr<bool> alive;
+    ImageLoader* loader;
+    // Вкладка, запросившая изображение
+    unsigned memory_tab;
+    // Навигация страницы в трассе
+    uint64_t trace_navigation;
+    // Поколение загрузчика на момент запуска (cancel_pending)
+    uint64_t generation;
+    std::string url;
+    uint8_t* data;
+    size_t len;
+    GdkPixbuf* pixbuf;
+};
+
+ImageLoader::ImageLoader(size_t cache_budget)
+    : cache(cache_budget)
+    , alive(std::make_shared<bool>(true))
+{
+}
+
+ImageLoader::~ImageLoader() {
+    *alive = false;
+
+    for (GtkWidget* view : views) {
+        g_signal_handlers_disconnect_by_data(view, this);
+    }
+}
+
+GThreadPool* ImageLoader::decode_pool() {
+    static GThreadPool* pool = [] {
+        gint threads = std::max(1, std::min<gint>(4, g_get_num_processors()));
+        return g_thread_pool_new(decode_job, nullptr, threads, FALSE, nullptr);
+    }();
+    return pool;
+}
+
+GdkPixbuf* ImageLoader::request(const std::string& src, GtkWidget* view, std::function<void()> on_ready) {
+    if (const PixbufPtr* cached = cache.get(src)) {
+        return cached->get();
+    }
+    // Рисуется сейчас - значит, на экране
+    subscribe(src, view, std::move(on_ready), FETCH_PRIORITY_VISIBLE_IMAGE);
+    return nullptr;
+}
+
+void ImageLoader::prefetch(const std::string& src, GtkWidget* view, std::function<void()> on_ready,
+                           FetchPriority priority) {
+    if (cache.contains(src)) {
+        return;
+    }
+    subscribe(src, view, std::move(on_ready), priority);
+}
+
+void ImageLoader::set_priority(const std::string& src, FetchPriority priority) {
+    auto it = waiting.find(src);
+    if (it == waiting.end() || it->second.priority == priority) {
+        return;
+    }
+    it->second.priority = priority;
+    // Уже ушедший в сеть запрос планировщик не переупорядочивает
+    if (it->second.request != 0) {
+        network_fetch_set_priority(it->second.request, priority);
+    }
+}
+
+void ImageLoader::subscribe(const std::string& src, GtkWidget* view, std::function<void()> on_ready,
+                            FetchPriority priority) {
+    if (failed.count(src)) {
+        return;
+    }
+
+    if (std::find(views.begin(), views.end(), view) == views.end()) {
+        views.push_back(view);
+        g_signal_connect(view, "destroy", G_CALLBACK(on_view_destroy), this);
+    }
+
+    // Одинаковые картинки на странице загружаются один раз
+    auto it = waiting.find(src);
+    if (it == waiting.end()) {
+        PendingFetch& fetch = waiting[src];
+        fetch.priority = priority;
+        fetch.waiters.push_back(Waiter{view, std::move(on_ready)});
+        start_fetch(src, priority);
+        return;
+    }
+
+    set_priority(src, priority);
+
+    // Виджет перерисовывается до прихода изображения - повторно не подписываем
+    std::vector<Waiter>& waiters = it->second.waiters;
+    for (const Waiter& waiter : waiters) {
+        if (waiter.view == view) {
+            return;
+        }
+    }
+    waiters.push_back(Waiter{view, std::move(on_ready)});
+}
+
+void ImageLoader::cancel_pending() {
+    ++generation;
+    waiting.clear();
+}
+
+bool ImageLoader::cached_size(const std::string& src, int& width, int& height) const {
+    const PixbufPtr* cached = cache.peek(src);
+    if (!cached) {
+        return false;
+    }
+    width = gdk_pixbuf_get_width(cached->get());
+    height = gdk_pixbuf_get_height(cached->get());
+    return true;
+}
+
+void ImageLoader::start_fetch(const std::string& url, FetchPriority priority) {
+    unsigned memory_tab = MEMORY_NO_TAB;
+    memory_get_thread_tags(nullptr, &memory_tab);
+    ImageJob* job = new ImageJob{alive, this, memory_tab, trace_get_navigation(), generation, url, nullptr, 0,
+                                 nullptr};
+
+    // Загрузка в Rust наследует метки и навигацию; по вкладке из меток
+    // планировщик отличает запросы активной вкладки
+    MemoryScope scope(MEMORY_IMAGES, memory_tab);
+    uint64_t request = network_fetch_image_async(url.c_str(), priority, on_fetched, job);
+    if (request == 0) {
+        delete job;
+        finish_fetch(url, nullptr, memory_tab);
+        return;
+    }
+    // Результат приходит в главный поток позже, запись еще на месте
+    waiting[url].request = request;
+}
+
+// Поток Rust: байты получены, декодирование уходит в пул
+void ImageLoader::on_fetched(void* user_data, uint8_t* data, size_t len) {
+    ImageJob* job = static_cast<ImageJob*>(user_data);
+    job->data = data;
+    job->len = len;
+
+    if (data) {
+        g_thread_pool_push(decode_pool(), job, nullptr);
+    } else {
+        g_idle_add(commit_job, job);
+    }
+}
+
+// Поток пула: декодирование в GdkPixbuf
+void ImageLoader::decode_job(gpointer data, gpointer) {
+    ImageJob* job = static_cast<ImageJob*>(data);
+    MemoryScope scope(MEMORY_IMAGES, job->memory_tab);
+    trace_set_thread_name("image-decode");
+    TraceNavigationScope trace_scope(job->trace_navigation);
+    TraceSpan span("images", "image_decode");
+    span.set_bytes(job->len);
+
+    GdkPixbufLoader* pixbuf_loader = gdk_pixbuf_loader_new();
+    GError* error = nullptr;
+
+    bool written = gdk_pixbuf_loader_write(pixbuf_loader, job->data, job->len, &error);
+    // close обязателен даже после ошибки записи
+    bool closed = gdk_pixbuf_loader_close(pixbuf_loader, written ? &error : nullptr);
+
+    if (written && closed) {
+        GdkPixbuf* pixbuf = gdk_pixbuf_loader_get_pixbuf(pixbuf_loader);
+        if (pixbuf) {
+            job->pixbuf = GDK_PIXBUF(g_object_ref(pixbuf));
+        }
+    } else if (error) {
+        LOG_WARN("images") << "Ошибка декодирования изображения " << job->url << ": " << error->message;
+    }
+
+    if (error) {
+        g_error_free(error);
+    }
+    g_object_unref(pixbuf_loader);
+
+    network_bytes_free(job->data, job->len);
+    job->data = nullptr;
+
+    g_idle_add(commit_job, job);
+}
+
+// Главный поток: результат попадает в кэш и в ожидающие заглушки
+gboolean ImageLoader::commit_job(gpointer data) {
+    ImageJob* job = static_cast<ImageJob*>(data);
+
+    // Пустой результат отмененной загрузки - не неудача: картинку не запоминаем
+    // как битую, а ее запись в waiting уже принадлежит новой загрузке
+    if (*job->alive && (job->pixbuf || job->generation == job->loader->generation)) {
+        job->loader->finish_fetch(job->url, job->pixbuf, job->memory_tab);
+    }
+
+    if (job->pixbuf) {
+        g_object_unref(job->pixbuf);
+    }
+    delete job;
+    return G_SOURCE_REMOVE;
+}
+
+void ImageLoader::finish_fetch(const std::string& url, GdkPixbuf* pixbuf, unsigned memory_tab) {
+    if (pixbuf) {
+        // Пиксели выделяет GLib мимо memory_alloc: пока запись в кэше, они
+        // числятся за картинками вкладки, вытеснение списывает их обратно
+        size_t size = gdk_pixbuf_get_byte_length(pixbuf);
+        memory_charge(MEMORY_IMAGES, memory_tab, size);
+        PixbufPtr cached(GDK_PIXBUF(g_object_ref(pixbuf)), [memory_tab, size](GdkPixbuf* p) {
+            memory_uncharge(MEMORY_IMAGES, memory_tab, size);
+            g_object_unref(p);
+        });
+        cache.put(url, std::move(cached), size);
+    } else {
+        // Список неудач не должен расти бесконечно за долгую сессию
+        if (failed.size() >= MAX_FAILED_URLS) {
+            failed.clear();
+        }
+        failed.insert(url);
+    }
+
+    auto it = waiting.find(url);
+    if (it == waiting.end()) {
+        return;
+    }
+
+    // Обработчики могут сразу запросить другие изображения и изменить waiting
+    std::vector<Waiter> ready = std::move(it->second.waiters);
+    waiting.erase(it);
+    for (const Waiter& waiter : ready) {
+        if (waiter.on_ready) {
+            waiter.on_ready();
+        }
+    }
+}
+
+// Виджет уничтожен до прихода изображений (например, ушли со страницы)
+void ImageLoader::on_view_destroy(GtkWidget* widget, gpointer user_data) {
+    ImageLoader* loader = static_cast<ImageLoader*>(user_data);
+
+    for (auto& entry : loader->waiting) {
+        auto& waiters = entry.second.waiters;
+        waiters.erase(std::remove_if(waiters.begin(), waiters.end(),
+                                     [widget](const Waiter& waiter) { return waiter.view == widget; }),
+                      waiters.end());
+    }
+    loader->views.erase(std::remove(loader->views.begin(), loader->views.end(), widget), loader->views.end());
+}
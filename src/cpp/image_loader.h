@@ -0,0 +1,121 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <unordered_set>
+#include <cstdint>
+#include <unordered_map>
+#include <gtk/gtk.h>
+#include "lru_cache.h"
+
+// FFI интерфейсы для Rust
+extern "C" {
+    // Классы планировщика загрузок (src/rust/src/scheduler.rs), по убыванию важности
+    enum FetchPriority {
+        FETCH_PRIORITY_DOCUMENT = 0,
+        FETCH_PRIORITY_STYLESHEET = 1,
+        FETCH_PRIORITY_SCRIPT = 2,
+        FETCH_PRIORITY_VISIBLE_IMAGE = 3,
+        FETCH_PRIORITY_OFFSCREEN_IMAGE = 4,
+        FETCH_PRIORITY_PREFETCH = 5,
+    };
+
+    typedef void (*ImageFetchCallback)(void* user_data, uint8_t* data, size_t len);
+    uint64_t network_fetch_image_async(const char* url, uint32_t priority, ImageFetchCallback callback,
+                                       void* user_data);
+    bool network_fetch_set_priority(uint64_t request, uint32_t priority);
+    void network_bytes_free(uint8_t* data, size_t len);
+}
+
+// Асинхронная загрузка изображений страницы.
+//
+// Все <img> загружаются параллельно в сетевом рантайме Rust, декодируются в
+// GdkPixbuf в пуле потоков, а виджет страницы получает уведомление в главном
+// потоке и перерисовывается. Декодированные изображения кэшируются по URL.
+//
+// Загрузки идут через планировщик: картинки на экране раньше картинок в
+// запасе вокруг него, и те и другие - после документа. Пока загрузка ждет
+// очереди, ее класс можно поменять (prefetch, set_priority).
+class ImageLoader {
+public:
+    // Бюджет кэша декодированных изображений по умолчанию
+    static constexpr size_t DEFAULT_CACHE_BUDGET = 64 * 1024 * 1024;
+    static constexpr size_t MAX_FAILED_URLS = 1024;
+
+    explicit ImageLoader(size_t cache_budget = DEFAULT_CACHE_BUDGET);
+    ~ImageLoader();
+
+    ImageLoader(const ImageLoader&) = delete;
+    ImageLoader& operator=(const ImageLoader&) = delete;
+
+    // Изображение для отрисовки: из кэша сразу, иначе nullptr и загрузка
+    // в фоне, после которой вызывается on_ready (если view еще жив).
+    // Указатель действителен до возврата в главный цикл
+    GdkPixbuf* request(const std::string& src, GtkWidget* view, std::function<void()> on_ready);
+
+    // Загрузка заранее (картинка рядом с видимой областью) или смена класса
+    // уже идущей загрузки. on_ready - как у request
+    void prefetch(const std::string& src, GtkWidget* view, std::function<void()> on_ready,
+                  FetchPriority priority);
+
+    // Смена класса, если загрузка src еще ждет очереди; новую не начинает
+    void set_priority(const std::string& src, FetchPriority priority);
+
+    // Идущие загрузки отменены (network_cancel_tab): ожидающие виджеты
+    // отписываются, а пустые результаты отмененных загрузок не попадают в
+    // список неудач - при следующей отрисовке картинка запросится снова
+    void cancel_pending();
+
+    // Размер изображения из кэша, загрузку не запускает
+    bool cached_size(const std::string& src, int& width, int& height) const;
+
+    size_t cache_size_bytes() const { return cache.size_bytes(); }
+    size_t cache_count() const { return cache.count(); }
+
+private:
+    using PixbufPtr = std::shared_ptr<GdkPixbuf>;
+    struct ImageJob;
+
+    // Пул декодирования общий для всех загрузчиков и живет до конца процесса:
+    // в него пишут потоки Rust, которые могут пережить загрузчик
+    static GThreadPool* decode_pool();
+
+    static void on_fetched(void* user_data, uint8_t* data, size_t len);
+    static void decode_job(gpointer data, gpointer user_data);
+    static gboolean commit_job(gpointer data);
+    static void on_view_destroy(GtkWidget* widget, gpointer user_data);
+
+    struct Waiter {
+        GtkWidget* view;
+        std::function<void()> on_ready;
+    };
+
+    // Идущая загрузка одного URL
+    struct PendingFetch {
+        // Номер в планировщике, 0 - еще не получен
+        uint64_t request = 0;
+        FetchPriority priority = FETCH_PRIORITY_VISIBLE_IMAGE;
+        std::vector<Waiter> waiters;
+    };
+
+    // Общая часть request и prefetch: подписка на изображение и загрузка,
+    // если она еще не идет
+    void subscribe(const std::string& src, GtkWidget* view, std::function<void()> on_ready,
+                   FetchPriority priority);
+    void start_fetch(const std::string& url, FetchPriority priority);
+    void finish_fetch(const std::string& url, GdkPixbuf* pixbuf, unsigned memory_tab);
+    
+    LruCache<std::string, PixbufPtr> cache;
+    // Загрузки по URL с ожидающими их виджетами; наличие ключа - загрузка идет
+    std::unordered_map<std::string, PendingFetch> waiting;
+    // Виджеты, подписанные на destroy
+    std::vector<GtkWidget*> views;
+    // URL, которые не удалось загрузить: повторная отрисовка не перезапрашивает их
+    std::unordered_set<std::string> failed;
+    // Сбрасывается в деструкторе; завершившиеся позже задачи просто отбрасываются
+    std::shared_ptr<bool> alive;
+    // Растет при каждой отмене; задача помнит поколение, в котором началась
+    uint64_t generation = 0;
+};
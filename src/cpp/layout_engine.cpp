@@ -0,0 +1,702 @@
+#include "layout_engine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+namespace {
+    // Межстрочный интервал как в .content-view (line-height)
+    constexpr float LINE_HEIGHT = 1.4f;
+    constexpr float PAGE_PADDING = 20.0f;
+    constexpr float CELL_GAP = 16.0f;
+    constexpr float LIST_MARKER_OFFSET = 14.0f;
+    constexpr float DEFAULT_IMAGE_WIDTH = 150.0f;
+    constexpr float DEFAULT_IMAGE_HEIGHT = 100.0f;
+    constexpr uint32_t RULE_COLOR = 0xdee2e6;
+
+    bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+    }
+
+    // Декодирует один символ UTF-8; на битых последовательностях возвращает байт как есть
+    uint32_t next_codepoint(std::string_view text, size_t& pos) {
+        unsigned char c = static_cast<unsigned char>(text[pos++]);
+        if (c < 0x80) {
+            return c;
+        }
+
+        int extra = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : c >= 0xc0 ? 1 : 0;
+        uint32_t cp = c & (0x3f >> extra);
+        for (int i = 0; i < extra && pos < text.size(); i++) {
+            unsigned char next = static_cast<unsigned char>(text[pos]);
+            if ((next & 0xc0) != 0x80) {
+                break;
+            }
+            cp = (cp << 6) | (next & 0x3f);
+            pos++;
+        }
+        return cp;
+    }
+
+    float parse_dimension(std::string_view value) {
+        if (value.empty()) {
+            return 0.0f;
+        }
+        std::string copy(value);
+        return std::strtof(copy.c_str(), nullptr);
+    }
+
+    // Адрес картинки: src, иначе кандидат srcset для плотности 1x (или
+    // первый). Так же выбирает сканер упреждающей загрузки (preload.rs)
+    std::string_view image_source(std::string_view src, std::string_view srcset) {
+        if (src.find_first_not_of(" \t\n\r\f") != std::string_view::npos) {
+            return src;
+        }
+        std::string_view first;
+        while (!srcset.empty()) {
+            size_t comma = srcset.find(',');
+            std::string_view candidate = srcset.substr(0, comma);
+            srcset = comma == std::string_view::npos ? std::string_view() : srcset.substr(comma + 1);
+
+            size_t url_start = 0;
+            while (url_start < candidate.size() && is_space(candidate[url_start])) {
+                url_start++;
+            }
+            size_t url_end = url_start;
+            while (url_end < candidate.size() && !is_space(candidate[url_end])) {
+                url_end++;
+            }
+            if (url_start == url_end) {
+                continue;
+            }
+            std::string_view url = candidate.substr(url_start, url_end - url_start);
+
+            size_t descriptor_start = url_end;
+            while (descriptor_start < candidate.size() && is_space(candidate[descriptor_start])) {
+                descriptor_start++;
+            }
+            size_t descriptor_end = descriptor_start;
+            while (descriptor_end < candidate.size() && !is_space(candidate[descriptor_end])) {
+                descriptor_end++;
+            }
+            std::string_view descriptor = candidate.substr(descriptor_start, descriptor_end - descriptor_start);
+            if (descriptor.empty() || descriptor == "1x") {
+                return url;
+            }
+            if (first.empty()) {
+                first = url;
+            }
+        }
+        return first;
+    }
+}
+
+std::pair<size_t, size_t> DisplayList::visible_range(float top, float bottom) const {
+    auto by_top = [](const DisplayItem& item, float y) { return item.rect.y < y; };
+    auto first = std::lower_bound(items.begin(), items.end(), top - max_item_height, by_top);
+    auto last = std::lower_bound(first, items.end(), bottom, by_top);
+    return {static_cast<size_t>(first - items.begin()), static_cast<size_t>(last - items.begin())};
+}
+
+const DisplayItem* DisplayList::hit_test(float x, float y) const {
+    auto range = visible_range(y, y + 1.0f);
+    for (size_t i = range.second; i > range.first; i--) {
+        const DisplayItem& item = items[i - 1];
+        if (item.rect.contains(x, y)) {
+            return &item;
+        }
+    }
+    return nullptr;
+}
+
+void DisplayList::clear() {
+    items.clear();
+    styles.clear();
+    text_buffer.clear();
+    width = 0.0f;
+    height = 0.0f;
+    max_item_height = 0.0f;
+}
+
+FontMetrics ApproximateMetrics::font_metrics(const TextStyle& style) {
+    return FontMetrics{style.size * 0.8f, style.size * 0.25f};
+}
+
+float ApproximateMetrics::advance(const TextStyle& style, uint32_t codepoint) {
+    if (style.monospace) {
+        return style.size * 0.6f;
+    }
+    if (codepoint == ' ') {
+        return style.size * 0.28f;
+    }
+    return style.size * ((codepoint < 128 ? 0.52f : 0.58f) + (style.bold ? 0.04f : 0.0f));
+}
+
+LayoutEngine::LayoutEngine(LayoutMetrics& metrics)
+    : metrics(metrics)
+    , document(nullptr)
+    , out(nullptr)
+    , content_left(0.0f)
+    , content_right(0.0f)
+    , cursor_y(0.0f)
+    , pending_margin(0.0f)
+    , line_start(0)
+    , line_x(0.0f)
+    , line_ascent(0.0f)
+    , line_descent(0.0f)
+    , pending_space(false)
+    , line_has_content(false)
+    , last_opened(0)
+    , done(true)
+{
+}
+
+void LayoutEngine::clear_metrics_cache() {
+    known_styles.clear();
+    known_metrics.clear();
+}
+
+void LayoutEngine::layout(const HtmlDocument& doc, float width, DisplayList& result) {
+    begin(doc, width, result);
+    layout_until(std::numeric_limits<float>::infinity());
+}
+
+void LayoutEngine::begin(const HtmlDocument& doc, float width, DisplayList& result) {
+    result.clear();
+    document = &doc;
+    out = &result;
+
+    content_left = PAGE_PADDING;
+    content_right = std::max(content_left + 1.0f, width - PAGE_PADDING);
+    cursor_y = PAGE_PADDING;
+    pending_margin = 0.0f;
+    line_start = 0;
+    line_x = content_left;
+    line_ascent = 0.0f;
+    line_descent = 0.0f;
+    pending_space = false;
+    line_has_content = false;
+    last_opened = 0;
+
+    stack.clear();
+    if (doc.node_count() > 0) {
+        open_node(0, TextStyle(), HTML_NO_NODE, false);
+    }
+
+    result.styles.assign(known_styles.begin(), known_styles.end());
+    result.width = width;
+    result.height = cursor_y;
+    done = stack.empty();
+    if (done) {
+        finish();
+    }
+}
+
+bool LayoutEngine::layout_until(float y) {
+    if (done) {
+        return true;
+    }
+
+    while (!stack.empty()) {
+        // Останавливаемся только между строками: незавершенная строка
+        // еще не имеет координат
+        if (cursor_y >= y && line_start == out->items.size()) {
+            out->styles.assign(known_styles.begin(), known_styles.end());
+            out->height = cursor_y;
+            return false;
+        }
+
+        Frame& top = stack.back();
+        if (top.next_child != HTML_NO_NODE) {
+            uint32_t child = top.next_child;
+            top.next_child = document->node(child).next_sibling();
+            // open_node может добавить кадр и сдвинуть стек - top дальше не используем
+            TextStyle style = top.style;
+            open_node(child, style, top.link, top.preformatted);
+        } else {
+            Frame closed = top;
+            stack.pop_back();
+            close_node(closed);
+        }
+    }
+
+    finish();
+    return true;
+}
+
+float LayoutEngine::estimated_height() const {
+    if (done || !document || document->node_count() == 0) {
+        return out ? out->height : 0.0f;
+    }
+    // Узлы пронумерованы в порядке документа: номер последнего открытого -
+    // доля пройденного документа
+    float progress = static_cast<float>(last_opened + 1) / document->node_count();
+    return std::max(cursor_y, cursor_y / progress);
+}
+
+void LayoutEngine::finish() {
+    finish_line();
+    out->styles.assign(known_styles.begin(), known_styles.end());
+    out->height = cursor_y + pending_margin + PAGE_PADDING;
+    done = true;
+}
+
+LayoutEngine::BlockStyle LayoutEngine::block_style(TagAtom tag, const HtmlSnapshotStyle* computed) {
+    BlockStyle style;
+    if (!computed) {
+        return style;
+    }
+    if (static_cast<HtmlDisplay>(computed->display) == HtmlDisplay::None) {
+        style.display = Display::None;
+        return style;
+    }
+
+    style.margin_top = computed->margin_top;
+    style.margin_bottom = computed->margin_bottom;
+    style.indent = computed->indent;
+
+    // Замещаемые элементы раскладываются по-своему при любом display
+    switch (tag) {
+    case TagAtom::Img:
+        style.display = Display::Image;
+        return style;
+    case TagAtom::Input:
+    case TagAtom::Button:
+    case TagAtom::Textarea:
+    case TagAtom::Select:
+        style.display = Display::Control;
+        return style;
+    case TagAtom::Br:
+        style.display = Display::LineBreak;
+        return style;
+    case TagAtom::Hr:
+        style.display = Display::Rule;
+        return style;
+    default:
+        break;
+    }
+
+    switch (static_cast<HtmlDisplay>(computed->display)) {
+    case HtmlDisplay::Block:
+        style.display = Display::Block;
+        break;
+    case HtmlDisplay::ListItem:
+        style.display = Display::ListItem;
+        break;
+    case HtmlDisplay::TableCell:
+        style.display = Display::TableCell;
+        break;
+    default:
+        style.display = Display::Inline;
+        break;
+    }
+
+    return style;
+}
+
+TextStyle LayoutEngine::text_style(const HtmlSnapshotStyle* computed, const TextStyle& parent) {
+    if (!computed) {
+        return parent;
+    }
+
+    TextStyle style;
+    style.size = computed->font_size;
+    style.bold = computed->bold != 0;
+    style.italic = computed->italic != 0;
+    style.monospace = computed->monospace != 0;
+    style.underline = computed->underline != 0;
+    style.color = computed->color;
+    return style;
+}
+
+void LayoutEngine::open_node(uint32_t index, const TextStyle& parent_style, uint32_t link, bool preformatted) {
+    HtmlNodeView node = document->node(index);
+    last_opened = index;
+
+    if (node.kind() == HtmlNodeKind::Document) {
+        push_frame(index, Display::Inline, BlockStyle(), parent_style, link, preformatted);
+        return;
+    }
+    if (node.is_text()) {
+        layout_text(index, node.text_content(), parent_style, link, preformatted);
+        return;
+    }
+
+    TagAtom tag = node.tag();
+    const HtmlSnapshotStyle* computed = node.style();
+    BlockStyle block = block_style(tag, computed);
+    TextStyle style = text_style(computed, parent_style);
+    if (computed) {
+        preformatted = computed->preformatted != 0;
+    }
+    if (tag == TagAtom::A && node.has_attribute("href")) {
+        link = index;
+    }
+
+    switch (block.display) {
+    case Display::None:
+        break;
+
+    case Display::Inline:
+        push_frame(index, Display::Inline, block, style, link, preformatted);
+        break;
+
+    case Display::Block:
+        begin_block(block.margin_top, block.indent);
+        push_frame(index, Display::Block, block, style, link, preformatted);
+        break;
+
+    case Display::ListItem: {
+        begin_block(block.margin_top, block.indent);
+        // Маркер висит слева от содержимого и не считается началом строки
+        uint16_t style_index = intern_style(style);
+        const StyleMetrics& m = style_metrics(style_index);
+        DisplayItem marker{};
+        marker.kind = DisplayItemKind::Text;
+        marker.style = style_index;
+        marker.color = style.color;
+        marker.node = index;
+        marker.link = HTML_NO_NODE;
+        marker.text_offset = static_cast<uint32_t>(out->text_buffer.size());
+        out->text_buffer += "•";
+        marker.text_len = static_cast<uint32_t>(out->text_buffer.size()) - marker.text_offset;
+        marker.rect = {content_left - LIST_MARKER_OFFSET, 0.0f, LIST_MARKER_OFFSET,
+                       m.font.ascent + m.font.descent};
+        marker.baseline = m.font.ascent;
+        out->items.push_back(marker);
+        line_ascent = std::max(line_ascent, m.font.ascent + m.half_leading);
+        line_descent = std::max(line_descent, m.font.descent + m.half_leading);
+
+        push_frame(index, Display::ListItem, block, style, link, preformatted);
+        break;
+    }
+
+    case Display::TableCell:
+        if (line_has_content) {
+            line_x += CELL_GAP;
+            pending_space = false;
+        }
+        push_frame(index, Display::TableCell, block, style, link, preformatted);
+        break;
+
+    case Display::Image: {
+        std::string_view src = image_source(node.attribute("src"), node.attribute("srcset"));
+        float width = parse_dimension(node.attribute("width"));
+        float height = parse_dimension(node.attribute("height"));
+        float natural_width = 0.0f;
+        float natural_height = 0.0f;
+        if ((width <= 0.0f || height <= 0.0f) && !src.empty() &&
+            metrics.image_size(src, natural_width, natural_height) && natural_width > 0.0f) {
+            if (width > 0.0f) {
+                height = natural_height * width / natural_width;
+            } else if (height > 0.0f && natural_height > 0.0f) {
+                width = natural_width * height / natural_height;
+            } else {
+                width = natural_width;
+                height = natural_height;
+            }
+        }
+        if (width <= 0.0f || height <= 0.0f) {
+            width = DEFAULT_IMAGE_WIDTH;
+            height = DEFAULT_IMAGE_HEIGHT;
+        }
+        // Широкие изображения ужимаются до колонки с сохранением пропорций
+        float available = content_right - content_left;
+        if (width > available) {
+            height = height * available / width;
+            width = available;
+        }
+        layout_atomic(DisplayItemKind::Image, index, link, intern_style(style), width, height, src);
+        break;
+    }
+
+    case Display::Control: {
+        std::string_view type = node.attribute("type");
+        if (tag == TagAtom::Input && type == "hidden") {
+            break;
+        }
+
+        uint16_t style_index = intern_style(parent_style);
+        const StyleMetrics& m = style_metrics(style_index);
+        float line_height = m.font.ascent + m.font.descent;
+        float width = 200.0f;
+        float height = line_height + 12.0f;
+
+        if (tag == TagAtom::Button || type == "button" || type == "submit" || type == "reset") {
+            std::string_view label = tag == TagAtom::Button ? node.label_text() : node.attribute("value");
+            width = measure(style_index, label.empty() ? std::string_view("Button") : label) + 24.0f;
+        } else if (type == "checkbox" || type == "radio") {
+            width = 24.0f;
+            height = 24.0f;
+        } else if (tag == TagAtom::Textarea) {
+            width = 320.0f;
+            height = line_height * 4.0f + 12.0f;
+        }
+        layout_atomic(DisplayItemKind::Control, index, link, style_index, width, height, std::string_view());
+        break;
+    }
+
+    case Display::LineBreak:
+        line_break(intern_style(parent_style));
+        break;
+
+    case Display::Rule: {
+        finish_line();
+        cursor_y += std::max(pending_margin, block.margin_top);
+        pending_margin = 0.0f;
+
+        DisplayItem rule{};
+        rule.kind = DisplayItemKind::Rect;
+        rule.color = RULE_COLOR;
+        rule.node = index;
+        rule.link = HTML_NO_NODE;
+        rule.rect = {content_left, cursor_y, content_right - content_left, 1.0f};
+        out->items.push_back(rule);
+        line_start = out->items.size();
+        out->max_item_height = std::max(out->max_item_height, rule.rect.height);
+
+        cursor_y += 1.0f;
+        pending_margin = block.margin_bottom;
+        break;
+    }
+    }
+}
+
+void LayoutEngine::push_frame(uint32_t node, Display display, const BlockStyle& block, const TextStyle& style,
+                              uint32_t link, bool preformatted) {
+    Frame frame;
+    frame.node = node;
+    frame.next_child = document->node(node).first_child();
+    frame.display = display;
+    frame.block = block;
+    frame.style = style;
+    frame.link = link;
+    frame.preformatted = preformatted;
+    stack.push_back(frame);
+}
+
+void LayoutEngine::close_node(const Frame& frame) {
+    if (frame.display == Display::Block || frame.display == Display::ListItem) {
+        end_block(frame.block.margin_bottom, frame.block.indent);
+    }
+}
+
+void LayoutEngine::layout_text(uint32_t node, std::string_view text, const TextStyle& style,
+                               uint32_t link, bool preformatted) {
+    uint16_t style_index = intern_style(style);
+
+    if (preformatted) {
+        // Пробелы сохраняются, переносы - только по \n
+        size_t start = 0;
+        while (start <= text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string_view::npos) {
+                end = text.size();
+            }
+            if (end > start) {
+                add_word(text.substr(start, end - start), style_index, node, link);
+            }
+            if (end == text.size()) {
+                break;
+            }
+            line_break(style_index);
+            start = end + 1;
+        }
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (is_space(text[pos])) {
+            pending_space = true;
+            pos++;
+            continue;
+        }
+        size_t end = pos;
+        while (end < text.size() && !is_space(text[end])) {
+            end++;
+        }
+        add_word(text.substr(pos, end - pos), style_index, node, link);
+        pos = end;
+    }
+}
+
+void LayoutEngine::layout_atomic(DisplayItemKind kind, uint32_t node, uint32_t link, uint16_t style,
+                                 float width, float height, std::string_view src) {
+    float space = pending_space && line_has_content ? style_metrics(style).space : 0.0f;
+    if (line_has_content && line_x + space + width > content_right) {
+        finish_line();
+    } else {
+        line_x += space;
+    }
+
+    DisplayItem item{};
+    item.kind = kind;
+    item.style = style;
+    item.node = node;
+    item.link = link;
+    item.text_offset = static_cast<uint32_t>(out->text_buffer.size());
+    out->text_buffer.append(src);
+    item.text_len = static_cast<uint32_t>(src.size());
+    item.rect = {line_x, 0.0f, width, height};
+    // Атомарный блок стоит на базовой линии
+    item.baseline = height;
+    out->items.push_back(item);
+
+    line_x += width;
+    line_ascent = std::max(line_ascent, height);
+    line_has_content = true;
+    pending_space = false;
+}
+
+void LayoutEngine::begin_block(float margin_top, float indent) {
+    finish_line();
+    pending_margin = std::max(pending_margin, margin_top);
+    content_left += indent;
+    line_x = content_left;
+}
+
+void LayoutEngine::end_block(float margin_bottom, float indent) {
+    finish_line();
+    content_left -= indent;
+    line_x = content_left;
+    pending_margin = std::max(pending_margin, margin_bottom);
+}
+
+void LayoutEngine::add_word(std::string_view word, uint16_t style, uint32_t node, uint32_t link) {
+    const StyleMetrics& m = style_metrics(style);
+    float width = measure(style, word);
+    float space = pending_space && line_has_content ? m.space : 0.0f;
+
+    if (line_has_content && line_x + space + width > content_right) {
+        finish_line();
+        space = 0.0f;
+    }
+
+    // Слова подряд одного стиля склеиваются в один фрагмент строки
+    std::pmr::vector<DisplayItem>& items = out->items;
+    DisplayItem* last = line_start < items.size() ? &items.back() : nullptr;
+    bool merge = last && line_has_content && last->kind == DisplayItemKind::Text &&
+                 last->style == style && last->node == node && last->link == link &&
+                 last->text_offset + last->text_len == out->text_buffer.size() &&
+                 last->rect.x + last->rect.width == line_x;
+
+    if (merge) {
+        if (space > 0.0f) {
+            out->text_buffer += ' ';
+        }
+        out->text_buffer.append(word);
+        last->text_len = static_cast<uint32_t>(out->text_buffer.size()) - last->text_offset;
+        last->rect.width += space + width;
+    } else {
+        DisplayItem item{};
+        item.kind = DisplayItemKind::Text;
+        item.style = style;
+        item.color = known_styles[style].color;
+        item.node = node;
+        item.link = link;
+        item.text_offset = static_cast<uint32_t>(out->text_buffer.size());
+        out->text_buffer.append(word);
+        item.text_len = static_cast<uint32_t>(word.size());
+        item.rect = {line_x + space, 0.0f, width, m.font.ascent + m.font.descent};
+        item.baseline = m.font.ascent;
+        items.push_back(item);
+    }
+
+    line_x += space + width;
+    line_ascent = std::max(line_ascent, m.font.ascent + m.half_leading);
+    line_descent = std::max(line_descent, m.font.descent + m.half_leading);
+    line_has_content = true;
+    pending_space = false;
+}
+
+void LayoutEngine::finish_line() {
+    std::pmr::vector<DisplayItem>& items = out->items;
+
+    if (line_start < items.size()) {
+        cursor_y += pending_margin;
+        pending_margin = 0.0f;
+
+        // Выравниваем все элементы строки по общей базовой линии
+        float baseline_y = cursor_y + line_ascent;
+        for (size_t i = line_start; i < items.size(); i++) {
+            items[i].rect.y = baseline_y - items[i].baseline;
+            out->max_item_height = std::max(out->max_item_height, items[i].rect.height);
+        }
+        cursor_y = baseline_y + line_descent;
+
+        // Строки идут сверху вниз, внутри строки элементы начинаются на разной
+        // высоте: для двоичного поиска по y достаточно упорядочить саму строку
+        std::stable_sort(items.begin() + static_cast<std::ptrdiff_t>(line_start), items.end(),
+                         [](const DisplayItem& a, const DisplayItem& b) { return a.rect.y < b.rect.y; });
+    }
+
+    line_start = items.size();
+    line_x = content_left;
+    line_ascent = 0.0f;
+    line_descent = 0.0f;
+    line_has_content = false;
+    pending_space = false;
+}
+
+void LayoutEngine::line_break(uint16_t style) {
+    if (line_start < out->items.size()) {
+        finish_line();
+        return;
+    }
+
+    const StyleMetrics& m = style_metrics(style);
+    cursor_y += pending_margin + m.font.ascent + m.font.descent + 2.0f * m.half_leading;
+    pending_margin = 0.0f;
+    line_x = content_left;
+    pending_space = false;
+}
+
+uint16_t LayoutEngine::intern_style(const TextStyle& style) {
+    // Стилей на странице единицы, линейный поиск быстрее хэширования
+    for (size_t i = 0; i < known_styles.size(); i++) {
+        if (known_styles[i] == style) {
+            return static_cast<uint16_t>(i);
+        }
+    }
+
+    StyleMetrics m;
+    m.font = metrics.font_metrics(style);
+    float natural = m.font.ascent + m.font.descent;
+    m.half_leading = std::max(0.0f, (style.size * LINE_HEIGHT - natural) / 2.0f);
+    m.ascii.fill(-1.0f);
+    m.space = metrics.advance(style, ' ');
+    m.ascii[' '] = m.space;
+
+    known_styles.push_back(style);
+    known_metrics.push_back(std::move(m));
+    return static_cast<uint16_t>(known_styles.size() - 1);
+}
+
+LayoutEngine::StyleMetrics& LayoutEngine::style_metrics(uint16_t style) {
+    return known_metrics[style];
+}
+
+float LayoutEngine::measure(uint16_t style, std::string_view text) {
+    StyleMetrics& m = known_metrics[style];
+    const TextStyle& text_style = known_styles[style];
+    float width = 0.0f;
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        uint32_t cp = next_codepoint(text, pos);
+        if (cp < 128) {
+            float& advance = m.ascii[cp];
+            if (advance < 0.0f) {
+                advance = metrics.advance(text_style, cp);
+            }
+            width += advance;
+        } else {
+            auto it = m.other.find(cp);
+            if (it == m.other.end()) {
+                it = m.other.emplace(cp, metrics.advance(text_style, cp)).first;
+            }
+            width += it->second;
+        }
+    }
+    return width;
+}
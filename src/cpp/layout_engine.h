@@ -0,0 +1,245 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "html_document.h"
+
+// Начертание текста. Стили интернируются в DisplayList::styles,
+// элементы списка отображения ссылаются на них по индексу
+struct TextStyle {
+    float size = 16.0f;
+    bool bold = false;
+    bool italic = false;
+    bool monospace = false;
+    bool underline = false;
+    // 0xRRGGBB
+    uint32_t color = 0x212529;
+
+    bool operator==(const TextStyle& other) const {
+        return size == other.size && bold == other.bold && italic == other.italic &&
+               monospace == other.monospace && underline == other.underline &&
+               color == other.color;
+    }
+};
+
+struct FontMetrics {
+    float ascent = 0.0f;
+    float descent = 0.0f;
+};
+
+struct LayoutRect {
+    float x = 0.0f;
+    float y = 0.0f;
+    float width = 0.0f;
+    float height = 0.0f;
+
+    float bottom() const { return y + height; }
+    bool contains(float px, float py) const {
+        return px >= x && px < x + width && py >= y && py < y + height;
+    }
+};
+
+// Источник размеров для раскладки. Движок раскладки не зависит от GTK:
+// шрифты измеряет отрисовщик (Pango), а без экрана - любая другая реализация
+class LayoutMetrics {
+public:
+    virtual ~LayoutMetrics() = default;
+
+    virtual FontMetrics font_metrics(const TextStyle& style) = 0;
+    // Ширина одного символа; результат кэшируется движком
+    virtual float advance(const TextStyle& style, uint32_t codepoint) = 0;
+    // Размер уже загруженного изображения; false - размер пока неизвестен
+    virtual bool image_size(std::string_view src, float& width, float& height) {
+        (void)src; (void)width; (void)height;
+        return false;
+    }
+};
+
+// Размеры без шрифтов: ширины как у типичного пропорционального шрифта.
+// Для раскладки без экрана (headless-режим, бенчмарки), где Pango недоступен
+class ApproximateMetrics : public LayoutMetrics {
+public:
+    FontMetrics font_metrics(const TextStyle& style) override;
+    float advance(const TextStyle& style, uint32_t codepoint) override;
+};
+
+enum class DisplayItemKind : uint8_t {
+    // Фрагмент строки текста одного стиля
+    Text,
+    // Залитый прямоугольник (hr, маркеры)
+    Rect,
+    // Изображение или его заглушка
+    Image,
+    // Место под нативный элемент формы
+    Control,
+};
+
+// Элемент списка отображения в координатах документа
+struct DisplayItem {
+    DisplayItemKind kind;
+    uint16_t style;
+    uint32_t color;
+    LayoutRect rect;
+    // Узел документа, из которого получен элемент
+    uint32_t node;
+    // Ближайшая ссылка <a> над элементом или HTML_NO_NODE
+    uint32_t link;
+    // Text: фрагмент DisplayList::text_buffer; Image: src
+    uint32_t text_offset;
+    uint32_t text_len;
+    // Базовая линия текста относительно rect.y
+    float baseline;
+};
+
+// Результат раскладки: сохраняется между перерисовками и прокруткой,
+// отрисовщик только проходит по видимой части.
+// Память берется из переданного ресурса - обычно арены страницы
+class DisplayList {
+public:
+    explicit DisplayList(std::pmr::memory_resource* memory = std::pmr::get_default_resource())
+        : items(memory), styles(memory), text_buffer(memory) {}
+
+    std::pmr::vector<DisplayItem> items;
+    std::pmr::vector<TextStyle> styles;
+    // Тексты фрагментов строк: пробелы уже схлопнуты
+    std::pmr::string text_buffer;
+
+    float width = 0.0f;
+    float height = 0.0f;
+
+    std::string_view text(const DisplayItem& item) const {
+        return std::string_view(text_buffer.data() + item.text_offset, item.text_len);
+    }
+
+    // Диапазон элементов, пересекающих полосу [top, bottom).
+    // Элементы отсортированы по rect.y, поиск - двоичный
+    std::pair<size_t, size_t> visible_range(float top, float bottom) const;
+
+    // Верхний элемент в точке или nullptr
+    const DisplayItem* hit_test(float x, float y) const;
+
+    void clear();
+
+private:
+    friend class LayoutEngine;
+    // Высота самого высокого элемента - граница поиска назад от top
+    float max_item_height = 0.0f;
+};
+
+// Раскладка документа: блоки идут сверху вниз, строчное содержимое
+// переносится по словам и собирается во фрагменты строк.
+//
+// Раскладка возобновляемая: обход дерева идет по явному стеку, и можно
+// разложить документ только до нужной высоты (видимая часть и запас),
+// а остальное - по мере прокрутки. Ширины символов кэшируются по стилю,
+// поэтому повторная раскладка не обращается к шрифтам.
+class LayoutEngine {
+public:
+    explicit LayoutEngine(LayoutMetrics& metrics);
+
+    LayoutEngine(const LayoutEngine&) = delete;
+    LayoutEngine& operator=(const LayoutEngine&) = delete;
+
+    // Раскладывает документ в заданную ширину целиком
+    void layout(const HtmlDocument& document, float width, DisplayList& out);
+
+    // Начинает раскладку заново. Документ и out должны жить, пока идет раскладка
+    void begin(const HtmlDocument& document, float width, DisplayList& out);
+
+    // Продолжает раскладку, пока низ разложенной части выше y.
+    // true - документ разложен целиком
+    bool layout_until(float y);
+
+    bool finished() const { return done; }
+
+    // Высота всего документа: точная после завершения, до него - оценка
+    // по доле пройденных узлов
+    float estimated_height() const;
+
+    // Сбрасывает кэш ширин (например, после смены шрифтов темы)
+    void clear_metrics_cache();
+
+private:
+    enum class Display : uint8_t { None, Block, Inline, ListItem, TableCell, Image, Control, LineBreak, Rule };
+
+    struct BlockStyle {
+        Display display = Display::Inline;
+        float margin_top = 0.0f;
+        float margin_bottom = 0.0f;
+        float indent = 0.0f;
+    };
+
+    struct StyleMetrics {
+        FontMetrics font;
+        // Добавка к высоте строки сверху и снизу (межстрочный интервал)
+        float half_leading = 0.0f;
+        float space = 0.0f;
+        std::array<float, 128> ascii;
+        std::unordered_map<uint32_t, float> other;
+    };
+
+    // Открытый узел с детьми: при закрытии завершает свой блок
+    struct Frame {
+        uint32_t node;
+        uint32_t next_child;
+        Display display;
+        BlockStyle block;
+        TextStyle style;
+        uint32_t link;
+        bool preformatted;
+    };
+
+    // Стили приходят вычисленными из снимка; по тегу определяются только
+    // замещаемые элементы (изображения, элементы форм, br, hr)
+    static BlockStyle block_style(TagAtom tag, const HtmlSnapshotStyle* computed);
+    static TextStyle text_style(const HtmlSnapshotStyle* computed, const TextStyle& parent);
+
+    void open_node(uint32_t node, const TextStyle& style, uint32_t link, bool preformatted);
+    void push_frame(uint32_t node, Display display, const BlockStyle& block, const TextStyle& style,
+                    uint32_t link, bool preformatted);
+    void close_node(const Frame& frame);
+    void finish();
+    void layout_text(uint32_t node, std::string_view text, const TextStyle& style, uint32_t link, bool preformatted);
+    void layout_atomic(DisplayItemKind kind, uint32_t node, uint32_t link, uint16_t style,
+                       float width, float height, std::string_view src);
+
+    void begin_block(float margin_top, float indent);
+    void end_block(float margin_bottom, float indent);
+    void add_word(std::string_view word, uint16_t style, uint32_t node, uint32_t link);
+    void finish_line();
+    // Принудительный перенос; пустая строка тоже занимает высоту
+    void line_break(uint16_t style);
+
+    uint16_t intern_style(const TextStyle& style);
+    StyleMetrics& style_metrics(uint16_t style);
+    float measure(uint16_t style, std::string_view text);
+
+    LayoutMetrics& metrics;
+    // Ширины символов по стилю; индексы совпадают с out->styles
+    std::vector<TextStyle> known_styles;
+    std::vector<StyleMetrics> known_metrics;
+
+    // Состояние текущего прохода
+    const HtmlDocument* document;
+    DisplayList* out;
+    float content_left;
+    float content_right;
+    float cursor_y;
+    float pending_margin;
+    // Текущая строка: элементы с line_start в out->items
+    size_t line_start;
+    float line_x;
+    float line_ascent;
+    float line_descent;
+    bool pending_space;
+    bool line_has_content;
+    std::vector<Frame> stack;
+    uint32_t last_opened;
+    bool done;
+};
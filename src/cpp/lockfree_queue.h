@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+
+// Очередь без блокировок: много производителей, один потребитель
+// (схема Вьюкова). Производитель - любой поток, потребитель - главный
+// цикл GTK; push никогда не ждет, pop не ждет и не конкурирует с push
+// за общий замок.
+//
+// Узлы выделяются на каждый push, поэтому очередь рассчитана на редкие
+// крупные элементы (готовые документы, задачи), а не на поток байтов.
+template <typename T>
+class LockFreeQueue {
+public:
+    LockFreeQueue() {
+        Node* stub = new Node();
+        head.store(stub, std::memory_order_relaxed);
+        tail = stub;
+    }
+
+    ~LockFreeQueue() {
+        T value;
+        while (pop(value)) {
+        }
+        delete tail;
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+    // Из любого потока
+    void push(T value) {
+        Node* node = new Node();
+        node->value = std::move(value);
+        Node* previous = head.exchange(node, std::memory_order_acq_rel);
+        // До этой записи элемент еще не виден потребителю: pop вернет false,
+        // и производитель, закончив push, сам разбудит потребителя
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // Только из потока-потребителя; false - очередь пуста
+    bool pop(T& value) {
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete tail;
+        // next становится новой заглушкой, его значение уже забрано
+        tail = next;
+        return true;
+    }
+
+private:
+    struct Node {
+        std::atomic<Node*> next{nullptr};
+        T value{};
+    };
+
+    // Последний добавленный узел; сюда пишут производители
+    std::atomic<Node*> head;
+    // Заглушка перед первым непрочитанным узлом; только потребитель
+    Node* tail;
+};
@@ -0,0 +1,303 @@
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+namespace {
+    using WallClock = std::chrono::system_clock;
+
+    // Ячейка кольца. sequence - схема Вьюкова: ячейка свободна для записи
+    // с номером pos, когда sequence == pos, и готова к чтению, когда
+    // sequence == pos + 1
+    struct LogRecord {
+        std::atomic<uint64_t> sequence;
+        int64_t time_us;
+        uint32_t thread;
+        LogLevel level;
+        uint16_t length;
+        const char* category;
+        char message[logging::MAX_MESSAGE];
+    };
+
+    // Степень двойки
+    constexpr size_t RING_SIZE = 1024;
+    // Сколько байт вывода копить перед записью в stderr
+    constexpr size_t WRITE_BATCH = 16 * 1024;
+
+    std::atomic<uint32_t> next_thread{1};
+    // Номер потока в журнале: короче и стабильнее pthread_t
+    thread_local uint32_t log_thread = 0;
+
+    uint32_t current_thread() {
+        if (log_thread == 0) {
+            log_thread = next_thread.fetch_add(1, std::memory_order_relaxed);
+        }
+        return log_thread;
+    }
+
+    LogLevel initial_level() {
+        LogLevel level = LogLevel::Info;
+        const char* value = std::getenv("HEAVENLY_LOG");
+        if (value) {
+            logging::parse_level(value, level);
+        }
+        return level;
+    }
+
+    std::atomic<LogLevel>& runtime_level() {
+        static std::atomic<LogLevel> level{initial_level()};
+        return level;
+    }
+
+    // После разрушения журнала (завершение процесса) записи выводятся сразу
+    std::atomic<bool> logger_stopped{false};
+
+    size_t format_record(char* out, size_t size, int64_t time_us, uint32_t thread, LogLevel level,
+                         const char* category, const char* message, size_t length) {
+        std::time_t seconds = static_cast<std::time_t>(time_us / 1000000);
+        std::tm local;
+        localtime_r(&seconds, &local);
+        int written = std::snprintf(out, size, "%02d:%02d:%02d.%03d %-5s [%s] #%u %.*s\n",
+                                    local.tm_hour, local.tm_min, local.tm_sec,
+                                    static_cast<int>((time_us / 1000) % 1000), logging::level_name(level),
+                                    category, thread, static_cast<int>(length), message);
+        if (written < 0) {
+            return 0;
+        }
+        return std::min(static_cast<size_t>(written), size - 1);
+    }
+
+    class Logger {
+    public:
+        static Logger& instance() {
+            static Logger logger;
+            return logger;
+        }
+
+        // Любой поток; false - кольцо заполнено
+        bool push(LogLevel level, const char* category, const char* message, size_t length) {
+            uint64_t pos = enqueue_pos.load(std::memory_order_relaxed);
+            LogRecord* record;
+            for (;;) {
+                record = &ring[pos & (RING_SIZE - 1)];
+                uint64_t sequence = record->sequence.load(std::memory_order_acquire);
+                int64_t diff = static_cast<int64_t>(sequence) - static_cast<int64_t>(pos);
+                if (diff == 0) {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                        break;
+                    }
+                } else if (diff < 0) {
+                    dropped_count.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                } else {
+                    pos = enqueue_pos.load(std::memory_order_relaxed);
+                }
+            }
+
+            record->time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                WallClock::now().time_since_epoch()).count();
+            record->thread = current_thread();
+            record->level = level;
+            record->category = category;
+            record->length = static_cast<uint16_t>(length);
+            std::memcpy(record->message, message, length);
+            // seq_cst: в паре с writer_sleeping (см. run) запись не может
+            // остаться незамеченной уснувшим потоком вывода
+            record->sequence.store(pos + 1, std::memory_order_seq_cst);
+
+            wake_writer();
+            return true;
+        }
+
+        void flush() {
+            uint64_t target = enqueue_pos.load(std::memory_order_acquire);
+            wake_writer();
+            uint64_t done = consumed.load(std::memory_order_acquire);
+            while (done < target) {
+                consumed.wait(done, std::memory_order_acquire);
+                done = consumed.load(std::memory_order_acquire);
+            }
+        }
+
+        uint64_t dropped() const {
+            return dropped_count.load(std::memory_order_relaxed);
+        }
+
+    private:
+        Logger()
+            : enqueue_pos(0)
+            , dequeue_pos(0)
+            , consumed(0)
+            , wake(0)
+            , writer_sleeping(false)
+            , stopping(false)
+            , dropped_count(0)
+        {
+            for (size_t i = 0; i < RING_SIZE; i++) {
+                ring[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            writer = std::thread([this]() { run(); });
+        }
+
+        ~Logger() {
+            logger_stopped.store(true, std::memory_order_release);
+            stopping.store(true);
+            wake.fetch_add(1);
+            wake.notify_one();
+            writer.join();
+        }
+
+        // Будит поток вывода, только если он уснул: обычная запись
+        // обходится без системных вызовов
+        void wake_writer() {
+            if (writer_sleeping.load(std::memory_order_seq_cst)) {
+                wake.fetch_add(1, std::memory_order_release);
+                wake.notify_one();
+            }
+        }
+
+        // Поток вывода: единственный потребитель кольца
+        void run() {
+            char batch[WRITE_BATCH];
+            size_t batch_size = 0;
+            uint64_t reported_dropped = 0;
+
+            for (;;) {
+                LogRecord* record = &ring[dequeue_pos & (RING_SIZE - 1)];
+                if (record->sequence.load(std::memory_order_acquire) == dequeue_pos + 1) {
+                    constexpr size_t MAX_LINE = logging::MAX_MESSAGE + 128;
+                    if (batch_size + MAX_LINE > sizeof(batch)) {
+                        std::fwrite(batch, 1, batch_size, stderr);
+                        batch_size = 0;
+                        consumed.store(dequeue_pos, std::memory_order_release);
+                        consumed.notify_all();
+                    }
+                    batch_size += format_record(batch + batch_size, MAX_LINE, record->time_us, record->thread,
+                                                record->level, record->category, record->message,
+                                                record->length);
+                    record->sequence.store(dequeue_pos + RING_SIZE, std::memory_order_release);
+                    dequeue_pos++;
+                    continue;
+                }
+
+                // Кольцо пусто: выводим накопленное и засыпаем до следующей записи
+                uint64_t dropped_now = dropped_count.load(std::memory_order_relaxed);
+                if (dropped_now != reported_dropped) {
+                    char text[64];
+                    int length = std::snprintf(text, sizeof(text), "отброшено записей: %llu",
+                                               static_cast<unsigned long long>(dropped_now - reported_dropped));
+                    int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        WallClock::now().time_since_epoch()).count();
+                    batch_size += format_record(batch + batch_size, sizeof(batch) - batch_size, time_us,
+                                                current_thread(), LogLevel::Warn, "log", text,
+                                                static_cast<size_t>(length));
+                    reported_dropped = dropped_now;
+                }
+                if (batch_size > 0) {
+                    std::fwrite(batch, 1, batch_size, stderr);
+                    std::fflush(stderr);
+                    batch_size = 0;
+                }
+                consumed.store(dequeue_pos, std::memory_order_release);
+                consumed.notify_all();
+
+                uint32_t observed = wake.load(std::memory_order_acquire);
+                writer_sleeping.store(true, std::memory_order_seq_cst);
+                bool empty = record->sequence.load(std::memory_order_seq_cst) != dequeue_pos + 1;
+                if (empty) {
+                    if (stopping.load()) {
+                        return;
+                    }
+                    wake.wait(observed, std::memory_order_acquire);
+                }
+                writer_sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        LogRecord ring[RING_SIZE];
+        alignas(64) std::atomic<uint64_t> enqueue_pos;
+        // Только поток вывода
+        alignas(64) uint64_t dequeue_pos;
+        // Сколько записей уже выведено: для flush
+        std::atomic<uint64_t> consumed;
+        std::atomic<uint32_t> wake;
+        std::atomic<bool> writer_sleeping;
+        std::atomic<bool> stopping;
+        std::atomic<uint64_t> dropped_count;
+        std::thread writer;
+    };
+}
+
+LogLine::LogLine(LogLevel level, const char* category)
+    : level(level)
+    , category(category)
+    , buffer(message, sizeof(message))
+    , stream(&buffer) {
+}
+
+LogLine::~LogLine() {
+    if (!logger_stopped.load(std::memory_order_acquire)) {
+        Logger::instance().push(level, category, message, buffer.size());
+        return;
+    }
+
+    char line[logging::MAX_MESSAGE + 128];
+    int64_t time_us = std::chrono::duration_cast<std::chrono::microseconds>(
+        WallClock::now().time_since_epoch()).count();
+    size_t length = format_record(line, sizeof(line), time_us, current_thread(), level, category,
+                                  message, buffer.size());
+    std::fwrite(line, 1, length, stderr);
+}
+
+namespace logging {
+    void set_level(LogLevel level) {
+        runtime_level().store(level, std::memory_order_relaxed);
+    }
+
+    LogLevel level() {
+        return runtime_level().load(std::memory_order_relaxed);
+    }
+
+    void flush() {
+        if (!logger_stopped.load(std::memory_order_acquire)) {
+            Logger::instance().flush();
+        }
+    }
+
+    uint64_t dropped() {
+        return logger_stopped.load(std::memory_order_acquire) ? 0 : Logger::instance().dropped();
+    }
+
+    const char* level_name(LogLevel level) {
+        switch (level) {
+        case LogLevel::Trace: return "TRACE";
+        case LogLevel::Debug: return "DEBUG";
+        case LogLevel::Info: return "INFO";
+        case LogLevel::Warn: return "WARN";
+        case LogLevel::Error: return "ERROR";
+        default: return "OFF";
+        }
+    }
+
+    bool parse_level(const char* name, LogLevel& level) {
+        static const struct {
+            const char* name;
+            LogLevel level;
+        } levels[] = {
+            {"trace", LogLevel::Trace}, {"debug", LogLevel::Debug}, {"info", LogLevel::Info},
+            {"warn", LogLevel::Warn},   {"error", LogLevel::Error}, {"off", LogLevel::Off},
+        };
+        for (const auto& entry : levels) {
+            if (std::strcmp(name, entry.name) == 0) {
+                level = entry.level;
+                return true;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+
+enum class LogLevel : uint8_t {
+    Trace = 0,
+    Debug,
+    Info,
+    Warn,
+    Error,
+    Off,
+};
+
+// Уровень, ниже которого вызовы LOG_* не попадают в бинарник
+// (CMake: HEAVENLY_LOG_LEVEL). 0 - trace, 1 - debug и т.д.
+#ifndef HEAVENLY_LOG_LEVEL
+#define HEAVENLY_LOG_LEVEL 1
+#endif
+
+// Асинхронный журнал. Запись форматируется в буфер на стеке и кладется
+// в кольцо фиксированного размера без блокировок и без выделений памяти;
+// в stderr ее выводит отдельный поток. Вызывающий поток (в том числе
+// главный цикл GTK) никогда не ждет вывода. Если кольцо заполнено, запись
+// отбрасывается и учитывается в счетчике потерь.
+namespace logging {
+    // Длина сообщения одной записи; длинные обрезаются
+    constexpr size_t MAX_MESSAGE = 224;
+
+    // Уровень во время работы (по умолчанию Info, переменная окружения
+    // HEAVENLY_LOG=trace|debug|info|warn|error|off)
+    void set_level(LogLevel level);
+    LogLevel level();
+
+    inline bool enabled(LogLevel level) {
+        return static_cast<int>(level) >= HEAVENLY_LOG_LEVEL && level >= logging::level();
+    }
+
+    // Дождаться вывода всех уже принятых записей
+    void flush();
+    // Записей, отброшенных из-за переполнения кольца
+    uint64_t dropped();
+
+    const char* level_name(LogLevel level);
+    // "warn" -> Warn; false - неизвестное имя
+    bool parse_level(const char* name, LogLevel& level);
+}
+
+// Одна запись: собирается через operator<< и уходит в кольцо в деструкторе.
+// Используется только через макросы LOG_*
+class LogLine {
+public:
+    LogLine(LogLevel level, const char* category);
+    ~LogLine();
+
+    template <typename T>
+    LogLine& operator<<(const T& value) {
+        stream << value;
+        return *this;
+    }
+
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+
+private:
+    // Поток в массив фиксированного размера: без выделений памяти,
+    // лишнее отбрасывается
+    class FixedBuffer : public std::streambuf {
+    public:
+        FixedBuffer(char* data, size_t size) { setp(data, data + size); }
+        size_t size() const { return static_cast<size_t>(pptr() - pbase()); }
+
+    protected:
+        int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+    };
+
+    LogLevel level;
+    const char* category;
+    char message[logging::MAX_MESSAGE];
+    FixedBuffer buffer;
+    std::ostream stream;
+};
+
+// LOG_DEBUG("renderer") << "Найдено элементов: " << count;
+// Ниже HEAVENLY_LOG_LEVEL выражение выбрасывается при компиляции, ниже
+// уровня времени выполнения аргументы не вычисляются. category - строковая
+// константа
+#define HEAVENLY_LOG(level, category)                                              \
+    if constexpr (static_cast<int>(level) < HEAVENLY_LOG_LEVEL) {                  \
+    } else if (!logging::enabled(level)) {                                         \
+    } else                                                                         \
+        LogLine(level, category)
+
+#define LOG_TRACE(category) HEAVENLY_LOG(LogLevel::Trace, category)
+#define LOG_DEBUG(category) HEAVENLY_LOG(LogLevel::Debug, category)
+#define LOG_INFO(category) HEAVENLY_LOG(LogLevel::Info, category)
+#define LOG_WARN(category) HEAVENLY_LOG(LogLevel::Warn, category)
+#define LOG_ERROR(category) HEAVENLY_LOG(LogLevel::Error, category)
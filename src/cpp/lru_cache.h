@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+// Счетчики работы кэша
+struct LruCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t insertions = 0;
+    uint64_t evictions = 0;
+    // Записи больше всего бюджета, которые не были закэшированы
+    uint64_t rejected = 0;
+};
+
+// LRU кэш с бюджетом в байтах. Размер записи задает вызывающий,
+// при превышении бюджета вытесняются давно не использованные записи.
+//
+// Записи лежат прямо в узлах хэш-таблицы и связаны в интрузивный двусвязный
+// список (узлы unordered_map не перемещаются при рехэше), поэтому поиск,
+// вставка и вытеснение - O(1) и одно выделение памяти на запись.
+// Не потокобезопасен: используется из главного потока GTK.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache {
+public:
+    explicit LruCache(size_t budget_bytes)
+        : head(nullptr)
+        , tail(nullptr)
+        , budget(budget_bytes)
+        , used(0)
+    {
+    }
+
+    LruCache(const LruCache&) = delete;
+    LruCache& operator=(const LruCache&) = delete;
+
+    // Возвращает значение и делает запись самой свежей; nullptr - промах
+    const Value* get(const Key& key) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            counters.misses++;
+            return nullptr;
+        }
+        counters.hits++;
+        move_to_front(&it->second);
+        return &it->second.value;
+    }
+
+    // Проверка без влияния на порядок вытеснения и счетчики
+    bool contains(const Key& key) const {
+        return entries.find(key) != entries.end();
+    }
+
+    // Значение без влияния на порядок вытеснения и счетчики; nullptr - нет записи
+    const Value* peek(const Key& key) const {
+        auto it = entries.find(key);
+        return it != entries.end() ? &it->second.value : nullptr;
+    }
+
+    // Запись больше всего бюджета не кэшируется
+    bool put(const Key& key, Value value, size_t size_bytes) {
+        erase(key);
+        if (size_bytes > budget) {
+            counters.rejected++;
+            return false;
+        }
+
+        auto result = entries.emplace(key, Entry{std::move(value), size_bytes, nullptr, nullptr, nullptr});
+        Entry* entry = &result.first->second;
+        entry->key = &result.first->first;
+        link_front(entry);
+
+        used += size_bytes;
+        counters.insertions++;
+        evict_to(budget);
+        return true;
+    }
+
+    bool erase(const Key& key) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            return false;
+        }
+        unlink(&it->second);
+        used -= it->second.size;
+        entries.erase(it);
+        return true;
+    }
+
+    void clear() {
+        entries.clear();
+        head = nullptr;
+        tail = nullptr;
+        used = 0;
+    }
+
+    // Уменьшение бюджета сразу вытесняет лишнее
+    void set_budget(size_t budget_bytes) {
+        budget = budget_bytes;
+        evict_to(budget);
+    }
+
+    size_t size_bytes() const { return used; }
+    size_t budget_bytes() const { return budget; }
+    size_t count() const { return entries.size(); }
+    const LruCacheStats& stats() const { return counters; }
+    void reset_stats() { counters = LruCacheStats(); }
+
+private:
+    struct Entry {
+        Value value;
+        size_t size;
+        const Key* key;
+        Entry* prev;
+        Entry* next;
+    };
+
+    void link_front(Entry* entry) {
+        entry->prev = nullptr;
+        entry->next = head;
+        if (head) {
+            head->prev = entry;
+        }
+        head = entry;
+        if (!tail) {
+            tail = entry;
+        }
+    }
+
+    void unlink(Entry* entry) {
+        if (entry->prev) {
+            entry->prev->next = entry->next;
+        } else {
+            head = entry->next;
+        }
+        if (entry->next) {
+            entry->next->prev = entry->prev;
+        } else {
+            tail = entry->prev;
+        }
+        entry->prev = nullptr;
+        entry->next = nullptr;
+    }
+
+    void move_to_front(Entry* entry) {
+        if (entry != head) {
+            unlink(entry);
+            link_front(entry);
+        }
+    }
+
+    void evict_to(size_t limit) {
+        while (used > limit && tail) {
+            Entry* oldest = tail;
+            unlink(oldest);
+            used -= oldest->size;
+            counters.evictions++;
+            entries.erase(entries.find(*oldest->key));
+        }
+    }
+
+    std::unordered_map<Key, Entry, Hash> entries;
+    // head - самая свежая запись, tail - кандидат на вытеснение
+    Entry* head;
+    Entry* tail;
+    size_t budget;
+    size_t used;
+    LruCacheStats counters;
+};
@@ -1,10 +1,28 @@
 #include "browser.h"
+#include "headless.h"
+#include "tracing.h"
+#include <cstring>
 #include <iostream>
 #include <gtk/gtk.h>
 
 int main(int argc, char* argv[]) {
+    // Пакетная обработка страниц без окна: GTK не инициализируется
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            return headless_main(argc, argv);
+        }
+    }
+    
     std::cout << "Запуск HeavenlyWebGu..." << std::endl;
     
+    // HEAVENLY_TRACE=путь: трасса этапов загрузки пишется туда при выходе
+    // и по F12 (show_developer_tools)
+    std::string trace_path = tracing::output_path();
+    if (!trace_path.empty()) {
+        trace_set_thread_name("main");
+        tracing::set_enabled(true);
+    }
+    
     try {
         // Создаем экземпляр браузера
         Browser browser;
@@ -23,6 +41,10 @@ int main(int argc, char* argv[]) {
         // Запускаем главный цикл GTK
         gtk_main();
         
+        if (!trace_path.empty() && !tracing::write_chrome_json(trace_path)) {
+            std::cerr << "Не удалось записать трассу: " << trace_path << std::endl;
+        }
+        
     } catch (const std::exception& e) {
         std::cerr << "Критическая ошибка: " << e.what() << std::endl;
         return 1;
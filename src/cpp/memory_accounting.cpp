@@ -0,0 +1,205 @@
+#include "memory_accounting.h"
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem, unsigned tab) {
+    memory_get_thread_tags(&previous_subsystem, &previous_tab);
+    memory_set_thread_tags(subsystem, tab);
+    memory_rust_set_thread_tags(subsystem, tab);
+}
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem) {
+    memory_get_thread_tags(&previous_subsystem, &previous_tab);
+    memory_set_thread_tags(subsystem, previous_tab);
+    memory_rust_set_thread_tags(subsystem, previous_tab);
+}
+
+MemoryScope::~MemoryScope() {
+    memory_set_thread_tags(previous_subsystem, previous_tab);
+    memory_rust_set_thread_tags(previous_subsystem, previous_tab);
+}
+
+namespace {
+    void write_counters(std::ostringstream& out, const MemoryCounters& counters) {
+        out << "{\"live_bytes\":" << counters.live_bytes
+            << ",\"peak_bytes\":" << counters.peak_bytes
+            << ",\"allocations\":" << counters.allocations
+            << ",\"frees\":" << counters.frees << "}";
+    }
+
+    void write_usage(std::ostringstream& out, const MemoryUsage& usage) {
+        out << "{\"live_bytes\":" << usage.live_bytes()
+            << ",\"peak_bytes\":" << usage.peak_bytes()
+            << ",\"allocations\":" << usage.allocations()
+            << ",\"native\":";
+        write_counters(out, usage.native);
+        out << ",\"rust\":";
+        write_counters(out, usage.rust);
+        out << "}";
+    }
+}
+
+namespace memory_accounting {
+    bool native_enabled() {
+#ifdef HEAVENLY_MEMORY_ACCOUNTING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    bool rust_enabled() {
+        return memory_rust_accounting_enabled();
+    }
+
+    const char* subsystem_name(MemorySubsystem subsystem) {
+        switch (subsystem) {
+        case MEMORY_OTHER: return "other";
+        case MEMORY_NETWORK: return "network";
+        case MEMORY_PARSER: return "parser";
+        case MEMORY_RENDERER: return "renderer";
+        case MEMORY_CACHE: return "cache";
+        case MEMORY_IMAGES: return "images";
+        default: return "unknown";
+        }
+    }
+
+    MemoryUsage subsystem(MemorySubsystem subsystem) {
+        MemoryUsage usage;
+        memory_get_subsystem_counters(subsystem, &usage.native);
+        memory_rust_subsystem_counters(subsystem, &usage.rust);
+        return usage;
+    }
+
+    MemoryUsage tab(unsigned tab) {
+        MemoryUsage usage;
+        memory_get_tab_counters(tab, &usage.native);
+        memory_rust_tab_counters(tab, &usage.rust);
+        return usage;
+    }
+
+    MemoryUsage total() {
+        MemoryUsage usage;
+        memory_get_total_counters(&usage.native);
+        memory_rust_total_counters(&usage.rust);
+        return usage;
+    }
+
+    unsigned open_tab() {
+        unsigned tab = memory_tab_open();
+        if (tab != MEMORY_NO_TAB) {
+            memory_rust_tab_restart(tab);
+        }
+        return tab;
+    }
+
+    void close_tab(unsigned tab) {
+        memory_tab_close(tab);
+    }
+
+    std::string to_json() {
+        std::ostringstream out;
+        out << "{\"native_accounting\":" << (native_enabled() ? "true" : "false")
+            << ",\"rust_accounting\":" << (rust_enabled() ? "true" : "false")
+            << ",\"tab_budget_bytes\":" << TAB_BUDGET
+            << ",\"total\":";
+        write_usage(out, total());
+
+        out << ",\"subsystems\":{";
+        for (int i = 0; i < MEMORY_SUBSYSTEM_COUNT; i++) {
+            MemorySubsystem id = static_cast<MemorySubsystem>(i);
+            out << (i ? "," : "") << "\"" << subsystem_name(id) << "\":";
+            write_usage(out, subsystem(id));
+        }
+
+        // Вкладка 0 - память вне вкладок
+        out << "},\"tabs\":[";
+        bool first = true;
+        for (unsigned id = 0; id < MEMORY_MAX_TABS; id++) {
+            if (id != MEMORY_NO_TAB && !memory_tab_is_open(id)) {
+                continue;
+            }
+            MemoryUsage usage = tab(id);
+            out << (first ? "" : ",") << "{\"tab\":" << id
+                << ",\"over_budget\":" << (id != MEMORY_NO_TAB && usage.live_bytes() > TAB_BUDGET ? "true" : "false")
+                << ",\"usage\":";
+            write_usage(out, usage);
+            out << "}";
+            first = false;
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    std::string report_path() {
+        const char* path = std::getenv("HEAVENLY_MEMORY_REPORT");
+        return path ? path : "";
+    }
+
+    bool write_json(const std::string& path) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << to_json();
+        return static_cast<bool>(file);
+    }
+}
+
+#ifdef HEAVENLY_MEMORY_ACCOUNTING
+// Глобальные operator new/delete: выделения C++ идут через учет из memory.c
+// и помечаются метками потока, как и выделения C
+
+namespace {
+    void* counted_new(std::size_t size, std::size_t align) {
+        for (;;) {
+            if (void* ptr = memory_alloc(size, align)) {
+                return ptr;
+            }
+            std::new_handler handler = std::get_new_handler();
+            if (!handler) {
+                throw std::bad_alloc();
+            }
+            handler();
+        }
+    }
+
+    void* counted_new_nothrow(std::size_t size, std::size_t align) noexcept {
+        try {
+            return counted_new(size, align);
+        } catch (...) {
+            return nullptr;
+        }
+    }
+}
+
+void* operator new(std::size_t size) { return counted_new(size, 0); }
+void* operator new[](std::size_t size) { return counted_new(size, 0); }
+void* operator new(std::size_t size, std::align_val_t align) { return counted_new(size, static_cast<std::size_t>(align)); }
+void* operator new[](std::size_t size, std::align_val_t align) { return counted_new(size, static_cast<std::size_t>(align)); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return counted_new_nothrow(size, 0); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return counted_new_nothrow(size, 0); }
+void* operator new(std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return counted_new_nothrow(size, static_cast<std::size_t>(align));
+}
+void* operator new[](std::size_t size, std::align_val_t align, const std::nothrow_t&) noexcept {
+    return counted_new_nothrow(size, static_cast<std::size_t>(align));
+}
+
+// Заголовок блока хранит смещение, поэтому все формы delete сводятся к memory_free
+void operator delete(void* ptr) noexcept { memory_free(ptr); }
+void operator delete[](void* ptr) noexcept { memory_free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { memory_free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { memory_free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { memory_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { memory_free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { memory_free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { memory_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { memory_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { memory_free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { memory_free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { memory_free(ptr); }
+#endif
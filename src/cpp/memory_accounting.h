@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "memory.h"
+
+// FFI интерфейсы для Rust: счетный аллокатор src/rust/src/memory.rs
+extern "C" {
+    bool memory_rust_accounting_enabled();
+    void memory_rust_set_thread_tags(uint32_t subsystem, uint32_t tab);
+    bool memory_rust_subsystem_counters(uint32_t subsystem, MemoryCounters* counters);
+    bool memory_rust_tab_counters(uint32_t tab, MemoryCounters* counters);
+    void memory_rust_total_counters(MemoryCounters* counters);
+    void memory_rust_tab_restart(uint32_t tab);
+}
+
+// Метки памяти текущего потока на время области видимости: выделения C,
+// C++ (через operator new) и Rust попадают в заданную подсистему и вкладку.
+// Задачи Rust, запущенные внутри, наследуют вкладку
+class MemoryScope {
+public:
+    MemoryScope(MemorySubsystem subsystem, unsigned tab);
+    // Вкладка остается прежней
+    explicit MemoryScope(MemorySubsystem subsystem);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope& operator=(const MemoryScope&) = delete;
+
+private:
+    MemorySubsystem previous_subsystem;
+    unsigned previous_tab;
+};
+
+// Счетчики одного среза: выделения C/C++ и Rust по отдельности
+struct MemoryUsage {
+    MemoryCounters native = {};
+    MemoryCounters rust = {};
+
+    size_t live_bytes() const { return native.live_bytes + rust.live_bytes; }
+    // Пики сторон могли прийтись на разное время: это верхняя оценка
+    size_t peak_bytes() const { return native.peak_bytes + rust.peak_bytes; }
+    uint64_t allocations() const { return native.allocations + rust.allocations; }
+};
+
+namespace memory_accounting {
+    // Целевой предел памяти одной вкладки
+    constexpr size_t TAB_BUDGET = 100 * 1024 * 1024;
+
+    // Учет C++ выделений включен при сборке (HEAVENLY_MEMORY_ACCOUNTING)
+    bool native_enabled();
+    bool rust_enabled();
+
+    const char* subsystem_name(MemorySubsystem subsystem);
+
+    MemoryUsage subsystem(MemorySubsystem subsystem);
+    MemoryUsage tab(unsigned tab);
+    MemoryUsage total();
+
+    // Номер для новой вкладки, MEMORY_NO_TAB - свободных номеров нет
+    unsigned open_tab();
+    void close_tab(unsigned tab);
+
+    // Все счетчики: итог, по подсистемам и по открытым вкладкам
+    std::string to_json();
+
+    // Файл отчета из HEAVENLY_MEMORY_REPORT, пустая строка - не задан
+    std::string report_path();
+    bool write_json(const std::string& path);
+}
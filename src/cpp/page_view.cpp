@@ -0,0 +1,640 @@
+#include "page_view.h"
+#include "logger.h"
+#include "tracing.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    constexpr uint32_t PAGE_BACKGROUND = 0xffffff;
+    constexpr uint32_t PLACEHOLDER_FILL = 0xf1f3f5;
+    constexpr uint32_t PLACEHOLDER_BORDER = 0xdee2e6;
+    constexpr uint32_t PLACEHOLDER_TEXT = 0x6c757d;
+
+    void set_color(cairo_t* cr, uint32_t color) {
+        cairo_set_source_rgb(cr,
+                             ((color >> 16) & 0xff) / 255.0,
+                             ((color >> 8) & 0xff) / 255.0,
+                             (color & 0xff) / 255.0);
+    }
+
+    // Абсолютный адрес картинки: под ним она загружается, в том числе
+    // сканером упреждающей загрузки, и лежит в кэше
+    std::string image_url(const std::string& base_url, std::string_view src) {
+        std::string url = resolve_url(base_url, src);
+        return url.empty() ? std::string(src) : url;
+    }
+}
+
+PageMetrics::PageMetrics(GtkWidget* widget, ImageLoader& images, const std::string& base_url)
+    : widget(widget)
+    , images(images)
+    , base_url(base_url)
+    , measure_layout(gtk_widget_create_pango_layout(widget, nullptr))
+{
+}
+
+PageMetrics::~PageMetrics() {
+    g_object_unref(measure_layout);
+}
+
+PangoFontDescription* PageMetrics::font_description(const TextStyle& style) {
+    PangoFontDescription* desc = pango_font_description_new();
+    pango_font_description_set_family(desc, style.monospace ? "Monospace" : "Sans");
+    pango_font_description_set_absolute_size(desc, style.size * PANGO_SCALE);
+    pango_font_description_set_weight(desc, style.bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+    pango_font_description_set_style(desc, style.italic ? PANGO_STYLE_ITALIC : PANGO_STYLE_NORMAL);
+    return desc;
+}
+
+FontMetrics PageMetrics::font_metrics(const TextStyle& style) {
+    PangoFontDescription* desc = font_description(style);
+    PangoFontMetrics* pango_metrics = pango_context_get_metrics(gtk_widget_get_pango_context(widget), desc, nullptr);
+
+    FontMetrics result;
+    result.ascent = static_cast<float>(pango_font_metrics_get_ascent(pango_metrics)) / PANGO_SCALE;
+    result.descent = static_cast<float>(pango_font_metrics_get_descent(pango_metrics)) / PANGO_SCALE;
+
+    pango_font_metrics_unref(pango_metrics);
+    pango_font_description_free(desc);
+    return result;
+}
+
+float PageMetrics::advance(const TextStyle& style, uint32_t codepoint) {
+    char utf8[8];
+    gint len = g_unichar_to_utf8(codepoint, utf8);
+
+    PangoFontDescription* desc = font_description(style);
+    pango_layout_set_font_description(measure_layout, desc);
+    pango_font_description_free(desc);
+    pango_layout_set_text(measure_layout, utf8, len);
+
+    PangoRectangle logical;
+    pango_layout_get_extents(measure_layout, nullptr, &logical);
+    return static_cast<float>(logical.width) / PANGO_SCALE;
+}
+
+bool PageMetrics::image_size(std::string_view src, float& width, float& height) {
+    int pixel_width = 0;
+    int pixel_height = 0;
+    if (!images.cached_size(image_url(base_url, src), pixel_width, pixel_height)) {
+        return false;
+    }
+    width = static_cast<float>(pixel_width);
+    height = static_cast<float>(pixel_height);
+    return true;
+}
+
+GtkWidget* PageView::create(std::shared_ptr<const HtmlDocument> document, const std::string& base_url,
+                            ImageLoader& images, LinkHandler link_handler) {
+    PageView* view = new PageView(std::move(document), base_url, images, std::move(link_handler));
+    return view->layout_widget;
+}
+
+PageView::PageView(std::shared_ptr<const HtmlDocument> document, const std::string& base_url, ImageLoader& images,
+                   LinkHandler link_handler)
+    : layout_widget(gtk_layout_new(nullptr, nullptr))
+    , document(std::move(document))
+    , memory_tab(MEMORY_NO_TAB)
+    , images(images)
+    , link_handler(std::move(link_handler))
+    , base_url(base_url)
+    , metrics(layout_widget, images, this->base_url)
+    , engine(metrics)
+    , display_list(&arena)
+    , layout_width(0)
+    , text_layout(gtk_widget_create_pango_layout(layout_widget, nullptr))
+    , control_states(&arena)
+    , control_generation(0)
+    , vadjustment(nullptr)
+    , updating_viewport(false)
+    , relayout_source(0)
+    , hovered_link(HTML_NO_NODE)
+{
+    // Страница создается под метками своей вкладки
+    memory_get_thread_tags(nullptr, &memory_tab);
+
+    gtk_widget_set_name(layout_widget, "page-view");
+    gtk_widget_add_events(layout_widget, GDK_BUTTON_PRESS_MASK | GDK_POINTER_MOTION_MASK);
+
+    g_signal_connect(layout_widget, "destroy", G_CALLBACK(on_destroy), this);
+    g_signal_connect_after(layout_widget, "size-allocate", G_CALLBACK(on_size_allocate), this);
+    g_signal_connect(layout_widget, "draw", G_CALLBACK(on_draw), this);
+    g_signal_connect(layout_widget, "button-press-event", G_CALLBACK(on_button_press), this);
+    g_signal_connect(layout_widget, "motion-notify-event", G_CALLBACK(on_motion), this);
+    // Прокрутку отдает GtkScrolledWindow, в который виджет добавят позже
+    g_signal_connect(layout_widget, "notify::vadjustment", G_CALLBACK(on_vadjustment_changed), this);
+}
+
+PageView::~PageView() {
+    if (relayout_source) {
+        g_source_remove(relayout_source);
+    }
+    if (vadjustment) {
+        g_signal_handlers_disconnect_by_data(vadjustment, this);
+        g_object_unref(vadjustment);
+    }
+    for (PangoFontDescription* font : fonts) {
+        pango_font_description_free(font);
+    }
+    g_object_unref(text_layout);
+}
+
+void PageView::on_destroy(GtkWidget*, gpointer user_data) {
+    delete static_cast<PageView*>(user_data);
+}
+
+void PageView::on_size_allocate(GtkWidget*, GdkRectangle* allocation, gpointer user_data) {
+    PageView* view = static_cast<PageView*>(user_data);
+    // Прокрутка и изменение высоты не требуют новой раскладки
+    if (allocation->width != view->layout_width) {
+        view->relayout(allocation->width);
+    }
+}
+
+gboolean PageView::on_relayout_idle(gpointer user_data) {
+    PageView* view = static_cast<PageView*>(user_data);
+    view->relayout_source = 0;
+    view->relayout(view->layout_width);
+    return G_SOURCE_REMOVE;
+}
+
+void PageView::on_vadjustment_changed(GObject*, GParamSpec*, gpointer user_data) {
+    PageView* view = static_cast<PageView*>(user_data);
+    if (view->vadjustment) {
+        g_signal_handlers_disconnect_by_data(view->vadjustment, view);
+        g_object_unref(view->vadjustment);
+    }
+
+    view->vadjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(view->layout_widget));
+    if (view->vadjustment) {
+        g_object_ref(view->vadjustment);
+        g_signal_connect(view->vadjustment, "value-changed", G_CALLBACK(on_scroll), view);
+    }
+}
+
+void PageView::on_scroll(GtkAdjustment*, gpointer user_data) {
+    static_cast<PageView*>(user_data)->update_viewport();
+}
+
+void PageView::schedule_relayout() {
+    // Изображения приходят пачками - раскладываем один раз на пачку
+    if (!relayout_source && layout_width > 0) {
+        relayout_source = g_idle_add(on_relayout_idle, this);
+    }
+}
+
+void PageView::relayout(int width) {
+    if (!document || width <= 1) {
+        return;
+    }
+    MemoryScope scope(MEMORY_RENDERER, memory_tab);
+    TraceSpan span("layout", "layout");
+
+    gint64 start = g_get_monotonic_time();
+    engine.begin(*document, static_cast<float>(width), display_list);
+    layout_width = width;
+    update_viewport();
+
+    ArenaStats memory = arena.stats();
+    LOG_DEBUG("layout") << "Раскладка видимой части: " << display_list.items.size() << " элементов за "
+              << (g_get_monotonic_time() - start) / 1000.0 << " мс, арена страницы "
+              << memory.bytes_reserved / 1024 << " КБ";
+}
+
+void PageView::update_viewport() {
+    // Изменение размера области может прокрутить ее и вызвать нас повторно
+    if (updating_viewport || layout_width <= 0) {
+        return;
+    }
+    MemoryScope scope(MEMORY_RENDERER, memory_tab);
+    updating_viewport = true;
+
+    double top = vadjustment ? gtk_adjustment_get_value(vadjustment) : 0.0;
+    double page = vadjustment ? gtk_adjustment_get_page_size(vadjustment) : 0.0;
+    double bottom = top + page + OVERSCAN;
+
+    size_t items_before = display_list.items.size();
+    if (!engine.finished() && bottom > display_list.height) {
+        engine.layout_until(static_cast<float>(bottom));
+
+        // Шрифты для стилей, появившихся в этой части раскладки
+        for (size_t i = fonts.size(); i < display_list.styles.size(); i++) {
+            fonts.push_back(PageMetrics::font_description(display_list.styles[i]));
+        }
+    }
+
+    // Пока документ не разложен, высота прокрутки - оценка
+    guint height = static_cast<guint>(std::ceil(engine.estimated_height()));
+    guint current_width = 0;
+    guint current_height = 0;
+    gtk_layout_get_size(GTK_LAYOUT(layout_widget), &current_width, &current_height);
+    if (current_width != static_cast<guint>(layout_width) || current_height != height) {
+        gtk_layout_set_size(GTK_LAYOUT(layout_widget), layout_width, height);
+    }
+
+    update_controls(top - OVERSCAN, bottom);
+    prioritize_images(top, top + page);
+    if (display_list.items.size() != items_before || items_before == 0) {
+        gtk_widget_queue_draw(layout_widget);
+    }
+
+    updating_viewport = false;
+}
+
+void PageView::prioritize_images(double top, double bottom) {
+    std::vector<std::string> visible;
+    auto range = display_list.visible_range(static_cast<float>(top - OVERSCAN),
+                                            static_cast<float>(bottom + OVERSCAN));
+    for (size_t i = range.first; i < range.second; i++) {
+        const DisplayItem& item = display_list.items[i];
+        if (item.kind != DisplayItemKind::Image || item.text_len == 0) {
+            continue;
+        }
+        std::string src = image_url(base_url, display_list.text(item));
+        bool on_screen = item.rect.bottom() > top && item.rect.y < bottom;
+        images.prefetch(src, layout_widget, [this]() { schedule_relayout(); },
+                        on_screen ? FETCH_PRIORITY_VISIBLE_IMAGE : FETCH_PRIORITY_OFFSCREEN_IMAGE);
+        if (on_screen) {
+            visible.push_back(std::move(src));
+        }
+    }
+
+    // Ушедшие с экрана и еще не загруженные уступают место видимым
+    for (const std::string& src : visible_images) {
+        if (std::find(visible.begin(), visible.end(), src) == visible.end()) {
+            images.set_priority(src, FETCH_PRIORITY_OFFSCREEN_IMAGE);
+        }
+    }
+    visible_images = std::move(visible);
+}
+
+void PageView::update_controls(double top, double bottom) {
+    unsigned generation = ++control_generation;
+    auto range = display_list.visible_range(static_cast<float>(top), static_cast<float>(bottom));
+
+    for (size_t i = range.first; i < range.second; i++) {
+        const DisplayItem& item = display_list.items[i];
+        if (item.kind != DisplayItemKind::Control || item.rect.bottom() < top) {
+            continue;
+        }
+
+        int x = static_cast<int>(item.rect.x);
+        int y = static_cast<int>(item.rect.y);
+        auto it = controls.find(item.node);
+        if (it == controls.end()) {
+            ControlKind kind = control_kind(document->node(item.node));
+            std::vector<GtkWidget*>& pool = control_pool[static_cast<size_t>(kind)];
+            GtkWidget* control = nullptr;
+            if (!pool.empty()) {
+                control = pool.back();
+                pool.pop_back();
+                gtk_layout_move(GTK_LAYOUT(layout_widget), control, x, y);
+            } else {
+                control = create_control(kind);
+                gtk_layout_put(GTK_LAYOUT(layout_widget), control, x, y);
+            }
+            bind_control(control, kind, item.node);
+            gtk_widget_show_all(control);
+            it = controls.emplace(item.node, BoundControl{control, kind, generation}).first;
+        } else {
+            gtk_layout_move(GTK_LAYOUT(layout_widget), it->second.widget, x, y);
+            it->second.generation = generation;
+        }
+        gtk_widget_set_size_request(it->second.widget, static_cast<int>(item.rect.width),
+                                    static_cast<int>(item.rect.height));
+    }
+
+    // Элементы, ушедшие из полосы, возвращаются в пул
+    for (auto it = controls.begin(); it != controls.end();) {
+        if (it->second.generation != generation) {
+            release_control(it->first, it->second);
+            it = controls.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+PageView::ControlKind PageView::control_kind(const HtmlNodeView& node) {
+    switch (node.tag()) {
+    case TagAtom::Textarea:
+        return ControlKind::TextArea;
+    case TagAtom::Select:
+        return ControlKind::Select;
+    case TagAtom::Input:
+        break;
+    default:
+        return ControlKind::Button;
+    }
+
+    std::string_view type = node.attribute("type");
+    if (type == "button" || type == "submit" || type == "reset") {
+        return ControlKind::Button;
+    }
+    if (type == "checkbox") {
+        return ControlKind::Check;
+    }
+    if (type == "radio") {
+        return ControlKind::Radio;
+    }
+    if (type == "password") {
+        return ControlKind::Password;
+    }
+    return ControlKind::Entry;
+}
+
+GtkWidget* PageView::create_control(ControlKind kind) {
+    GtkWidget* widget = nullptr;
+
+    switch (kind) {
+    case ControlKind::Entry:
+    case ControlKind::Password:
+        widget = gtk_entry_new();
+        gtk_entry_set_visibility(GTK_ENTRY(widget), kind != ControlKind::Password);
+        gtk_widget_set_name(widget, "input");
+        break;
+    case ControlKind::Check:
+        widget = gtk_check_button_new();
+        gtk_widget_set_name(widget, "input");
+        break;
+    case ControlKind::Radio:
+        widget = gtk_radio_button_new(nullptr);
+        gtk_widget_set_name(widget, "input");
+        break;
+    case ControlKind::TextArea: {
+        GtkWidget* text_view = gtk_text_view_new();
+        gtk_text_view_set_wrap_mode(GTK_TEXT_VIEW(text_view), GTK_WRAP_WORD_CHAR);
+        widget = gtk_frame_new(nullptr);
+        gtk_container_add(GTK_CONTAINER(widget), text_view);
+        gtk_widget_set_name(widget, "input");
+        break;
+    }
+    case ControlKind::Select:
+        widget = gtk_combo_box_text_new();
+        gtk_widget_set_name(widget, "input");
+        break;
+    case ControlKind::Button:
+    case ControlKind::Count:
+        widget = gtk_button_new();
+        gtk_widget_set_name(widget, "button");
+        break;
+    }
+
+    return widget;
+}
+
+void PageView::bind_control(GtkWidget* widget, ControlKind kind, uint32_t index) {
+    HtmlNodeView node = document->node(index);
+    auto saved = control_states.find(index);
+    const ControlState* state = saved != control_states.end() ? &saved->second : nullptr;
+
+    switch (kind) {
+    case ControlKind::Entry:
+    case ControlKind::Password: {
+        std::string placeholder(node.attribute("placeholder"));
+        std::string value = state ? state->text : std::string(node.attribute("value"));
+        gtk_entry_set_placeholder_text(GTK_ENTRY(widget), placeholder.c_str());
+        gtk_entry_set_text(GTK_ENTRY(widget), value.c_str());
+        break;
+    }
+    case ControlKind::Check:
+    case ControlKind::Radio:
+        gtk_toggle_button_set_active(GTK_TOGGLE_BUTTON(widget),
+                                     state ? state->checked : node.has_attribute("checked"));
+        break;
+    case ControlKind::TextArea: {
+        GtkWidget* text_view = gtk_bin_get_child(GTK_BIN(widget));
+        std::string text = state ? state->text : std::string(node.text_content());
+        gtk_text_buffer_set_text(gtk_text_view_get_buffer(GTK_TEXT_VIEW(text_view)), text.c_str(), -1);
+        break;
+    }
+    case ControlKind::Select: {
+        gtk_combo_box_text_remove_all(GTK_COMBO_BOX_TEXT(widget));
+        for (uint32_t child = node.first_child(); child != HTML_NO_NODE;
+             child = document->node(child).next_sibling()) {
+            HtmlNodeView option = document->node(child);
+            if (option.tag() == TagAtom::Option) {
+                std::string text(option.label_text());
+                gtk_combo_box_text_append_text(GTK_COMBO_BOX_TEXT(widget), text.c_str());
+            }
+        }
+        gtk_combo_box_set_active(GTK_COMBO_BOX(widget), state ? state->active : 0);
+        break;
+    }
+    case ControlKind::Button:
+    case ControlKind::Count: {
+        std::string label(node.tag() == TagAtom::Button ? node.label_text() : node.attribute("value"));
+        gtk_button_set_label(GTK_BUTTON(widget), label.empty() ? "Button" : label.c_str());
+        break;
+    }
+    }
+}
+
+void PageView::release_control(uint32_t index, const BoundControl& control) {
+    GtkWidget* widget = control.widget;
+
+    // Введенное пользователем переживает прокрутку
+    switch (control.kind) {
+    case ControlKind::Entry:
+    case ControlKind::Password:
+        control_states[index].text = gtk_entry_get_text(GTK_ENTRY(widget));
+        break;
+    case ControlKind::Check:
+    case ControlKind::Radio:
+        control_states[index].checked = gtk_toggle_button_get_active(GTK_TOGGLE_BUTTON(widget));
+        break;
+    case ControlKind::TextArea: {
+        GtkTextBuffer* buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(gtk_bin_get_child(GTK_BIN(widget))));
+        GtkTextIter start;
+        GtkTextIter end;
+        gtk_text_buffer_get_bounds(buffer, &start, &end);
+        gchar* text = gtk_text_buffer_get_text(buffer, &start, &end, FALSE);
+        control_states[index].text = text;
+        g_free(text);
+        break;
+    }
+    case ControlKind::Select:
+        control_states[index].active = gtk_combo_box_get_active(GTK_COMBO_BOX(widget));
+        break;
+    case ControlKind::Button:
+    case ControlKind::Count:
+        break;
+    }
+
+    std::vector<GtkWidget*>& pool = control_pool[static_cast<size_t>(control.kind)];
+    if (pool.size() < MAX_POOLED_CONTROLS) {
+        gtk_widget_hide(widget);
+        pool.push_back(widget);
+    } else {
+        gtk_widget_destroy(widget);
+    }
+}
+
+gboolean PageView::on_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data) {
+    PageView* view = static_cast<PageView*>(user_data);
+    MemoryScope scope(MEMORY_RENDERER, view->memory_tab);
+    TraceSpan span("renderer", "paint");
+    GdkWindow* bin_window = gtk_layout_get_bin_window(GTK_LAYOUT(widget));
+
+    // Рисуем в координатах документа: bin_window уже сдвинут прокруткой
+    if (gtk_cairo_should_draw_window(cr, bin_window)) {
+        cairo_save(cr);
+        gtk_cairo_transform_to_window(cr, widget, bin_window);
+        GdkRectangle clip;
+        if (gdk_cairo_get_clip_rectangle(cr, &clip)) {
+            view->paint(cr, clip);
+        }
+        cairo_restore(cr);
+    }
+
+    // Дочерние элементы форм рисует обработчик GtkLayout по умолчанию
+    return FALSE;
+}
+
+void PageView::paint(cairo_t* cr, const GdkRectangle& clip) {
+    set_color(cr, PAGE_BACKGROUND);
+    cairo_rectangle(cr, clip.x, clip.y, clip.width, clip.height);
+    cairo_fill(cr);
+
+    float top = static_cast<float>(clip.y);
+    auto range = display_list.visible_range(top, top + clip.height);
+
+    for (size_t i = range.first; i < range.second; i++) {
+        const DisplayItem& item = display_list.items[i];
+        if (item.rect.bottom() < top) {
+            continue;
+        }
+
+        switch (item.kind) {
+        case DisplayItemKind::Text:
+            paint_text(cr, item);
+            break;
+        case DisplayItemKind::Rect:
+            set_color(cr, item.color);
+            cairo_rectangle(cr, item.rect.x, item.rect.y, item.rect.width, item.rect.height);
+            cairo_fill(cr);
+            break;
+        case DisplayItemKind::Image:
+            paint_image(cr, item);
+            break;
+        case DisplayItemKind::Control:
+            break;
+        }
+    }
+}
+
+void PageView::paint_text(cairo_t* cr, const DisplayItem& item) {
+    const TextStyle& style = display_list.styles[item.style];
+    std::string_view text = display_list.text(item);
+
+    pango_layout_set_font_description(text_layout, fonts[item.style]);
+    pango_layout_set_text(text_layout, text.data(), static_cast<int>(text.size()));
+
+    if (style.underline) {
+        PangoAttrList* attrs = pango_attr_list_new();
+        pango_attr_list_insert(attrs, pango_attr_underline_new(PANGO_UNDERLINE_SINGLE));
+        pango_layout_set_attributes(text_layout, attrs);
+        pango_attr_list_unref(attrs);
+    } else {
+        pango_layout_set_attributes(text_layout, nullptr);
+    }
+
+    // Базовая линия Pango совпадает с рассчитанной раскладкой
+    double baseline = static_cast<double>(pango_layout_get_baseline(text_layout)) / PANGO_SCALE;
+    set_color(cr, item.color);
+    cairo_move_to(cr, item.rect.x, item.rect.y + item.baseline - baseline);
+    pango_cairo_show_layout(cr, text_layout);
+}
+
+void PageView::paint_image(cairo_t* cr, const DisplayItem& item) {
+    const LayoutRect& rect = item.rect;
+    std::string src = image_url(base_url, display_list.text(item));
+
+    GdkPixbuf* pixbuf = nullptr;
+    if (!src.empty()) {
+        // После загрузки размер может измениться - раскладываем заново
+        pixbuf = images.request(src, layout_widget, [this]() { schedule_relayout(); });
+    }
+
+    if (pixbuf) {
+        int width = gdk_pixbuf_get_width(pixbuf);
+        int height = gdk_pixbuf_get_height(pixbuf);
+        cairo_save(cr);
+        cairo_translate(cr, rect.x, rect.y);
+        cairo_scale(cr, rect.width / width, rect.height / height);
+        gdk_cairo_set_source_pixbuf(cr, pixbuf, 0, 0);
+        cairo_paint(cr);
+        cairo_restore(cr);
+        return;
+    }
+
+    // Заглушка с alt текстом, пока изображение грузится или если загрузить не удалось
+    set_color(cr, PLACEHOLDER_FILL);
+    cairo_rectangle(cr, rect.x, rect.y, rect.width, rect.height);
+    cairo_fill_preserve(cr);
+    set_color(cr, PLACEHOLDER_BORDER);
+    cairo_set_line_width(cr, 1.0);
+    cairo_stroke(cr);
+
+    std::string_view alt = document->node(item.node).attribute("alt");
+    if (!alt.empty() && !fonts.empty()) {
+        cairo_save(cr);
+        cairo_rectangle(cr, rect.x, rect.y, rect.width, rect.height);
+        cairo_clip(cr);
+        pango_layout_set_font_description(text_layout, fonts[item.style]);
+        pango_layout_set_attributes(text_layout, nullptr);
+        pango_layout_set_text(text_layout, alt.data(), static_cast<int>(alt.size()));
+        set_color(cr, PLACEHOLDER_TEXT);
+        cairo_move_to(cr, rect.x + 4, rect.y + 4);
+        pango_cairo_show_layout(cr, text_layout);
+        cairo_restore(cr);
+    }
+}
+
+uint32_t PageView::link_at(double x, double y) const {
+    const DisplayItem* item = display_list.hit_test(static_cast<float>(x), static_cast<float>(y));
+    return item ? item->link : HTML_NO_NODE;
+}
+
+gboolean PageView::on_button_press(GtkWidget*, GdkEventButton* event, gpointer user_data) {
+    PageView* view = static_cast<PageView*>(user_data);
+    if (event->type != GDK_BUTTON_PRESS || event->button != 1) {
+        return FALSE;
+    }
+
+    uint32_t link = view->link_at(event->x, event->y);
+    if (link == HTML_NO_NODE || !view->link_handler) {
+        return FALSE;
+    }
+
+    // Переход может уничтожить этот виджет вместе с view - работаем с копиями
+    std::string href(view->document->node(link).attribute("href"));
+    LinkHandler handler = view->link_handler;
+    if (!href.empty()) {
+        handler(href);
+    }
+    return TRUE;
+}
+
+gboolean PageView::on_motion(GtkWidget* widget, GdkEventMotion* event, gpointer user_data) {
+    PageView* view = static_cast<PageView*>(user_data);
+    uint32_t link = view->link_at(event->x, event->y);
+    if (link == view->hovered_link) {
+        return FALSE;
+    }
+    view->hovered_link = link;
+
+    GdkWindow* bin_window = gtk_layout_get_bin_window(GTK_LAYOUT(widget));
+    if (link != HTML_NO_NODE) {
+        GdkCursor* cursor = gdk_cursor_new_from_name(gtk_widget_get_display(widget), "pointer");
+        gdk_window_set_cursor(bin_window, cursor);
+        g_object_unref(cursor);
+
+        std::string href(view->document->node(link).attribute("href"));
+        gtk_widget_set_tooltip_text(widget, href.c_str());
+    } else {
+        gdk_window_set_cursor(bin_window, nullptr);
+        gtk_widget_set_tooltip_text(widget, nullptr);
+    }
+    return FALSE;
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <memory_resource>
+#include <unordered_map>
+#include <gtk/gtk.h>
+#include "html_document.h"
+#include "arena_resource.h"
+#include "image_loader.h"
+#include "layout_engine.h"
+#include "memory_accounting.h"
+
+// Размеры шрифтов через Pango того же виджета, которым идет отрисовка
+class PageMetrics : public LayoutMetrics {
+public:
+    // base_url - адрес страницы: относительные src картинок от него
+    PageMetrics(GtkWidget* widget, ImageLoader& images, const std::string& base_url);
+    ~PageMetrics() override;
+
+    PageMetrics(const PageMetrics&) = delete;
+    PageMetrics& operator=(const PageMetrics&) = delete;
+
+    FontMetrics font_metrics(const TextStyle& style) override;
+    float advance(const TextStyle& style, uint32_t codepoint) override;
+    bool image_size(std::string_view src, float& width, float& height) override;
+
+    // Описание шрифта для стиля; принадлежит вызывающему
+    static PangoFontDescription* font_description(const TextStyle& style);
+
+private:
+    GtkWidget* widget;
+    ImageLoader& images;
+    const std::string& base_url;
+    PangoLayout* measure_layout;
+};
+
+// Виджет страницы: один GtkLayout рисует сохраненный список отображения
+// через Cairo/Pango, нативные виджеты создаются только для элементов форм.
+//
+// Страница виртуализирована: документ раскладывается только до низа
+// видимой области с запасом (OVERSCAN) и дальше по мере прокрутки, а
+// элементы форм существуют только в видимой полосе - ушедшие за ее
+// пределы прячутся в пул и переиспользуются, введенные значения
+// сохраняются по узлу. Объект живет, пока жив его виджет.
+//
+// Данные страницы (список отображения, состояние форм) лежат в арене
+// страницы и освобождаются одним вызовом вместе с ней при переходе.
+class PageView {
+public:
+    using LinkHandler = std::function<void(const std::string& href)>;
+
+    // Создает виджет страницы; удаляется вместе с виджетом. base_url -
+    // адрес страницы, картинки загружаются по абсолютным адресам
+    static GtkWidget* create(std::shared_ptr<const HtmlDocument> document, const std::string& base_url,
+                             ImageLoader& images, LinkHandler link_handler);
+
+    PageView(const PageView&) = delete;
+    PageView& operator=(const PageView&) = delete;
+
+    // Запас над и под видимой областью, пикселей
+    static constexpr double OVERSCAN = 400.0;
+    // Сколько спрятанных элементов форм каждого вида держать для переиспользования
+    static constexpr size_t MAX_POOLED_CONTROLS = 16;
+
+private:
+    enum class ControlKind { Entry, Password, Button, Check, Radio, TextArea, Select, Count };
+
+    struct BoundControl {
+        GtkWidget* widget;
+        ControlKind kind;
+        // Поколение последнего обновления, в котором элемент был виден
+        unsigned generation;
+    };
+
+    // Значения элементов форм, ушедших из видимой полосы
+    struct ControlState {
+        std::string text;
+        gint active = -1;
+        bool checked = false;
+    };
+
+    PageView(std::shared_ptr<const HtmlDocument> document, const std::string& base_url, ImageLoader& images,
+             LinkHandler link_handler);
+    ~PageView();
+
+    static void on_destroy(GtkWidget* widget, gpointer user_data);
+    static void on_size_allocate(GtkWidget* widget, GdkRectangle* allocation, gpointer user_data);
+    static gboolean on_draw(GtkWidget* widget, cairo_t* cr, gpointer user_data);
+    static gboolean on_button_press(GtkWidget* widget, GdkEventButton* event, gpointer user_data);
+    static gboolean on_motion(GtkWidget* widget, GdkEventMotion* event, gpointer user_data);
+    static gboolean on_relayout_idle(gpointer user_data);
+    static void on_vadjustment_changed(GObject* object, GParamSpec* pspec, gpointer user_data);
+    static void on_scroll(GtkAdjustment* adjustment, gpointer user_data);
+
+    void relayout(int width);
+    void schedule_relayout();
+    // Доводит раскладку до низа видимой области с запасом и обновляет элементы форм
+    void update_viewport();
+    void update_controls(double top, double bottom);
+    // Картинки на экране загружаются раньше картинок в запасе вокруг него
+    void prioritize_images(double top, double bottom);
+
+    static ControlKind control_kind(const HtmlNodeView& node);
+    static GtkWidget* create_control(ControlKind kind);
+    void bind_control(GtkWidget* widget, ControlKind kind, uint32_t node);
+    void release_control(uint32_t node, const BoundControl& control);
+
+    void paint(cairo_t* cr, const GdkRectangle& clip);
+    void paint_text(cairo_t* cr, const DisplayItem& item);
+    void paint_image(cairo_t* cr, const DisplayItem& item);
+
+    // Ссылка под точкой документа или HTML_NO_NODE
+    uint32_t link_at(double x, double y) const;
+
+    GtkWidget* layout_widget;
+    std::shared_ptr<const HtmlDocument> document;
+    // Вкладка в учете памяти; раскладка и отрисовка считаются за ней
+    unsigned memory_tab;
+    ImageLoader& images;
+    LinkHandler link_handler;
+    // Объявлен до metrics, которые ссылаются на него
+    std::string base_url;
+
+    // Объявлена до всего, что из нее выделяет
+    ArenaResource arena;
+
+    PageMetrics metrics;
+    LayoutEngine engine;
+    DisplayList display_list;
+    int layout_width;
+
+    // Отрисовка текста: один PangoLayout и шрифты по индексу стиля
+    PangoLayout* text_layout;
+    std::vector<PangoFontDescription*> fonts;
+
+    // Элементы форм в видимой полосе по узлу документа
+    std::unordered_map<uint32_t, BoundControl> controls;
+    std::pmr::unordered_map<uint32_t, ControlState> control_states;
+    std::vector<GtkWidget*> control_pool[static_cast<size_t>(ControlKind::Count)];
+    unsigned control_generation;
+
+    // src картинок, бывших на экране при прошлом обновлении
+    std::vector<std::string> visible_images;
+
+    GtkAdjustment* vadjustment;
+    bool updating_viewport;
+    guint relayout_source;
+    // Ссылка под курсором: курсор и подсказка меняются только при смене ссылки
+    uint32_t hovered_link;
+};
@@ -2,29 +2,12 @@
 
 #include <string>
 #include <vector>
-#include <map>
+#include <memory>
+#include <functional>
 #include <gtk/gtk.h>
-
-// FFI интерфейсы для Rust
-extern "C" {
-    struct HtmlParser;
-    size_t html_get_element_count(HtmlParser* parser);
-    char* html_get_element_tag_name(HtmlParser* parser, size_t index);
-    char* html_get_element_text(HtmlParser* parser, size_t index);
-    char* html_get_element_attribute(HtmlParser* parser, size_t element_index, const char* attr_name);
-    size_t html_get_element_attribute_count(HtmlParser* parser, size_t element_index);
-    char* html_get_element_attribute_name(HtmlParser* parser, size_t element_index, size_t attr_index);
-    
-    // Сетевые функции
-    char* network_fetch_image(const char* url);
-    void string_free(char* ptr);
-}
-
-struct RustHtmlElement {
-    std::string tag_name;
-    std::map<std::string, std::string> attributes;
-    std::string text_content;
-};
+#include "html_document.h"
+#include "image_loader.h"
+#include "page_view.h"
 
 class RustHtmlRenderer {
 public:
@@ -34,21 +17,30 @@ public:
     // Парсит HTML через Rust и создает элементы
     bool parse_from_rust(HtmlParser* rust_parser);
     
-    // Рендерит HTML в GTK виджет
+    // Готовит к рендерингу уже полученный снимок DOM (в том числе из кэша)
+    bool load_document(std::shared_ptr<const HtmlDocument> doc);
+    
+    // Документ, загруженный последним
+    const std::shared_ptr<const HtmlDocument>& current_document() const { return document; }
+    
+    // Рендерит HTML в GTK виджет: раскладка и отрисовка списком отображения
     GtkWidget* render_to_widget();
     
+    // Вызывается при щелчке по ссылке с сырым значением href
+    void set_link_handler(PageView::LinkHandler handler) { link_handler = std::move(handler); }
+    
+    // Загрузки картинок отменены вместе с загрузками вкладки
+    void cancel_image_loads() { image_loader.cancel_pending(); }
+    
     // Очищает все данные
     void clear();
     
 private:
-    std::vector<RustHtmlElement> elements;
-    
-    // Создает GTK виджет для элемента
-    GtkWidget* create_element_widget(const RustHtmlElement& element);
+    // Снимок DOM от Rust; раскладка читает его напрямую
+    std::shared_ptr<const HtmlDocument> document;
     
-    // Применяет CSS стили
-    void apply_styles(GtkWidget* widget, const std::string& tag_name);
+    // Изображения грузятся в фоне; кэш переживает смену страниц
+    ImageLoader image_loader;
     
-    // Загружает изображение по URL
-    GtkWidget* load_image(const std::string& src, const std::string& alt_text);
+    PageView::LinkHandler link_handler;
 };
@@ -3,10 +3,14 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include <gtk/gtk.h>
 
+#include "tag_atoms.h"
+
 struct SimpleHtmlElement {
     std::string tag_name;
+    TagAtom tag = TagAtom::Unknown;
     std::map<std::string, std::string> attributes;
     std::string text_content;
     std::vector<SimpleHtmlElement> children;
@@ -17,25 +21,34 @@ public:
     SimpleHtmlRenderer();
     ~SimpleHtmlRenderer();
     
-    // Парсит HTML напрямую (без JSON)
+    // Парсит HTML напрямую (без JSON и без FFI) SIMD-токенизатором
     bool parse_html(const std::string& html);
     
-    // Рендерит HTML в GTK виджет
+    // Рендерит HTML в GTK виджет: виртуальный список, в котором виджеты
+    // создаются только для видимых элементов
     GtkWidget* render_to_widget();
     
     // Очищает все данные
     void clear();
     
 private:
-    std::vector<SimpleHtmlElement> elements;
+    // Вид строки списка: строки одного вида переиспользуют виджет
+    enum class RowKind { Container, Label, Link, Image, Entry, Button, Check, Radio };
+    class RowAdapter;
+    
+    // Разделяется с уже отрисованным списком, поэтому parse_html
+    // не трогает строки, которые еще показываются
+    std::shared_ptr<std::vector<SimpleHtmlElement>> elements;
     
     // Простой HTML парсер
     void parse_html_recursive(const std::string& html, size_t& pos, SimpleHtmlElement& element);
-    void parse_attributes(const std::string& attr_string, std::map<std::string, std::string>& attributes);
     
-    // Создает GTK виджет для элемента
-    GtkWidget* create_element_widget(const SimpleHtmlElement& element);
+    // Виджет для элемента: вид выбирается по тегу, содержимое
+    // заполняется отдельно, чтобы виджет можно было переиспользовать
+    static RowKind row_kind(const SimpleHtmlElement& element);
+    static GtkWidget* create_row_widget(RowKind kind);
+    static void bind_element_widget(GtkWidget* widget, const SimpleHtmlElement& element);
     
     // Применяет базовые стили
-    void apply_basic_styles(GtkWidget* widget, const std::string& tag_name);
+    static void apply_basic_styles(GtkWidget* widget, TagAtom tag);
 };
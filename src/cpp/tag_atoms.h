@@ -0,0 +1,263 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+
+// Атомы имен тегов: известный тег - маленькое число вместо строки.
+// Номера совпадают с src/rust/src/tag_atoms.rs (порядок списка один и тот же),
+// Rust кладет атом в каждый узел снимка, поэтому отрисовка выбирает ветку
+// по switch, а не по цепочке сравнений строк. Для строк, пришедших не из
+// снимка, tag_atom() находит атом идеальным хешем, посчитанным при компиляции.
+#define HEAVENLY_TAG_ATOMS(X) \
+    X(A, "a") \
+    X(Abbr, "abbr") \
+    X(Address, "address") \
+    X(Area, "area") \
+    X(Article, "article") \
+    X(Aside, "aside") \
+    X(Audio, "audio") \
+    X(B, "b") \
+    X(Base, "base") \
+    X(Bdi, "bdi") \
+    X(Bdo, "bdo") \
+    X(Big, "big") \
+    X(Blockquote, "blockquote") \
+    X(Body, "body") \
+    X(Br, "br") \
+    X(Button, "button") \
+    X(Canvas, "canvas") \
+    X(Caption, "caption") \
+    X(Center, "center") \
+    X(Cite, "cite") \
+    X(Code, "code") \
+    X(Col, "col") \
+    X(Colgroup, "colgroup") \
+    X(Data, "data") \
+    X(Datalist, "datalist") \
+    X(Dd, "dd") \
+    X(Del, "del") \
+    X(Details, "details") \
+    X(Dfn, "dfn") \
+    X(Dialog, "dialog") \
+    X(Div, "div") \
+    X(Dl, "dl") \
+    X(Dt, "dt") \
+    X(Em, "em") \
+    X(Embed, "embed") \
+    X(Fieldset, "fieldset") \
+    X(Figcaption, "figcaption") \
+    X(Figure, "figure") \
+    X(Font, "font") \
+    X(Footer, "footer") \
+    X(Form, "form") \
+    X(H1, "h1") \
+    X(H2, "h2") \
+    X(H3, "h3") \
+    X(H4, "h4") \
+    X(H5, "h5") \
+    X(H6, "h6") \
+    X(Head, "head") \
+    X(Header, "header") \
+    X(Hgroup, "hgroup") \
+    X(Hr, "hr") \
+    X(Html, "html") \
+    X(I, "i") \
+    X(Iframe, "iframe") \
+    X(Img, "img") \
+    X(Input, "input") \
+    X(Ins, "ins") \
+    X(Kbd, "kbd") \
+    X(Label, "label") \
+    X(Legend, "legend") \
+    X(Li, "li") \
+    X(Link, "link") \
+    X(Main, "main") \
+    X(Map, "map") \
+    X(Mark, "mark") \
+    X(Menu, "menu") \
+    X(Meta, "meta") \
+    X(Meter, "meter") \
+    X(Nav, "nav") \
+    X(Noembed, "noembed") \
+    X(Noframes, "noframes") \
+    X(Noscript, "noscript") \
+    X(Object, "object") \
+    X(Ol, "ol") \
+    X(Optgroup, "optgroup") \
+    X(Option, "option") \
+    X(Output, "output") \
+    X(P, "p") \
+    X(Param, "param") \
+    X(Picture, "picture") \
+    X(Pre, "pre") \
+    X(Progress, "progress") \
+    X(Q, "q") \
+    X(Rp, "rp") \
+    X(Rt, "rt") \
+    X(Ruby, "ruby") \
+    X(S, "s") \
+    X(Samp, "samp") \
+    X(Script, "script") \
+    X(Section, "section") \
+    X(Select, "select") \
+    X(Slot, "slot") \
+    X(Small, "small") \
+    X(Source, "source") \
+    X(Span, "span") \
+    X(Strike, "strike") \
+    X(Strong, "strong") \
+    X(Style, "style") \
+    X(Sub, "sub") \
+    X(Summary, "summary") \
+    X(Sup, "sup") \
+    X(Svg, "svg") \
+    X(Table, "table") \
+    X(Tbody, "tbody") \
+    X(Td, "td") \
+    X(Template, "template") \
+    X(Textarea, "textarea") \
+    X(Tfoot, "tfoot") \
+    X(Th, "th") \
+    X(Thead, "thead") \
+    X(Time, "time") \
+    X(Title, "title") \
+    X(Tr, "tr") \
+    X(Track, "track") \
+    X(Tt, "tt") \
+    X(U, "u") \
+    X(Ul, "ul") \
+    X(Var, "var") \
+    X(Video, "video") \
+    X(Wbr, "wbr") \
+    X(Xmp, "xmp")
+
+enum class TagAtom : uint16_t {
+    Unknown = 0,
+#define HEAVENLY_TAG_ATOM_ENUM(atom, name) atom,
+    HEAVENLY_TAG_ATOMS(HEAVENLY_TAG_ATOM_ENUM)
+#undef HEAVENLY_TAG_ATOM_ENUM
+    Count
+};
+
+namespace tag_atoms_detail {
+    inline constexpr std::string_view NAMES[] = {
+        "",
+#define HEAVENLY_TAG_ATOM_NAME(atom, name) name,
+        HEAVENLY_TAG_ATOMS(HEAVENLY_TAG_ATOM_NAME)
+#undef HEAVENLY_TAG_ATOM_NAME
+    };
+
+    constexpr size_t COUNT = static_cast<size_t>(TagAtom::Count);
+    static_assert(std::size(NAMES) == COUNT);
+    static_assert(COUNT <= 256, "атом в таблице хеша хранится в uint8_t");
+
+    constexpr size_t max_name_length() {
+        size_t length = 0;
+        for (std::string_view name : NAMES) {
+            length = name.size() > length ? name.size() : length;
+        }
+        return length;
+    }
+    constexpr size_t MAX_NAME_LENGTH = max_name_length();
+
+    // Таблица в 16 раз больше списка: бесконфликтное зерно находится
+    // за несколько десятков попыток, а сама таблица занимает 2 КБ
+    constexpr size_t TABLE_SIZE = 2048;
+
+    constexpr char lower(char c) {
+        return c >= 'A' && c <= 'Z' ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+
+    // FNV-1a без учета регистра: имена из разметки могут быть в любом регистре
+    constexpr uint32_t slot(std::string_view name, uint32_t seed) {
+        uint32_t hash = 0x811c9dc5u ^ (seed * 0x9e3779b9u);
+        for (char c : name) {
+            hash = (hash ^ static_cast<uint8_t>(lower(c))) * 0x01000193u;
+        }
+        hash ^= hash >> 15;
+        return hash & (TABLE_SIZE - 1);
+    }
+
+    // Первое зерно, при котором все имена попадают в разные ячейки
+    constexpr uint32_t find_seed() {
+        for (uint32_t seed = 0; seed < 100000; seed++) {
+            bool used[TABLE_SIZE] = {};
+            bool collision = false;
+            for (size_t atom = 1; atom < COUNT && !collision; atom++) {
+                uint32_t index = slot(NAMES[atom], seed);
+                collision = used[index];
+                used[index] = true;
+            }
+            if (!collision) {
+                return seed;
+            }
+        }
+        return UINT32_MAX;
+    }
+    constexpr uint32_t SEED = find_seed();
+    static_assert(SEED != UINT32_MAX, "идеальный хеш для списка тегов не найден");
+
+    constexpr std::array<uint8_t, TABLE_SIZE> build_table() {
+        std::array<uint8_t, TABLE_SIZE> table = {};
+        for (size_t atom = 1; atom < COUNT; atom++) {
+            table[slot(NAMES[atom], SEED)] = static_cast<uint8_t>(atom);
+        }
+        return table;
+    }
+    inline constexpr std::array<uint8_t, TABLE_SIZE> TABLE = build_table();
+
+    constexpr bool equals_lower(std::string_view name, std::string_view atom_name) {
+        if (name.size() != atom_name.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < name.size(); i++) {
+            if (lower(name[i]) != atom_name[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // FNV-1a по именам, каждое с завершающим '\0'; так же считает Rust
+    constexpr uint32_t table_hash() {
+        uint32_t hash = 0x811c9dc5u;
+        for (std::string_view name : NAMES) {
+            for (char c : name) {
+                hash = (hash ^ static_cast<uint8_t>(c)) * 0x01000193u;
+            }
+            hash = hash * 0x01000193u;
+        }
+        return hash;
+    }
+}
+
+// Снимок DOM несет ту же сумму: несовпадение значит, что списки разошлись
+constexpr uint32_t TAG_TABLE_HASH = tag_atoms_detail::table_hash();
+
+// Атом по имени тега (регистр не важен); одна ячейка таблицы и одно сравнение
+constexpr TagAtom tag_atom(std::string_view name) {
+    using namespace tag_atoms_detail;
+    if (name.empty() || name.size() > MAX_NAME_LENGTH) {
+        return TagAtom::Unknown;
+    }
+    uint8_t atom = TABLE[slot(name, SEED)];
+    return atom != 0 && equals_lower(name, NAMES[atom]) ? static_cast<TagAtom>(atom) : TagAtom::Unknown;
+}
+
+constexpr std::string_view tag_name(TagAtom atom) {
+    size_t index = static_cast<size_t>(atom);
+    return index < tag_atoms_detail::COUNT ? tag_atoms_detail::NAMES[index] : std::string_view();
+}
+
+// Уровень заголовка h1-h6 или 0
+constexpr int heading_level(TagAtom atom) {
+    return atom >= TagAtom::H1 && atom <= TagAtom::H6
+        ? static_cast<int>(atom) - static_cast<int>(TagAtom::H1) + 1
+        : 0;
+}
+
+static_assert(tag_atom("div") == TagAtom::Div && tag_atom("TD") == TagAtom::Td);
+static_assert(tag_atom("custom-element") == TagAtom::Unknown && tag_name(TagAtom::Xmp) == "xmp");
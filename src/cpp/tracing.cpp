@@ -0,0 +1,159 @@
+#include "tracing.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+TraceSpan::TraceSpan(const char* category, const char* name)
+    : category(category)
+    , name(name)
+    , start_ns(trace_is_enabled() ? trace_now_ns() : 0)
+    , bytes(0) {
+}
+
+TraceSpan::~TraceSpan() {
+    end();
+}
+
+void TraceSpan::end() {
+    if (start_ns != 0) {
+        trace_record(name, category, start_ns, trace_now_ns(), bytes);
+        start_ns = 0;
+    }
+}
+
+TraceNavigationScope::TraceNavigationScope(uint64_t navigation)
+    : previous(trace_get_navigation()) {
+    tracing::set_thread_navigation(navigation);
+}
+
+TraceNavigationScope::~TraceNavigationScope() {
+    trace_set_navigation(previous);
+    trace_rust_set_navigation(previous);
+}
+
+namespace {
+    std::atomic<uint64_t> last_navigation{TRACE_NO_NAVIGATION};
+
+    struct ChromeJsonWriter {
+        std::ostringstream& out;
+        uint32_t pid;
+        bool first;
+    };
+
+    void write_separator(ChromeJsonWriter& writer) {
+        if (!writer.first) {
+            writer.out << ",";
+        }
+        writer.first = false;
+    }
+
+    void write_string(std::ostringstream& out, const char* value) {
+        out << '"';
+        for (const char* c = value; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                out << '\\' << *c;
+            } else if (static_cast<unsigned char>(*c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(*c));
+                out << escaped;
+            } else {
+                out << *c;
+            }
+        }
+        out << '"';
+    }
+
+    void write_thread(const TraceThreadInfo* thread, void* user_data) {
+        auto& writer = *static_cast<ChromeJsonWriter*>(user_data);
+        write_separator(writer);
+        writer.out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << writer.pid
+                   << ",\"tid\":" << thread->tid << ",\"args\":{\"name\":";
+        write_string(writer.out, thread->thread_name);
+        writer.out << ",\"dropped\":" << thread->dropped << "}}";
+    }
+
+    void write_event(const TraceThreadInfo* thread, const TraceEvent* event, void* user_data) {
+        auto& writer = *static_cast<ChromeJsonWriter*>(user_data);
+        write_separator(writer);
+        char times[64];
+        // trace_event ожидает микросекунды
+        std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+                      event->start_ns / 1000.0, event->duration_ns / 1000.0);
+        writer.out << "{\"name\":";
+        write_string(writer.out, event->name);
+        writer.out << ",\"cat\":";
+        write_string(writer.out, event->category);
+        writer.out << ",\"ph\":\"X\"," << times
+                   << ",\"pid\":" << writer.pid << ",\"tid\":" << thread->tid
+                   << ",\"args\":{\"navigation\":" << event->navigation
+                   << ",\"bytes\":" << event->bytes << "}}";
+    }
+}
+
+namespace tracing {
+    void set_enabled(bool enabled) {
+        trace_rust_set_enabled(enabled, trace_now_ns());
+        trace_set_enabled(enabled ? 1 : 0);
+    }
+
+    bool enabled() {
+        return trace_is_enabled() != 0;
+    }
+
+    uint64_t next_navigation() {
+        return last_navigation.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    void set_thread_navigation(uint64_t navigation) {
+        if (trace_is_enabled()) {
+            trace_rust_bind_thread(trace_thread_id());
+        }
+        trace_set_navigation(navigation);
+        trace_rust_set_navigation(navigation);
+    }
+
+    std::string output_path() {
+        const char* path = std::getenv("HEAVENLY_TRACE");
+        return path ? path : "";
+    }
+
+    std::string to_chrome_json() {
+        std::ostringstream out;
+        ChromeJsonWriter writer{out, static_cast<uint32_t>(getpid()), true};
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << writer.pid
+            << ",\"tid\":0,\"args\":{\"name\":\"HeavenlyWebGu\"}}";
+        writer.first = false;
+
+        trace_collect(write_thread, write_event, &writer);
+
+        char* rust_events = trace_rust_export_json(writer.pid);
+        if (rust_events) {
+            if (*rust_events) {
+                out << "," << rust_events;
+            }
+            string_free(rust_events);
+        }
+
+        out << "]}";
+        return out.str();
+    }
+
+    bool write_chrome_json(const std::string& path) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            return false;
+        }
+        file << to_chrome_json();
+        return static_cast<bool>(file);
+    }
+
+    void clear() {
+        trace_clear();
+        trace_rust_clear();
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "trace.h"
+
+// FFI интерфейсы для Rust: кольца событий src/rust/src/trace.rs
+extern "C" {
+    void trace_rust_set_enabled(bool enabled, uint64_t now_ns);
+    void trace_rust_set_navigation(uint64_t navigation);
+    void trace_rust_bind_thread(uint32_t tid);
+    char* trace_rust_export_json(uint32_t pid);
+    void trace_rust_clear();
+    void string_free(char* ptr);
+}
+
+// Отрезок трассы от создания до уничтожения в кольце текущего потока.
+// name и category - строковые константы. При выключенной трассировке
+// ничего не записывается
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name);
+    ~TraceSpan();
+
+    void set_bytes(uint64_t value) { bytes = value; }
+    // Завершить раньше конца области видимости
+    void end();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* category;
+    const char* name;
+    uint64_t start_ns;
+    uint64_t bytes;
+};
+
+// Навигация текущего потока на время области видимости: события C, C++
+// и Rust (включая запущенные отсюда задачи) относятся к ней. Rust-события
+// самого потока попадают на его же дорожку трассы
+class TraceNavigationScope {
+public:
+    explicit TraceNavigationScope(uint64_t navigation);
+    ~TraceNavigationScope();
+
+    TraceNavigationScope(const TraceNavigationScope&) = delete;
+    TraceNavigationScope& operator=(const TraceNavigationScope&) = delete;
+
+private:
+    uint64_t previous;
+};
+
+namespace tracing {
+    // Включает запись на всех сторонах и выравнивает часы Rust по C
+    void set_enabled(bool enabled);
+    bool enabled();
+
+    // Номер для новой навигации (загрузки страницы)
+    uint64_t next_navigation();
+    // Навигация текущего потока до следующего вызова (в отличие от
+    // TraceNavigationScope не восстанавливается)
+    void set_thread_navigation(uint64_t navigation);
+
+    // Путь из переменной окружения HEAVENLY_TRACE: если задан, трассировка
+    // включается при запуске и трасса записывается туда
+    std::string output_path();
+
+    // Трасса всех потоков C, C++ и Rust в формате Chrome trace_event:
+    // открывается в chrome://tracing и Perfetto
+    std::string to_chrome_json();
+    bool write_chrome_json(const std::string& path);
+
+    void clear();
+}
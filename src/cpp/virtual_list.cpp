@@ -0,0 +1,163 @@
+#include "virtual_list.h"
+#include <algorithm>
+
+GtkWidget* VirtualList::create(std::shared_ptr<VirtualListAdapter> adapter, int estimated_row_height) {
+    VirtualList* list = new VirtualList(std::move(adapter), estimated_row_height);
+    return list->layout_widget;
+}
+
+VirtualList::VirtualList(std::shared_ptr<VirtualListAdapter> adapter, int estimated_row_height)
+    : layout_widget(gtk_layout_new(nullptr, nullptr))
+    , adapter(std::move(adapter))
+    , estimated_row_height(estimated_row_height)
+    , width(0)
+    , offsets_dirty(true)
+    , generation(0)
+    , vadjustment(nullptr)
+    , updating(false)
+{
+    heights.assign(this->adapter->row_count(), estimated_row_height);
+
+    g_signal_connect(layout_widget, "destroy", G_CALLBACK(on_destroy), this);
+    g_signal_connect_after(layout_widget, "size-allocate", G_CALLBACK(on_size_allocate), this);
+    g_signal_connect(layout_widget, "notify::vadjustment", G_CALLBACK(on_vadjustment_changed), this);
+}
+
+VirtualList::~VirtualList() {
+    if (vadjustment) {
+        g_signal_handlers_disconnect_by_data(vadjustment, this);
+        g_object_unref(vadjustment);
+    }
+}
+
+void VirtualList::on_destroy(GtkWidget*, gpointer user_data) {
+    delete static_cast<VirtualList*>(user_data);
+}
+
+void VirtualList::on_size_allocate(GtkWidget*, GdkRectangle* allocation, gpointer user_data) {
+    VirtualList* list = static_cast<VirtualList*>(user_data);
+    if (allocation->width == list->width) {
+        return;
+    }
+
+    // Строки переносятся по-другому: прежние высоты больше не верны
+    list->width = allocation->width;
+    std::fill(list->heights.begin(), list->heights.end(), list->estimated_row_height);
+    list->offsets_dirty = true;
+    list->update();
+}
+
+void VirtualList::on_vadjustment_changed(GObject*, GParamSpec*, gpointer user_data) {
+    VirtualList* list = static_cast<VirtualList*>(user_data);
+    if (list->vadjustment) {
+        g_signal_handlers_disconnect_by_data(list->vadjustment, list);
+        g_object_unref(list->vadjustment);
+    }
+
+    list->vadjustment = gtk_scrollable_get_vadjustment(GTK_SCROLLABLE(list->layout_widget));
+    if (list->vadjustment) {
+        g_object_ref(list->vadjustment);
+        g_signal_connect(list->vadjustment, "value-changed", G_CALLBACK(on_scroll), list);
+    }
+}
+
+void VirtualList::on_scroll(GtkAdjustment*, gpointer user_data) {
+    static_cast<VirtualList*>(user_data)->update();
+}
+
+void VirtualList::recompute_offsets() {
+    offsets.resize(heights.size() + 1);
+    offsets[0] = 0;
+    for (size_t i = 0; i < heights.size(); i++) {
+        offsets[i + 1] = offsets[i] + heights[i];
+    }
+    offsets_dirty = false;
+}
+
+size_t VirtualList::row_at(double y) const {
+    auto it = std::upper_bound(offsets.begin() + 1, offsets.end(), static_cast<int>(y));
+    return static_cast<size_t>(it - (offsets.begin() + 1));
+}
+
+void VirtualList::update() {
+    // Изменение размера области может прокрутить ее и вызвать нас повторно
+    if (updating || width <= 0) {
+        return;
+    }
+    updating = true;
+
+    if (offsets_dirty) {
+        recompute_offsets();
+    }
+
+    double value = vadjustment ? gtk_adjustment_get_value(vadjustment) : 0.0;
+    double page = vadjustment ? gtk_adjustment_get_page_size(vadjustment) : 0.0;
+    double top = value - OVERSCAN;
+    double bottom = value + page + OVERSCAN;
+
+    unsigned current = ++generation;
+    size_t count = heights.size();
+    size_t index = row_at(std::max(0.0, top));
+    int y = index < count ? offsets[index] : 0;
+
+    // Строки раскладываются подряд от первой видимой: если заполнение
+    // уточнило высоту, следующие строки сразу встают на свое место
+    for (; index < count && y < bottom; index++) {
+        auto it = bound.find(index);
+        if (it == bound.end()) {
+            int kind = adapter->row_kind(index);
+            std::vector<GtkWidget*>& free_rows = pool[kind];
+            GtkWidget* row = nullptr;
+            if (!free_rows.empty()) {
+                row = free_rows.back();
+                free_rows.pop_back();
+                gtk_layout_move(GTK_LAYOUT(layout_widget), row, 0, y);
+            } else {
+                row = adapter->create_row(kind);
+                gtk_layout_put(GTK_LAYOUT(layout_widget), row, 0, y);
+            }
+            adapter->bind_row(row, index);
+            gtk_widget_show_all(row);
+            it = bound.emplace(index, BoundRow{row, kind, current}).first;
+        } else {
+            gtk_layout_move(GTK_LAYOUT(layout_widget), it->second.widget, 0, y);
+            it->second.generation = current;
+        }
+
+        GtkWidget* row = it->second.widget;
+        gtk_widget_set_size_request(row, width, -1);
+        int natural_height = 0;
+        gtk_widget_get_preferred_height_for_width(row, width, nullptr, &natural_height);
+        if (natural_height != heights[index]) {
+            heights[index] = natural_height;
+            offsets_dirty = true;
+        }
+        y += heights[index];
+    }
+
+    for (auto it = bound.begin(); it != bound.end();) {
+        if (it->second.generation != current) {
+            release_row(it->second);
+            it = bound.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (offsets_dirty) {
+        recompute_offsets();
+    }
+    gtk_layout_set_size(GTK_LAYOUT(layout_widget), width, static_cast<guint>(offsets.back()));
+
+    updating = false;
+}
+
+void VirtualList::release_row(const BoundRow& row) {
+    std::vector<GtkWidget*>& free_rows = pool[row.kind];
+    if (free_rows.size() < MAX_POOLED_ROWS) {
+        gtk_widget_hide(row.widget);
+        free_rows.push_back(row.widget);
+    } else {
+        gtk_widget_destroy(row.widget);
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <gtk/gtk.h>
+
+// Источник строк виртуального списка
+class VirtualListAdapter {
+public:
+    virtual ~VirtualListAdapter() = default;
+
+    virtual size_t row_count() const = 0;
+    // Строки одного вида переиспользуют виджеты друг друга
+    virtual int row_kind(size_t index) const = 0;
+    virtual GtkWidget* create_row(int kind) = 0;
+    // Заполняет виджет (новый или переиспользованный) данными строки
+    virtual void bind_row(GtkWidget* row, size_t index) = 0;
+};
+
+// Вертикальный список, в котором виджеты существуют только для видимых
+// строк и небольшого запаса (OVERSCAN). Строки, ушедшие из полосы,
+// прячутся в пул своего вида и заполняются заново для новых строк.
+//
+// Высота строки известна после ее первого заполнения, до этого
+// используется оценка. Объект живет, пока жив его виджет.
+class VirtualList {
+public:
+    static constexpr double OVERSCAN = 400.0;
+    static constexpr int DEFAULT_ROW_HEIGHT = 32;
+    static constexpr size_t MAX_POOLED_ROWS = 32;
+
+    // Создает виджет списка (GtkLayout) для добавления в GtkScrolledWindow
+    static GtkWidget* create(std::shared_ptr<VirtualListAdapter> adapter,
+                             int estimated_row_height = DEFAULT_ROW_HEIGHT);
+
+    VirtualList(const VirtualList&) = delete;
+    VirtualList& operator=(const VirtualList&) = delete;
+
+private:
+    struct BoundRow {
+        GtkWidget* widget;
+        int kind;
+        unsigned generation;
+    };
+
+    VirtualList(std::shared_ptr<VirtualListAdapter> adapter, int estimated_row_height);
+    ~VirtualList();
+
+    static void on_destroy(GtkWidget* widget, gpointer user_data);
+    static void on_size_allocate(GtkWidget* widget, GdkRectangle* allocation, gpointer user_data);
+    static void on_vadjustment_changed(GObject* object, GParamSpec* pspec, gpointer user_data);
+    static void on_scroll(GtkAdjustment* adjustment, gpointer user_data);
+
+    void update();
+    // Первая строка, нижний край которой ниже y
+    size_t row_at(double y) const;
+    void recompute_offsets();
+    void release_row(const BoundRow& row);
+
+    GtkWidget* layout_widget;
+    std::shared_ptr<VirtualListAdapter> adapter;
+    int estimated_row_height;
+    int width;
+
+    // Высоты строк (оценка, пока строка не заполнялась) и их верхние края;
+    // offsets[row_count] - высота всего списка
+    std::vector<int> heights;
+    std::vector<int> offsets;
+    bool offsets_dirty;
+
+    std::unordered_map<size_t, BoundRow> bound;
+    std::unordered_map<int, std::vector<GtkWidget*>> pool;
+    unsigned generation;
+
+    GtkAdjustment* vadjustment;
+    bool updating;
+};
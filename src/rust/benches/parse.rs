@@ -0,0 +1,97 @@
+// Бенчмарки Rust-части конвейера на корпусе bench/corpus: разбор html5ever,
+// каскад стилей и снимок DOM для FFI. Та же большая страница (~5 МБ),
+// что и в heavenly_bench, собирается из тела средней.
+//
+//   cargo bench --manifest-path src/rust/Cargo.toml
+
+use criterion::{black_box, criterion_group, criterion_main, BenchmarkId, Criterion, Throughput};
+use heavenly_webgu_rust::{html_get_snapshot, html_snapshot_free, HtmlParser, StyleEngine};
+
+const CORPUS_DIR: &str = concat!(env!("CARGO_MANIFEST_DIR"), "/../../bench/corpus");
+const LARGE_PAGE_SIZE: usize = 5 * 1024 * 1024;
+
+fn read_page(name: &str) -> String {
+    let path = format!("{}/{}", CORPUS_DIR, name);
+    std::fs::read_to_string(&path).unwrap_or_else(|err| panic!("{}: {}", path, err))
+}
+
+fn make_large_page(medium: &str) -> String {
+    let body_start = medium
+        .find("<body")
+        .and_then(|open| medium[open..].find('>').map(|end| open + end + 1))
+        .expect("medium.html без <body>");
+    let body_end = medium.rfind("</body>").expect("medium.html без </body>");
+    let (head, body, tail) = (&medium[..body_start], &medium[body_start..body_end], &medium[body_end..]);
+
+    let mut page = String::with_capacity(LARGE_PAGE_SIZE + medium.len());
+    page.push_str(head);
+    while page.len() + tail.len() < LARGE_PAGE_SIZE {
+        page.push_str(body);
+    }
+    page.push_str(tail);
+    page
+}
+
+fn corpus() -> Vec<(&'static str, String)> {
+    let medium = read_page("medium.html");
+    let large = make_large_page(&medium);
+    vec![("small", read_page("small.html")), ("medium", medium), ("large", large)]
+}
+
+fn parsed(html: &str) -> HtmlParser {
+    let mut parser = HtmlParser::new();
+    parser.parse(html).expect("разбор корпуса");
+    parser
+}
+
+fn bench_pipeline(c: &mut Criterion) {
+    let pages = corpus();
+
+    let mut group = c.benchmark_group("parse");
+    for (name, html) in &pages {
+        group.throughput(Throughput::Bytes(html.len() as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(name), html, |b, html| {
+            b.iter(|| {
+                let mut parser = HtmlParser::new();
+                black_box(parser.parse(black_box(html)).is_ok())
+            })
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("style");
+    for (name, html) in &pages {
+        let parser = parsed(html);
+        group.throughput(Throughput::Bytes(html.len() as u64));
+        group.bench_function(BenchmarkId::from_parameter(name), |b| {
+            b.iter(|| {
+                let document = parser.document();
+                black_box(StyleEngine::from_document(document).resolve_document(document))
+            })
+        });
+    }
+    group.finish();
+
+    // Снимок со стилями - то, что C++ получает через html_get_snapshot
+    let mut group = c.benchmark_group("snapshot");
+    for (name, html) in &pages {
+        let mut parser = parsed(html);
+        group.throughput(Throughput::Bytes(html.len() as u64));
+        group.bench_function(BenchmarkId::from_parameter(name), |b| {
+            b.iter(|| {
+                let snapshot = html_get_snapshot(&mut parser);
+                assert!(!snapshot.is_null());
+                html_snapshot_free(black_box(snapshot));
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group! {
+    name = benches;
+    // 5 МБ страница разбирается долго: выборка меньше стандартной
+    config = Criterion::default().sample_size(20);
+    targets = bench_pipeline
+}
+criterion_main!(benches);
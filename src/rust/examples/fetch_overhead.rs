@@ -0,0 +1,120 @@
+// Накладные расходы на запрос: N загрузок с локального сервера
+// старым способом (рантайм и Client на каждый запрос) и через общий NetworkManager.
+//
+//     cargo run --release --example fetch_overhead -- 500
+
+use std::io::{BufRead, BufReader, Write};
+use std::net::{TcpListener, TcpStream};
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::Arc;
+use std::time::{Duration, Instant};
+
+use heavenly_webgu_rust::NetworkManager;
+
+const BODY: &str = "<html><body><p>heavenly</p></body></html>";
+const TIMEOUT: Duration = Duration::from_secs(5);
+
+// Минимальный HTTP/1.1 сервер с keep-alive, считает принятые соединения
+fn start_server(connections: Arc<AtomicUsize>) -> String {
+    let listener = TcpListener::bind("127.0.0.1:0").expect("bind");
+    let address = listener.local_addr().unwrap();
+
+    std::thread::spawn(move || {
+        for stream in listener.incoming().flatten() {
+            connections.fetch_add(1, Ordering::Relaxed);
+            std::thread::spawn(move || serve_connection(stream));
+        }
+    });
+
+    format!("http://{}/", address)
+}
+
+fn serve_connection(stream: TcpStream) {
+    let mut writer = match stream.try_clone() {
+        Ok(writer) => writer,
+        Err(_) => return,
+    };
+    let mut reader = BufReader::new(stream);
+    let mut line = String::new();
+
+    loop {
+        // Читаем заголовки запроса до пустой строки
+        let mut saw_request = false;
+        loop {
+            line.clear();
+            match reader.read_line(&mut line) {
+                Ok(0) | Err(_) => return,
+                Ok(_) if line == "\r\n" => break,
+                Ok(_) => saw_request = true,
+            }
+        }
+        if !saw_request {
+            continue;
+        }
+
+        let response = format!(
+            "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: {}\r\n\r\n{}",
+            BODY.len(),
+            BODY
+        );
+        if writer.write_all(response.as_bytes()).is_err() {
+            return;
+        }
+    }
+}
+
+// Как загрузка работала раньше: новый рантайм и Client на каждый запрос
+fn fetch_fresh(url: &str) -> Option<String> {
+    let rt = tokio::runtime::Runtime::new().ok()?;
+    rt.block_on(async move {
+        let client = reqwest::Client::builder().timeout(TIMEOUT).build().ok()?;
+        let resp = client.get(url).send().await.ok()?;
+        resp.text().await.ok()
+    })
+}
+
+fn fetch_shared(network: &NetworkManager, url: &str) -> Option<String> {
+    network.block_on(NetworkManager::get_text(
+        network.client().clone(),
+        url.to_string(),
+        TIMEOUT,
+    ))
+}
+
+fn report(name: &str, count: usize, elapsed: Duration, connections: usize) {
+    println!(
+        "{:<8} {:>5} запросов  {:>9.2} мс  {:>8.1} мкс/запрос  соединений: {}",
+        name,
+        count,
+        elapsed.as_secs_f64() * 1000.0,
+        elapsed.as_secs_f64() * 1_000_000.0 / count as f64,
+        connections
+    );
+}
+
+fn main() {
+    let count: usize = std::env::args()
+        .nth(1)
+        .and_then(|arg| arg.parse().ok())
+        .unwrap_or(200);
+
+    let connections = Arc::new(AtomicUsize::new(0));
+    let url = start_server(Arc::clone(&connections));
+
+    let start = Instant::now();
+    for _ in 0..count {
+        fetch_fresh(&url).expect("fetch");
+    }
+    report("before", count, start.elapsed(), connections.swap(0, Ordering::Relaxed));
+
+    let network = NetworkManager::global().expect("network");
+    // Первый запрос создает рантайм и соединение, в замер не входит
+    fetch_shared(network, &url).expect("fetch");
+    connections.store(0, Ordering::Relaxed);
+
+    let start = Instant::now();
+    for _ in 0..count {
+        fetch_shared(network, &url).expect("fetch");
+    }
+    report("after", count, start.elapsed(), connections.load(Ordering::Relaxed));
+}
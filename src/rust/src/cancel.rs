@@ -0,0 +1,74 @@
+// Отмена загрузок. У каждой вкладки (номер из меток памяти) есть текущий
+// токен; запрос, поставленный в планировщик, запоминает токен своей
+// вкладки. Остановка, новая навигация и закрытие вкладки отменяют токен:
+// ждущие запросы снимаются с очереди, а у начатых бросается future reqwest -
+// соединение закрывается сразу, буферы тела освобождаются. Следующие
+// запросы вкладки получают новый токен.
+
+use std::collections::HashMap;
+use std::future::Future;
+use std::sync::{Arc, Mutex, OnceLock};
+
+use tokio::sync::watch;
+
+use crate::memory;
+
+#[derive(Clone)]
+pub struct CancelToken {
+    state: Arc<watch::Sender<bool>>,
+}
+
+impl CancelToken {
+    fn new() -> Self {
+        Self {
+            state: Arc::new(watch::Sender::new(false)),
+        }
+    }
+
+    pub fn cancel(&self) {
+        self.state.send_replace(true);
+    }
+
+    pub fn is_cancelled(&self) -> bool {
+        *self.state.borrow()
+    }
+
+    // Завершается после отмены (сразу, если токен уже отменен)
+    pub async fn cancelled(&self) {
+        let mut receiver = self.state.subscribe();
+        // Отправитель живет в self, ошибки ожидания быть не может
+        let _ = receiver.wait_for(|cancelled| *cancelled).await;
+    }
+
+    // Выполняет future до завершения или до отмены; при отмене future
+    // бросается там, где его застала отмена, и результат - None
+    pub async fn run<F: Future>(&self, future: F) -> Option<F::Output> {
+        tokio::select! {
+            biased;
+            _ = self.cancelled() => None,
+            output = future => Some(output),
+        }
+    }
+}
+
+fn tokens() -> &'static Mutex<HashMap<u16, CancelToken>> {
+    static TOKENS: OnceLock<Mutex<HashMap<u16, CancelToken>>> = OnceLock::new();
+    TOKENS.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+// Текущий токен вкладки
+pub fn for_tab(tab: u16) -> CancelToken {
+    tokens().lock().unwrap().entry(tab).or_insert_with(CancelToken::new).clone()
+}
+
+// Токен вкладки из меток памяти вызывающего потока
+pub fn current() -> CancelToken {
+    for_tab(memory::current_tags().tab)
+}
+
+// Отменяет все запросы вкладки, начатые до вызова
+pub fn cancel_tab(tab: u16) {
+    if let Some(token) = tokens().lock().unwrap().remove(&tab) {
+        token.cancel();
+    }
+}
@@ -0,0 +1,502 @@
+use std::borrow::Cow;
+
+use crate::css_parser::Declaration;
+
+// Вычисленный стиль элемента: только свойства, которые понимает раскладка.
+// Значения абсолютные (px, 0xRRGGBB), относительные единицы уже пересчитаны.
+
+#[repr(u8)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Display {
+    None = 0,
+    Inline = 1,
+    Block = 2,
+    ListItem = 3,
+    TableCell = 4,
+}
+
+#[derive(Debug, Clone, PartialEq)]
+pub struct ComputedStyle {
+    // Наследуемые
+    pub font_size: f32,
+    pub bold: bool,
+    pub italic: bool,
+    pub monospace: bool,
+    // Оформление текста не наследуется в CSS, но распространяется на
+    // потомков - для раскладки это одно и то же
+    pub underline: bool,
+    pub preformatted: bool,
+    pub color: u32,
+    // Ненаследуемые
+    pub display: Display,
+    pub margin_top: f32,
+    pub margin_bottom: f32,
+    pub margin_left: f32,
+    pub padding_top: f32,
+    pub padding_bottom: f32,
+    pub padding_left: f32,
+}
+
+// Размер шрифта корневого элемента для rem
+const ROOT_FONT_SIZE: f32 = 16.0;
+
+impl ComputedStyle {
+    pub fn initial() -> Self {
+        Self {
+            font_size: ROOT_FONT_SIZE,
+            bold: false,
+            italic: false,
+            monospace: false,
+            underline: false,
+            preformatted: false,
+            color: 0x000000,
+            display: Display::Inline,
+            margin_top: 0.0,
+            margin_bottom: 0.0,
+            margin_left: 0.0,
+            padding_top: 0.0,
+            padding_bottom: 0.0,
+            padding_left: 0.0,
+        }
+    }
+
+    // Стиль ребенка до применения правил: наследуемое от родителя, остальное начальное
+    pub fn inherit_from(parent: &ComputedStyle) -> Self {
+        Self {
+            font_size: parent.font_size,
+            bold: parent.bold,
+            italic: parent.italic,
+            monospace: parent.monospace,
+            underline: parent.underline,
+            preformatted: parent.preformatted,
+            color: parent.color,
+            ..Self::initial()
+        }
+    }
+
+    // Каскад: обычные объявления правил, затем обычные из style="",
+    // затем !important в том же порядке. Правила - в порядке каскада
+    pub fn cascade<'a>(
+        parent: &ComputedStyle,
+        rules: impl Iterator<Item = &'a [Declaration]> + Clone,
+        inline: &'a [Declaration],
+    ) -> Self {
+        let mut winners: [Option<&'a str>; PROPERTY_COUNT] = [None; PROPERTY_COUNT];
+        for important in [false, true] {
+            for declarations in rules.clone().chain(std::iter::once(inline)) {
+                for declaration in declarations.iter().filter(|d| d.important == important) {
+                    record(&mut winners, &declaration.name, &declaration.value);
+                }
+            }
+        }
+
+        let mut style = Self::inherit_from(parent);
+        // font-size первым: от него считаются em остальных свойств
+        if let Some(value) = winners[Property::FontSize as usize] {
+            style.apply(Property::FontSize, value, parent);
+        }
+        for (index, value) in winners.iter().enumerate() {
+            if let (Some(value), Some(property)) = (value, Property::from_index(index)) {
+                if property != Property::FontSize {
+                    style.apply(property, value, parent);
+                }
+            }
+        }
+        style
+    }
+
+    fn apply(&mut self, property: Property, value: &str, parent: &ComputedStyle) {
+        let value = value.trim();
+        // Значения в таблицах почти всегда уже в нижнем регистре
+        let keyword: Cow<str> = if value.bytes().any(|byte| byte.is_ascii_uppercase()) {
+            Cow::Owned(value.to_ascii_lowercase())
+        } else {
+            Cow::Borrowed(value)
+        };
+        let initial = Self::initial();
+        let source = match &*keyword {
+            "inherit" => Some(parent),
+            "initial" => Some(&initial),
+            "unset" => Some(if property.is_inherited() { parent } else { &initial }),
+            _ => None,
+        };
+        if let Some(source) = source {
+            self.copy_property(property, source);
+            return;
+        }
+
+        let em = self.font_size;
+        match property {
+            Property::Display => {
+                if let Some(display) = parse_display(&keyword) {
+                    self.display = display;
+                }
+            }
+            Property::FontSize => {
+                if let Some(size) = parse_font_size(&keyword, parent.font_size) {
+                    self.font_size = size;
+                }
+            }
+            Property::FontWeight => {
+                self.bold = match &*keyword {
+                    "bold" | "bolder" => true,
+                    "normal" | "lighter" => false,
+                    number => match number.parse::<f32>() {
+                        Ok(weight) => weight >= 600.0,
+                        Err(_) => return,
+                    },
+                }
+            }
+            Property::FontStyle => self.italic = keyword.starts_with("italic") || keyword.starts_with("oblique"),
+            Property::FontFamily => self.monospace = is_monospace_family(&keyword),
+            Property::Color => {
+                if keyword == "currentcolor" {
+                    self.color = parent.color;
+                } else if let Some(color) = parse_color(&keyword) {
+                    self.color = color;
+                }
+            }
+            Property::TextDecoration => {
+                if keyword.split_ascii_whitespace().any(|word| word == "underline") {
+                    self.underline = true;
+                } else if keyword.split_ascii_whitespace().any(|word| word == "none") {
+                    self.underline = false;
+                }
+            }
+            Property::WhiteSpace => {
+                self.preformatted = matches!(&*keyword, "pre" | "pre-wrap" | "pre-line" | "break-spaces")
+            }
+            Property::MarginTop => set_length(&mut self.margin_top, &keyword, em, true),
+            Property::MarginBottom => set_length(&mut self.margin_bottom, &keyword, em, true),
+            Property::MarginLeft => set_length(&mut self.margin_left, &keyword, em, true),
+            Property::PaddingTop => set_length(&mut self.padding_top, &keyword, em, false),
+            Property::PaddingBottom => set_length(&mut self.padding_bottom, &keyword, em, false),
+            Property::PaddingLeft => set_length(&mut self.padding_left, &keyword, em, false),
+        }
+    }
+
+    fn copy_property(&mut self, property: Property, source: &ComputedStyle) {
+        match property {
+            Property::Display => self.display = source.display,
+            Property::FontSize => self.font_size = source.font_size,
+            Property::FontWeight => self.bold = source.bold,
+            Property::FontStyle => self.italic = source.italic,
+            Property::FontFamily => self.monospace = source.monospace,
+            Property::Color => self.color = source.color,
+            Property::TextDecoration => self.underline = source.underline,
+            Property::WhiteSpace => self.preformatted = source.preformatted,
+            Property::MarginTop => self.margin_top = source.margin_top,
+            Property::MarginBottom => self.margin_bottom = source.margin_bottom,
+            Property::MarginLeft => self.margin_left = source.margin_left,
+            Property::PaddingTop => self.padding_top = source.padding_top,
+            Property::PaddingBottom => self.padding_bottom = source.padding_bottom,
+            Property::PaddingLeft => self.padding_left = source.padding_left,
+        }
+    }
+}
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Property {
+    Display,
+    FontSize,
+    FontWeight,
+    FontStyle,
+    FontFamily,
+    Color,
+    TextDecoration,
+    WhiteSpace,
+    MarginTop,
+    MarginBottom,
+    MarginLeft,
+    PaddingTop,
+    PaddingBottom,
+    PaddingLeft,
+}
+
+const PROPERTY_COUNT: usize = 14;
+
+impl Property {
+    const ALL: [Property; PROPERTY_COUNT] = [
+        Property::Display,
+        Property::FontSize,
+        Property::FontWeight,
+        Property::FontStyle,
+        Property::FontFamily,
+        Property::Color,
+        Property::TextDecoration,
+        Property::WhiteSpace,
+        Property::MarginTop,
+        Property::MarginBottom,
+        Property::MarginLeft,
+        Property::PaddingTop,
+        Property::PaddingBottom,
+        Property::PaddingLeft,
+    ];
+
+    fn from_index(index: usize) -> Option<Self> {
+        Self::ALL.get(index).copied()
+    }
+
+    fn from_name(name: &str) -> Option<Self> {
+        Some(match name {
+            "display" => Property::Display,
+            "font-size" => Property::FontSize,
+            "font-weight" => Property::FontWeight,
+            "font-style" => Property::FontStyle,
+            "font-family" => Property::FontFamily,
+            "color" => Property::Color,
+            "text-decoration" | "text-decoration-line" => Property::TextDecoration,
+            "white-space" => Property::WhiteSpace,
+            "margin-top" => Property::MarginTop,
+            "margin-bottom" => Property::MarginBottom,
+            "margin-left" => Property::MarginLeft,
+            "padding-top" => Property::PaddingTop,
+            "padding-bottom" => Property::PaddingBottom,
+            "padding-left" => Property::PaddingLeft,
+            _ => return None,
+        })
+    }
+
+    fn is_inherited(self) -> bool {
+        matches!(
+            self,
+            Property::FontSize
+                | Property::FontWeight
+                | Property::FontStyle
+                | Property::FontFamily
+                | Property::Color
+                | Property::TextDecoration
+                | Property::WhiteSpace
+        )
+    }
+}
+
+// Запоминает объявление как текущего победителя; сокращения раскладываются
+// на составляющие на месте, поэтому позднее объявление перекрывает раннее
+// независимо от того, записано оно полностью или сокращением
+fn record<'a>(winners: &mut [Option<&'a str>; PROPERTY_COUNT], name: &str, value: &'a str) {
+    if let Some(property) = Property::from_name(name) {
+        winners[property as usize] = Some(value);
+        return;
+    }
+
+    match name {
+        "margin" | "padding" => {
+            let (top, left, bottom) = if name == "margin" {
+                (Property::MarginTop, Property::MarginLeft, Property::MarginBottom)
+            } else {
+                (Property::PaddingTop, Property::PaddingLeft, Property::PaddingBottom)
+            };
+            if is_global_keyword(value) {
+                winners[top as usize] = Some(value);
+                winners[bottom as usize] = Some(value);
+                winners[left as usize] = Some(value);
+                return;
+            }
+            // top [right [bottom [left]]]
+            let parts: Vec<&'a str> = value.split_ascii_whitespace().collect();
+            let (t, b, l) = match parts.len() {
+                1 => (parts[0], parts[0], parts[0]),
+                2 => (parts[0], parts[0], parts[1]),
+                3 => (parts[0], parts[2], parts[1]),
+                4 => (parts[0], parts[2], parts[3]),
+                _ => return,
+            };
+            winners[top as usize] = Some(t);
+            winners[bottom as usize] = Some(b);
+            winners[left as usize] = Some(l);
+        }
+        "font" => {
+            if is_global_keyword(value) {
+                for property in [Property::FontSize, Property::FontWeight, Property::FontStyle, Property::FontFamily] {
+                    winners[property as usize] = Some(value);
+                }
+                return;
+            }
+            // [style] [weight] size[/line-height] family
+            let mut words = value.split_ascii_whitespace();
+            let mut weight = "normal";
+            let mut style = "normal";
+            for word in words.by_ref() {
+                let lower = word.to_ascii_lowercase();
+                match lower.as_str() {
+                    "italic" | "oblique" => style = word,
+                    "bold" | "bolder" | "lighter" => weight = word,
+                    "normal" | "small-caps" => {}
+                    _ if lower.len() == 3 && lower.bytes().all(|b| b.is_ascii_digit()) => weight = word,
+                    _ => {
+                        let size = word.split('/').next().unwrap_or(word);
+                        let family_start = value.find(word).map(|start| start + word.len()).unwrap_or(value.len());
+                        winners[Property::FontSize as usize] = Some(size);
+                        winners[Property::FontWeight as usize] = Some(weight);
+                        winners[Property::FontStyle as usize] = Some(style);
+                        winners[Property::FontFamily as usize] = Some(value[family_start..].trim());
+                        return;
+                    }
+                }
+            }
+        }
+        _ => {}
+    }
+}
+
+fn is_global_keyword(value: &str) -> bool {
+    let value = value.trim();
+    value.eq_ignore_ascii_case("inherit") || value.eq_ignore_ascii_case("initial") || value.eq_ignore_ascii_case("unset")
+}
+
+fn parse_display(keyword: &str) -> Option<Display> {
+    // Двухсловная запись (display: block flow) - по внешнему типу
+    let outer = keyword.split_ascii_whitespace().next()?;
+    Some(match outer {
+        "none" => Display::None,
+        "inline" | "inline-block" | "inline-flex" | "inline-grid" | "inline-table" | "contents" | "ruby" => Display::Inline,
+        "list-item" => Display::ListItem,
+        "table-cell" => Display::TableCell,
+        "block" | "flex" | "grid" | "flow-root" | "table" | "table-row" | "table-row-group" | "table-header-group"
+        | "table-footer-group" | "table-caption" | "flow" => Display::Block,
+        _ => return None,
+    })
+}
+
+fn parse_font_size(keyword: &str, parent_size: f32) -> Option<f32> {
+    let size = match keyword {
+        "xx-small" => 9.0,
+        "x-small" => 10.0,
+        "small" => 13.0,
+        "medium" => ROOT_FONT_SIZE,
+        "large" => 18.0,
+        "x-large" => 24.0,
+        "xx-large" => 32.0,
+        "xxx-large" => 48.0,
+        "smaller" => parent_size / 1.2,
+        "larger" => parent_size * 1.2,
+        _ => parse_length(keyword, parent_size, parent_size)?,
+    };
+    if size >= 0.0 {
+        Some(size)
+    } else {
+        None
+    }
+}
+
+// Длина в px; em - от em_base, % - от percent_base
+fn parse_length(value: &str, em_base: f32, percent_base: f32) -> Option<f32> {
+    let split = value
+        .find(|c: char| !(c.is_ascii_digit() || c == '.' || c == '-' || c == '+'))
+        .unwrap_or(value.len());
+    let (number, unit) = value.split_at(split);
+    let number: f32 = number.parse().ok()?;
+    Some(match unit {
+        "px" => number,
+        // Ноль без единиц допустим
+        "" if number == 0.0 => 0.0,
+        "em" => number * em_base,
+        "rem" => number * ROOT_FONT_SIZE,
+        "%" => number * percent_base / 100.0,
+        "pt" => number * 4.0 / 3.0,
+        "pc" => number * 16.0,
+        "in" => number * 96.0,
+        "cm" => number * 96.0 / 2.54,
+        "mm" => number * 96.0 / 25.4,
+        "ex" | "ch" => number * em_base / 2.0,
+        _ => return None,
+    })
+}
+
+fn set_length(target: &mut f32, keyword: &str, em: f32, allow_negative: bool) {
+    if keyword == "auto" {
+        *target = 0.0;
+        return;
+    }
+    // Проценты считаются от ширины блока, которая здесь неизвестна
+    if let Some(length) = parse_length(keyword, em, 0.0) {
+        if allow_negative || length >= 0.0 {
+            *target = length;
+        }
+    }
+}
+
+fn is_monospace_family(families: &str) -> bool {
+    families.split(',').any(|family| {
+        let family = family.trim().trim_matches(|c| c == '"' || c == '\'');
+        matches!(
+            family,
+            "monospace" | "ui-monospace" | "courier" | "courier new" | "consolas" | "menlo" | "monaco"
+                | "sfmono-regular" | "dejavu sans mono" | "liberation mono" | "ubuntu mono" | "source code pro"
+                | "fira code" | "fira mono" | "jetbrains mono" | "lucida console"
+        )
+    })
+}
+
+pub fn parse_color(value: &str) -> Option<u32> {
+    if let Some(hex) = value.strip_prefix('#') {
+        let digits: Vec<u32> = hex.chars().map(|c| c.to_digit(16)).collect::<Option<_>>()?;
+        return match digits.len() {
+            // #rgb и #rgba: каждая цифра удваивается, альфа отбрасывается
+            3 | 4 => Some((digits[0] * 17) << 16 | (digits[1] * 17) << 8 | digits[2] * 17),
+            6 | 8 => Some(digits[..6].iter().fold(0, |acc, digit| acc << 4 | digit)),
+            _ => None,
+        };
+    }
+
+    if let Some(arguments) = value.strip_prefix("rgb(").or_else(|| value.strip_prefix("rgba(")) {
+        let arguments = arguments.strip_suffix(')')?;
+        let channels: Vec<u32> = arguments
+            .split(|c: char| c == ',' || c == '/' || c.is_ascii_whitespace())
+            .filter(|part| !part.is_empty())
+            .take(3)
+            .map(|part| {
+                let channel = match part.strip_suffix('%') {
+                    Some(percent) => percent.parse::<f32>().ok()? * 2.55,
+                    None => part.parse::<f32>().ok()?,
+                };
+                Some(channel.round().clamp(0.0, 255.0) as u32)
+            })
+            .collect::<Option<_>>()?;
+        if channels.len() != 3 {
+            return None;
+        }
+        return Some(channels[0] << 16 | channels[1] << 8 | channels[2]);
+    }
+
+    Some(match value {
+        "black" => 0x000000,
+        "white" => 0xffffff,
+        "red" => 0xff0000,
+        "green" => 0x008000,
+        "blue" => 0x0000ff,
+        "yellow" => 0xffff00,
+        "orange" => 0xffa500,
+        "purple" => 0x800080,
+        "gray" | "grey" => 0x808080,
+        "darkgray" | "darkgrey" => 0xa9a9a9,
+        "lightgray" | "lightgrey" => 0xd3d3d3,
+        "dimgray" | "dimgrey" => 0x696969,
+        "silver" => 0xc0c0c0,
+        "maroon" => 0x800000,
+        "navy" => 0x000080,
+        "teal" => 0x008080,
+        "olive" => 0x808000,
+        "lime" => 0x00ff00,
+        "aqua" | "cyan" => 0x00ffff,
+        "fuchsia" | "magenta" => 0xff00ff,
+        "brown" => 0xa52a2a,
+        "darkred" => 0x8b0000,
+        "darkgreen" => 0x006400,
+        "darkblue" => 0x00008b,
+        "steelblue" => 0x4682b4,
+        "crimson" => 0xdc143c,
+        "gold" => 0xffd700,
+        "pink" => 0xffc0cb,
+        "indigo" => 0x4b0082,
+        "violet" => 0xee82ee,
+        "tomato" => 0xff6347,
+        "coral" => 0xff7f50,
+        "salmon" => 0xfa8072,
+        "slategray" | "slategrey" => 0x708090,
+        "whitesmoke" => 0xf5f5f5,
+        "gainsboro" => 0xdcdcdc,
+        _ => return None,
+    })
+}
@@ -1,89 +1,444 @@
-
 use std::collections::HashMap;
 use serde::{Serialize, Deserialize};
 use std::error::Error;
 
+use crate::css_selector::{parse_selector, parse_selector_list, split_top_level, to_css, Selector};
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct CssRule {
     pub selector: String,
     pub properties: HashMap<String, String>,
 }
 
+#[derive(Debug, Clone)]
+pub struct Declaration {
+    pub name: Box<str>,
+    pub value: Box<str>,
+    pub important: bool,
+}
+
+#[derive(Debug, Clone)]
+pub struct StyleRule {
+    pub selectors: Vec<Selector>,
+    pub selector_text: Box<str>,
+    pub declarations: Vec<Declaration>,
+}
+
+// Разобранная таблица стилей: правила в порядке исходного текста
+#[derive(Debug, Default)]
+pub struct Stylesheet {
+    pub rules: Vec<StyleRule>,
+}
+
+impl Stylesheet {
+    pub fn parse(css: &str) -> Self {
+        let mut sheet = Self::default();
+        sheet.append(css);
+        sheet
+    }
+
+    // Добавляет правила следующей таблицы (например, очередного <style>)
+    pub fn append(&mut self, css: &str) {
+        let mut scanner = Scanner { input: css.as_bytes(), text: css, pos: 0 };
+        scanner.parse_rule_list(&mut self.rules, false);
+    }
+}
+
+// Разбор на уровне токенов: комментарии, строки и вложенные скобки
+// учитываются, поэтому правило можно записывать в одну строку или разбивать
+// как угодно. Ошибочное правило пропускается целиком, как требует CSS.
+struct Scanner<'a> {
+    input: &'a [u8],
+    text: &'a str,
+    pos: usize,
+}
+
+impl<'a> Scanner<'a> {
+    fn peek(&self) -> Option<u8> {
+        self.input.get(self.pos).copied()
+    }
+
+    fn skip_whitespace_and_comments(&mut self) {
+        loop {
+            while self.peek().map_or(false, |byte| byte.is_ascii_whitespace()) {
+                self.pos += 1;
+            }
+            if self.input[self.pos..].starts_with(b"/*") {
+                self.pos = match self.text[self.pos + 2..].find("*/") {
+                    Some(end) => self.pos + 2 + end + 2,
+                    None => self.input.len(),
+                };
+            } else if self.input[self.pos..].starts_with(b"<!--") {
+                self.pos += 4;
+            } else if self.input[self.pos..].starts_with(b"-->") {
+                self.pos += 3;
+            } else {
+                return;
+            }
+        }
+    }
+
+    fn skip_string(&mut self, quote: u8) {
+        self.pos += 1;
+        while let Some(byte) = self.peek() {
+            self.pos += 1;
+            if byte == b'\\' {
+                self.pos += 1;
+            } else if byte == quote || byte == b'\n' {
+                break;
+            }
+        }
+        self.pos = self.pos.min(self.input.len());
+    }
+
+    // Текст до одного из стоп-символов на нулевой глубине скобок, без комментариев
+    fn read_until(&mut self, stops: &[u8]) -> String {
+        let mut out = String::new();
+        let mut start = self.pos;
+        let mut depth = 0i32;
+        while let Some(byte) = self.peek() {
+            match byte {
+                b'"' | b'\'' => {
+                    self.skip_string(byte);
+                    continue;
+                }
+                b'/' if self.input.get(self.pos + 1) == Some(&b'*') => {
+                    out.push_str(&self.text[start..self.pos]);
+                    out.push(' ');
+                    self.skip_whitespace_and_comments();
+                    start = self.pos;
+                    continue;
+                }
+                b'\\' => {
+                    self.pos += 2;
+                    continue;
+                }
+                b'(' | b'[' => depth += 1,
+                b')' | b']' => depth -= 1,
+                _ if depth <= 0 && stops.contains(&byte) => break,
+                _ => {}
+            }
+            self.pos += 1;
+        }
+        self.pos = self.pos.min(self.input.len());
+        out.push_str(&self.text[start..self.pos]);
+        out
+    }
+
+    // Пропускает блок { ... } целиком; pos стоит на '{'
+    fn skip_block(&mut self) {
+        let mut depth = 0;
+        while let Some(byte) = self.peek() {
+            match byte {
+                b'"' | b'\'' => {
+                    self.skip_string(byte);
+                    continue;
+                }
+                b'{' => depth += 1,
+                b'}' => {
+                    depth -= 1;
+                    if depth == 0 {
+                        self.pos += 1;
+                        return;
+                    }
+                }
+                _ => {}
+            }
+            self.pos += 1;
+        }
+    }
+
+    fn parse_rule_list(&mut self, rules: &mut Vec<StyleRule>, nested: bool) {
+        loop {
+            self.skip_whitespace_and_comments();
+            match self.peek() {
+                None => return,
+                Some(b'}') => {
+                    self.pos += 1;
+                    if nested {
+                        return;
+                    }
+                }
+                Some(b'@') => self.parse_at_rule(rules),
+                Some(_) => self.parse_qualified_rule(rules),
+            }
+        }
+    }
+
+    fn parse_at_rule(&mut self, rules: &mut Vec<StyleRule>) {
+        self.pos += 1;
+        let start = self.pos;
+        while self.peek().map_or(false, |byte| byte.is_ascii_alphanumeric() || byte == b'-') {
+            self.pos += 1;
+        }
+        let name = self.text[start..self.pos].to_ascii_lowercase();
+        let prelude = self.read_until(b"{;");
+
+        if self.peek() != Some(b'{') {
+            // @import, @charset, @namespace: без блока
+            self.pos = (self.pos + 1).min(self.input.len());
+            return;
+        }
+
+        match name.as_str() {
+            // Условные группы: правила внутри действуют, если подходит условие
+            "media" if media_matches(&prelude) => {
+                self.pos += 1;
+                self.parse_rule_list(rules, true);
+            }
+            "supports" | "layer" | "document" | "-moz-document" | "container" => {
+                self.pos += 1;
+                self.parse_rule_list(rules, true);
+            }
+            // @font-face, @keyframes, @page и прочие к сопоставлению не относятся
+            _ => self.skip_block(),
+        }
+    }
+
+    fn parse_qualified_rule(&mut self, rules: &mut Vec<StyleRule>) {
+        let prelude = self.read_until(b"{;}");
+        if self.peek() != Some(b'{') {
+            // Мусор без блока: пропускаем до следующего разделителя
+            self.pos = (self.pos + 1).min(self.input.len());
+            return;
+        }
+        self.pos += 1;
+        let body = self.read_until(b"}{");
+        if self.peek() == Some(b'{') {
+            // Вложенные правила (CSS nesting) не поддерживаются: блок пропускается
+            self.skip_block();
+            self.read_until(b"}");
+        }
+        self.pos = (self.pos + 1).min(self.input.len());
+
+        let selector_text = prelude.trim();
+        let selectors = match parse_selector_list(selector_text) {
+            Some(selectors) => selectors,
+            None => return,
+        };
+        let declarations = parse_declarations(&body);
+        if declarations.is_empty() {
+            return;
+        }
+        rules.push(StyleRule {
+            selectors,
+            selector_text: selector_text.into(),
+            declarations,
+        });
+    }
+}
+
+// Статичная страница на экране: печать и явно неподходящие типы отсекаются,
+// условия по размерам считаются выполненными
+fn media_matches(prelude: &str) -> bool {
+    let query = prelude.trim().to_ascii_lowercase();
+    if query.is_empty() {
+        return true;
+    }
+    split_top_level(&query, b',').iter().any(|part| {
+        let part = part.trim();
+        let (negated, part) = match part.strip_prefix("not ") {
+            Some(rest) => (true, rest.trim()),
+            None => (false, part.strip_prefix("only ").unwrap_or(part).trim()),
+        };
+        let media_type = part.split_ascii_whitespace().next().unwrap_or("");
+        let matches = match media_type {
+            "print" | "speech" | "tty" | "tv" | "projection" | "handheld" | "braille" | "embossed" | "aural" => false,
+            _ => true,
+        };
+        matches != negated
+    })
+}
+
+// Объявления блока: name: value [!important]; ...
+pub fn parse_declarations(body: &str) -> Vec<Declaration> {
+    let mut declarations = Vec::new();
+    for part in split_top_level(body, b';') {
+        let colon = match part.find(':') {
+            Some(colon) => colon,
+            None => continue,
+        };
+        let name = part[..colon].trim();
+        let mut value = part[colon + 1..].trim();
+        if name.is_empty() || !name.bytes().all(|byte| byte.is_ascii_alphanumeric() || byte == b'-' || byte == b'_') {
+            continue;
+        }
+
+        let mut important = false;
+        if let Some(bang) = value.rfind('!') {
+            if value[bang + 1..].trim().eq_ignore_ascii_case("important") {
+                important = true;
+                value = value[..bang].trim_end();
+            }
+        }
+        if value.is_empty() {
+            continue;
+        }
+
+        // Пользовательские свойства (--x) чувствительны к регистру
+        let name = if name.starts_with("--") { name.to_string() } else { name.to_ascii_lowercase() };
+        declarations.push(Declaration {
+            name: name.into(),
+            value: value.into(),
+            important,
+        });
+    }
+    declarations
+}
+
+// Каноническая запись селектора, по которой ищутся правила
+fn normalize_selector(selector: &str) -> String {
+    match parse_selector(selector.trim()) {
+        Some(parsed) => to_css(&parsed),
+        None => selector.trim().to_string(),
+    }
+}
+
 #[derive(Debug)]
 pub struct CssParser {
     rules: Vec<CssRule>,
+    stylesheet: Stylesheet,
+    // Каноническая запись каждого селектора списка -> правила, в порядке источника
+    by_selector: HashMap<String, Vec<usize>>,
 }
 
 impl CssParser {
     pub fn new() -> Self {
-        Self { rules: Vec::new() }
+        Self {
+            rules: Vec::new(),
+            stylesheet: Stylesheet::default(),
+            by_selector: HashMap::new(),
+        }
     }
 
     pub fn parse(&mut self, css: &str) -> Result<String, Box<dyn Error>> {
-        // Упрощенный CSS парсер
-        let lines: Vec<&str> = css.lines().collect();
-        let mut current_selector = String::new();
-        let mut current_properties = HashMap::new();
-        
-        for line in lines {
-            let line = line.trim();
-            
-            if line.is_empty() {
-                continue;
-            }
-            
-            // Если строка заканчивается на {, это селектор
-            if line.ends_with('{') {
-                if !current_selector.is_empty() && !current_properties.is_empty() {
-                    // Сохраняем предыдущее правило
-                    self.rules.push(CssRule {
-                        selector: current_selector.clone(),
-                        properties: current_properties.clone(),
-                    });
-                    current_properties.clear();
-                }
-                current_selector = line[..line.len()-1].trim().to_string();
+        let first_new = self.stylesheet.rules.len();
+        self.stylesheet.append(css);
+
+        for rule in &self.stylesheet.rules[first_new..] {
+            let index = self.rules.len();
+            for selector in &rule.selectors {
+                self.by_selector.entry(to_css(selector)).or_default().push(index);
             }
-            // Если строка содержит :, это свойство
-            else if line.contains(':') && !current_selector.is_empty() {
-                let parts: Vec<&str> = line.split(':').collect();
-                if parts.len() >= 2 {
-                    let property = parts[0].trim();
-                    let value = parts[1].trim().trim_end_matches(';');
-                    current_properties.insert(property.to_string(), value.to_string());
-                }
-            }
-            // Если строка заканчивается на }, закрываем правило
-            else if line.ends_with('}') && !current_selector.is_empty() {
-                if !current_properties.is_empty() {
-                    self.rules.push(CssRule {
-                        selector: current_selector.clone(),
-                        properties: current_properties.clone(),
-                    });
-                    current_properties.clear();
-                }
-                current_selector.clear();
+            // Как и в каскаде, из повторных объявлений действует последнее
+            let mut properties = HashMap::new();
+            for declaration in &rule.declarations {
+                properties.insert(declaration.name.to_string(), declaration.value.to_string());
             }
+            self.rules.push(CssRule {
+                selector: rule.selector_text.to_string(),
+                properties,
+            });
         }
-        
+
         // Сериализуем в JSON
         let json = serde_json::to_string(&self.rules)?;
         Ok(json)
     }
 
+    pub fn stylesheet(&self) -> &Stylesheet {
+        &self.stylesheet
+    }
+
+    // Правила, в списке селекторов которых есть данный селектор
     pub fn get_rules_for_selector(&self, selector: &str) -> Vec<&CssRule> {
-        self.rules
-            .iter()
-            .filter(|rule| rule.selector.contains(selector))
-            .collect()
+        self.by_selector
+            .get(&normalize_selector(selector))
+            .map(|indices| indices.iter().map(|&index| &self.rules[index]).collect())
+            .unwrap_or_default()
     }
 
+    // Значение свойства по каскаду: позднее правило перекрывает раннее
     pub fn get_property_value(&self, selector: &str, property: &str) -> Option<&String> {
-        for rule in &self.rules {
-            if rule.selector.contains(selector) {
-                return rule.properties.get(property);
-            }
-        }
-        None
+        let indices = self.by_selector.get(&normalize_selector(selector))?;
+        indices
+            .iter()
+            .rev()
+            .find_map(|&index| self.rules[index].properties.get(property))
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn selectors(sheet: &Stylesheet) -> Vec<&str> {
+        sheet.rules.iter().map(|rule| &*rule.selector_text).collect()
+    }
+
+    fn value<'a>(rule: &'a StyleRule, name: &str) -> Option<&'a str> {
+        rule.declarations.iter().rev().find(|d| &*d.name == name).map(|d| &*d.value)
+    }
+
+    #[test]
+    fn minified_rules() {
+        let sheet = Stylesheet::parse("a{color:red}b,i{margin:0;padding:1px!important}p>em{}u{x:y;;}");
+        assert_eq!(selectors(&sheet), ["a", "b,i", "u"]);
+        assert_eq!(value(&sheet.rules[0], "color"), Some("red"));
+        assert_eq!(sheet.rules[1].selectors.len(), 2);
+        let padding = &sheet.rules[1].declarations[1];
+        assert_eq!((&*padding.name, &*padding.value, padding.important), ("padding", "1px", true));
+        assert!(!sheet.rules[1].declarations[0].important);
+    }
+
+    #[test]
+    fn comments_are_skipped_everywhere() {
+        let css = "/* a { color: red } */ p /* между */ , i { color: /* внутри */ blue; /* ; */ margin: 0 }\n\
+                   <!-- em { color: green } -->\n\
+                   b { color: black } /* не закрыт";
+        let sheet = Stylesheet::parse(css);
+        assert_eq!(selectors(&sheet), ["p  , i", "em", "b"]);
+        assert_eq!(value(&sheet.rules[0], "color"), Some("blue"));
+        assert_eq!(value(&sheet.rules[0], "margin"), Some("0"));
+        assert_eq!(value(&sheet.rules[1], "color"), Some("green"));
+    }
+
+    #[test]
+    fn strings_hide_delimiters() {
+        let css = r#"a::after{content:"}{;/* */"}[title='x,}y']{color:red}q{quotes:'\'' "\""}b{color:blue}"#;
+        let sheet = Stylesheet::parse(css);
+        assert_eq!(selectors(&sheet), ["a::after", "[title='x,}y']", "q", "b"]);
+        assert_eq!(value(&sheet.rules[0], "content"), Some(r#""}{;/* */""#));
+        assert_eq!(sheet.rules[1].selectors.len(), 1);
+        assert_eq!(value(&sheet.rules[2], "quotes"), Some(r#"'\'' "\"""#));
+    }
+
+    #[test]
+    fn invalid_rules_are_dropped_whole() {
+        let css = "p{color:red} %%%{color:blue} div{margin:0} a{color:red;&:hover{color:blue}} i{color:green}\
+                   u{b@d:x;-ok:y;--Custom:Z;COLOR:Red} garbage; s{color:gray}";
+        let sheet = Stylesheet::parse(css);
+        assert_eq!(selectors(&sheet), ["p", "div", "a", "i", "u", "s"]);
+        assert_eq!(sheet.rules[2].declarations.len(), 1);
+        let names: Vec<&str> = sheet.rules[4].declarations.iter().map(|d| &*d.name).collect();
+        assert_eq!(names, ["-ok", "--Custom", "color"]);
+    }
+
+    #[test]
+    fn media_queries() {
+        let css = "@media print{p{color:red}}\
+                   @media screen and (min-width: 10px){p{color:blue}}\
+                   @media not print{i{x:y}}\
+                   @media only screen, print{b{x:y}}\
+                   @media tv, PRINT{s{x:y}}\
+                   @media{u{x:y}}\
+                   @supports (display: grid){@media not screen{q{x:y}}em{x:y}}\
+                   @font-face{font-family:x;src:url(a{b}.woff)}\
+                   @keyframes k{from{x:y}to{x:z}}\
+                   @import url(x.css);@charset \"utf-8\";\
+                   a{x:y}";
+        let sheet = Stylesheet::parse(css);
+        assert_eq!(selectors(&sheet), ["p", "i", "b", "u", "em", "a"]);
+        assert_eq!(value(&sheet.rules[0], "color"), Some("blue"));
+    }
+
+    #[test]
+    fn lookup_by_canonical_selector() {
+        let mut parser = CssParser::new();
+        parser.parse("ul  >  li{color:red} h1,UL>LI{color:blue;margin:0}").unwrap();
+        assert_eq!(parser.get_property_value("ul > li", "color").map(String::as_str), Some("blue"));
+        assert_eq!(parser.get_property_value("ul>li", "margin").map(String::as_str), Some("0"));
+        assert_eq!(parser.get_rules_for_selector("h1").len(), 1);
+        assert!(parser.get_property_value("ul li", "color").is_none());
     }
 }
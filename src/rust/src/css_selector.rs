@@ -0,0 +1,819 @@
+use std::fmt;
+
+use cssparser::{CowRcStr, ParseError, ParserInput, SourceLocation, ToCss};
+use precomputed_hash::PrecomputedHash;
+use selectors::attr::{AttrSelectorOperation, CaseSensitivity, NamespaceConstraint};
+use selectors::bloom::BloomFilter;
+use selectors::matching::{
+    self, ElementSelectorFlags, IgnoreNthChildForInvalidation, MatchingContext, MatchingMode, NeedsSelectorFlags,
+    QuirksMode,
+};
+use selectors::parser::{AncestorHashes, Component, ParseRelative, SelectorParseErrorKind};
+use selectors::{Element, NthIndexCache, OpaqueElement, SelectorList};
+
+use crate::dom::{Document, Node, NodeKind, NO_NODE};
+
+// Селекторы CSS: разбор и сопоставление - крейт selectors (тот же код, что в
+// Servo), здесь - его привязка к индексному DOM, хэши для фильтра Блума по
+// предкам и ключи корзин индекса правил (style.rs).
+
+pub type Selector = selectors::parser::Selector<HtmlSelectors>;
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct HtmlSelectors;
+
+impl selectors::SelectorImpl for HtmlSelectors {
+    type ExtraMatchingData<'a> = ();
+    type AttrValue = CssString;
+    type Identifier = CssIdent;
+    type LocalName = CssLocalName;
+    type NamespaceUrl = CssString;
+    type NamespacePrefix = CssIdent;
+    type BorrowedNamespaceUrl = CssString;
+    type BorrowedLocalName = CssLocalName;
+    type NonTSPseudoClass = PseudoClass;
+    type PseudoElement = PseudoElement;
+}
+
+// FNV-1a: ключи короткие, а хэш нужен одинаковый для селектора и элемента
+pub fn hash_str(s: &str) -> u32 {
+    let mut hash: u32 = 0x811c_9dc5;
+    for byte in s.bytes() {
+        hash ^= byte as u32;
+        hash = hash.wrapping_mul(0x0100_0193);
+    }
+    // 0 зарезервирован под пустой слот
+    hash | 1
+}
+
+// Значение атрибута или URL пространства имен
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct CssString(Box<str>);
+
+impl From<&str> for CssString {
+    fn from(value: &str) -> Self {
+        Self(value.into())
+    }
+}
+
+impl AsRef<str> for CssString {
+    fn as_ref(&self) -> &str {
+        &self.0
+    }
+}
+
+impl ToCss for CssString {
+    fn to_css<W: fmt::Write>(&self, dest: &mut W) -> fmt::Result {
+        cssparser::serialize_string(&self.0, dest)
+    }
+}
+
+impl PrecomputedHash for CssString {
+    fn precomputed_hash(&self) -> u32 {
+        hash_str(&self.0)
+    }
+}
+
+// id и класс: сравниваются с учетом регистра
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct CssIdent(Box<str>);
+
+impl From<&str> for CssIdent {
+    fn from(value: &str) -> Self {
+        Self(value.into())
+    }
+}
+
+impl ToCss for CssIdent {
+    fn to_css<W: fmt::Write>(&self, dest: &mut W) -> fmt::Result {
+        cssparser::serialize_identifier(&self.0, dest)
+    }
+}
+
+impl PrecomputedHash for CssIdent {
+    fn precomputed_hash(&self) -> u32 {
+        hash_str(&self.0)
+    }
+}
+
+// Имя тега или атрибута. В HTML регистр не важен, поэтому каноническая
+// запись (ключ CssParser::get_rules_for_selector) - строчными
+#[derive(Debug, Clone, Default, PartialEq, Eq)]
+pub struct CssLocalName(Box<str>);
+
+impl From<&str> for CssLocalName {
+    fn from(value: &str) -> Self {
+        Self(value.into())
+    }
+}
+
+impl ToCss for CssLocalName {
+    fn to_css<W: fmt::Write>(&self, dest: &mut W) -> fmt::Result {
+        cssparser::serialize_identifier(&self.0.to_ascii_lowercase(), dest)
+    }
+}
+
+impl PrecomputedHash for CssLocalName {
+    fn precomputed_hash(&self) -> u32 {
+        hash_str(&self.0)
+    }
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum PseudoClass {
+    Link,
+    AnyLink,
+    // Динамические состояния (:hover, :focus...): статичная страница в них
+    // никогда не находится
+    State(Box<str>),
+}
+
+impl selectors::parser::NonTSPseudoClass for PseudoClass {
+    type Impl = HtmlSelectors;
+
+    fn is_active_or_hover(&self) -> bool {
+        matches!(self, PseudoClass::State(name) if matches!(&**name, "active" | "hover"))
+    }
+
+    fn is_user_action_state(&self) -> bool {
+        matches!(self, PseudoClass::State(name) if matches!(&**name, "active" | "hover" | "focus"))
+    }
+}
+
+impl ToCss for PseudoClass {
+    fn to_css<W: fmt::Write>(&self, dest: &mut W) -> fmt::Result {
+        match self {
+            PseudoClass::Link => dest.write_str(":link"),
+            PseudoClass::AnyLink => dest.write_str(":any-link"),
+            PseudoClass::State(name) => write!(dest, ":{}", name),
+        }
+    }
+}
+
+// Псевдоэлементы разбираются, чтобы правило не отбрасывалось целиком, но
+// ни с чем не совпадают
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct PseudoElement(Box<str>);
+
+impl selectors::parser::PseudoElement for PseudoElement {
+    type Impl = HtmlSelectors;
+}
+
+impl ToCss for PseudoElement {
+    fn to_css<W: fmt::Write>(&self, dest: &mut W) -> fmt::Result {
+        write!(dest, "::{}", self.0)
+    }
+}
+
+struct SelectorParser;
+
+impl<'i> selectors::Parser<'i> for SelectorParser {
+    type Impl = HtmlSelectors;
+    type Error = SelectorParseErrorKind<'i>;
+
+    fn parse_is_and_where(&self) -> bool {
+        true
+    }
+
+    fn parse_non_ts_pseudo_class(
+        &self,
+        location: SourceLocation,
+        name: CowRcStr<'i>,
+    ) -> Result<PseudoClass, ParseError<'i, Self::Error>> {
+        let lower = name.to_ascii_lowercase();
+        match lower.as_str() {
+            "link" => Ok(PseudoClass::Link),
+            "any-link" => Ok(PseudoClass::AnyLink),
+            "hover" | "active" | "focus" | "focus-within" | "focus-visible" | "visited" | "target" | "checked"
+            | "disabled" | "enabled" | "required" | "optional" | "invalid" | "valid" | "placeholder-shown"
+            | "read-only" | "read-write" | "indeterminate" | "default" => Ok(PseudoClass::State(lower.into())),
+            _ => Err(location.new_custom_error(SelectorParseErrorKind::UnsupportedPseudoClassOrElement(name))),
+        }
+    }
+
+    fn parse_pseudo_element(
+        &self,
+        location: SourceLocation,
+        name: CowRcStr<'i>,
+    ) -> Result<PseudoElement, ParseError<'i, Self::Error>> {
+        let lower = name.to_ascii_lowercase();
+        match lower.as_str() {
+            "before" | "after" | "first-line" | "first-letter" | "marker" | "placeholder" | "selection"
+            | "backdrop" => Ok(PseudoElement(lower.into())),
+            _ => Err(location.new_custom_error(SelectorParseErrorKind::UnsupportedPseudoClassOrElement(name))),
+        }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Разбор
+
+// None, если хоть один селектор списка ошибочен: по CSS такое правило
+// отбрасывается целиком
+pub fn parse_selector_list(input: &str) -> Option<Vec<Selector>> {
+    let mut input = ParserInput::new(input);
+    let mut parser = cssparser::Parser::new(&mut input);
+    let list = SelectorList::parse(&SelectorParser, &mut parser, ParseRelative::No).ok()?;
+    Some(list.0.into_iter().collect())
+}
+
+pub fn parse_selector(input: &str) -> Option<Selector> {
+    let mut selectors = parse_selector_list(input)?;
+    if selectors.len() == 1 {
+        selectors.pop()
+    } else {
+        None
+    }
+}
+
+// Каноническая запись: одинаковые селекторы записываются одинаково
+pub fn to_css(selector: &Selector) -> String {
+    selector.to_css_string()
+}
+
+// Делит по разделителю вне скобок и строк
+pub fn split_top_level(input: &str, separator: u8) -> Vec<&str> {
+    let bytes = input.as_bytes();
+    let mut parts = Vec::new();
+    let mut depth = 0i32;
+    let mut quote = 0u8;
+    let mut start = 0;
+    let mut i = 0;
+    while i < bytes.len() {
+        let byte = bytes[i];
+        if quote != 0 {
+            if byte == b'\\' {
+                i += 1;
+            } else if byte == quote {
+                quote = 0;
+            }
+        } else {
+            match byte {
+                b'"' | b'\'' => quote = byte,
+                b'(' | b'[' => depth += 1,
+                b')' | b']' => depth -= 1,
+                b'\\' => i += 1,
+                _ if byte == separator && depth == 0 => {
+                    parts.push(&input[start..i]);
+                    start = i + 1;
+                }
+                _ => {}
+            }
+        }
+        i += 1;
+    }
+    parts.push(&input[start..]);
+    parts
+}
+
+// Корзина индекса правил: самый правый id, иначе класс, иначе тег субъекта
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub enum SubjectKey {
+    Id(Box<str>),
+    Class(Box<str>),
+    Tag(Box<str>),
+    Universal,
+}
+
+pub fn subject_key(selector: &Selector) -> SubjectKey {
+    let mut class = None;
+    let mut tag = None;
+    // iter() проходит только составной селектор субъекта
+    for component in selector.iter() {
+        match component {
+            Component::ID(id) => return SubjectKey::Id(id.0.clone()),
+            Component::Class(name) if class.is_none() => class = Some(name.0.clone()),
+            Component::LocalName(name) => tag = Some(name.lower_name.0.clone()),
+            _ => {}
+        }
+    }
+    match (class, tag) {
+        (Some(class), _) => SubjectKey::Class(class),
+        (None, Some(tag)) => SubjectKey::Tag(tag),
+        (None, None) => SubjectKey::Universal,
+    }
+}
+
+// Хэши id, классов и тегов предков субъекта для проверки по фильтру Блума.
+// Селекторы, достижимые через + и ~, сюда не попадают: это соседи, а не предки
+pub fn ancestor_hashes(selector: &Selector) -> AncestorHashes {
+    AncestorHashes::new(selector, QuirksMode::NoQuirks)
+}
+
+// ---------------------------------------------------------------------------
+// Сопоставление
+
+// Сведения об элементе, нужные сопоставлению: id и классы достаются из
+// атрибутов один раз на элемент, а не на каждое проверяемое правило
+#[derive(Debug, Clone, Copy)]
+pub struct ElementInfo<'a> {
+    pub index: u32,
+    pub id: Option<&'a str>,
+    pub class: &'a str,
+}
+
+impl<'a> ElementInfo<'a> {
+    pub fn new(document: &'a Document, index: u32) -> Self {
+        let node = &document.nodes[index as usize];
+        let mut id = None;
+        let mut class = "";
+        for attr in document.node_attrs(node) {
+            match &*attr.name {
+                "id" => id = Some(document.text(attr.value)),
+                "class" => class = document.text(attr.value),
+                _ => {}
+            }
+        }
+        Self { index, id, class }
+    }
+
+    pub fn classes(&self) -> impl Iterator<Item = &'a str> {
+        self.class.split_ascii_whitespace()
+    }
+
+    pub fn has_class(&self, name: &str) -> bool {
+        self.classes().any(|class| class == name)
+    }
+}
+
+// Счетный фильтр Блума по предкам текущего элемента. Ложные срабатывания
+// допустимы (дальше идет полная проверка), ложных отказов не бывает.
+pub struct AncestorFilter {
+    bloom: Box<BloomFilter>,
+}
+
+impl Default for AncestorFilter {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl AncestorFilter {
+    pub fn new() -> Self {
+        Self {
+            bloom: Box::new(BloomFilter::new()),
+        }
+    }
+
+    pub fn might_match(&self, hashes: &AncestorHashes) -> bool {
+        matching::selector_may_match(hashes, &self.bloom)
+    }
+
+    // Элемент становится предком для своих потомков
+    pub fn push(&mut self, document: &Document, info: &ElementInfo) {
+        self.for_each_hash(document, info, |bloom, hash| bloom.insert_hash(hash));
+    }
+
+    pub fn pop(&mut self, document: &Document, info: &ElementInfo) {
+        self.for_each_hash(document, info, |bloom, hash| bloom.remove_hash(hash));
+    }
+
+    // Те же хэши, что PrecomputedHash дает тегу, id и классу в селекторе
+    fn for_each_hash(&mut self, document: &Document, info: &ElementInfo, mut f: impl FnMut(&mut BloomFilter, u32)) {
+        f(&mut self.bloom, hash_str(&document.nodes[info.index as usize].tag));
+        if let Some(id) = info.id {
+            f(&mut self.bloom, hash_str(id));
+        }
+        for class in info.classes() {
+            f(&mut self.bloom, hash_str(class));
+        }
+    }
+}
+
+// nth_cache - позиции среди соседей для :nth-child; годится, пока документ
+// не меняется, поэтому заводится на весь обход
+pub fn matches(selector: &Selector, document: &Document, element: &ElementInfo, nth_cache: &mut NthIndexCache) -> bool {
+    let mut context = MatchingContext::new(
+        MatchingMode::Normal,
+        None,
+        nth_cache,
+        QuirksMode::NoQuirks,
+        NeedsSelectorFlags::No,
+        IgnoreNthChildForInvalidation::No,
+    );
+    let element = DomElement { document, index: element.index };
+    matching::matches_selector(selector, 0, None, &element, &mut context)
+}
+
+fn parent_element(document: &Document, index: u32) -> u32 {
+    let parent = document.nodes[index as usize].parent;
+    if parent != NO_NODE && document.nodes[parent as usize].kind == NodeKind::Element {
+        parent
+    } else {
+        NO_NODE
+    }
+}
+
+fn previous_element_sibling(document: &Document, index: u32) -> u32 {
+    let mut previous = document.nodes[index as usize].previous_sibling;
+    while previous != NO_NODE && document.nodes[previous as usize].kind != NodeKind::Element {
+        previous = document.nodes[previous as usize].previous_sibling;
+    }
+    previous
+}
+
+fn next_element_sibling(document: &Document, index: u32) -> u32 {
+    let mut next = document.nodes[index as usize].next_sibling;
+    while next != NO_NODE && document.nodes[next as usize].kind != NodeKind::Element {
+        next = document.nodes[next as usize].next_sibling;
+    }
+    next
+}
+
+const HTML_NAMESPACE: &str = "http://www.w3.org/1999/xhtml";
+
+// Элемент индексного DOM для selectors: пара документ + номер узла
+#[derive(Clone, Copy)]
+struct DomElement<'a> {
+    document: &'a Document,
+    index: u32,
+}
+
+impl<'a> DomElement<'a> {
+    fn node(&self) -> &'a Node {
+        &self.document.nodes[self.index as usize]
+    }
+
+    fn at(&self, index: u32) -> Option<Self> {
+        (index != NO_NODE).then_some(Self { document: self.document, index })
+    }
+
+    fn attribute(&self, name: &str) -> Option<&'a str> {
+        self.document.attribute(self.index, name)
+    }
+}
+
+impl fmt::Debug for DomElement<'_> {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "<{}> #{}", &*self.node().tag, self.index)
+    }
+}
+
+impl<'a> Element for DomElement<'a> {
+    type Impl = HtmlSelectors;
+
+    fn opaque(&self) -> OpaqueElement {
+        OpaqueElement::new(self.node())
+    }
+
+    fn parent_element(&self) -> Option<Self> {
+        self.at(parent_element(self.document, self.index))
+    }
+
+    fn parent_node_is_shadow_root(&self) -> bool {
+        false
+    }
+
+    fn containing_shadow_host(&self) -> Option<Self> {
+        None
+    }
+
+    fn is_pseudo_element(&self) -> bool {
+        false
+    }
+
+    fn prev_sibling_element(&self) -> Option<Self> {
+        self.at(previous_element_sibling(self.document, self.index))
+    }
+
+    fn next_sibling_element(&self) -> Option<Self> {
+        self.at(next_element_sibling(self.document, self.index))
+    }
+
+    fn first_element_child(&self) -> Option<Self> {
+        self.document
+            .children(self.index)
+            .find(|&child| self.document.nodes[child as usize].kind == NodeKind::Element)
+            .and_then(|child| self.at(child))
+    }
+
+    // Разбор идет без пространств имен: все элементы - HTML, имена тегов и
+    // атрибутов уже строчные
+    fn is_html_element_in_html_document(&self) -> bool {
+        true
+    }
+
+    fn has_local_name(&self, local_name: &CssLocalName) -> bool {
+        *self.node().tag == *local_name.0
+    }
+
+    fn has_namespace(&self, namespace: &CssString) -> bool {
+        &*namespace.0 == HTML_NAMESPACE
+    }
+
+    fn is_same_type(&self, other: &Self) -> bool {
+        self.node().tag == other.node().tag
+    }
+
+    fn attr_matches(
+        &self,
+        namespace: &NamespaceConstraint<&CssString>,
+        local_name: &CssLocalName,
+        operation: &AttrSelectorOperation<&CssString>,
+    ) -> bool {
+        // У атрибутов нет пространства имен
+        if let NamespaceConstraint::Specific(url) = namespace {
+            if !url.0.is_empty() {
+                return false;
+            }
+        }
+        self.attribute(&local_name.0).map_or(false, |value| operation.eval_str(value))
+    }
+
+    fn match_non_ts_pseudo_class(&self, pseudo: &PseudoClass, _context: &mut MatchingContext<HtmlSelectors>) -> bool {
+        match pseudo {
+            PseudoClass::Link | PseudoClass::AnyLink => self.is_link(),
+            PseudoClass::State(_) => false,
+        }
+    }
+
+    fn match_pseudo_element(&self, _pseudo: &PseudoElement, _context: &mut MatchingContext<HtmlSelectors>) -> bool {
+        false
+    }
+
+    fn apply_selector_flags(&self, _flags: ElementSelectorFlags) {}
+
+    fn is_link(&self) -> bool {
+        matches!(&*self.node().tag, "a" | "area") && self.attribute("href").is_some()
+    }
+
+    fn is_html_slot_element(&self) -> bool {
+        false
+    }
+
+    fn has_id(&self, id: &CssIdent, case_sensitivity: CaseSensitivity) -> bool {
+        self.attribute("id")
+            .map_or(false, |value| case_sensitivity.eq(value.as_bytes(), id.0.as_bytes()))
+    }
+
+    fn has_class(&self, name: &CssIdent, case_sensitivity: CaseSensitivity) -> bool {
+        self.attribute("class").map_or(false, |value| {
+            value
+                .split_ascii_whitespace()
+                .any(|class| case_sensitivity.eq(class.as_bytes(), name.0.as_bytes()))
+        })
+    }
+
+    fn imported_part(&self, _name: &CssIdent) -> Option<CssIdent> {
+        None
+    }
+
+    fn is_part(&self, _name: &CssIdent) -> bool {
+        false
+    }
+
+    // Пустой - без элементов и непустого текста среди детей
+    fn is_empty(&self) -> bool {
+        !self.document.children(self.index).any(|child| {
+            let node = &self.document.nodes[child as usize];
+            node.kind == NodeKind::Element || (node.kind == NodeKind::Text && !self.document.text(node.text).is_empty())
+        })
+    }
+
+    fn is_root(&self) -> bool {
+        let parent = self.node().parent;
+        parent != NO_NODE && self.document.nodes[parent as usize].kind == NodeKind::Document
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::tag_atoms::TagAtom;
+    use html5ever::LocalName;
+
+    fn add(document: &mut Document, parent: u32, tag: &str, attrs: &[(&str, &str)]) -> u32 {
+        let attrs = attrs.iter().map(|&(name, value)| (LocalName::from(name), value));
+        document.append_element(parent, LocalName::from(tag), TagAtom::from_name(tag), attrs)
+    }
+
+    // id всех элементов документа, с которыми совпадает селектор
+    fn select<'a>(document: &'a Document, selector: &str) -> Vec<&'a str> {
+        let selector = parse_selector(selector).unwrap_or_else(|| panic!("не разобран: {}", selector));
+        let mut nth_cache = NthIndexCache::default();
+        (0..document.len() as u32)
+            .filter(|&index| document.nodes[index as usize].kind == NodeKind::Element)
+            .filter(|&index| matches(&selector, document, &ElementInfo::new(document, index), &mut nth_cache))
+            .filter_map(|index| document.attribute(index, "id"))
+            .collect()
+    }
+
+    // html > body > (div#outer.box > (p#p1, span#s1, p#p2.note > em#deep), p#p3)
+    fn sample() -> Document {
+        let mut document = Document::new();
+        let html = add(&mut document, 0, "html", &[("id", "html")]);
+        let body = add(&mut document, html, "body", &[("id", "body")]);
+        let outer = add(&mut document, body, "div", &[("id", "outer"), ("class", "box wide")]);
+        add(&mut document, outer, "p", &[("id", "p1")]);
+        add(&mut document, outer, "span", &[("id", "s1")]);
+        let p2 = add(&mut document, outer, "p", &[("id", "p2"), ("class", "note")]);
+        add(&mut document, p2, "em", &[("id", "deep")]);
+        add(&mut document, body, "p", &[("id", "p3")]);
+        document
+    }
+
+    fn specificity(selector: &str) -> u32 {
+        parse_selector(selector).unwrap().specificity()
+    }
+
+    const ID: u32 = 1 << 20;
+    const CLASS: u32 = 1 << 10;
+    const TAG: u32 = 1;
+
+    #[test]
+    fn specificity_counts_ids_classes_and_tags() {
+        assert_eq!(specificity("*"), 0);
+        assert_eq!(specificity("div"), TAG);
+        assert_eq!(specificity(".a"), CLASS);
+        assert_eq!(specificity("#x"), ID);
+        assert_eq!(specificity("ul li > a"), 3 * TAG);
+        assert_eq!(specificity("div#x.a.b[href]:first-child"), ID + 4 * CLASS + TAG);
+        assert_eq!(specificity("#a #b .c"), 2 * ID + CLASS);
+        // :not() весит как самый специфичный аргумент, сам не считается
+        assert_eq!(specificity(":not(#x)"), ID);
+        assert_eq!(specificity("p:not(.a, div)"), TAG + CLASS);
+    }
+
+    #[test]
+    fn descendant_and_child_combinators() {
+        let document = sample();
+        assert_eq!(select(&document, "div p"), ["p1", "p2"]);
+        assert_eq!(select(&document, "body p"), ["p1", "p2", "p3"]);
+        assert_eq!(select(&document, "body > p"), ["p3"]);
+        assert_eq!(select(&document, "div em"), ["deep"]);
+        assert!(select(&document, "div > em").is_empty());
+        assert_eq!(select(&document, "html > body > div.box > p.note > em"), ["deep"]);
+        // Первый подходящий предок не годится, нужен возврат к следующему
+        assert_eq!(select(&document, "body > * em"), ["deep"]);
+    }
+
+    #[test]
+    fn sibling_combinators() {
+        let document = sample();
+        assert_eq!(select(&document, "p + span"), ["s1"]);
+        assert_eq!(select(&document, "span + p"), ["p2"]);
+        assert!(select(&document, "p + p").is_empty());
+        assert_eq!(select(&document, "p ~ p"), ["p2"]);
+        assert_eq!(select(&document, "div ~ p"), ["p3"]);
+        assert_eq!(select(&document, "p ~ .note > em"), ["deep"]);
+    }
+
+    #[test]
+    fn attribute_operators() {
+        let mut document = Document::new();
+        add(&mut document, 0, "a", &[
+            ("id", "link"),
+            ("href", "https://example.com/page.html"),
+            ("lang", "en-US"),
+            ("rel", "nofollow external"),
+            ("data-k", "Value"),
+        ]);
+        let hit = |selector: &str| select(&document, selector) == ["link"];
+
+        assert!(hit("[href]"));
+        assert!(!hit("[title]"));
+        assert!(hit("a[href='https://example.com/page.html']"));
+        assert!(!hit("[href=https]"));
+        assert!(hit("[rel~=external]"));
+        assert!(!hit("[rel~='nofollow external']"));
+        assert!(!hit("[rel~=extern]"));
+        assert!(hit("[lang|=en]"));
+        assert!(hit("[lang|=en-US]"));
+        assert!(!hit("[lang|=e]"));
+        assert!(hit("[href^=https]"));
+        assert!(hit("[href$=\".html\"]"));
+        assert!(hit("[href*=example]"));
+        // Пустое значение у ^= $= *= не совпадает ни с чем
+        assert!(!hit("[href^='']"));
+        assert!(!hit("[href*='']"));
+        assert!(hit("[data-k=value i]"));
+        assert!(hit("[ DATA-K = 'VALUE' i ]"));
+        assert!(!hit("[data-k=value]"));
+        assert!(!hit("[data-k=value s]"));
+
+        assert!(parse_selector("[href=]").is_none());
+        assert!(parse_selector("[href!=x]").is_none());
+    }
+
+    #[test]
+    fn nth_child_and_structural_pseudo_classes() {
+        let mut document = Document::new();
+        let list = add(&mut document, 0, "ul", &[("id", "list")]);
+        for id in ["l1", "l2", "l3", "l4", "l5", "l6"] {
+            add(&mut document, list, "li", &[("id", id)]);
+        }
+
+        assert_eq!(select(&document, "li:nth-child(odd)"), ["l1", "l3", "l5"]);
+        assert_eq!(select(&document, "li:nth-child(even)"), ["l2", "l4", "l6"]);
+        assert_eq!(select(&document, "li:nth-child(2n + 1)"), ["l1", "l3", "l5"]);
+        assert_eq!(select(&document, "li:nth-child(3)"), ["l3"]);
+        assert_eq!(select(&document, "li:nth-child(3n+1)"), ["l1", "l4"]);
+        assert_eq!(select(&document, "li:nth-child(-n+2)"), ["l1", "l2"]);
+        assert_eq!(select(&document, "li:nth-child(n+5)"), ["l5", "l6"]);
+        assert_eq!(select(&document, "li:NTH-CHILD(N)").len(), 6);
+        assert!(parse_selector("li:nth-child(foo)").is_none());
+
+        assert_eq!(select(&document, "li:first-child"), ["l1"]);
+        assert_eq!(select(&document, "li:last-child"), ["l6"]);
+        assert_eq!(select(&document, ":root"), ["list"]);
+        assert!(select(&document, "li:only-child").is_empty());
+        assert!(select(&document, "li:hover").is_empty());
+    }
+
+    #[test]
+    fn not_pseudo_class() {
+        let mut document = Document::new();
+        let list = add(&mut document, 0, "ul", &[]);
+        add(&mut document, list, "li", &[("id", "l1"), ("class", "skip")]);
+        add(&mut document, list, "li", &[("id", "l2")]);
+        add(&mut document, list, "li", &[("id", "l3")]);
+
+        assert_eq!(select(&document, "li:not(.skip)"), ["l2", "l3"]);
+        assert_eq!(select(&document, "li:not(:first-child)"), ["l2", "l3"]);
+        assert_eq!(select(&document, "li:not(#l2, .skip)"), ["l3"]);
+        assert_eq!(select(&document, "li:not([id$='3'])"), ["l1", "l2"]);
+        // Selectors 4: в :not() - полный селектор с комбинаторами
+        assert!(select(&document, "li:not(ul > li)").is_empty());
+        assert_eq!(select(&document, "li:not(ol li)"), ["l1", "l2", "l3"]);
+    }
+
+    // Фильтр с элементом index и всеми его предками, как при обходе дерева
+    fn filter_for(document: &Document, index: u32) -> AncestorFilter {
+        let mut chain = Vec::new();
+        let mut ancestor = parent_element(document, index);
+        while ancestor != NO_NODE {
+            chain.push(ancestor);
+            ancestor = parent_element(document, ancestor);
+        }
+        let mut filter = AncestorFilter::new();
+        for &ancestor in chain.iter().rev() {
+            filter.push(document, &ElementInfo::new(document, ancestor));
+        }
+        filter
+    }
+
+    #[test]
+    fn ancestor_filter_rejects_missing_ancestors() {
+        let document = sample();
+        let deep = (0..document.len() as u32).find(|&i| document.attribute(i, "id") == Some("deep")).unwrap();
+        let mut filter = filter_for(&document, deep);
+
+        let hashes = |selector: &str| ancestor_hashes(&parse_selector(selector).unwrap());
+        assert!(filter.might_match(&hashes("div.box p em")));
+        assert!(filter.might_match(&hashes("#outer > .note em")));
+        assert!(!filter.might_match(&hashes("section em")));
+        assert!(!filter.might_match(&hashes(".missing em")));
+        assert!(!filter.might_match(&hashes("#p1 em")));
+        // Соседи предками не считаются: h1 и .a нет среди предков, но
+        // селекторы отсекать нельзя
+        assert!(AncestorFilter::new().might_match(&hashes("h1 + em")));
+        assert!(filter.might_match(&hashes("h1 + em")));
+        assert!(filter.might_match(&hashes("h1 + p em")));
+        assert!(filter.might_match(&hashes(".a + div ~ p em")));
+        assert!(filter.might_match(&hashes("span + p em")));
+        assert!(filter.might_match(&hashes("#p1 ~ .note > em")));
+
+        // Снятый со стека предок больше не находится
+        let p2 = document.nodes[deep as usize].parent;
+        filter.pop(&document, &ElementInfo::new(&document, p2));
+        assert!(!filter.might_match(&hashes(".note em")));
+        assert!(filter.might_match(&hashes(".box em")));
+    }
+
+    #[test]
+    fn ancestor_filter_never_rejects_a_match() {
+        let document = sample();
+        let selectors = ["div p", "body > p", "div em", "html body div.box p.note em", "#outer span", "p ~ p",
+                         ".wide > p + span", "body div p:not(.x)", "span + p em", "p ~ .note em",
+                         "#p1 + span ~ p > em", "body > div + p", "html div + p", "span + .note > em"];
+        for selector in selectors {
+            let parsed = parse_selector(selector).unwrap();
+            let hashes = ancestor_hashes(&parsed);
+            let mut nth_cache = NthIndexCache::default();
+            for index in 1..document.len() as u32 {
+                let info = ElementInfo::new(&document, index);
+                if matches(&parsed, &document, &info, &mut nth_cache) {
+                    assert!(filter_for(&document, index).might_match(&hashes), "{}", selector);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn selector_lists_split_outside_strings_and_brackets() {
+        assert_eq!(parse_selector_list("a, b > i,[title='x,y']").unwrap().len(), 3);
+        assert_eq!(parse_selector_list("li:not(.a, .b)").unwrap().len(), 1);
+        assert!(parse_selector_list("a, , b").is_none());
+        assert_eq!(to_css(&parse_selector("UL>LI.x").unwrap()), "ul > li.x");
+    }
+
+    #[test]
+    fn subject_key_prefers_id_then_class_then_tag() {
+        let key = |selector: &str| subject_key(&parse_selector(selector).unwrap());
+        assert_eq!(key("div .a p#x.b"), SubjectKey::Id("x".into()));
+        assert_eq!(key("#x p.b.c"), SubjectKey::Class("b".into()));
+        assert_eq!(key(".a > LI"), SubjectKey::Tag("li".into()));
+        assert_eq!(key("p *"), SubjectKey::Universal);
+        assert_eq!(key("[href]"), SubjectKey::Universal);
+    }
+}
@@ -0,0 +1,299 @@
+use std::collections::HashMap;
+
+use html5ever::LocalName;
+
+use crate::tag_atoms::TagAtom;
+
+// Индексный DOM: все узлы лежат в одном Vec, связи - u32 индексы,
+// весь текст и значения атрибутов - в общем пуле строк.
+
+pub const NO_NODE: u32 = u32::MAX;
+
+// Пробельные символы HTML (без неразрывного пробела и прочих Unicode-пробелов)
+pub fn is_html_space(c: char) -> bool {
+    matches!(c, ' ' | '\t' | '\n' | '\r' | '\x0c')
+}
+
+// Строки короче этого порога дедуплицируются (классы, id, короткие подписи)
+const INTERN_MAX_LEN: usize = 64;
+
+#[repr(u32)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum NodeKind {
+    Document = 0,
+    Element = 1,
+    Text = 2,
+}
+
+// Диапазон строки в пуле; за строкой в пуле всегда следует '\0'
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct TextRange {
+    pub start: u32,
+    pub len: u32,
+}
+
+#[derive(Debug, Clone)]
+pub struct Node {
+    pub kind: NodeKind,
+    pub tag: LocalName,
+    // Известный тег как число: по нему идет разбор и отрисовка без сравнения строк
+    pub atom: TagAtom,
+    pub parent: u32,
+    pub first_child: u32,
+    pub last_child: u32,
+    pub next_sibling: u32,
+    // Обратная связь для селекторов соседей (+, ~, :nth-child)
+    pub previous_sibling: u32,
+    // Для текстового узла - его содержимое, для элемента - первый прямой текст
+    pub text: TextRange,
+    pub first_attr: u32,
+    pub attr_count: u32,
+}
+
+#[derive(Debug, Clone)]
+pub struct Attr {
+    pub name: LocalName,
+    pub value: TextRange,
+}
+
+// Пул начинается с '\0', поэтому пустой TextRange::default() - валидная C-строка
+#[derive(Debug)]
+pub struct StringPool {
+    data: Vec<u8>,
+    interned: HashMap<Box<str>, TextRange>,
+}
+
+impl Default for StringPool {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl StringPool {
+    pub fn new() -> Self {
+        Self::with_capacity(0)
+    }
+
+    pub fn with_capacity(capacity: usize) -> Self {
+        let mut data = Vec::with_capacity(capacity + 1);
+        data.push(0);
+        Self {
+            data,
+            interned: HashMap::new(),
+        }
+    }
+
+    pub fn intern(&mut self, s: &str) -> TextRange {
+        if s.len() > INTERN_MAX_LEN {
+            return self.append(s);
+        }
+        if let Some(range) = self.interned.get(s) {
+            return *range;
+        }
+        let range = self.append(s);
+        self.interned.insert(s.into(), range);
+        range
+    }
+
+    fn append(&mut self, s: &str) -> TextRange {
+        let start = self.data.len() as u32;
+        self.data.extend_from_slice(s.as_bytes());
+        self.data.push(0);
+        TextRange { start, len: s.len() as u32 }
+    }
+
+    pub fn get(&self, range: TextRange) -> &str {
+        let start = range.start as usize;
+        let end = start + range.len as usize;
+        // В пул попадают только &str, поэтому границы всегда валидный UTF-8
+        unsafe { std::str::from_utf8_unchecked(&self.data[start..end]) }
+    }
+
+    // Сырые байты пула вместе с терминаторами, для снимка
+    pub fn as_bytes(&self) -> &[u8] {
+        &self.data
+    }
+
+    pub fn clear(&mut self) {
+        self.data.truncate(1);
+        self.interned.clear();
+    }
+}
+
+#[derive(Debug)]
+pub struct Document {
+    pub nodes: Vec<Node>,
+    pub attrs: Vec<Attr>,
+    pub strings: StringPool,
+}
+
+impl Default for Document {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+impl Document {
+    pub fn new() -> Self {
+        let mut document = Self {
+            nodes: Vec::new(),
+            attrs: Vec::new(),
+            strings: StringPool::new(),
+        };
+        document.push_root();
+        document
+    }
+
+    pub fn with_capacity(input_len: usize) -> Self {
+        // Грубая оценка: один узел на ~40 байт разметки
+        let mut document = Self {
+            nodes: Vec::with_capacity(input_len / 40 + 1),
+            attrs: Vec::with_capacity(input_len / 80 + 1),
+            strings: StringPool::with_capacity(input_len / 2),
+        };
+        document.push_root();
+        document
+    }
+
+    fn push_root(&mut self) {
+        self.nodes.push(Node {
+            kind: NodeKind::Document,
+            tag: LocalName::from("#document"),
+            atom: TagAtom::Unknown,
+            parent: NO_NODE,
+            first_child: NO_NODE,
+            last_child: NO_NODE,
+            next_sibling: NO_NODE,
+            previous_sibling: NO_NODE,
+            text: TextRange::default(),
+            first_attr: 0,
+            attr_count: 0,
+        });
+    }
+
+    pub fn root(&self) -> u32 {
+        0
+    }
+
+    pub fn clear(&mut self) {
+        self.nodes.clear();
+        self.attrs.clear();
+        self.strings.clear();
+        self.push_root();
+    }
+
+    pub fn len(&self) -> usize {
+        self.nodes.len()
+    }
+
+    pub fn node(&self, index: u32) -> Option<&Node> {
+        self.nodes.get(index as usize)
+    }
+
+    pub fn text(&self, range: TextRange) -> &str {
+        self.strings.get(range)
+    }
+
+    pub fn node_attrs(&self, node: &Node) -> &[Attr] {
+        let start = node.first_attr as usize;
+        &self.attrs[start..start + node.attr_count as usize]
+    }
+
+    pub fn attribute(&self, index: u32, name: &str) -> Option<&str> {
+        let node = self.node(index)?;
+        self.node_attrs(node)
+            .iter()
+            .find(|attr| &*attr.name == name)
+            .map(|attr| self.text(attr.value))
+    }
+
+    pub fn append_element<'s, I>(&mut self, parent: u32, tag: LocalName, atom: TagAtom, attrs: I) -> u32
+    where
+        I: IntoIterator<Item = (LocalName, &'s str)>,
+    {
+        let first_attr = self.attrs.len() as u32;
+        for (name, value) in attrs {
+            let value = self.strings.intern(value);
+            self.attrs.push(Attr { name, value });
+        }
+        let attr_count = self.attrs.len() as u32 - first_attr;
+
+        self.append_node(parent, Node {
+            kind: NodeKind::Element,
+            tag,
+            atom,
+            parent,
+            first_child: NO_NODE,
+            last_child: NO_NODE,
+            next_sibling: NO_NODE,
+            previous_sibling: NO_NODE,
+            text: TextRange::default(),
+            first_attr,
+            attr_count,
+        })
+    }
+
+    pub fn append_text(&mut self, parent: u32, text: &str) -> u32 {
+        let range = self.strings.intern(text);
+
+        // Первый прямой текст становится текстом элемента
+        let parent_node = &mut self.nodes[parent as usize];
+        if parent_node.kind == NodeKind::Element && parent_node.text.len == 0 {
+            parent_node.text = range;
+        }
+
+        self.append_node(parent, Node {
+            kind: NodeKind::Text,
+            tag: LocalName::from("#text"),
+            atom: TagAtom::Unknown,
+            parent,
+            first_child: NO_NODE,
+            last_child: NO_NODE,
+            next_sibling: NO_NODE,
+            previous_sibling: NO_NODE,
+            text: range,
+            first_attr: self.attrs.len() as u32,
+            attr_count: 0,
+        })
+    }
+
+    fn append_node(&mut self, parent: u32, node: Node) -> u32 {
+        let index = self.nodes.len() as u32;
+        self.nodes.push(node);
+
+        let parent_node = &mut self.nodes[parent as usize];
+        let previous = parent_node.last_child;
+        parent_node.last_child = index;
+        if previous == NO_NODE {
+            parent_node.first_child = index;
+        } else {
+            self.nodes[previous as usize].next_sibling = index;
+            self.nodes[index as usize].previous_sibling = previous;
+        }
+        index
+    }
+
+    // Дети узла в порядке документа
+    pub fn children(&self, index: u32) -> Children<'_> {
+        let first = self.node(index).map(|node| node.first_child).unwrap_or(NO_NODE);
+        Children { document: self, next: first }
+    }
+}
+
+pub struct Children<'a> {
+    document: &'a Document,
+    next: u32,
+}
+
+impl<'a> Iterator for Children<'a> {
+    type Item = u32;
+
+    fn next(&mut self) -> Option<u32> {
+        if self.next == NO_NODE {
+            return None;
+        }
+        let current = self.next;
+        self.next = self.document.nodes[current as usize].next_sibling;
+        Some(current)
+    }
+}
@@ -1,178 +1,446 @@
-use std::collections::HashMap;
-use serde::{Serialize, Deserialize};
 use std::error::Error;
 
-#[derive(Debug, Clone, Serialize, Deserialize)]
-pub struct HtmlElement {
-    pub tag_name: String,
-    pub attributes: HashMap<String, String>,
-    pub text_content: String,
-    pub children: Vec<HtmlElement>,
+use html5ever::tendril::StrTendril;
+use html5ever::tokenizer::states::RawKind;
+use html5ever::tokenizer::{
+    BufferQueue, Tag, TagKind, Token, TokenSink, TokenSinkResult, Tokenizer, TokenizerOpts,
+};
+
+use crate::dom::{is_html_space, Document, Node, NodeKind, NO_NODE};
+use crate::tag_atoms::TagAtom;
+
+// Элементы без содержимого: никогда не попадают в стек открытых элементов
+fn is_void_element(tag: TagAtom) -> bool {
+    use TagAtom::*;
+    matches!(
+        tag,
+        Area | Base | Br | Col | Embed | Hr | Img | Input | Link | Meta | Param | Source | Track | Wbr
+    )
 }
 
-#[derive(Debug)]
-pub struct HtmlParser {
-    elements: Vec<HtmlElement>,
+// Блочные элементы, открытие которых неявно закрывает <p>
+fn closes_paragraph(tag: TagAtom) -> bool {
+    use TagAtom::*;
+    matches!(
+        tag,
+        Address | Article | Aside | Blockquote | Div | Dl | Fieldset | Footer | Form | H1 | H2 | H3
+            | H4 | H5 | H6 | Header | Hr | Main | Nav | Ol | P | Pre | Section | Table | Ul
+    )
 }
 
-impl HtmlParser {
-    pub fn new() -> Self {
-        Self { elements: Vec::new() }
-    }
-
-    pub fn parse(&mut self, html: &str) -> Result<String, Box<dyn Error>> {
-        // Быстрый HTML парсер с ограничением элементов
-        self.elements.clear();
-        
-        // Ограничиваем количество элементов для производительности
-        const MAX_ELEMENTS: usize = 500;
-        
-        let mut pos = 0;
-        let chars: Vec<char> = html.chars().collect();
-        
-        while pos < chars.len() && self.elements.len() < MAX_ELEMENTS {
-            // Ищем открывающий тег
-            if let Some(tag_start) = self.find_next_tag_start(&chars, pos) {
-                // Извлекаем текст перед тегом (только если он значимый)
-                if tag_start > pos {
-                    let text_content = chars[pos..tag_start].iter().collect::<String>().trim().to_string();
-                    if !text_content.is_empty() && 
-                       !text_content.chars().all(|c| c.is_whitespace()) &&
-                       text_content.len() > 1 {
-                        self.elements.push(HtmlElement {
-                            tag_name: "#text".to_string(),
-                            attributes: HashMap::new(),
-                            text_content,
-                            children: Vec::new(),
-                        });
-                    }
+// Состояние токенизатора для элементов с "сырым" содержимым
+fn raw_kind(tag: TagAtom) -> Option<RawKind> {
+    use TagAtom::*;
+    match tag {
+        Script => Some(RawKind::ScriptData),
+        Style | Xmp | Iframe | Noembed | Noframes | Noscript => Some(RawKind::Rawtext),
+        Title | Textarea => Some(RawKind::Rcdata),
+        _ => None,
+    }
+}
+
+// Строит индексный DOM из потока токенов html5ever
+pub struct DomBuilder {
+    document: Document,
+    open_elements: Vec<u32>,
+    pending_text: String,
+}
+
+impl DomBuilder {
+    pub fn new(document: Document) -> Self {
+        Self {
+            document,
+            open_elements: Vec::new(),
+            pending_text: String::new(),
+        }
+    }
+
+    pub fn document(&self) -> &Document {
+        &self.document
+    }
+
+    pub fn into_document(mut self) -> Document {
+        self.flush_text();
+        self.document
+    }
+
+    fn current_node(&self) -> u32 {
+        self.open_elements.last().copied().unwrap_or(self.document.root())
+    }
+
+    fn current_atom(&self) -> Option<TagAtom> {
+        self.open_elements
+            .last()
+            .map(|&index| self.document.nodes[index as usize].atom)
+    }
+
+    // Текст попадает в DOM как есть: пробелы схлопывает раскладка.
+    // Отбрасываются только пробельные узлы, которые ничего не меняют на экране
+    fn flush_text(&mut self) {
+        if self.pending_text.is_empty() {
+            return;
+        }
+        let parent = self.current_node();
+        let mut text = self.pending_text.as_str();
+
+        // Перевод строки сразу после <pre> и <textarea> не отображается
+        let parent_node = &self.document.nodes[parent as usize];
+        if matches!(parent_node.atom, TagAtom::Pre | TagAtom::Textarea) && parent_node.last_child == NO_NODE {
+            text = text.strip_prefix('\n').unwrap_or(text);
+        }
+
+        if !text.is_empty() && (!text.chars().all(is_html_space) || self.whitespace_matters()) {
+            self.document.append_text(parent, text);
+        }
+        self.pending_text.clear();
+    }
+
+    // Пробельный текст нужен внутри pre/textarea и между строчным
+    // содержимым (`<b>a</b> <i>b</i>`). В начале элемента, после блока и в
+    // контейнерах таблиц и списков он ничего не отображает
+    fn whitespace_matters(&self) -> bool {
+        use TagAtom::*;
+        let preformatted = self
+            .open_elements
+            .iter()
+            .any(|&index| matches!(self.document.nodes[index as usize].atom, Pre | Textarea));
+        if preformatted {
+            return true;
+        }
+
+        let parent = &self.document.nodes[self.current_node() as usize];
+        if matches!(parent.atom, Html | Head | Table | Tbody | Thead | Tfoot | Tr | Ul | Ol | Dl | Select) {
+            return false;
+        }
+        if parent.last_child == NO_NODE {
+            return false;
+        }
+        let previous = &self.document.nodes[parent.last_child as usize];
+        previous.kind == NodeKind::Text
+            || !(closes_paragraph(previous.atom) || matches!(previous.atom, Li | Dt | Dd | Br | Head | Body))
+    }
+
+    // Закрывает открытые элементы до tag включительно, не выходя за границу scope
+    fn pop_until(&mut self, tag: TagAtom, scope: &[TagAtom]) -> bool {
+        let position = self.open_elements.iter().rposition(|&index| {
+            let atom = self.document.nodes[index as usize].atom;
+            atom == tag || scope.contains(&atom)
+        });
+        match position {
+            Some(position) if self.document.nodes[self.open_elements[position] as usize].atom == tag => {
+                self.open_elements.truncate(position);
+                true
+            }
+            _ => false,
+        }
+    }
+
+    // Упрощенные правила неявного закрытия из спецификации HTML
+    fn close_implied(&mut self, tag: TagAtom) {
+        use TagAtom::*;
+        if closes_paragraph(tag) {
+            self.pop_until(P, &[Button, Table, Td, Th]);
+        }
+        match tag {
+            Li => {
+                self.pop_until(Li, &[Ul, Ol]);
+            }
+            Dt | Dd => {
+                if !self.pop_until(Dd, &[Dl]) {
+                    self.pop_until(Dt, &[Dl]);
                 }
-                
-                // Парсим тег
-                if let Some(tag_end) = self.find_tag_end(&chars, tag_start) {
-                    let tag_content = chars[tag_start+1..tag_end].iter().collect::<String>();
-                    
-                    // Пропускаем технические теги
-                    if !tag_content.starts_with('!') && 
-                       !tag_content.starts_with('/') &&
-                       !tag_content.starts_with("script") &&
-                       !tag_content.starts_with("style") &&
-                       !tag_content.starts_with("meta") &&
-                       !tag_content.starts_with("link") &&
-                       !tag_content.starts_with("noscript") {
-                        
-                        let element = self.parse_tag(&tag_content);
-                        if let Some(elem) = element {
-                            // Ищем текст после тега (упрощенно)
-                            let text_start = tag_end + 1;
-                            if let Some(next_tag_start) = self.find_next_tag_start(&chars, text_start) {
-                                let text_between = chars[text_start..next_tag_start].iter().collect::<String>().trim().to_string();
-                                if !text_between.is_empty() && 
-                                   !text_between.chars().all(|c| c.is_whitespace()) &&
-                                   text_between.len() > 1 {
-                                    let mut element_with_text = elem;
-                                    element_with_text.text_content = text_between;
-                                    self.elements.push(element_with_text);
-                                } else {
-                                    self.elements.push(elem);
-                                }
-                            } else {
-                                self.elements.push(elem);
-                            }
-                        }
-                    }
-                    pos = tag_end + 1;
-                } else {
-                    break;
+            }
+            Tr => {
+                self.pop_until(Tr, &[Table, Tbody, Thead, Tfoot]);
+            }
+            Td | Th => {
+                if !self.pop_until(Td, &[Tr, Table]) {
+                    self.pop_until(Th, &[Tr, Table]);
+                }
+            }
+            Option => {
+                if self.current_atom() == Some(Option) {
+                    self.open_elements.pop();
                 }
-            } else {
-                break;
             }
+            _ => {}
         }
-        
-        // Сериализуем в JSON
-        let json = serde_json::to_string(&self.elements)?;
-        Ok(json)
     }
-    
-    fn find_next_tag_start(&self, chars: &[char], start: usize) -> Option<usize> {
-        for i in start..chars.len() {
-            if chars[i] == '<' {
-                return Some(i);
-            }
+
+    fn start_tag(&mut self, tag: Tag) -> TokenSinkResult<()> {
+        self.flush_text();
+        // Имя сравнивается со списком известных тегов один раз, дальше - только атом
+        let atom = TagAtom::from_name(&tag.name);
+        self.close_implied(atom);
+
+        let parent = self.current_node();
+        let attrs = tag
+            .attrs
+            .iter()
+            .map(|attr| (attr.name.local.clone(), &*attr.value));
+        let raw = raw_kind(atom);
+        let is_void = is_void_element(atom);
+        let index = self.document.append_element(parent, tag.name.clone(), atom, attrs);
+
+        if is_void || tag.self_closing {
+            return TokenSinkResult::Continue;
+        }
+
+        self.open_elements.push(index);
+        match raw {
+            Some(kind) => TokenSinkResult::RawData(kind),
+            None => TokenSinkResult::Continue,
         }
-        None
     }
-    
-    fn find_tag_end(&self, chars: &[char], start: usize) -> Option<usize> {
-        for i in start..chars.len() {
-            if chars[i] == '>' {
-                return Some(i);
+
+    fn end_tag(&mut self, tag: Tag) {
+        self.flush_text();
+        match TagAtom::from_name(&tag.name) {
+            TagAtom::Unknown => {
+                // Неизвестные теги отличаются друг от друга только именем
+                let position = self
+                    .open_elements
+                    .iter()
+                    .rposition(|&index| self.document.nodes[index as usize].tag == tag.name);
+                if let Some(position) = position {
+                    self.open_elements.truncate(position);
+                }
+            }
+            atom => {
+                self.pop_until(atom, &[]);
             }
         }
-        None
-    }
-    
-    fn parse_tag(&self, tag_content: &str) -> Option<HtmlElement> {
-        let parts: Vec<&str> = tag_content.trim().split_whitespace().collect();
-        if parts.is_empty() {
-            return None;
-        }
-        
-        let tag_name = parts[0].to_lowercase();
-        let mut attributes = HashMap::new();
-        
-        // Простой парсинг атрибутов
-        for part in &parts[1..] {
-            if let Some(eq_pos) = part.find('=') {
-                let key = part[..eq_pos].to_string();
-                let value = part[eq_pos+1..].trim_matches('"').trim_matches('\'').to_string();
-                attributes.insert(key, value);
+    }
+}
+
+impl TokenSink for DomBuilder {
+    type Handle = ();
+
+    fn process_token(&mut self, token: Token, _line_number: u64) -> TokenSinkResult<()> {
+        match token {
+            Token::TagToken(tag) => match tag.kind {
+                TagKind::StartTag => return self.start_tag(tag),
+                TagKind::EndTag => self.end_tag(tag),
+            },
+            Token::CharacterTokens(text) => self.pending_text.push_str(&text),
+            Token::EOFToken => self.flush_text(),
+            Token::DoctypeToken(_)
+            | Token::CommentToken(_)
+            | Token::NullCharacterToken
+            | Token::ParseError(_) => {}
+        }
+        TokenSinkResult::Continue
+    }
+}
+
+// Инкрементальный разбор: байты документа подаются кусками по мере загрузки,
+// частично построенный DOM доступен в любой момент
+pub struct IncrementalParser {
+    tokenizer: Tokenizer<DomBuilder>,
+    input: BufferQueue,
+    // Хвост незавершенной UTF-8 последовательности на границе кусков
+    pending_bytes: Vec<u8>,
+    bytes_fed: usize,
+}
+
+impl IncrementalParser {
+    pub fn new() -> Self {
+        Self::with_capacity_hint(0)
+    }
+
+    pub fn with_capacity_hint(expected_len: usize) -> Self {
+        let builder = DomBuilder::new(Document::with_capacity(expected_len));
+        Self {
+            tokenizer: Tokenizer::new(builder, TokenizerOpts::default()),
+            input: BufferQueue::new(),
+            pending_bytes: Vec::new(),
+            bytes_fed: 0,
+        }
+    }
+
+    pub fn feed(&mut self, bytes: &[u8]) {
+        self.bytes_fed += bytes.len();
+
+        if self.pending_bytes.is_empty() {
+            let consumed = self.decode(bytes);
+            self.pending_bytes.extend_from_slice(&bytes[consumed..]);
+        } else {
+            let mut joined = std::mem::take(&mut self.pending_bytes);
+            joined.extend_from_slice(bytes);
+            let consumed = self.decode(&joined);
+            joined.drain(..consumed);
+            self.pending_bytes = joined;
+        }
+
+        let _ = self.tokenizer.feed(&mut self.input);
+    }
+
+    // Передает токенизатору валидный UTF-8 префикс, возвращает сколько байт съедено.
+    // Битые последовательности заменяются на U+FFFD, незавершенный хвост остается.
+    fn decode(&mut self, mut bytes: &[u8]) -> usize {
+        let total = bytes.len();
+        loop {
+            match std::str::from_utf8(bytes) {
+                Ok(text) => {
+                    self.push_str(text);
+                    return total;
+                }
+                Err(error) => {
+                    let valid = error.valid_up_to();
+                    // Префикс до valid_up_to гарантированно валиден
+                    self.push_str(unsafe { std::str::from_utf8_unchecked(&bytes[..valid]) });
+                    match error.error_len() {
+                        Some(invalid) => {
+                            self.push_str("\u{FFFD}");
+                            bytes = &bytes[valid + invalid..];
+                        }
+                        None => return total - (bytes.len() - valid),
+                    }
+                }
             }
         }
-        
-        Some(HtmlElement {
-            tag_name,
-            attributes,
-            text_content: String::new(),
-            children: Vec::new(),
-        })
     }
 
-    pub fn get_elements_by_tag(&self, _tag_name: &str) -> Vec<&HtmlElement> {
-        // TODO: Реализовать поиск по тегу
-        Vec::new()
+    fn push_str(&mut self, text: &str) {
+        if !text.is_empty() {
+            self.input.push_back(StrTendril::from_slice(text));
+        }
+    }
+
+    pub fn bytes_fed(&self) -> usize {
+        self.bytes_fed
     }
 
-    pub fn get_element_by_id(&self, _id: &str) -> Option<&HtmlElement> {
-        // TODO: Реализовать поиск по ID
-        None
+    // Частично построенный документ
+    pub fn document(&self) -> &Document {
+        self.tokenizer.sink.document()
     }
-    
-    // Новые методы для FFI
-    
+
+    pub fn finish(mut self) -> Document {
+        if !self.pending_bytes.is_empty() {
+            let tail = String::from_utf8_lossy(&self.pending_bytes).into_owned();
+            self.pending_bytes.clear();
+            self.push_str(&tail);
+            let _ = self.tokenizer.feed(&mut self.input);
+        }
+        self.tokenizer.end();
+        std::mem::take(&mut self.tokenizer.sink).into_document()
+    }
+}
+
+impl Default for IncrementalParser {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+#[derive(Debug)]
+pub struct HtmlParser {
+    document: Document,
+}
+
+impl HtmlParser {
+    pub fn new() -> Self {
+        Self { document: Document::new() }
+    }
+
+    // Разбирает документ целиком, возвращает количество узлов
+    pub fn parse(&mut self, html: &str) -> Result<usize, Box<dyn Error>> {
+        let builder = DomBuilder::new(Document::with_capacity(html.len()));
+        let mut tokenizer = Tokenizer::new(builder, TokenizerOpts::default());
+
+        let mut input = BufferQueue::new();
+        input.push_back(StrTendril::from_slice(html));
+        let _ = tokenizer.feed(&mut input);
+        tokenizer.end();
+
+        self.document = std::mem::take(&mut tokenizer.sink).into_document();
+        Ok(self.document.len())
+    }
+
+    pub fn document(&self) -> &Document {
+        &self.document
+    }
+
+    // Устанавливает документ, построенный инкрементальным парсером
+    pub fn set_document(&mut self, document: Document) {
+        self.document = document;
+    }
+
+    pub fn get_elements_by_tag(&self, tag_name: &str) -> Vec<u32> {
+        let atom = TagAtom::from_name(tag_name);
+        self.document
+            .nodes
+            .iter()
+            .enumerate()
+            .filter(|(_, node)| match atom {
+                TagAtom::Unknown => &*node.tag == tag_name,
+                atom => node.atom == atom,
+            })
+            .map(|(index, _)| index as u32)
+            .collect()
+    }
+
+    pub fn get_element_by_id(&self, id: &str) -> Option<u32> {
+        (0..self.document.len() as u32).find(|&index| self.document.attribute(index, "id") == Some(id))
+    }
+
+    // Методы для FFI: индекс элемента совпадает с индексом узла в документе
+
     pub fn get_element_count(&self) -> usize {
-        self.elements.len()
+        self.document.len()
+    }
+
+    fn node(&self, index: usize) -> Option<&Node> {
+        self.document.nodes.get(index)
     }
-    
-    pub fn get_element_tag_name(&self, index: usize) -> Option<&String> {
-        self.elements.get(index).map(|el| &el.tag_name)
+
+    pub fn get_element_tag_name(&self, index: usize) -> Option<&str> {
+        self.node(index).map(|node| &*node.tag)
     }
-    
-    pub fn get_element_text(&self, index: usize) -> Option<&String> {
-        self.elements.get(index).map(|el| &el.text_content)
+
+    pub fn get_element_tag_atom(&self, index: usize) -> TagAtom {
+        self.node(index).map(|node| node.atom).unwrap_or_default()
     }
-    
-    pub fn get_element_attribute(&self, element_index: usize, attr_name: &str) -> Option<&String> {
-        self.elements.get(element_index)?.attributes.get(attr_name)
+
+    pub fn get_element_text(&self, index: usize) -> Option<&str> {
+        self.node(index).map(|node| self.document.text(node.text))
     }
-    
+
+    pub fn get_element_attribute(&self, element_index: usize, attr_name: &str) -> Option<&str> {
+        self.document.attribute(element_index as u32, attr_name)
+    }
+
     pub fn get_element_attribute_count(&self, element_index: usize) -> usize {
-        self.elements.get(element_index).map(|el| el.attributes.len()).unwrap_or(0)
+        self.node(element_index).map(|node| node.attr_count as usize).unwrap_or(0)
+    }
+
+    pub fn get_element_attribute_name(&self, element_index: usize, attr_index: usize) -> Option<&str> {
+        let node = self.node(element_index)?;
+        self.document.node_attrs(node).get(attr_index).map(|attr| &*attr.name)
+    }
+
+    pub fn get_element_parent(&self, index: usize) -> u32 {
+        self.node(index).map(|node| node.parent).unwrap_or(NO_NODE)
+    }
+
+    pub fn get_element_first_child(&self, index: usize) -> u32 {
+        self.node(index).map(|node| node.first_child).unwrap_or(NO_NODE)
+    }
+
+    pub fn get_element_next_sibling(&self, index: usize) -> u32 {
+        self.node(index).map(|node| node.next_sibling).unwrap_or(NO_NODE)
+    }
+}
+
+impl Default for HtmlParser {
+    fn default() -> Self {
+        Self::new()
     }
-    
-    pub fn get_element_attribute_name(&self, element_index: usize, attr_index: usize) -> Option<&String> {
-        let element = self.elements.get(element_index)?;
-        element.attributes.keys().nth(attr_index)
+}
+
+impl Default for DomBuilder {
+    fn default() -> Self {
+        Self::new(Document::new())
     }
 }
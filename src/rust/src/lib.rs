@@ -1,16 +1,36 @@
-use std::ffi::{CStr, CString};
+use std::ffi::{c_void, CStr, CString};
 use std::os::raw::c_char;
 use std::ptr;
+use std::sync::OnceLock;
+use std::time::Duration;
 
+mod cancel;
+mod computed_style;
+mod dom;
 mod html_parser;
 mod css_parser;
+mod css_selector;
+mod memory;
 mod network;
+mod preload;
+mod scheduler;
 mod security;
+mod snapshot;
+mod streaming;
+mod style;
+mod tag_atoms;
+mod trace;
 
 pub use html_parser::HtmlParser;
+pub use memory::{CountingAlloc, MemoryCounters};
 pub use css_parser::CssParser;
 pub use network::NetworkManager;
+pub use scheduler::{FetchPriority, FetchScheduler};
 pub use security::SecurityManager;
+pub use snapshot::HtmlSnapshot;
+pub use streaming::{StreamNotifyFn, StreamingFetch, Validators};
+pub use style::{MatchedRules, NodeStyles, StyleEngine};
+pub use tag_atoms::{TagAtom, TAG_TABLE_HASH};
 
 // FFI интерфейсы для C++
 
@@ -53,7 +73,7 @@ pub extern "C" fn html_get_element_tag_name(
     unsafe {
         match (*parser).get_element_tag_name(index) {
             Some(tag_name) => {
-                let c_string = CString::new(tag_name.as_str()).unwrap();
+                let c_string = CString::new(tag_name).unwrap();
                 c_string.into_raw()
             }
             None => ptr::null_mut(),
@@ -61,6 +81,19 @@ pub extern "C" fn html_get_element_tag_name(
     }
 }
 
+// Атом тега (0 - неизвестный тег или не элемент), без копирования имени
+#[no_mangle]
+pub extern "C" fn html_get_element_tag_atom(
+    parser: *mut HtmlParser,
+    index: usize
+) -> u16 {
+    if parser.is_null() {
+        return TagAtom::Unknown as u16;
+    }
+
+    unsafe { (*parser).get_element_tag_atom(index) as u16 }
+}
+
 // Новая функция: получает текст элемента по индексу
 #[no_mangle]
 pub extern "C" fn html_get_element_text(
@@ -74,7 +107,7 @@ pub extern "C" fn html_get_element_text(
     unsafe {
         match (*parser).get_element_text(index) {
             Some(text) => {
-                let c_string = CString::new(text.as_str()).unwrap();
+                let c_string = CString::new(text).unwrap();
                 c_string.into_raw()
             }
             None => ptr::null_mut(),
@@ -97,7 +130,7 @@ pub extern "C" fn html_get_element_attribute(
         let attr_name_str = CStr::from_ptr(attr_name).to_string_lossy();
         match (*parser).get_element_attribute(element_index, &attr_name_str) {
             Some(value) => {
-                let c_string = CString::new(value.as_str()).unwrap();
+                let c_string = CString::new(value).unwrap();
                 c_string.into_raw()
             }
             None => ptr::null_mut(),
@@ -133,7 +166,7 @@ pub extern "C" fn html_get_element_attribute_name(
     unsafe {
         match (*parser).get_element_attribute_name(element_index, attr_index) {
             Some(name) => {
-                let c_string = CString::new(name.as_str()).unwrap();
+                let c_string = CString::new(name).unwrap();
                 c_string.into_raw()
             }
             None => ptr::null_mut(),
@@ -141,6 +174,56 @@ pub extern "C" fn html_get_element_attribute_name(
     }
 }
 
+// Структура дерева: индексы узлов, u32::MAX если узла нет
+#[no_mangle]
+pub extern "C" fn html_get_element_parent(parser: *mut HtmlParser, index: usize) -> u32 {
+    if parser.is_null() {
+        return u32::MAX;
+    }
+    unsafe {
+        (*parser).get_element_parent(index)
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn html_get_element_first_child(parser: *mut HtmlParser, index: usize) -> u32 {
+    if parser.is_null() {
+        return u32::MAX;
+    }
+    unsafe {
+        (*parser).get_element_first_child(index)
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn html_get_element_next_sibling(parser: *mut HtmlParser, index: usize) -> u32 {
+    if parser.is_null() {
+        return u32::MAX;
+    }
+    unsafe {
+        (*parser).get_element_next_sibling(index)
+    }
+}
+
+// Снимок всего документа одним буфером: таблица узлов, таблица атрибутов
+// и арена строк. Освобождается одним вызовом html_snapshot_free.
+#[no_mangle]
+pub extern "C" fn html_get_snapshot(parser: *mut HtmlParser) -> *const HtmlSnapshot {
+    if parser.is_null() {
+        return ptr::null();
+    }
+    unsafe {
+        snapshot::build_snapshot((*parser).document())
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn html_snapshot_free(snapshot: *const HtmlSnapshot) {
+    unsafe {
+        snapshot::free_snapshot(snapshot);
+    }
+}
+
 // Старая функция для обратной совместимости
 #[no_mangle]
 pub extern "C" fn html_parse_string(
@@ -166,9 +249,63 @@ pub extern "C" fn html_parse_string(
     }
 }
 
+// Разбор документа из буфера без завершающего '\0' (например, отображенного
+// в память файла дискового кэша): байты не копируются на стороне FFI
+#[no_mangle]
+pub extern "C" fn html_parse_bytes(parser: *mut HtmlParser, data: *const u8, len: usize) -> bool {
+    if parser.is_null() || (data.is_null() && len > 0) {
+        return false;
+    }
+
+    unsafe {
+        let parser_ref = &mut *parser;
+        let bytes = if len == 0 { &[][..] } else { std::slice::from_raw_parts(data, len) };
+        let html = String::from_utf8_lossy(bytes);
+        parser_ref.parse(&html).is_ok()
+    }
+}
+
+// SHA-256 от данных в hex (освобождается через string_free)
+#[no_mangle]
+pub extern "C" fn security_calculate_hash(data: *const u8, len: usize) -> *mut c_char {
+    if data.is_null() && len > 0 {
+        return ptr::null_mut();
+    }
+
+    static SECURITY: OnceLock<SecurityManager> = OnceLock::new();
+    let security = SECURITY.get_or_init(SecurityManager::new);
+
+    unsafe {
+        let bytes = if len == 0 { &[][..] } else { std::slice::from_raw_parts(data, len) };
+        string_to_c(Some(security.calculate_hash(bytes)))
+    }
+}
+
+fn string_to_c(value: Option<String>) -> *mut c_char {
+    value
+        .and_then(|value| CString::new(value).ok())
+        .map(CString::into_raw)
+        .unwrap_or(ptr::null_mut())
+}
+
+unsafe fn c_to_string(value: *const c_char) -> Option<String> {
+    if value.is_null() {
+        None
+    } else {
+        Some(CStr::from_ptr(value).to_string_lossy().into_owned())
+    }
+}
+
+// Таймауты запросов (на весь запрос, включая тело)
+const ASYNC_FETCH_TIMEOUT: Duration = Duration::from_secs(10);
+const SYNC_FETCH_TIMEOUT: Duration = Duration::from_secs(5);
+const IMAGE_FETCH_TIMEOUT: Duration = Duration::from_secs(10);
+// Документ целиком в пакетном режиме: большие страницы на медленной сети
+const DOCUMENT_FETCH_TIMEOUT: Duration = Duration::from_secs(30);
+
 // Структура для асинхронной загрузки
 pub struct AsyncFetchHandle {
-    pub handle: std::thread::JoinHandle<Option<String>>,
+    pub handle: tokio::task::JoinHandle<Option<String>>,
 }
 
 #[no_mangle]
@@ -177,26 +314,21 @@ pub extern "C" fn network_fetch_url_async(url: *const c_char) -> *mut AsyncFetch
         return ptr::null_mut();
     }
 
+    let network = match NetworkManager::global() {
+        Some(network) => network,
+        None => return ptr::null_mut(),
+    };
+
     unsafe {
         let url_str = CStr::from_ptr(url).to_string_lossy().to_string();
         
-        let handle = std::thread::spawn(move || {
-            let rt = match tokio::runtime::Runtime::new() {
-                Ok(rt) => rt,
-                Err(_) => return None,
-            };
-            
-            rt.block_on(async move {
-                let client = reqwest::Client::builder()
-                    .timeout(std::time::Duration::from_secs(10))
-                    .build()
-                    .ok()?;
-                    
-                let resp = client.get(&url_str).send().await.ok()?;
-                let text = resp.text().await.ok()?;
-                Some(text)
-            })
-        });
+        // Задача в общем рантайме, соединение берется из общего пула
+        let tags = memory::current_tags().with_subsystem(memory::Subsystem::Network);
+        let ticket = FetchScheduler::global().enqueue(&url_str, FetchPriority::Document);
+        let request = NetworkManager::get_text(network.client().clone(), url_str, ASYNC_FETCH_TIMEOUT);
+        let handle = network.spawn(memory::tagged(tags, async move {
+            NetworkManager::scheduled(ticket, request).await.flatten()
+        }));
         
         Box::into_raw(Box::new(AsyncFetchHandle { handle }))
     }
@@ -226,16 +358,30 @@ pub extern "C" fn network_fetch_url_result(fetch_handle: *mut AsyncFetchHandle)
     
     unsafe {
         let handle_box = Box::from_raw(fetch_handle);
-        match handle_box.handle.join() {
-            Ok(Some(text)) => {
-                let c_string = CString::new(text).unwrap();
-                c_string.into_raw()
-            }
+        let network = match NetworkManager::global() {
+            Some(network) => network,
+            None => return ptr::null_mut(),
+        };
+        match network.block_on(handle_box.handle) {
+            // Текст с NUL в C-строку не передать - как ошибка, без паники
+            Ok(Some(text)) => string_to_c(Some(text)),
             _ => ptr::null_mut(),
         }
     }
 }
 
+// Отменяет загрузку и освобождает handle; результат больше не нужен
+#[no_mangle]
+pub extern "C" fn network_fetch_url_cancel(fetch_handle: *mut AsyncFetchHandle) {
+    if !fetch_handle.is_null() {
+        unsafe {
+            let handle_box = Box::from_raw(fetch_handle);
+            // Задача бросается в ближайшей точке ожидания вместе с запросом
+            handle_box.handle.abort();
+        }
+    }
+}
+
 // Старая синхронная функция для обратной совместимости
 #[no_mangle]
 pub extern "C" fn network_fetch_url(url: *const c_char) -> *mut c_char {
@@ -243,61 +389,381 @@ pub extern "C" fn network_fetch_url(url: *const c_char) -> *mut c_char {
         return ptr::null_mut();
     }
 
+    let network = match NetworkManager::global() {
+        Some(network) => network,
+        None => return ptr::null_mut(),
+    };
+
     unsafe {
-        let url_str = CStr::from_ptr(url).to_string_lossy();
+        let url_str = CStr::from_ptr(url).to_string_lossy().to_string();
         
         // Синхронный вызов с таймаутом
-        let rt = tokio::runtime::Runtime::new().unwrap();
-        let result = rt.block_on(async move {
-            let client = reqwest::Client::builder()
-                .timeout(std::time::Duration::from_secs(5))
-                .build()?;
-            let resp = client.get(&*url_str).send().await?;
-            let text = resp.text().await?;
-            Ok::<String, Box<dyn std::error::Error>>(text)
-        });
-
-        match result {
-            Ok(text) => {
-                let c_string = CString::new(text).unwrap();
-                c_string.into_raw()
+        let ticket = FetchScheduler::global().enqueue(&url_str, FetchPriority::Document);
+        let request = NetworkManager::get_text(network.client().clone(), url_str, SYNC_FETCH_TIMEOUT);
+        let result = network.block_on(NetworkManager::scheduled(ticket, request)).flatten();
+        string_to_c(result)
+    }
+}
+
+// Синхронная загрузка тела как есть: байты без перекодирования (NUL и
+// любая кодировка допустимы) с таймаутом DOCUMENT_FETCH_TIMEOUT. Тело
+// освобождается через network_bytes_free, длина - в len. final_url (может
+// быть NULL) получает адрес ответа после перенаправлений (string_free).
+// NULL - ошибка сети или ответ не 2xx
+#[no_mangle]
+pub extern "C" fn network_fetch_bytes(url: *const c_char, len: *mut usize, final_url: *mut *mut c_char) -> *mut u8 {
+    if !final_url.is_null() {
+        unsafe {
+            *final_url = ptr::null_mut();
+        }
+    }
+    let network = match NetworkManager::global() {
+        Some(network) => network,
+        None => return ptr::null_mut(),
+    };
+
+    unsafe {
+        let url_str = match c_to_string(url) {
+            Some(url) => url,
+            None => return ptr::null_mut(),
+        };
+        let ticket = FetchScheduler::global().enqueue(&url_str, FetchPriority::Document);
+        let request = NetworkManager::get_bytes_with_url(network.client().clone(), url_str, DOCUMENT_FETCH_TIMEOUT);
+        let (response_url, body) = match network.block_on(NetworkManager::scheduled(ticket, request)).flatten() {
+            Some(result) => result,
+            None => return ptr::null_mut(),
+        };
+
+        if !final_url.is_null() {
+            *final_url = string_to_c(Some(response_url));
+        }
+        let body = body.into_boxed_slice();
+        if !len.is_null() {
+            *len = body.len();
+        }
+        Box::into_raw(body) as *mut u8
+    }
+}
+
+// Загрузка изображений: асинхронно в общем рантайме, сырые байты без перекодирования.
+// callback вызывается из рабочего потока ровно один раз; при ошибке data = NULL.
+// Владение data переходит к вызывающему (освобождается через network_bytes_free).
+pub type ImageFetchCallback = extern "C" fn(user_data: *mut c_void, data: *mut u8, len: usize);
+
+struct ImageFetchTarget {
+    callback: ImageFetchCallback,
+    user_data: *mut c_void,
+}
+
+// user_data принадлежит вызывающему, callback обязан быть потокобезопасным
+unsafe impl Send for ImageFetchTarget {}
+
+impl ImageFetchTarget {
+    fn complete(self, body: Option<Vec<u8>>) {
+        match body {
+            Some(body) => {
+                let body = body.into_boxed_slice();
+                let len = body.len();
+                (self.callback)(self.user_data, Box::into_raw(body) as *mut u8, len);
             }
-            Err(_) => ptr::null_mut(),
+            None => (self.callback)(self.user_data, ptr::null_mut(), 0),
+        }
+    }
+}
+
+// priority - класс в планировщике (FetchPriority). Возвращает номер запроса
+// для network_fetch_set_priority; 0 - загрузку запустить не удалось
+// (callback не будет вызван)
+#[no_mangle]
+pub extern "C" fn network_fetch_image_async(
+    url: *const c_char,
+    priority: u32,
+    callback: ImageFetchCallback,
+    user_data: *mut c_void,
+) -> u64 {
+    if url.is_null() {
+        return 0;
+    }
+
+    let network = match NetworkManager::global() {
+        Some(network) => network,
+        None => return 0,
+    };
+
+    unsafe {
+        let url_str = CStr::from_ptr(url).to_string_lossy().to_string();
+        let target = ImageFetchTarget { callback, user_data };
+        let client = network.client().clone();
+        let priority = FetchPriority::from_raw(priority).unwrap_or(FetchPriority::OffscreenImage);
+
+        // Байты картинки живут до декодирования - относим их к изображениям
+        let tags = memory::current_tags().with_subsystem(memory::Subsystem::Images);
+        let navigation = trace::current_navigation();
+
+        // Картинку уже нашел сканер: дожидаемся его загрузки, подняв ее класс.
+        // Ожидание привязано к токену вкладки на момент вызова
+        if let Some(preloaded) = preload::take(&url_str) {
+            let id = preloaded.request();
+            FetchScheduler::global().set_priority(id, priority);
+            let cancel = cancel::current();
+            network.spawn(trace::traced(navigation, memory::tagged(tags, async move {
+                // Запасной запрос - только если загрузку сканера отменили
+                let body = cancel
+                    .run(preloaded.body(async move {
+                        let ticket = FetchScheduler::global().enqueue(&url_str, priority);
+                        let body = NetworkManager::scheduled(ticket, fetch_image(client, url_str)).await;
+                        body.flatten().map(bytes::Bytes::from)
+                    }))
+                    .await
+                    .flatten();
+                target.complete(body.map(Vec::from));
+            })));
+            return id;
         }
+
+        let ticket = FetchScheduler::global().enqueue(&url_str, priority);
+        let id = ticket.id();
+        network.spawn(trace::traced(navigation, memory::tagged(tags, async move {
+            let body = NetworkManager::scheduled(ticket, fetch_image(client, url_str)).await;
+            target.complete(body.flatten());
+        })));
+        id
     }
 }
 
-// Функция для загрузки изображений
+async fn fetch_image(client: reqwest::Client, url: String) -> Option<Vec<u8>> {
+    let mut span = trace::Span::begin("images", "image_fetch");
+    let body = NetworkManager::get_bytes(client, url, IMAGE_FETCH_TIMEOUT).await;
+    span.set_bytes(body.as_ref().map_or(0, |body| body.len() as u64));
+    body
+}
+
+// Меняет класс запроса, еще ждущего в очереди (например, картинка
+// прокруткой попала на экран). false - запрос уже в сети или завершен
+#[no_mangle]
+pub extern "C" fn network_fetch_set_priority(request: u64, priority: u32) -> bool {
+    match FetchPriority::from_raw(priority) {
+        Some(priority) => FetchScheduler::global().set_priority(request, priority),
+        None => false,
+    }
+}
+
+// Отменяет все запросы вкладки (номер в учете памяти): документ, картинки и
+// упреждающие загрузки. Ждущие запросы снимаются с очереди, начатые
+// закрывают соединение; callback картинок вызывается с NULL. Запросы,
+// начатые после вызова, работают как обычно
+#[no_mangle]
+pub extern "C" fn network_cancel_tab(tab: u32) {
+    cancel::cancel_tab(tab as u16);
+    preload::discard_cancelled();
+}
+
+// Вкладка на экране (номер в учете памяти): ее запросы идут раньше запросов
+// остальных вкладок
+#[no_mangle]
+pub extern "C" fn network_scheduler_set_active_tab(tab: u32) {
+    FetchScheduler::global().set_active_tab(tab as u16);
+}
+
+// Потоковая загрузка HTML: тело разбирается по мере поступления.
+// notify (может быть NULL) вызывается из рабочих потоков при каждом событии
+// загрузки и только будит UI; состояние читается через network_stream_*.
+
 #[no_mangle]
-pub extern "C" fn network_fetch_image(url: *const c_char) -> *mut c_char {
+pub extern "C" fn network_fetch_html_stream(
+    url: *const c_char,
+    validators: *const FetchValidators,
+    notify: Option<StreamNotifyFn>,
+    user_data: *mut c_void,
+) -> *mut StreamingFetch {
     if url.is_null() {
         return ptr::null_mut();
     }
 
     unsafe {
-        let url_str = CStr::from_ptr(url).to_string_lossy();
-        
-        // Синхронная загрузка изображения с таймаутом
-        let rt = tokio::runtime::Runtime::new().unwrap();
-        let result = rt.block_on(async move {
-            let client = reqwest::Client::builder()
-                .timeout(std::time::Duration::from_secs(5))
-                .build()?;
-                
-            let resp = client.get(&*url_str).send().await?;
-            let bytes = resp.bytes().await?;
-            
-            // Конвертируем в base64 для передачи в C++
-            let base64_data = base64::encode(&bytes);
-            Ok::<String, Box<dyn std::error::Error>>(base64_data)
-        });
-
-        match result {
-            Ok(base64_data) => {
-                let c_string = CString::new(base64_data).unwrap();
-                c_string.into_raw()
+        let url_str = CStr::from_ptr(url).to_string_lossy().to_string();
+        let validators = if validators.is_null() {
+            Validators::default()
+        } else {
+            Validators {
+                etag: c_to_string((*validators).etag),
+                last_modified: c_to_string((*validators).last_modified),
             }
-            Err(_) => ptr::null_mut(),
+        };
+        let notify = notify.map(|callback| (callback, user_data));
+        Box::into_raw(Box::new(StreamingFetch::start_with_notify(url_str, validators, notify)))
+    }
+}
+
+// Валидаторы сохраненной копии для условного запроса; любое поле может быть NULL
+#[repr(C)]
+pub struct FetchValidators {
+    pub etag: *const c_char,
+    pub last_modified: *const c_char,
+}
+
+// 0 - загружается, 1 - готово, 2 - не изменилось (304), -1 - ошибка
+#[no_mangle]
+pub extern "C" fn network_stream_check(stream: *mut StreamingFetch) -> i32 {
+    if stream.is_null() {
+        return -1;
+    }
+    unsafe {
+        (*stream).status()
+    }
+}
+
+// HTTP статус ответа, 0 - ответ еще не получен
+#[no_mangle]
+pub extern "C" fn network_stream_http_status(stream: *mut StreamingFetch) -> u16 {
+    if stream.is_null() {
+        return 0;
+    }
+    unsafe {
+        (*stream).http_status()
+    }
+}
+
+// Валидаторы из ответа сервера (освобождаются через string_free), NULL - нет заголовка
+#[no_mangle]
+pub extern "C" fn network_stream_etag(stream: *mut StreamingFetch) -> *mut c_char {
+    if stream.is_null() {
+        return ptr::null_mut();
+    }
+    unsafe {
+        string_to_c((*stream).response_validators().etag)
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn network_stream_last_modified(stream: *mut StreamingFetch) -> *mut c_char {
+    if stream.is_null() {
+        return ptr::null_mut();
+    }
+    unsafe {
+        string_to_c((*stream).response_validators().last_modified)
+    }
+}
+
+// Адрес ответа после перенаправлений (освобождается через string_free);
+// NULL - ответа еще нет
+#[no_mangle]
+pub extern "C" fn network_stream_final_url(stream: *mut StreamingFetch) -> *mut c_char {
+    if stream.is_null() {
+        return ptr::null_mut();
+    }
+    unsafe {
+        string_to_c((*stream).final_url())
+    }
+}
+
+// Абсолютный URL href относительно base (base может быть NULL), так же, как
+// его разрешает сканер упреждающей загрузки. Освобождается через
+// string_free; NULL - адрес не разбирается
+#[no_mangle]
+pub extern "C" fn network_resolve_url(base: *const c_char, href: *const c_char) -> *mut c_char {
+    unsafe {
+        let href = match c_to_string(href) {
+            Some(href) => href,
+            None => return ptr::null_mut(),
+        };
+        let base = c_to_string(base).and_then(|base| reqwest::Url::parse(&base).ok());
+        string_to_c(preload::resolve(base.as_ref(), &href).map(String::from))
+    }
+}
+
+// total = 0, если сервер не сообщил размер
+#[no_mangle]
+pub extern "C" fn network_stream_progress(
+    stream: *mut StreamingFetch,
+    received: *mut u64,
+    total: *mut u64,
+) {
+    if stream.is_null() {
+        return;
+    }
+    unsafe {
+        let (bytes_received, content_length) = (*stream).progress();
+        if !received.is_null() {
+            *received = bytes_received;
+        }
+        if !total.is_null() {
+            *total = content_length;
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn network_stream_request_preview(stream: *mut StreamingFetch) {
+    if stream.is_null() {
+        return;
+    }
+    unsafe {
+        (*stream).request_preview();
+    }
+}
+
+// Снимок частично разобранного документа или null, если он еще не готов
+#[no_mangle]
+pub extern "C" fn network_stream_take_preview(stream: *mut StreamingFetch) -> *const HtmlSnapshot {
+    if stream.is_null() {
+        return ptr::null();
+    }
+    unsafe {
+        match (*stream).take_preview() {
+            Some(snapshot) => snapshot.into_raw(),
+            None => ptr::null(),
+        }
+    }
+}
+
+// Завершает загрузку: переносит DOM в parser и возвращает тело ответа
+// (освобождается через network_bytes_free). Освобождает stream.
+#[no_mangle]
+pub extern "C" fn network_stream_finish(
+    stream: *mut StreamingFetch,
+    parser: *mut HtmlParser,
+    body_len: *mut usize,
+) -> *mut u8 {
+    if stream.is_null() {
+        return ptr::null_mut();
+    }
+
+    unsafe {
+        let stream = Box::from_raw(stream);
+        let result = match stream.finish() {
+            Some(result) => result,
+            None => return ptr::null_mut(),
+        };
+
+        if !parser.is_null() {
+            (*parser).set_document(result.document);
+        }
+
+        let body = result.body.into_boxed_slice();
+        if !body_len.is_null() {
+            *body_len = body.len();
+        }
+        Box::into_raw(body) as *mut u8
+    }
+}
+
+// Освобождает handle без ожидания: задачи загрузки доработают сами,
+// notify после возврата больше не вызывается
+#[no_mangle]
+pub extern "C" fn network_stream_free(stream: *mut StreamingFetch) {
+    if !stream.is_null() {
+        unsafe {
+            let _ = Box::from_raw(stream);
+        }
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn network_bytes_free(data: *mut u8, len: usize) {
+    if !data.is_null() {
+        unsafe {
+            let _ = Box::from_raw(std::ptr::slice_from_raw_parts_mut(data, len));
         }
     }
 }
@@ -310,3 +776,90 @@ pub extern "C" fn string_free(ptr: *mut c_char) {
         }
     }
 }
+
+// Учет памяти Rust; C++ складывает эти счетчики со своими
+
+#[no_mangle]
+pub extern "C" fn memory_rust_accounting_enabled() -> bool {
+    cfg!(feature = "memory-accounting")
+}
+
+// Метки вызывающего потока; задачи, запущенные из него, наследуют вкладку
+#[no_mangle]
+pub extern "C" fn memory_rust_set_thread_tags(subsystem: u32, tab: u32) {
+    let subsystem = memory::Subsystem::from_index(subsystem).unwrap_or(memory::Subsystem::Other);
+    let tab = if (tab as usize) < memory::MAX_TABS { tab as u16 } else { memory::NO_TAB };
+    memory::set_tags(memory::Tags::new(subsystem, tab));
+}
+
+#[no_mangle]
+pub extern "C" fn memory_rust_subsystem_counters(subsystem: u32, counters: *mut memory::MemoryCounters) -> bool {
+    match memory::Subsystem::from_index(subsystem) {
+        Some(subsystem) if !counters.is_null() => {
+            unsafe { *counters = memory::subsystem_counters(subsystem) };
+            true
+        }
+        _ => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn memory_rust_tab_counters(tab: u32, counters: *mut memory::MemoryCounters) -> bool {
+    if counters.is_null() || tab as usize >= memory::MAX_TABS {
+        return false;
+    }
+    match memory::tab_counters(tab as u16) {
+        Some(value) => {
+            unsafe { *counters = value };
+            true
+        }
+        None => false,
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn memory_rust_total_counters(counters: *mut memory::MemoryCounters) {
+    if !counters.is_null() {
+        unsafe { *counters = memory::total_counters() };
+    }
+}
+
+#[no_mangle]
+pub extern "C" fn memory_rust_tab_restart(tab: u32) {
+    if (tab as usize) < memory::MAX_TABS {
+        memory::restart_tab(tab as u16);
+    }
+}
+
+// Трассировка (src/rust/src/trace.rs). now_ns - trace_now_ns() стороны C
+// в момент вызова: по нему выравниваются часы
+#[no_mangle]
+pub extern "C" fn trace_rust_set_enabled(enabled: bool, now_ns: u64) {
+    trace::set_enabled(enabled, now_ns);
+}
+
+// Навигация вызывающего потока; задачи, запущенные из него, наследуют ее
+#[no_mangle]
+pub extern "C" fn trace_rust_set_navigation(navigation: u64) {
+    trace::set_navigation(navigation);
+}
+
+// События вызывающего потока пишутся под его номером у стороны C
+#[no_mangle]
+pub extern "C" fn trace_rust_bind_thread(tid: u32) {
+    trace::bind_thread(tid);
+}
+
+// События Rust в формате trace_event через запятую (без скобок массива).
+// Освобождается через string_free
+#[no_mangle]
+pub extern "C" fn trace_rust_export_json(pid: u32) -> *mut c_char {
+    CString::new(trace::export_json(pid))
+        .map(CString::into_raw)
+        .unwrap_or(ptr::null_mut())
+}
+
+#[no_mangle]
+pub extern "C" fn trace_rust_clear() {
+    trace::clear();
+}
@@ -0,0 +1,289 @@
+// Учет памяти Rust по подсистемам и вкладкам. Метки те же, что в
+// src/c/memory.h: поток помечает свои выделения, метки пишутся в заголовок
+// блока, и освобождение из любого потока списывается туда, где выделялось.
+// Счетный аллокатор включается признаком memory-accounting.
+
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use std::task::{Context, Poll};
+
+// Номера совпадают с MemorySubsystem в C
+#[repr(u8)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Subsystem {
+    Other = 0,
+    Network,
+    Parser,
+    Renderer,
+    Cache,
+    Images,
+}
+
+pub const SUBSYSTEM_COUNT: usize = 6;
+
+impl Subsystem {
+    pub fn from_index(index: u32) -> Option<Self> {
+        match index {
+            0 => Some(Subsystem::Other),
+            1 => Some(Subsystem::Network),
+            2 => Some(Subsystem::Parser),
+            3 => Some(Subsystem::Renderer),
+            4 => Some(Subsystem::Cache),
+            5 => Some(Subsystem::Images),
+            _ => None,
+        }
+    }
+}
+
+pub const NO_TAB: u16 = 0;
+pub const MAX_TABS: usize = 64;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Tags {
+    pub subsystem: Subsystem,
+    pub tab: u16,
+}
+
+impl Tags {
+    pub const fn new(subsystem: Subsystem, tab: u16) -> Self {
+        Self { subsystem, tab }
+    }
+
+    pub fn with_subsystem(self, subsystem: Subsystem) -> Self {
+        Self { subsystem, ..self }
+    }
+}
+
+thread_local! {
+    // const: чтение из аллокатора не должно само выделять память
+    static THREAD_TAGS: Cell<Tags> = const { Cell::new(Tags::new(Subsystem::Other, NO_TAB)) };
+}
+
+pub fn current_tags() -> Tags {
+    // Во время завершения потока локальных переменных уже нет
+    THREAD_TAGS.try_with(Cell::get).unwrap_or(Tags::new(Subsystem::Other, NO_TAB))
+}
+
+pub fn set_tags(tags: Tags) {
+    let _ = THREAD_TAGS.try_with(|cell| cell.set(tags));
+}
+
+// Метки действуют до конца области видимости, потом восстанавливаются прежние
+pub struct TagScope {
+    previous: Tags,
+}
+
+impl TagScope {
+    pub fn enter(tags: Tags) -> Self {
+        let previous = current_tags();
+        set_tags(tags);
+        Self { previous }
+    }
+}
+
+impl Drop for TagScope {
+    fn drop(&mut self) {
+        set_tags(self.previous);
+    }
+}
+
+// Задача tokio переходит между потоками рантайма: метки ставятся на время
+// каждого poll
+pub struct Tagged<F> {
+    tags: Tags,
+    inner: F,
+}
+
+pub fn tagged<F: Future>(tags: Tags, inner: F) -> Tagged<F> {
+    Tagged { tags, inner }
+}
+
+impl<F: Future> Future for Tagged<F> {
+    type Output = F::Output;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<F::Output> {
+        let tags = self.tags;
+        let _scope = TagScope::enter(tags);
+        // inner не перемещается: Tagged закреплен вместе с ним
+        unsafe { self.map_unchecked_mut(|tagged| &mut tagged.inner) }.poll(cx)
+    }
+}
+
+// Раскладка совпадает с MemoryCounters в C
+#[repr(C)]
+#[derive(Debug, Default, Clone, Copy)]
+pub struct MemoryCounters {
+    pub live_bytes: usize,
+    pub peak_bytes: usize,
+    pub allocations: u64,
+    pub frees: u64,
+}
+
+#[repr(align(64))]
+struct AtomicCounters {
+    live_bytes: AtomicUsize,
+    peak_bytes: AtomicUsize,
+    allocations: AtomicU64,
+    frees: AtomicU64,
+}
+
+impl AtomicCounters {
+    const fn new() -> Self {
+        Self {
+            live_bytes: AtomicUsize::new(0),
+            peak_bytes: AtomicUsize::new(0),
+            allocations: AtomicU64::new(0),
+            frees: AtomicU64::new(0),
+        }
+    }
+
+    fn add(&self, size: usize) {
+        let live = self.live_bytes.fetch_add(size, Ordering::Relaxed) + size;
+        self.allocations.fetch_add(1, Ordering::Relaxed);
+        self.peak_bytes.fetch_max(live, Ordering::Relaxed);
+    }
+
+    fn sub(&self, size: usize) {
+        self.live_bytes.fetch_sub(size, Ordering::Relaxed);
+        self.frees.fetch_add(1, Ordering::Relaxed);
+    }
+
+    fn load(&self) -> MemoryCounters {
+        MemoryCounters {
+            live_bytes: self.live_bytes.load(Ordering::Relaxed),
+            peak_bytes: self.peak_bytes.load(Ordering::Relaxed),
+            allocations: self.allocations.load(Ordering::Relaxed),
+            frees: self.frees.load(Ordering::Relaxed),
+        }
+    }
+
+    fn restart(&self) {
+        self.peak_bytes.store(self.live_bytes.load(Ordering::Relaxed), Ordering::Relaxed);
+        self.allocations.store(0, Ordering::Relaxed);
+        self.frees.store(0, Ordering::Relaxed);
+    }
+}
+
+#[allow(clippy::declare_interior_mutable_const)]
+const ZERO: AtomicCounters = AtomicCounters::new();
+static SUBSYSTEM_COUNTERS: [AtomicCounters; SUBSYSTEM_COUNT] = [ZERO; SUBSYSTEM_COUNT];
+static TAB_COUNTERS: [AtomicCounters; MAX_TABS] = [ZERO; MAX_TABS];
+static TOTAL_COUNTERS: AtomicCounters = AtomicCounters::new();
+
+fn account_alloc(tags: Tags, size: usize) {
+    SUBSYSTEM_COUNTERS[tags.subsystem as usize].add(size);
+    TAB_COUNTERS[tags.tab as usize].add(size);
+    TOTAL_COUNTERS.add(size);
+}
+
+fn account_free(tags: Tags, size: usize) {
+    SUBSYSTEM_COUNTERS[tags.subsystem as usize].sub(size);
+    TAB_COUNTERS[tags.tab as usize].sub(size);
+    TOTAL_COUNTERS.sub(size);
+}
+
+pub fn subsystem_counters(subsystem: Subsystem) -> MemoryCounters {
+    SUBSYSTEM_COUNTERS[subsystem as usize].load()
+}
+
+pub fn tab_counters(tab: u16) -> Option<MemoryCounters> {
+    TAB_COUNTERS.get(tab as usize).map(AtomicCounters::load)
+}
+
+pub fn total_counters() -> MemoryCounters {
+    TOTAL_COUNTERS.load()
+}
+
+// Вкладка получила переиспользованный номер
+pub fn restart_tab(tab: u16) {
+    if let Some(counters) = TAB_COUNTERS.get(tab as usize) {
+        counters.restart();
+    }
+}
+
+// Аллокатор со счетчиками поверх системного. Перед данными - заголовок
+// из 16 байт (или больше, если выравнивание больше), метки в его последних
+// байтах
+pub struct CountingAlloc;
+
+const HEADER: usize = 16;
+
+#[derive(Clone, Copy)]
+#[repr(C)]
+struct StoredTags {
+    subsystem: u8,
+    tab: u16,
+}
+
+impl CountingAlloc {
+    fn outer_layout(layout: Layout) -> Option<(Layout, usize)> {
+        let offset = layout.align().max(HEADER);
+        let size = layout.size().checked_add(offset)?;
+        Layout::from_size_align(size, offset).ok().map(|outer| (outer, offset))
+    }
+
+    unsafe fn finish_alloc(base: *mut u8, offset: usize, size: usize) -> *mut u8 {
+        if base.is_null() {
+            return base;
+        }
+        let tags = current_tags();
+        let ptr = base.add(offset);
+        (ptr.sub(HEADER) as *mut StoredTags).write(StoredTags { subsystem: tags.subsystem as u8, tab: tags.tab });
+        account_alloc(tags, size);
+        ptr
+    }
+
+    unsafe fn stored_tags(ptr: *mut u8) -> Tags {
+        let stored = (ptr.sub(HEADER) as *const StoredTags).read();
+        let subsystem = Subsystem::from_index(stored.subsystem as u32).unwrap_or(Subsystem::Other);
+        Tags::new(subsystem, stored.tab)
+    }
+}
+
+unsafe impl GlobalAlloc for CountingAlloc {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        match Self::outer_layout(layout) {
+            Some((outer, offset)) => Self::finish_alloc(System.alloc(outer), offset, layout.size()),
+            None => std::ptr::null_mut(),
+        }
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        match Self::outer_layout(layout) {
+            Some((outer, offset)) => Self::finish_alloc(System.alloc_zeroed(outer), offset, layout.size()),
+            None => std::ptr::null_mut(),
+        }
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        // Раскладка уже была построена при выделении, unwrap не сработает
+        let (outer, offset) = Self::outer_layout(layout).unwrap();
+        account_free(Self::stored_tags(ptr), layout.size());
+        System.dealloc(ptr.sub(offset), outer);
+    }
+
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let (outer, offset) = Self::outer_layout(layout).unwrap();
+        let new_outer_size = match new_size.checked_add(offset) {
+            Some(size) => size,
+            None => return std::ptr::null_mut(),
+        };
+
+        // Блок остается за метками первого выделения
+        let tags = Self::stored_tags(ptr);
+        let base = System.realloc(ptr.sub(offset), outer, new_outer_size);
+        if base.is_null() {
+            return base;
+        }
+        account_free(tags, layout.size());
+        account_alloc(tags, new_size);
+        base.add(offset)
+    }
+}
+
+#[cfg(feature = "memory-accounting")]
+#[global_allocator]
+static GLOBAL: CountingAlloc = CountingAlloc;
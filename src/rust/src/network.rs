@@ -1,9 +1,26 @@
+use reqwest::dns::{Addrs, Name, Resolve, Resolving};
 use reqwest::Client;
 use serde::{Serialize, Deserialize};
 use std::collections::HashMap;
+use std::future::Future;
+use std::net::SocketAddr;
+use std::sync::{Arc, OnceLock};
+use std::time::Duration;
 use tokio::runtime::Runtime;
+use tokio::task::JoinHandle;
 use std::error::Error;
 
+use crate::scheduler::Ticket;
+use crate::trace;
+
+// Таймаут установки соединения; общий таймаут запроса задает вызывающий
+const CONNECT_TIMEOUT: Duration = Duration::from_secs(5);
+// Сколько простаивающих соединений держать открытыми на один хост
+const MAX_IDLE_PER_HOST: usize = 8;
+const POOL_IDLE_TIMEOUT: Duration = Duration::from_secs(90);
+const TCP_KEEPALIVE: Duration = Duration::from_secs(60);
+const NETWORK_WORKER_THREADS: usize = 2;
+
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct HttpResponse {
     pub status: u16,
@@ -12,23 +29,141 @@ pub struct HttpResponse {
     pub url: String,
 }
 
+// Единый сетевой сервис процесса: один многопоточный рантайм и один Client,
+// поэтому пул keep-alive соединений, TLS сессии и HTTP/2 переиспользуются
+// всеми запросами
 #[derive(Debug)]
 pub struct NetworkManager {
     client: Client,
     runtime: Runtime,
 }
 
+static GLOBAL_NETWORK: OnceLock<Option<NetworkManager>> = OnceLock::new();
+
+// Системный резолвер (getaddrinfo в пуле блокирующих потоков, как у reqwest
+// по умолчанию), с отрезком "dns" в трассе
+struct TracingResolver;
+
+impl Resolve for TracingResolver {
+    fn resolve(&self, name: Name) -> Resolving {
+        let navigation = trace::current_navigation();
+        Box::pin(async move {
+            let start = trace::now_ns();
+            let result = tokio::net::lookup_host((name.as_str(), 0)).await;
+            trace::record("dns", "network", start, trace::now_ns(), navigation, 0);
+            let addrs: Vec<SocketAddr> = result?.collect();
+            Ok::<Addrs, Box<dyn Error + Send + Sync>>(Box::new(addrs.into_iter()))
+        })
+    }
+}
+
 impl NetworkManager {
     pub fn new() -> Result<Self, Box<dyn Error>> {
         let client = Client::builder()
             .user_agent("HeavenlyWebGu/1.0")
+            .connect_timeout(CONNECT_TIMEOUT)
+            .pool_max_idle_per_host(MAX_IDLE_PER_HOST)
+            .pool_idle_timeout(POOL_IDLE_TIMEOUT)
+            .tcp_keepalive(TCP_KEEPALIVE)
+            .tcp_nodelay(true)
+            .http2_adaptive_window(true)
+            .dns_resolver(Arc::new(TracingResolver))
             .build()?;
         
-        let runtime = Runtime::new()?;
+        let runtime = tokio::runtime::Builder::new_multi_thread()
+            .worker_threads(NETWORK_WORKER_THREADS)
+            .thread_name("heavenly-net")
+            .enable_all()
+            .build()?;
         
         Ok(Self { client, runtime })
     }
 
+    // Общий экземпляр, создается при первом обращении.
+    // None - рантайм или клиент создать не удалось
+    pub fn global() -> Option<&'static NetworkManager> {
+        GLOBAL_NETWORK
+            .get_or_init(|| NetworkManager::new().ok())
+            .as_ref()
+    }
+
+    // Client дешево клонируется и разделяет пул соединений
+    pub fn client(&self) -> &Client {
+        &self.client
+    }
+
+    pub fn spawn<F>(&self, future: F) -> JoinHandle<F::Output>
+    where
+        F: Future + Send + 'static,
+        F::Output: Send + 'static,
+    {
+        self.runtime.spawn(future)
+    }
+
+    // Для CPU-работы, которую нельзя выполнять на потоках ввода-вывода
+    pub fn spawn_blocking<F, R>(&self, f: F) -> JoinHandle<R>
+    where
+        F: FnOnce() -> R + Send + 'static,
+        R: Send + 'static,
+    {
+        self.runtime.spawn_blocking(f)
+    }
+
+    // Нельзя вызывать из задач самого рантайма
+    pub fn block_on<F: Future>(&self, future: F) -> F::Output {
+        self.runtime.block_on(future)
+    }
+
+    // Запрос через планировщик: request начинает выполняться, когда до него
+    // дойдет очередь, и держит место в сети до завершения. Таймаут запроса
+    // отсчитывается от выхода в сеть. None - в том числе если вкладку
+    // остановили: запрос бросается в очереди или посреди ответа
+    pub async fn scheduled<F: Future>(mut ticket: Ticket, request: F) -> Option<F::Output> {
+        let cancel = ticket.cancel_token().clone();
+        cancel
+            .run(async move {
+                let _slot = ticket.admitted().await?;
+                Some(request.await)
+            })
+            .await
+            .flatten()
+    }
+
+    // GET с таймаутом на весь запрос, тело целиком в памяти
+    pub async fn get_bytes(client: Client, url: String, timeout: Duration) -> Option<Vec<u8>> {
+        Self::get_bytes_with_url(client, url, timeout).await.map(|(_, body)| body)
+    }
+
+    // То же, вместе с адресом ответа после перенаправлений
+    pub async fn get_bytes_with_url(client: Client, url: String, timeout: Duration) -> Option<(String, Vec<u8>)> {
+        let resp = Self::send_traced(client.get(&url).timeout(timeout)).await?;
+        if !resp.status().is_success() {
+            return None;
+        }
+        let final_url = resp.url().to_string();
+        let mut span = trace::Span::begin("network", "body");
+        let bytes = resp.bytes().await.ok()?;
+        span.set_bytes(bytes.len() as u64);
+        Some((final_url, Vec::from(bytes)))
+    }
+
+    pub async fn get_text(client: Client, url: String, timeout: Duration) -> Option<String> {
+        let resp = Self::send_traced(client.get(&url).timeout(timeout)).await?;
+        let mut span = trace::Span::begin("network", "body");
+        let text = resp.text().await.ok()?;
+        span.set_bytes(text.len() as u64);
+        Some(text)
+    }
+
+    // Отправка до заголовков ответа: соединение, TLS и ожидание сервера
+    // одним отрезком "first_byte" (reqwest их не разделяет)
+    pub async fn send_traced(request: reqwest::RequestBuilder) -> Option<reqwest::Response> {
+        let start = trace::now_ns();
+        let resp = request.send().await.ok()?;
+        trace::record("first_byte", "network", start, trace::now_ns(), trace::current_navigation(), 0);
+        Some(resp)
+    }
+
     pub fn fetch_url(&self, url: &str) -> Result<HttpResponse, Box<dyn Error>> {
         let client = self.client.clone();
         let url = url.to_string();
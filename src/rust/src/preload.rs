@@ -0,0 +1,577 @@
+// Упреждающая загрузка ресурсов. Сканер идет по байтам ответа в сетевой
+// задаче, раньше основного разбора, и находит адреса подресурсов: img
+// src/srcset, link rel=stylesheet и rel=preload, script src. Картинки сразу
+// ставятся в планировщик загрузок; когда раскладка доходит до них,
+// network_fetch_image_async забирает уже идущую или завершенную загрузку
+// вместо новой.
+//
+// Сканер - не разборщик: он не строит дерево и не исправляет разметку,
+// только пропускает комментарии и содержимое script/style. Ошибка сканера
+// стоит лишнего запроса, а не неверной страницы.
+
+use std::borrow::Cow;
+use std::collections::{HashMap, HashSet};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::time::{Duration, Instant};
+
+use bytes::Bytes;
+use reqwest::Url;
+use tokio::sync::OnceCell;
+
+use crate::cancel::CancelToken;
+use crate::memory::{self, Subsystem};
+use crate::network::NetworkManager;
+use crate::scheduler::{FetchPriority, FetchScheduler};
+use crate::trace;
+
+// Незабранная загрузка отбрасывается через это время вместе с телом
+const PRELOAD_TTL: Duration = Duration::from_secs(30);
+const PRELOAD_TIMEOUT: Duration = Duration::from_secs(10);
+// Сколько ресурсов одной страницы загружать заранее
+const MAX_PRELOADS_PER_PAGE: usize = 64;
+// Незакрытый тег на стыке кусков длиннее этого пропускается
+const MAX_PENDING: usize = 8 * 1024;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum PreloadKind {
+    Image,
+    Stylesheet,
+    Script,
+}
+
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct Preload {
+    pub url: String,
+    pub kind: PreloadKind,
+}
+
+// Где сканер находится между кусками
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Mode {
+    Markup,
+    Comment,
+    // Содержимое script или style до закрывающего тега
+    RawText(&'static [u8]),
+}
+
+pub struct PreloadScanner {
+    base: Option<Url>,
+    mode: Mode,
+    // Хвост прошлого куска: незакрытый тег или возможное начало конца комментария
+    pending: Vec<u8>,
+    seen: HashSet<String>,
+    base_seen: bool,
+}
+
+impl PreloadScanner {
+    // base - адрес документа (после перенаправлений)
+    pub fn new(base: Option<Url>) -> Self {
+        Self {
+            base,
+            mode: Mode::Markup,
+            pending: Vec::new(),
+            seen: HashSet::new(),
+            base_seen: false,
+        }
+    }
+
+    // Адреса, найденные в очередном куске, без повторов
+    pub fn scan(&mut self, chunk: &[u8]) -> Vec<Preload> {
+        let mut found = Vec::new();
+        let data: Cow<[u8]> = if self.pending.is_empty() {
+            Cow::Borrowed(chunk)
+        } else {
+            let mut joined = std::mem::take(&mut self.pending);
+            joined.extend_from_slice(chunk);
+            Cow::Owned(joined)
+        };
+
+        let mut pos = 0;
+        while pos < data.len() {
+            match self.mode {
+                Mode::Comment => match find(&data[pos..], b"-->") {
+                    Some(end) => {
+                        pos += end + 3;
+                        self.mode = Mode::Markup;
+                    }
+                    None => {
+                        self.keep_tail(&data, data.len().saturating_sub(2).max(pos));
+                        break;
+                    }
+                },
+                Mode::RawText(end_tag) => match find_ignore_case(&data[pos..], end_tag) {
+                    Some(end) => {
+                        pos += end + end_tag.len();
+                        self.mode = Mode::Markup;
+                    }
+                    None => {
+                        self.keep_tail(&data, data.len().saturating_sub(end_tag.len() - 1).max(pos));
+                        break;
+                    }
+                },
+                Mode::Markup => {
+                    let open = match data[pos..].iter().position(|&b| b == b'<') {
+                        Some(open) => pos + open,
+                        None => break,
+                    };
+                    let rest = &data[open + 1..];
+                    if rest.starts_with(b"!--") {
+                        pos = open + 4;
+                        self.mode = Mode::Comment;
+                        continue;
+                    }
+                    if rest.len() < 3 && b"!--".starts_with(rest) {
+                        self.keep_tail(&data, open);
+                        break;
+                    }
+                    match rest.first() {
+                        Some(b) if b.is_ascii_alphabetic() => {}
+                        Some(_) => {
+                            pos = open + 1;
+                            continue;
+                        }
+                        None => {
+                            self.keep_tail(&data, open);
+                            break;
+                        }
+                    }
+                    match tag_end(rest) {
+                        Some(end) => {
+                            self.tag(&rest[..end], &mut found);
+                            pos = open + 1 + end + 1;
+                        }
+                        None => {
+                            self.keep_tail(&data, open);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        found
+    }
+
+    fn keep_tail(&mut self, data: &[u8], from: usize) {
+        if data.len() - from <= MAX_PENDING {
+            self.pending = data[from..].to_vec();
+        }
+    }
+
+    // Содержимое тега между '<' и '>'
+    fn tag(&mut self, tag: &[u8], found: &mut Vec<Preload>) {
+        let name_len = tag
+            .iter()
+            .position(|b| b.is_ascii_whitespace() || *b == b'/')
+            .unwrap_or(tag.len());
+        let name = tag[..name_len].to_ascii_lowercase();
+        let attributes = parse_attributes(&tag[name_len..]);
+        let attribute = |wanted: &str| {
+            attributes
+                .iter()
+                .find(|(name, _)| name == wanted)
+                .map(|(_, value)| value.as_str())
+        };
+
+        match name.as_slice() {
+            b"img" => {
+                if let Some(src) = image_source(attribute("src"), attribute("srcset")) {
+                    self.push(src, PreloadKind::Image, found);
+                }
+            }
+            b"link" => {
+                let rel = attribute("rel").unwrap_or("").to_ascii_lowercase();
+                let kind = if has_token(&rel, "stylesheet") {
+                    Some(PreloadKind::Stylesheet)
+                } else if has_token(&rel, "preload") {
+                    match attribute("as").unwrap_or("").to_ascii_lowercase().as_str() {
+                        "image" => Some(PreloadKind::Image),
+                        "style" => Some(PreloadKind::Stylesheet),
+                        "script" => Some(PreloadKind::Script),
+                        _ => None,
+                    }
+                } else {
+                    None
+                };
+                if let (Some(kind), Some(href)) = (kind, attribute("href")) {
+                    self.push(href, kind, found);
+                }
+            }
+            b"script" => {
+                if let Some(src) = attribute("src") {
+                    self.push(src, PreloadKind::Script, found);
+                }
+                self.mode = Mode::RawText(b"</script");
+            }
+            b"style" => self.mode = Mode::RawText(b"</style"),
+            b"base" if !self.base_seen => {
+                // Как в браузере, действует только первый <base href>
+                if let Some(href) = attribute("href") {
+                    self.base_seen = true;
+                    if let Some(base) = self.base.as_ref().and_then(|base| resolve(Some(base), href)) {
+                        self.base = Some(base);
+                    }
+                }
+            }
+            _ => {}
+        }
+    }
+
+    fn push(&mut self, value: &str, kind: PreloadKind, found: &mut Vec<Preload>) {
+        let url = match resolve(self.base.as_ref(), value) {
+            Some(url) if url.scheme() == "http" || url.scheme() == "https" => url,
+            _ => return,
+        };
+        if self.seen.len() < MAX_PRELOADS_PER_PAGE && self.seen.insert(url.as_str().to_string()) {
+            found.push(Preload {
+                url: url.into(),
+                kind,
+            });
+        }
+    }
+}
+
+// Абсолютный адрес по правилам WHATWG. Тем же разрешением пользуется C++
+// (network_resolve_url), поэтому раскладка запрашивает ровно тот URL, под
+// которым лежит загрузка сканера
+pub fn resolve(base: Option<&Url>, value: &str) -> Option<Url> {
+    match base {
+        Some(base) => base.join(value.trim()).ok(),
+        None => Url::parse(value.trim()).ok(),
+    }
+}
+
+// Адрес картинки: src, иначе кандидат srcset для плотности 1x (или первый).
+// Так же выбирает раскладка (image_source в layout_engine.cpp)
+pub fn image_source<'a>(src: Option<&'a str>, srcset: Option<&'a str>) -> Option<&'a str> {
+    if let Some(src) = src.filter(|src| !src.trim().is_empty()) {
+        return Some(src);
+    }
+    let mut first = None;
+    for candidate in srcset?.split(',') {
+        let mut parts = candidate.split_whitespace();
+        let url = match parts.next() {
+            Some(url) => url,
+            None => continue,
+        };
+        let descriptor = parts.next();
+        if descriptor.is_none() || descriptor == Some("1x") {
+            return Some(url);
+        }
+        first.get_or_insert(url);
+    }
+    first
+}
+
+fn has_token(list: &str, token: &str) -> bool {
+    list.split_ascii_whitespace().any(|item| item == token)
+}
+
+fn find(data: &[u8], needle: &[u8]) -> Option<usize> {
+    data.windows(needle.len()).position(|window| window == needle)
+}
+
+fn find_ignore_case(data: &[u8], needle: &[u8]) -> Option<usize> {
+    data.windows(needle.len())
+        .position(|window| window.eq_ignore_ascii_case(needle))
+}
+
+// Позиция '>', закрывающего тег, с учетом кавычек в значениях
+fn tag_end(data: &[u8]) -> Option<usize> {
+    let mut quote = None;
+    for (i, &b) in data.iter().enumerate() {
+        match quote {
+            Some(q) if b == q => quote = None,
+            Some(_) => {}
+            None if b == b'"' || b == b'\'' => quote = Some(b),
+            None if b == b'>' => return Some(i),
+            None => {}
+        }
+    }
+    None
+}
+
+// Имена в нижнем регистре; из ссылок в значениях раскрывается только &amp;
+fn parse_attributes(data: &[u8]) -> Vec<(String, String)> {
+    let mut attributes = Vec::new();
+    let mut pos = 0;
+    let skip_space = |pos: &mut usize| {
+        while *pos < data.len() && (data[*pos].is_ascii_whitespace() || data[*pos] == b'/') {
+            *pos += 1;
+        }
+    };
+
+    loop {
+        skip_space(&mut pos);
+        if pos >= data.len() {
+            break;
+        }
+        let name_start = pos;
+        while pos < data.len() && !data[pos].is_ascii_whitespace() && data[pos] != b'=' && data[pos] != b'/' {
+            pos += 1;
+        }
+        let name = String::from_utf8_lossy(&data[name_start..pos]).to_ascii_lowercase();
+        while pos < data.len() && data[pos].is_ascii_whitespace() {
+            pos += 1;
+        }
+
+        let mut value = Cow::Borrowed(&b""[..]);
+        if pos < data.len() && data[pos] == b'=' {
+            pos += 1;
+            while pos < data.len() && data[pos].is_ascii_whitespace() {
+                pos += 1;
+            }
+            if pos < data.len() && (data[pos] == b'"' || data[pos] == b'\'') {
+                let quote = data[pos];
+                let start = pos + 1;
+                let end = data[start..].iter().position(|&b| b == quote).map_or(data.len(), |end| start + end);
+                value = Cow::Borrowed(&data[start..end]);
+                pos = (end + 1).min(data.len());
+            } else {
+                let start = pos;
+                while pos < data.len() && !data[pos].is_ascii_whitespace() {
+                    pos += 1;
+                }
+                value = Cow::Borrowed(&data[start..pos]);
+            }
+        }
+        let value = String::from_utf8_lossy(&value).replace("&amp;", "&");
+        attributes.push((name, value));
+    }
+    attributes
+}
+
+// Загрузка, начатая сканером. Результат общий: кто первым дождется -
+// сканер или раскладка - тот его и получит, второй запрос не уходит
+pub struct PreloadEntry {
+    body: OnceCell<Option<Bytes>>,
+    // Номер в планировщике: раскладка поднимает класс до видимого
+    request: u64,
+    started: Instant,
+    // Токен навигации, на которой ресурс найден
+    cancel: CancelToken,
+}
+
+impl PreloadEntry {
+    pub fn request(&self) -> u64 {
+        self.request
+    }
+
+    // Тело картинки; если загрузку сканера отменили, fallback выполняет ее заново
+    pub async fn body<F>(&self, fallback: F) -> Option<Bytes>
+    where
+        F: std::future::Future<Output = Option<Bytes>>,
+    {
+        self.body.get_or_init(|| fallback).await.clone()
+    }
+}
+
+fn registry() -> &'static Mutex<HashMap<String, Arc<PreloadEntry>>> {
+    static REGISTRY: OnceLock<Mutex<HashMap<String, Arc<PreloadEntry>>>> = OnceLock::new();
+    REGISTRY.get_or_init(|| Mutex::new(HashMap::new()))
+}
+
+// Запускает загрузку найденного ресурса. Стили и скрипты только находятся:
+// внешние CSS и JS пока никто не загружает, и их байты были бы лишними.
+// cancel - токен загрузки документа: с ней отменяется и упреждающая
+pub fn start(preload: Preload, cancel: &CancelToken) {
+    if preload.kind != PreloadKind::Image || cancel.is_cancelled() {
+        return;
+    }
+    let network = match NetworkManager::global() {
+        Some(network) => network,
+        None => return,
+    };
+
+    let (ticket, entry) = {
+        let mut entries = registry().lock().unwrap();
+        entries.retain(|_, entry| entry.started.elapsed() < PRELOAD_TTL && !entry.cancel.is_cancelled());
+        if entries.contains_key(&preload.url) {
+            return;
+        }
+        // Класс - как у картинки вне экрана: где она окажется, пока неизвестно
+        let ticket = FetchScheduler::global().enqueue(&preload.url, FetchPriority::OffscreenImage);
+        let entry = Arc::new(PreloadEntry {
+            body: OnceCell::new(),
+            request: ticket.id(),
+            started: Instant::now(),
+            cancel: cancel.clone(),
+        });
+        entries.insert(preload.url.clone(), Arc::clone(&entry));
+        (ticket, entry)
+    };
+
+    // Картинки ниже экрана или под display:none раскладка может не забрать
+    // никогда: тело не должно жить до следующей навигации
+    let key = preload.url.clone();
+    let expiring = Arc::downgrade(&entry);
+    network.spawn(async move {
+        tokio::time::sleep(PRELOAD_TTL).await;
+        let mut entries = registry().lock().unwrap();
+        if entries.get(&key).is_some_and(|entry| Arc::as_ptr(entry) == expiring.as_ptr()) {
+            entries.remove(&key);
+        }
+    });
+
+    let client = network.client().clone();
+    let tags = memory::current_tags().with_subsystem(Subsystem::Images);
+    let navigation = trace::current_navigation();
+    let cancel = cancel.clone();
+    network.spawn(trace::traced(navigation, memory::tagged(tags, async move {
+        let mut ticket = ticket;
+        // При отмене ячейка остается пустой: раскладка, если она еще ждет
+        // картинку, загрузит ее сама
+        let fetch = entry.body.get_or_init(|| async move {
+            let _slot = ticket.admitted().await?;
+            let mut span = trace::Span::begin("images", "image_fetch");
+            let body = NetworkManager::get_bytes(client, preload.url, PRELOAD_TIMEOUT).await;
+            span.set_bytes(body.as_ref().map_or(0, |body| body.len() as u64));
+            body.map(Bytes::from)
+        });
+        cancel.run(fetch).await;
+    })));
+}
+
+// Забирает загрузку сканера для url, если она есть и еще не устарела
+pub fn take(url: &str) -> Option<Arc<PreloadEntry>> {
+    let key = Url::parse(url).ok()?;
+    registry()
+        .lock()
+        .unwrap()
+        .remove(key.as_str())
+        .filter(|entry| entry.started.elapsed() < PRELOAD_TTL && !entry.cancel.is_cancelled())
+}
+
+// Отбрасывает загрузки отмененных навигаций вместе с уже полученными телами
+pub fn discard_cancelled() {
+    registry().lock().unwrap().retain(|_, entry| !entry.cancel.is_cancelled());
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    // Все комментарии, script и style страницы ложные: если сканер потеряет
+    // состояние на стыке кусков, он найдет лишние адреса или пропустит нужные
+    const PAGE: &str = concat!(
+        "<!DOCTYPE html><html><head>",
+        "<link rel=\"stylesheet\" href=\"/main.css\">",
+        "<!-- <img src=\"/comment.png\"> -- - -> --!>  -->",
+        "<link rel=preload as=image href='/hero.png'>",
+        "<script src=\"/app.js\">if (a<b) document.write('<img src=/script.png>')</SCRIPT >",
+        "<style>p::after { content: \"<img src=/style.png>\" }</style>",
+        "<!---->",
+        "</head><body>",
+        "<img alt=\"a > b\" src=\"/quoted.png\">",
+        "<img srcset=\"/small.png 1x, /large.png 2x\">",
+        "<p>a < b <3 <!-x></p>",
+        "<script>var s = '</scrip' + 't>'; var i = '<img src=/raw.png>'</script>",
+        "<img src=/last.png>",
+        "</body></html>",
+    );
+
+    const EXPECTED: [&str; 6] = ["/main.css", "/hero.png", "/app.js", "/quoted.png", "/small.png", "/last.png"];
+
+    fn base() -> Option<Url> {
+        Url::parse("https://example.com/").ok()
+    }
+
+    fn paths(found: &[Preload]) -> Vec<&str> {
+        found.iter().map(|preload| &preload.url["https://example.com".len()..]).collect()
+    }
+
+    // Скан документа, поданного кусками заданных длин
+    fn scan_chunks(data: &[u8], lengths: impl IntoIterator<Item = usize>) -> Vec<Preload> {
+        let mut scanner = PreloadScanner::new(base());
+        let mut found = Vec::new();
+        let mut pos = 0;
+        for length in lengths {
+            if pos >= data.len() {
+                break;
+            }
+            let end = (pos + length).min(data.len());
+            found.extend(scanner.scan(&data[pos..end]));
+            assert!(scanner.pending.len() <= MAX_PENDING);
+            pos = end;
+        }
+        assert_eq!(pos, data.len());
+        found
+    }
+
+    // xorshift: длины кусков воспроизводятся от прогона к прогону
+    fn random_lengths(seed: u32, max: u32) -> impl Iterator<Item = usize> {
+        let mut state = seed;
+        std::iter::repeat_with(move || {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            (state % max + 1) as usize
+        })
+    }
+
+    #[test]
+    fn single_chunk() {
+        assert_eq!(paths(&scan_chunks(PAGE.as_bytes(), [PAGE.len()])), EXPECTED);
+    }
+
+    #[test]
+    fn byte_chunks_match_single_chunk() {
+        let whole = scan_chunks(PAGE.as_bytes(), [PAGE.len()]);
+        assert_eq!(scan_chunks(PAGE.as_bytes(), std::iter::repeat(1)), whole);
+    }
+
+    #[test]
+    fn random_chunks_match_single_chunk() {
+        let whole = scan_chunks(PAGE.as_bytes(), [PAGE.len()]);
+        for seed in 1..200 {
+            assert_eq!(scan_chunks(PAGE.as_bytes(), random_lengths(seed, 16)), whole, "зерно {}", seed);
+            assert_eq!(scan_chunks(PAGE.as_bytes(), random_lengths(seed, 97)), whole, "зерно {}", seed);
+        }
+    }
+
+    // Каждая точка разреза документа на два куска
+    fn expect_every_split(page: &str, expected: &[&str]) {
+        for split in 0..=page.len() {
+            let found = scan_chunks(page.as_bytes(), [split, page.len()]);
+            assert_eq!(paths(&found), expected, "разрез на {}: {:?}", split, page.split_at(split));
+        }
+    }
+
+    #[test]
+    fn tag_split_across_chunks() {
+        expect_every_split("x<img src=\"/a.png\" alt='>'><IMG\nSRC=/b.png>", &["/a.png", "/b.png"]);
+    }
+
+    #[test]
+    fn comment_open_split_across_chunks() {
+        expect_every_split("<!--<img src=/no.png>--><img src=/yes.png>", &["/yes.png"]);
+        // "<!-" без второго дефиса - не комментарий
+        expect_every_split("<!-x><img src=/yes.png>", &["/yes.png"]);
+    }
+
+    #[test]
+    fn comment_close_split_across_chunks() {
+        expect_every_split("<!-- - -- -><img src=/no.png> --><img src=/yes.png>", &["/yes.png"]);
+        expect_every_split("<!-- a ---><img src=/yes.png>", &["/yes.png"]);
+    }
+
+    #[test]
+    fn raw_text_end_tag_split_across_chunks() {
+        expect_every_split("<script>'<img src=/no.png>'</ScRiPt><img src=/yes.png>", &["/yes.png"]);
+        expect_every_split("<style>x</styl</style ><img src=/yes.png>", &["/yes.png"]);
+    }
+
+    #[test]
+    fn oversized_tag_is_skipped() {
+        // Незакрытый тег не копится дольше MAX_PENDING байт: он пропускается,
+        // сканер идет дальше
+        let long = format!("<img src=/long.png alt=\"{}\"><img src=/after.png>", "x".repeat(2 * MAX_PENDING));
+        assert_eq!(paths(&scan_chunks(long.as_bytes(), [long.len()])), ["/long.png", "/after.png"]);
+        assert_eq!(paths(&scan_chunks(long.as_bytes(), std::iter::repeat(1))), ["/after.png"]);
+        assert_eq!(paths(&scan_chunks(long.as_bytes(), std::iter::repeat(1024))), ["/after.png"]);
+        assert_eq!(paths(&scan_chunks(long.as_bytes(), random_lengths(7, 4096))), ["/after.png"]);
+
+        // В пределах MAX_PENDING тег дожидается конца
+        let fits = format!("<img src=/fits.png alt=\"{}\">", "x".repeat(MAX_PENDING - 64));
+        assert_eq!(paths(&scan_chunks(fits.as_bytes(), random_lengths(7, 512))), ["/fits.png"]);
+    }
+}
@@ -0,0 +1,311 @@
+// Планировщик загрузок. Любой запрос сначала встает в очередь и уходит в
+// сеть, когда для него есть место: не больше MAX_IN_FLIGHT запросов всего и
+// MAX_PER_ORIGIN на один источник (схема, хост и порт). Очередь упорядочена
+// по классу (документ, стили, скрипты, видимые картинки, картинки вне
+// экрана, упреждающие загрузки), внутри класса - по времени постановки.
+// Запросы неактивных вкладок идут после всех запросов активной.
+//
+// Важные классы не застревают за картинками: малоприоритетные запросы
+// занимают не все места, RESERVED_CRITICAL слотов источника и процесса
+// остаются документу, стилям и скриптам. Класс ждущего запроса можно
+// поменять (прокрутка, переключение вкладки); начатый запрос уже не
+// переупорядочивается.
+//
+// Запрос привязан к токену отмены своей вкладки (cancel.rs): после отмены
+// NetworkManager::scheduled бросает его, и билет снимается с очереди.
+
+use std::collections::{BTreeMap, HashMap};
+use std::sync::{Mutex, OnceLock};
+
+use tokio::sync::oneshot;
+
+use crate::cancel::{self, CancelToken};
+use crate::memory::{self, NO_TAB};
+use crate::trace;
+
+// Как у браузеров для HTTP/1.1: больше соединений на хост сервер не любит
+const MAX_PER_ORIGIN: usize = 6;
+const MAX_IN_FLIGHT: usize = 24;
+// Места, которые малоприоритетные запросы не занимают
+const RESERVED_CRITICAL: usize = 2;
+
+#[repr(u8)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord, Hash)]
+pub enum FetchPriority {
+    Document = 0,
+    Stylesheet = 1,
+    Script = 2,
+    VisibleImage = 3,
+    OffscreenImage = 4,
+    Prefetch = 5,
+}
+
+impl FetchPriority {
+    pub fn from_raw(value: u32) -> Option<Self> {
+        match value {
+            0 => Some(FetchPriority::Document),
+            1 => Some(FetchPriority::Stylesheet),
+            2 => Some(FetchPriority::Script),
+            3 => Some(FetchPriority::VisibleImage),
+            4 => Some(FetchPriority::OffscreenImage),
+            5 => Some(FetchPriority::Prefetch),
+            _ => None,
+        }
+    }
+
+    // Без этих запросов страницу не показать
+    fn critical(self) -> bool {
+        self <= FetchPriority::Script
+    }
+}
+
+// Порядок в очереди: сначала активная вкладка, затем класс, затем номер
+#[derive(Debug, Clone, Copy, PartialEq, Eq, PartialOrd, Ord)]
+struct QueueKey {
+    background: bool,
+    priority: FetchPriority,
+    id: u64,
+}
+
+struct Waiting {
+    origin: String,
+    tab: u16,
+    start: oneshot::Sender<Slot>,
+}
+
+#[derive(Default)]
+struct OriginLoad {
+    total: usize,
+    // Из них малоприоритетных
+    low: usize,
+}
+
+struct SchedulerState {
+    queue: BTreeMap<QueueKey, Waiting>,
+    // Ключ ждущего запроса по номеру: для смены класса и отзыва
+    keys: HashMap<u64, QueueKey>,
+    origins: HashMap<String, OriginLoad>,
+    in_flight: usize,
+    low_in_flight: usize,
+    active_tab: u16,
+    next_id: u64,
+}
+
+pub struct FetchScheduler {
+    state: Mutex<SchedulerState>,
+}
+
+// Место в сети: пока оно живо, запрос учитывается в лимитах
+pub struct Slot {
+    origin: String,
+    low: bool,
+}
+
+impl Drop for Slot {
+    fn drop(&mut self) {
+        FetchScheduler::global().release(&self.origin, self.low);
+    }
+}
+
+// Запрос в очереди. Если его бросить до выхода в сеть, он снимается с очереди
+pub struct Ticket {
+    id: u64,
+    receiver: oneshot::Receiver<Slot>,
+    cancel: CancelToken,
+}
+
+impl Ticket {
+    // Номер для смены класса (network_fetch_set_priority)
+    pub fn id(&self) -> u64 {
+        self.id
+    }
+
+    // Токен вкладки, поставившей запрос
+    pub fn cancel_token(&self) -> &CancelToken {
+        &self.cancel
+    }
+
+    // Ждет своей очереди; время ожидания видно в трассе отрезком "queue"
+    pub async fn admitted(&mut self) -> Option<Slot> {
+        let start = trace::now_ns();
+        let slot = (&mut self.receiver).await.ok()?;
+        trace::record("queue", "network", start, trace::now_ns(), trace::current_navigation(), 0);
+        Some(slot)
+    }
+}
+
+impl Drop for Ticket {
+    fn drop(&mut self) {
+        FetchScheduler::global().withdraw(self.id);
+    }
+}
+
+// Источник запроса; для неразбираемого URL - пустая строка (запрос все
+// равно завершится ошибкой)
+fn origin_of(url: &str) -> String {
+    match reqwest::Url::parse(url) {
+        Ok(url) => url.origin().ascii_serialization(),
+        Err(_) => String::new(),
+    }
+}
+
+impl SchedulerState {
+    fn is_background(&self, tab: u16) -> bool {
+        tab != NO_TAB && self.active_tab != NO_TAB && tab != self.active_tab
+    }
+
+    // Снимает с очереди все, для чего есть место, в порядке очереди
+    fn admit(&mut self) -> Vec<(oneshot::Sender<Slot>, Slot)> {
+        let mut admitted = Vec::new();
+        let mut started = Vec::new();
+        for (key, waiting) in self.queue.iter() {
+            if self.in_flight >= MAX_IN_FLIGHT {
+                break;
+            }
+            let low = !key.priority.critical();
+            if low && self.low_in_flight >= MAX_IN_FLIGHT - RESERVED_CRITICAL {
+                continue;
+            }
+            let load = self.origins.entry(waiting.origin.clone()).or_default();
+            if load.total >= MAX_PER_ORIGIN || (low && load.low >= MAX_PER_ORIGIN - RESERVED_CRITICAL) {
+                continue;
+            }
+            load.total += 1;
+            self.in_flight += 1;
+            if low {
+                load.low += 1;
+                self.low_in_flight += 1;
+            }
+            started.push(*key);
+        }
+
+        for key in started {
+            if let Some(waiting) = self.queue.remove(&key) {
+                self.keys.remove(&key.id);
+                let low = !key.priority.critical();
+                admitted.push((waiting.start, Slot { origin: waiting.origin, low }));
+            }
+        }
+        admitted
+    }
+}
+
+impl FetchScheduler {
+    pub fn global() -> &'static FetchScheduler {
+        static SCHEDULER: OnceLock<FetchScheduler> = OnceLock::new();
+        SCHEDULER.get_or_init(|| FetchScheduler {
+            state: Mutex::new(SchedulerState {
+                queue: BTreeMap::new(),
+                keys: HashMap::new(),
+                origins: HashMap::new(),
+                in_flight: 0,
+                low_in_flight: 0,
+                active_tab: NO_TAB,
+                next_id: 1,
+            }),
+        })
+    }
+
+    // Ставит запрос в очередь. Вкладка берется из меток памяти вызывающего потока
+    pub fn enqueue(&self, url: &str, priority: FetchPriority) -> Ticket {
+        let origin = origin_of(url);
+        let tab = memory::current_tags().tab;
+        let cancel = cancel::for_tab(tab);
+        let (start, receiver) = oneshot::channel();
+
+        let (id, admitted) = {
+            let mut state = self.state.lock().unwrap();
+            let id = state.next_id;
+            state.next_id += 1;
+            let key = QueueKey {
+                background: state.is_background(tab),
+                priority,
+                id,
+            };
+            state.queue.insert(key, Waiting { origin, tab, start });
+            state.keys.insert(id, key);
+            (id, state.admit())
+        };
+        Self::start(admitted);
+        Ticket { id, receiver, cancel }
+    }
+
+    // Меняет класс ждущего запроса; false - запрос уже в сети или завершен
+    pub fn set_priority(&self, id: u64, priority: FetchPriority) -> bool {
+        let admitted = {
+            let mut state = self.state.lock().unwrap();
+            let key = match state.keys.get(&id) {
+                Some(key) => *key,
+                None => return false,
+            };
+            if key.priority == priority {
+                return true;
+            }
+            let waiting = state.queue.remove(&key).unwrap();
+            let key = QueueKey { priority, ..key };
+            state.queue.insert(key, waiting);
+            state.keys.insert(id, key);
+            state.admit()
+        };
+        Self::start(admitted);
+        true
+    }
+
+    // Запросы остальных вкладок пропускают вперед запросы этой
+    pub fn set_active_tab(&self, tab: u16) {
+        let admitted = {
+            let mut state = self.state.lock().unwrap();
+            if state.active_tab == tab {
+                return;
+            }
+            state.active_tab = tab;
+
+            let queue = std::mem::take(&mut state.queue);
+            for (key, waiting) in queue {
+                let key = QueueKey {
+                    background: state.is_background(waiting.tab),
+                    ..key
+                };
+                state.keys.insert(key.id, key);
+                state.queue.insert(key, waiting);
+            }
+            state.admit()
+        };
+        Self::start(admitted);
+    }
+
+    fn withdraw(&self, id: u64) {
+        let mut state = self.state.lock().unwrap();
+        if let Some(key) = state.keys.remove(&id) {
+            state.queue.remove(&key);
+        }
+    }
+
+    fn release(&self, origin: &str, low: bool) {
+        let admitted = {
+            let mut state = self.state.lock().unwrap();
+            state.in_flight -= 1;
+            if low {
+                state.low_in_flight -= 1;
+            }
+            if let Some(load) = state.origins.get_mut(origin) {
+                load.total -= 1;
+                if low {
+                    load.low -= 1;
+                }
+                if load.total == 0 {
+                    state.origins.remove(origin);
+                }
+            }
+            state.admit()
+        };
+        Self::start(admitted);
+    }
+
+    // Вне замка: если ожидающий уже ушел, брошенный Slot сам вызовет release
+    fn start(admitted: Vec<(oneshot::Sender<Slot>, Slot)>) {
+        for (start, slot) in admitted {
+            let _ = start.send(slot);
+        }
+    }
+}
@@ -0,0 +1,355 @@
+use std::alloc::{alloc, dealloc, Layout};
+use std::collections::HashMap;
+use std::mem::{align_of, size_of};
+use std::ptr;
+
+use crate::computed_style::ComputedStyle;
+use crate::dom::{Document, TextRange};
+use crate::style::StyleEngine;
+use crate::tag_atoms::TAG_TABLE_HASH;
+use crate::trace;
+
+// Плоский снимок DOM для передачи в C++ одним блоком памяти.
+//
+// Раскладка буфера (все смещения - от начала буфера):
+//   [HtmlSnapshot][HtmlSnapshotNode; node_count][HtmlSnapshotAttr; attr_count]
+//   [HtmlSnapshotStyle; style_count][строки]
+// Строки лежат в общей арене, каждая завершается '\0' (len его не учитывает),
+// поэтому C++ может отдавать их в GTK без копирования.
+
+pub const SNAPSHOT_MAGIC: u32 = 0x4857_4753; // "HWGS"
+pub const SNAPSHOT_VERSION: u32 = 4;
+
+// У узла нет вычисленного стиля (текст, корень документа)
+pub const NO_STYLE: u32 = u32::MAX;
+
+const SNAPSHOT_ALIGN: usize = 8;
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct HtmlSnapshotStr {
+    pub offset: u32,
+    pub len: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct HtmlSnapshotNode {
+    pub tag: HtmlSnapshotStr,
+    pub text: HtmlSnapshotStr,
+    pub first_attr: u32,
+    pub attr_count: u32,
+    pub kind: u32,
+    // Структура дерева: индексы узлов, u32::MAX - нет узла
+    pub parent: u32,
+    pub first_child: u32,
+    pub next_sibling: u32,
+    // Индекс в таблице стилей или NO_STYLE
+    pub style: u32,
+    // tag_atoms::TagAtom; 0 - неизвестный тег, имя есть только в tag
+    pub tag_atom: u32,
+}
+
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct HtmlSnapshotAttr {
+    pub name: HtmlSnapshotStr,
+    pub value: HtmlSnapshotStr,
+}
+
+// Вычисленный стиль в виде, готовом для раскладки. Одинаковые стили
+// элементов хранятся в таблице один раз
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct HtmlSnapshotStyle {
+    pub font_size: f32,
+    // 0xRRGGBB
+    pub color: u32,
+    // Вертикальные поля вместе с внутренними отступами
+    pub margin_top: f32,
+    pub margin_bottom: f32,
+    // Сдвиг содержимого вправо: margin-left + padding-left
+    pub indent: f32,
+    // computed_style::Display
+    pub display: u8,
+    pub bold: u8,
+    pub italic: u8,
+    pub monospace: u8,
+    pub underline: u8,
+    pub preformatted: u8,
+    pub reserved: [u8; 2],
+}
+
+impl HtmlSnapshotStyle {
+    fn from_computed(style: &ComputedStyle) -> Self {
+        Self {
+            font_size: style.font_size,
+            color: style.color,
+            margin_top: style.margin_top + style.padding_top,
+            margin_bottom: style.margin_bottom + style.padding_bottom,
+            indent: style.margin_left + style.padding_left,
+            display: style.display as u8,
+            bold: style.bold as u8,
+            italic: style.italic as u8,
+            monospace: style.monospace as u8,
+            underline: style.underline as u8,
+            preformatted: style.preformatted as u8,
+            reserved: [0; 2],
+        }
+    }
+
+    // Побитовый ключ для дедупликации таблицы
+    fn key(&self) -> [u32; 6] {
+        [
+            self.font_size.to_bits(),
+            self.color,
+            self.margin_top.to_bits(),
+            self.margin_bottom.to_bits(),
+            self.indent.to_bits(),
+            u32::from_le_bytes([self.display, self.bold | self.italic << 1 | self.monospace << 2,
+                                self.underline, self.preformatted]),
+        ]
+    }
+}
+
+#[repr(C)]
+#[derive(Debug)]
+pub struct HtmlSnapshot {
+    pub magic: u32,
+    pub version: u32,
+    pub total_size: u64,
+    pub node_count: u32,
+    pub attr_count: u32,
+    pub nodes_offset: u32,
+    pub attrs_offset: u32,
+    pub strings_offset: u32,
+    pub strings_len: u32,
+    pub style_count: u32,
+    pub styles_offset: u32,
+    // Контрольная сумма таблицы атомов: номера тегов должны совпадать с C++
+    pub tag_table_hash: u32,
+}
+
+// Накопитель таблиц до упаковки в один буфер
+struct SnapshotBuilder<'a> {
+    nodes: Vec<HtmlSnapshotNode>,
+    attrs: Vec<HtmlSnapshotAttr>,
+    styles: Vec<HtmlSnapshotStyle>,
+    strings: Vec<u8>,
+    // Имена тегов и атрибутов повторяются, храним их в арене один раз
+    interned: HashMap<&'a str, HtmlSnapshotStr>,
+}
+
+impl<'a> SnapshotBuilder<'a> {
+    fn new() -> Self {
+        Self {
+            nodes: Vec::new(),
+            attrs: Vec::new(),
+            styles: Vec::new(),
+            strings: Vec::new(),
+            interned: HashMap::new(),
+        }
+    }
+
+    fn push_str(&mut self, s: &str) -> HtmlSnapshotStr {
+        let offset = self.strings.len() as u32;
+        self.strings.extend_from_slice(s.as_bytes());
+        self.strings.push(0);
+        HtmlSnapshotStr { offset, len: s.len() as u32 }
+    }
+
+    fn intern(&mut self, s: &'a str) -> HtmlSnapshotStr {
+        if let Some(existing) = self.interned.get(s) {
+            return *existing;
+        }
+        let stored = self.push_str(s);
+        self.interned.insert(s, stored);
+        stored
+    }
+
+    fn finish(self) -> *const HtmlSnapshot {
+        let nodes_offset = align_up(size_of::<HtmlSnapshot>(), SNAPSHOT_ALIGN);
+        let attrs_offset = align_up(
+            nodes_offset + self.nodes.len() * size_of::<HtmlSnapshotNode>(),
+            SNAPSHOT_ALIGN,
+        );
+        let styles_offset = align_up(
+            attrs_offset + self.attrs.len() * size_of::<HtmlSnapshotAttr>(),
+            SNAPSHOT_ALIGN,
+        );
+        let strings_offset = align_up(
+            styles_offset + self.styles.len() * size_of::<HtmlSnapshotStyle>(),
+            SNAPSHOT_ALIGN,
+        );
+        let total_size = strings_offset + self.strings.len();
+
+        if total_size > u32::MAX as usize {
+            return ptr::null();
+        }
+
+        let layout = match snapshot_layout(total_size) {
+            Some(layout) => layout,
+            None => return ptr::null(),
+        };
+
+        unsafe {
+            let base = alloc(layout);
+            if base.is_null() {
+                return ptr::null();
+            }
+
+            let header = HtmlSnapshot {
+                magic: SNAPSHOT_MAGIC,
+                version: SNAPSHOT_VERSION,
+                total_size: total_size as u64,
+                node_count: self.nodes.len() as u32,
+                attr_count: self.attrs.len() as u32,
+                nodes_offset: nodes_offset as u32,
+                attrs_offset: attrs_offset as u32,
+                strings_offset: strings_offset as u32,
+                strings_len: self.strings.len() as u32,
+                style_count: self.styles.len() as u32,
+                styles_offset: styles_offset as u32,
+                tag_table_hash: TAG_TABLE_HASH,
+            };
+            ptr::write(base as *mut HtmlSnapshot, header);
+            ptr::copy_nonoverlapping(
+                self.nodes.as_ptr(),
+                base.add(nodes_offset) as *mut HtmlSnapshotNode,
+                self.nodes.len(),
+            );
+            ptr::copy_nonoverlapping(
+                self.attrs.as_ptr(),
+                base.add(attrs_offset) as *mut HtmlSnapshotAttr,
+                self.attrs.len(),
+            );
+            ptr::copy_nonoverlapping(
+                self.styles.as_ptr(),
+                base.add(styles_offset) as *mut HtmlSnapshotStyle,
+                self.styles.len(),
+            );
+            ptr::copy_nonoverlapping(
+                self.strings.as_ptr(),
+                base.add(strings_offset),
+                self.strings.len(),
+            );
+
+            base as *const HtmlSnapshot
+        }
+    }
+}
+
+fn align_up(value: usize, align: usize) -> usize {
+    (value + align - 1) & !(align - 1)
+}
+
+fn snapshot_layout(total_size: usize) -> Option<Layout> {
+    let align = SNAPSHOT_ALIGN
+        .max(align_of::<HtmlSnapshot>())
+        .max(align_of::<HtmlSnapshotNode>())
+        .max(align_of::<HtmlSnapshotAttr>())
+        .max(align_of::<HtmlSnapshotStyle>());
+    Layout::from_size_align(total_size, align).ok()
+}
+
+fn text_str(range: TextRange) -> HtmlSnapshotStr {
+    HtmlSnapshotStr { offset: range.start, len: range.len }
+}
+
+// Собирает снимок документа. Пул строк DOM копируется в арену целиком,
+// поэтому диапазоны текста и значений атрибутов переносятся без пересчета.
+// Стили вычисляются здесь же: раскладка получает готовые значения.
+pub fn build_snapshot(document: &Document) -> *const HtmlSnapshot {
+    let node_styles = {
+        let _span = trace::Span::begin("style", "style");
+        StyleEngine::from_document(document).resolve_document(document)
+    };
+    let mut span = trace::Span::begin("ffi", "snapshot_build");
+    let mut builder = SnapshotBuilder::new();
+    // Одинаковые стили попадают в таблицу один раз, даже если их вычислили
+    // разные потоки
+    let mut style_indices: HashMap<[u32; 6], u32> = HashMap::new();
+    builder.strings.extend_from_slice(document.strings.as_bytes());
+    builder.nodes.reserve(document.nodes.len());
+    builder.attrs.reserve(document.attrs.len());
+
+    for attr in &document.attrs {
+        let name = builder.intern(&attr.name);
+        builder.attrs.push(HtmlSnapshotAttr { name, value: text_str(attr.value) });
+    }
+
+    for (node, computed) in document.nodes.iter().zip(&node_styles) {
+        let tag = builder.intern(&node.tag);
+        let style = match computed {
+            Some(computed) => {
+                let style = HtmlSnapshotStyle::from_computed(computed);
+                *style_indices.entry(style.key()).or_insert_with(|| {
+                    builder.styles.push(style);
+                    (builder.styles.len() - 1) as u32
+                })
+            }
+            None => NO_STYLE,
+        };
+        builder.nodes.push(HtmlSnapshotNode {
+            tag,
+            text: text_str(node.text),
+            first_attr: node.first_attr,
+            attr_count: node.attr_count,
+            kind: node.kind as u32,
+            parent: node.parent,
+            first_child: node.first_child,
+            next_sibling: node.next_sibling,
+            style,
+            tag_atom: node.atom as u32,
+        });
+    }
+
+    let snapshot = builder.finish();
+    if !snapshot.is_null() {
+        span.set_bytes(unsafe { (*snapshot).total_size });
+    }
+    snapshot
+}
+
+// Освобождает снимок, созданный build_snapshot
+pub unsafe fn free_snapshot(snapshot: *const HtmlSnapshot) {
+    if snapshot.is_null() {
+        return;
+    }
+    let total_size = (*snapshot).total_size as usize;
+    if let Some(layout) = snapshot_layout(total_size) {
+        dealloc(snapshot as *mut u8, layout);
+    }
+}
+
+// Владеющая обертка для передачи готового снимка между потоками
+pub struct OwnedSnapshot(*const HtmlSnapshot);
+
+// Снимок неизменяем после сборки и не ссылается на данные потока-создателя
+unsafe impl Send for OwnedSnapshot {}
+
+impl OwnedSnapshot {
+    pub fn build(document: &Document) -> Option<Self> {
+        let snapshot = build_snapshot(document);
+        if snapshot.is_null() {
+            None
+        } else {
+            Some(Self(snapshot))
+        }
+    }
+
+    // Передает владение вызывающему (C++ освобождает через html_snapshot_free)
+    pub fn into_raw(self) -> *const HtmlSnapshot {
+        let snapshot = self.0;
+        std::mem::forget(self);
+        snapshot
+    }
+}
+
+impl Drop for OwnedSnapshot {
+    fn drop(&mut self) {
+        unsafe {
+            free_snapshot(self.0);
+        }
+    }
+}
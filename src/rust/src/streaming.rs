@@ -0,0 +1,363 @@
+use std::sync::atomic::{AtomicBool, AtomicI32, AtomicU32, AtomicU64, Ordering};
+use std::ffi::c_void;
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+
+use bytes::Bytes;
+use reqwest::header::{HeaderMap, ETAG, IF_MODIFIED_SINCE, IF_NONE_MATCH, LAST_MODIFIED};
+use reqwest::StatusCode;
+use tokio::sync::mpsc;
+use tokio::task::JoinHandle;
+
+use crate::cancel::CancelToken;
+use crate::dom::Document;
+use crate::html_parser::IncrementalParser;
+use crate::memory::{self, Subsystem, TagScope};
+use crate::network::NetworkManager;
+use crate::preload::{self, PreloadScanner};
+use crate::scheduler::{FetchPriority, FetchScheduler};
+use crate::snapshot::OwnedSnapshot;
+use crate::trace;
+
+pub const STREAM_LOADING: i32 = 0;
+pub const STREAM_DONE: i32 = 1;
+pub const STREAM_FAILED: i32 = -1;
+// Условный запрос: сервер ответил 304, сохраненная копия актуальна
+pub const STREAM_NOT_MODIFIED: i32 = 2;
+
+// Предварительное выделение по Content-Length не больше этого размера
+const MAX_PREALLOC: u64 = 16 * 1024 * 1024;
+const STREAM_TIMEOUT: Duration = Duration::from_secs(10);
+
+// События от сетевой задачи к задаче разбора
+enum BodyEvent {
+    // url - адрес ответа после перенаправлений
+    Headers {
+        url: String,
+        content_length: u64,
+        http_status: u16,
+        validators: Validators,
+    },
+    Chunk(Bytes),
+    End,
+    NotModified {
+        url: String,
+    },
+}
+
+// Валидаторы HTTP кэша: в запросе - от сохраненной копии, в ответе - от сервера
+#[derive(Debug, Clone, Default)]
+pub struct Validators {
+    pub etag: Option<String>,
+    pub last_modified: Option<String>,
+}
+
+impl Validators {
+    fn from_headers(headers: &HeaderMap) -> Self {
+        let header = |name| {
+            headers
+                .get(name)
+                .and_then(|value: &reqwest::header::HeaderValue| value.to_str().ok())
+                .map(str::to_string)
+        };
+        Self {
+            etag: header(ETAG),
+            last_modified: header(LAST_MODIFIED),
+        }
+    }
+}
+
+// Уведомление о событии загрузки (новые байты, снимок, завершение).
+// Вызывается из рабочих потоков, поэтому должно только разбудить UI-цикл.
+pub type StreamNotifyFn = extern "C" fn(user_data: *mut c_void);
+
+struct StreamNotify {
+    callback: StreamNotifyFn,
+    user_data: *mut c_void,
+}
+
+// user_data принадлежит вызывающему; он же гарантирует потокобезопасность callback
+unsafe impl Send for StreamNotify {}
+
+// Итог загрузки: готовый DOM и тело ответа (для кэша)
+pub struct StreamResult {
+    pub document: Document,
+    pub body: Vec<u8>,
+}
+
+// Состояние, разделяемое потоком загрузки и UI
+pub struct StreamState {
+    status: AtomicI32,
+    bytes_received: AtomicU64,
+    // 0 - размер неизвестен (нет Content-Length)
+    content_length: AtomicU64,
+    // 0 - ответ еще не получен
+    http_status: AtomicU32,
+    response_validators: Mutex<Validators>,
+    // Адрес ответа после перенаправлений; None - ответа еще нет
+    final_url: Mutex<Option<String>>,
+    preview_requested: AtomicBool,
+    preview: Mutex<Option<OwnedSnapshot>>,
+    result: Mutex<Option<StreamResult>>,
+    notify: Mutex<Option<StreamNotify>>,
+}
+
+impl StreamState {
+    fn new() -> Self {
+        Self {
+            status: AtomicI32::new(STREAM_LOADING),
+            bytes_received: AtomicU64::new(0),
+            content_length: AtomicU64::new(0),
+            http_status: AtomicU32::new(0),
+            response_validators: Mutex::new(Validators::default()),
+            final_url: Mutex::new(None),
+            preview_requested: AtomicBool::new(false),
+            preview: Mutex::new(None),
+            result: Mutex::new(None),
+            notify: Mutex::new(None),
+        }
+    }
+
+    fn publish_preview(&self, document: &Document) {
+        if let Some(snapshot) = OwnedSnapshot::build(document) {
+            *self.preview.lock().unwrap() = Some(snapshot);
+        }
+    }
+
+    // Вызов под замком: после detach_notify callback гарантированно не вызывается
+    fn notify(&self) {
+        if let Some(notify) = self.notify.lock().unwrap().as_ref() {
+            (notify.callback)(notify.user_data);
+        }
+    }
+
+    fn set_status(&self, status: i32) {
+        self.status.store(status, Ordering::Release);
+        self.notify();
+    }
+}
+
+// Загрузка HTML, при которой тело разбирается по мере поступления кусков.
+// Сеть обслуживает общий рантайм, разбор идет в блокирующей задаче того же
+// рантайма: токенизатор html5ever не Send и не должен занимать потоки ввода-вывода.
+pub struct StreamingFetch {
+    state: Arc<StreamState>,
+    parse_task: Option<JoinHandle<()>>,
+}
+
+impl Drop for StreamingFetch {
+    // Задачи могут пережить handle, но будить владельца после этого уже нельзя
+    fn drop(&mut self) {
+        self.detach_notify();
+    }
+}
+
+impl StreamingFetch {
+    pub fn start(url: String) -> Self {
+        Self::start_with_notify(url, Validators::default(), None)
+    }
+
+    // С валидаторами запрос становится условным и может завершиться STREAM_NOT_MODIFIED
+    pub fn start_with_notify(
+        url: String,
+        validators: Validators,
+        notify: Option<(StreamNotifyFn, *mut c_void)>,
+    ) -> Self {
+        let state = Arc::new(StreamState::new());
+        if let Some((callback, user_data)) = notify {
+            *state.notify.lock().unwrap() = Some(StreamNotify { callback, user_data });
+        }
+
+        let network = match NetworkManager::global() {
+            Some(network) => network,
+            None => {
+                state.set_status(STREAM_FAILED);
+                return Self { state, parse_task: None };
+            }
+        };
+
+        // Память загрузки и разбора считается за вкладкой, начавшей загрузку
+        let tags = memory::current_tags();
+        let navigation = trace::current_navigation();
+
+        let (sender, receiver) = mpsc::unbounded_channel();
+        // Отмена вкладки бросает сетевую задачу; канал закрывается без End,
+        // и разбор завершается с STREAM_FAILED
+        let ticket = FetchScheduler::global().enqueue(&url, FetchPriority::Document);
+        let cancel = ticket.cancel_token().clone();
+        let fetch = fetch_body(network.client().clone(), url, validators, sender, cancel);
+        network.spawn(trace::traced(
+            navigation,
+            memory::tagged(
+                tags.with_subsystem(Subsystem::Network),
+                NetworkManager::scheduled(ticket, fetch),
+            ),
+        ));
+
+        let parse_state = Arc::clone(&state);
+        let parse_task = network.spawn_blocking(move || {
+            let _scope = TagScope::enter(tags.with_subsystem(Subsystem::Parser));
+            let _navigation = trace::NavigationScope::enter(navigation);
+            let status = parse_body(receiver, &parse_state).unwrap_or(STREAM_FAILED);
+            parse_state.set_status(status);
+        });
+
+        Self { state, parse_task: Some(parse_task) }
+    }
+
+    pub fn status(&self) -> i32 {
+        self.state.status.load(Ordering::Acquire)
+    }
+
+    pub fn progress(&self) -> (u64, u64) {
+        (
+            self.state.bytes_received.load(Ordering::Relaxed),
+            self.state.content_length.load(Ordering::Relaxed),
+        )
+    }
+
+    pub fn http_status(&self) -> u16 {
+        self.state.http_status.load(Ordering::Acquire) as u16
+    }
+
+    pub fn response_validators(&self) -> Validators {
+        self.state.response_validators.lock().unwrap().clone()
+    }
+
+    // От него сканер разрешал адреса ресурсов; раскладка должна делать так же
+    pub fn final_url(&self) -> Option<String> {
+        self.state.final_url.lock().unwrap().clone()
+    }
+
+    // Просит задачу разбора опубликовать снимок частичного DOM после следующего куска
+    pub fn request_preview(&self) {
+        self.state.preview_requested.store(true, Ordering::Release);
+    }
+
+    pub fn take_preview(&self) -> Option<OwnedSnapshot> {
+        self.state.preview.lock().unwrap().take()
+    }
+
+    // Отключает уведомления; после возврата callback больше не будет вызван
+    pub fn detach_notify(&self) {
+        *self.state.notify.lock().unwrap() = None;
+    }
+
+    // Дожидается завершения разбора и забирает результат
+    pub fn finish(mut self) -> Option<StreamResult> {
+        if let (Some(task), Some(network)) = (self.parse_task.take(), NetworkManager::global()) {
+            let _ = network.block_on(task);
+        }
+        self.state.result.lock().unwrap().take()
+    }
+}
+
+// Сетевая часть: читает ответ кусками и передает их разбору.
+// Если канал закрылся без End, загрузка считается неудавшейся.
+async fn fetch_body(
+    client: reqwest::Client,
+    url: String,
+    validators: Validators,
+    sender: mpsc::UnboundedSender<BodyEvent>,
+    cancel: CancelToken,
+) -> Option<()> {
+    let mut request = client.get(&url).timeout(STREAM_TIMEOUT);
+    if let Some(etag) = validators.etag {
+        request = request.header(IF_NONE_MATCH, etag);
+    }
+    if let Some(last_modified) = validators.last_modified {
+        request = request.header(IF_MODIFIED_SINCE, last_modified);
+    }
+
+    let mut resp = NetworkManager::send_traced(request).await?;
+    if resp.status() == StatusCode::NOT_MODIFIED {
+        return sender
+            .send(BodyEvent::NotModified {
+                url: resp.url().to_string(),
+            })
+            .ok();
+    }
+
+    sender
+        .send(BodyEvent::Headers {
+            url: resp.url().to_string(),
+            content_length: resp.content_length().unwrap_or(0),
+            http_status: resp.status().as_u16(),
+            validators: Validators::from_headers(resp.headers()),
+        })
+        .ok()?;
+
+    // Сканер идет впереди разбора: картинки начинают грузиться, пока
+    // разбор еще не дошел до них
+    let mut scanner = PreloadScanner::new(Some(resp.url().clone()));
+    let mut body_span = trace::Span::begin("network", "body");
+    let mut received = 0;
+    while let Some(chunk) = resp.chunk().await.ok()? {
+        received += chunk.len() as u64;
+        body_span.set_bytes(received);
+        for found in scanner.scan(&chunk) {
+            preload::start(found, &cancel);
+        }
+        sender.send(BodyEvent::Chunk(chunk)).ok()?;
+    }
+    drop(body_span);
+
+    sender.send(BodyEvent::End).ok()
+}
+
+// Возвращает итоговый статус загрузки; None - ошибка
+fn parse_body(mut receiver: mpsc::UnboundedReceiver<BodyEvent>, state: &StreamState) -> Option<i32> {
+    let content_length = match receiver.blocking_recv()? {
+        BodyEvent::Headers {
+            url,
+            content_length,
+            http_status,
+            validators,
+        } => {
+            *state.final_url.lock().unwrap() = Some(url);
+            *state.response_validators.lock().unwrap() = validators;
+            state.http_status.store(http_status as u32, Ordering::Release);
+            content_length
+        }
+        BodyEvent::NotModified { url } => {
+            *state.final_url.lock().unwrap() = Some(url);
+            state.http_status.store(StatusCode::NOT_MODIFIED.as_u16() as u32, Ordering::Release);
+            return Some(STREAM_NOT_MODIFIED);
+        }
+        _ => return None,
+    };
+    state.content_length.store(content_length, Ordering::Relaxed);
+    state.notify();
+
+    let prealloc = content_length.min(MAX_PREALLOC) as usize;
+    let mut parser = IncrementalParser::with_capacity_hint(prealloc);
+    let mut body = Vec::with_capacity(prealloc);
+
+    loop {
+        match receiver.blocking_recv()? {
+            BodyEvent::Chunk(chunk) => {
+                let mut span = trace::Span::begin("parser", "parse_chunk");
+                span.set_bytes(chunk.len() as u64);
+                body.extend_from_slice(&chunk);
+                parser.feed(&chunk);
+                state.bytes_received.fetch_add(chunk.len() as u64, Ordering::Relaxed);
+
+                if state.preview_requested.swap(false, Ordering::AcqRel) {
+                    let _span = trace::Span::begin("parser", "preview_snapshot");
+                    state.publish_preview(parser.document());
+                }
+                state.notify();
+            }
+            BodyEvent::End => break,
+            BodyEvent::Headers { .. } | BodyEvent::NotModified { .. } => return None,
+        }
+    }
+
+    let document = {
+        let mut span = trace::Span::begin("parser", "parse_finish");
+        span.set_bytes(body.len() as u64);
+        parser.finish()
+    };
+    *state.result.lock().unwrap() = Some(StreamResult { document, body });
+    Some(STREAM_DONE)
+}
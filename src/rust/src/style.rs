@@ -0,0 +1,545 @@
+use std::collections::hash_map::DefaultHasher;
+use std::collections::HashMap;
+use std::hash::{Hash, Hasher};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::thread;
+
+use html5ever::LocalName;
+use selectors::parser::AncestorHashes;
+use selectors::NthIndexCache;
+
+use crate::computed_style::ComputedStyle;
+use crate::css_parser::{parse_declarations, Stylesheet};
+use crate::css_selector::{ancestor_hashes, matches, subject_key, AncestorFilter, ElementInfo, SubjectKey};
+use crate::dom::{Document, NodeKind, NO_NODE};
+use crate::memory::{self, TagScope};
+use crate::tag_atoms::TagAtom;
+
+// Стили браузера по умолчанию. Авторские правила всегда перекрывают их,
+// независимо от специфичности
+const USER_AGENT_CSS: &str = r#"
+html { display: block; color: #212529 }
+head, title, script, style, meta, link, noscript, template, [hidden], input[type=hidden] { display: none }
+body, div, tr, section, article, header, footer, nav, main, aside, figure, figcaption, dl, dt, dd,
+address, fieldset, thead, tbody, tfoot, caption, hr { display: block }
+h1, h2, h3, h4, h5, h6 { display: block; font-weight: bold; color: #343a40; margin: 10px 0 5px }
+h1 { font-size: 32px; margin: 15px 0 10px }
+h2 { font-size: 24px }
+h3 { font-size: 20px }
+h4 { font-size: 18px }
+h5 { font-size: 16px }
+h6 { font-size: 14px }
+p, pre { display: block; margin: 5px 0 10px }
+blockquote { display: block; margin: 5px 0 10px 20px }
+ul, ol { display: block; margin: 5px 0; padding-left: 30px }
+li { display: list-item; margin: 2px 0 }
+table, form { display: block; margin: 10px 0 }
+dd { margin-left: 30px }
+td, th { display: table-cell }
+hr { margin: 8px 0 }
+a:link { color: #007bff; text-decoration: underline }
+strong, b, th { font-weight: bold }
+em, i, cite, var { font-style: italic }
+u, ins { text-decoration: underline }
+code, kbd, samp, tt, pre { font-family: monospace; font-size: 0.875em }
+pre { white-space: pre }
+small { font-size: 0.85em }
+"#;
+
+fn user_agent_stylesheet() -> &'static Stylesheet {
+    static SHEET: OnceLock<Stylesheet> = OnceLock::new();
+    SHEET.get_or_init(|| Stylesheet::parse(USER_AGENT_CSS))
+}
+
+// Ключ каскада: авторские правила старше пользовательского агента при любой
+// специфичности (она занимает младшие 30 бит)
+const AUTHOR_ORIGIN: u32 = 1 << 30;
+
+// Ссылка на один селектор правила в индексе
+#[derive(Clone)]
+struct IndexedSelector {
+    rule: u32,
+    selector: u32,
+    specificity: u32,
+    ancestor_hashes: AncestorHashes,
+}
+
+// Правила, разложенные по самому правому id, классу или тегу селектора:
+// элементу достаются только корзины его id, классов и тега плюс
+// универсальные правила, а не вся таблица стилей
+#[derive(Debug, Default)]
+struct SelectorIndex {
+    by_id: HashMap<Box<str>, Vec<IndexedSelector>>,
+    by_class: HashMap<Box<str>, Vec<IndexedSelector>>,
+    by_tag: HashMap<Box<str>, Vec<IndexedSelector>>,
+    universal: Vec<IndexedSelector>,
+}
+
+impl SelectorIndex {
+    // Первые user_agent_rules правил таблицы - правила браузера
+    fn build(stylesheet: &Stylesheet, user_agent_rules: usize) -> Self {
+        let mut index = Self::default();
+        for (rule_index, rule) in stylesheet.rules.iter().enumerate() {
+            let origin = if rule_index < user_agent_rules { 0 } else { AUTHOR_ORIGIN };
+            for (selector_index, selector) in rule.selectors.iter().enumerate() {
+                let entry = IndexedSelector {
+                    rule: rule_index as u32,
+                    selector: selector_index as u32,
+                    specificity: origin | selector.specificity(),
+                    ancestor_hashes: ancestor_hashes(selector),
+                };
+                match subject_key(selector) {
+                    SubjectKey::Id(id) => index.by_id.entry(id).or_default().push(entry),
+                    SubjectKey::Class(class) => index.by_class.entry(class).or_default().push(entry),
+                    SubjectKey::Tag(tag) => index.by_tag.entry(tag).or_default().push(entry),
+                    SubjectKey::Universal => index.universal.push(entry),
+                }
+            }
+        }
+        index
+    }
+}
+
+// Совпавшие правила всех элементов в формате CSR: правила элемента i лежат
+// в rules[offsets[i]..offsets[i + 1]] в порядке каскада (источник,
+// специфичность, затем порядок в таблице), так что поздние перекрывают ранние
+#[derive(Debug, Default)]
+pub struct MatchedRules {
+    pub offsets: Vec<u32>,
+    pub rules: Vec<u32>,
+}
+
+impl MatchedRules {
+    pub fn for_node(&self, index: u32) -> &[u32] {
+        let index = index as usize;
+        if index + 1 >= self.offsets.len() {
+            return &[];
+        }
+        &self.rules[self.offsets[index] as usize..self.offsets[index + 1] as usize]
+    }
+}
+
+// Таблица стилей документа с индексом селекторов
+#[derive(Debug, Default)]
+pub struct StyleEngine {
+    stylesheet: Stylesheet,
+    index: SelectorIndex,
+}
+
+impl StyleEngine {
+    // Только авторские правила, без стилей браузера
+    pub fn new(stylesheet: Stylesheet) -> Self {
+        let index = SelectorIndex::build(&stylesheet, 0);
+        Self { stylesheet, index }
+    }
+
+    // Стили браузера и все <style> документа в порядке их появления
+    pub fn from_document(document: &Document) -> Self {
+        let mut stylesheet = Stylesheet {
+            rules: user_agent_stylesheet().rules.clone(),
+        };
+        let user_agent_rules = stylesheet.rules.len();
+        for (index, node) in document.nodes.iter().enumerate() {
+            if node.kind == NodeKind::Element && node.atom == TagAtom::Style {
+                for child in document.children(index as u32) {
+                    let child = &document.nodes[child as usize];
+                    if child.kind == NodeKind::Text {
+                        stylesheet.append(document.text(child.text));
+                    }
+                }
+            }
+        }
+        let index = SelectorIndex::build(&stylesheet, user_agent_rules);
+        Self { stylesheet, index }
+    }
+
+    pub fn stylesheet(&self) -> &Stylesheet {
+        &self.stylesheet
+    }
+
+    // Сопоставляет все элементы документа одним обходом в глубину; фильтр
+    // Блума держит хэши текущих предков и отсекает селекторы с потомками,
+    // не заходя в полную проверку
+    pub fn match_document(&self, document: &Document) -> MatchedRules {
+        let mut result = MatchedRules {
+            offsets: Vec::with_capacity(document.nodes.len() + 1),
+            rules: Vec::new(),
+        };
+        let mut filter = AncestorFilter::new();
+        let mut nth_cache = NthIndexCache::default();
+        let mut ancestors: Vec<ElementInfo> = Vec::new();
+        let mut candidates: Vec<(u32, u32)> = Vec::new();
+
+        // Узлы хранятся в прямом порядке обхода, поэтому стек предков
+        // восстанавливается по ссылкам на родителя
+        for (index, node) in document.nodes.iter().enumerate() {
+            result.offsets.push(result.rules.len() as u32);
+            if node.kind != NodeKind::Element {
+                continue;
+            }
+
+            // У элемента верхнего уровня родитель - узел документа, которого
+            // в стеке нет: стек опустошается целиком
+            while let Some(top) = ancestors.last() {
+                if top.index == node.parent {
+                    break;
+                }
+                filter.pop(document, top);
+                ancestors.pop();
+            }
+
+            let info = ElementInfo::new(document, index as u32);
+            self.match_element(document, &info, &filter, &mut nth_cache, &mut candidates);
+            result.rules.extend(candidates.iter().map(|&(_, rule)| rule));
+
+            filter.push(document, &info);
+            ancestors.push(info);
+        }
+        result.offsets.push(result.rules.len() as u32);
+        result
+    }
+
+    // Правила одного элемента в порядке каскада: (специфичность, правило)
+    fn match_element(
+        &self,
+        document: &Document,
+        element: &ElementInfo,
+        filter: &AncestorFilter,
+        nth_cache: &mut NthIndexCache,
+        out: &mut Vec<(u32, u32)>,
+    ) {
+        out.clear();
+        let mut collect = |bucket: Option<&Vec<IndexedSelector>>| {
+            for entry in bucket.into_iter().flatten() {
+                if !filter.might_match(&entry.ancestor_hashes) {
+                    continue;
+                }
+                let selector = &self.stylesheet.rules[entry.rule as usize].selectors[entry.selector as usize];
+                if matches(selector, document, element, nth_cache) {
+                    out.push((entry.specificity, entry.rule));
+                }
+            }
+        };
+
+        if let Some(id) = element.id {
+            collect(self.index.by_id.get(id));
+        }
+        for class in element.classes() {
+            collect(self.index.by_class.get(class));
+        }
+        collect(self.index.by_tag.get(&*document.nodes[element.index as usize].tag));
+        collect(Some(&self.index.universal));
+
+        // Правило с несколькими совпавшими селекторами (или класс, указанный
+        // дважды) применяется один раз с наибольшей специфичностью
+        out.sort_unstable_by_key(|&(specificity, rule)| (rule, std::cmp::Reverse(specificity)));
+        out.dedup_by_key(|&mut (_, rule)| rule);
+        out.sort_unstable();
+    }
+
+    // Вычисляет стили всех элементов документа. Элементы с одинаковыми
+    // тегом, классами, стилем родителя и набором правил получают один
+    // общий стиль. Большие документы делятся на независимые поддеревья,
+    // которые считаются параллельно на всех ядрах
+    pub fn resolve_document(&self, document: &Document) -> NodeStyles {
+        let count = document.nodes.len();
+        let mut styles: NodeStyles = vec![None; count];
+        let threads = thread::available_parallelism().map(|n| n.get()).unwrap_or(1);
+
+        if threads == 1 || count < PARALLEL_THRESHOLD {
+            let mut cache = StyleSharingCache::default();
+            self.resolve_range(document, &[], 0, &mut styles, &mut cache);
+            return styles;
+        }
+
+        let target = (count / (threads * TASKS_PER_THREAD)).max(1);
+        let (serial, ranges) = split_work(document, target);
+
+        // Крупные узлы над точками разбиения - последовательно, в порядке
+        // документа: их стили нужны как родительские для задач
+        let mut cache = StyleSharingCache::default();
+        for &node in &serial {
+            let chain = ancestor_chain(document, &styles, document.nodes[node as usize].parent);
+            let index = node as usize;
+            self.resolve_range(document, &chain, index, &mut styles[index..index + 1], &mut cache);
+        }
+
+        let chains: Vec<_> = ranges
+            .iter()
+            .map(|&(parent, _, _)| ancestor_chain(document, &styles, parent))
+            .collect();
+
+        // Участки не пересекаются: каждая задача получает свой кусок результата
+        let mut tasks = Vec::with_capacity(ranges.len());
+        let mut rest = &mut styles[..];
+        let mut consumed = 0;
+        for ((_, first, end), chain) in ranges.into_iter().zip(chains) {
+            let (_, tail) = rest.split_at_mut(first - consumed);
+            let (out, tail) = tail.split_at_mut(end - first);
+            rest = tail;
+            consumed = end;
+            tasks.push(StyleTask { chain, first, out });
+        }
+
+        let workers = threads.min(tasks.len());
+        let queue = Mutex::new(tasks);
+        // Рабочие потоки считают память за того, кто запросил стили
+        let tags = memory::current_tags();
+        thread::scope(|scope| {
+            for _ in 0..workers {
+                scope.spawn(|| {
+                    let _scope = TagScope::enter(tags);
+                    let mut cache = StyleSharingCache::default();
+                    loop {
+                        let task = queue.lock().unwrap().pop();
+                        match task {
+                            Some(task) => self.resolve_range(document, &task.chain, task.first, task.out, &mut cache),
+                            None => break,
+                        }
+                    }
+                });
+            }
+        });
+
+        styles
+    }
+
+    // Стили узлов [first, first + out.len()) - подряд идущих в порядке
+    // документа; chain - уже вычисленные предки первого узла от корня
+    fn resolve_range(
+        &self,
+        document: &Document,
+        chain: &[(u32, Arc<ComputedStyle>)],
+        first: usize,
+        out: &mut [Option<Arc<ComputedStyle>>],
+        cache: &mut StyleSharingCache,
+    ) {
+        let mut filter = AncestorFilter::new();
+        let mut nth_cache = NthIndexCache::default();
+        let mut ancestors: Vec<(ElementInfo, Arc<ComputedStyle>)> = Vec::with_capacity(chain.len() + 32);
+        for (index, style) in chain {
+            let info = ElementInfo::new(document, *index);
+            filter.push(document, &info);
+            ancestors.push((info, style.clone()));
+        }
+        let mut matched = Vec::new();
+
+        for (offset, slot) in out.iter_mut().enumerate() {
+            let index = first + offset;
+            let node = &document.nodes[index];
+            if node.kind != NodeKind::Element {
+                continue;
+            }
+
+            while let Some((top, _)) = ancestors.last() {
+                if top.index == node.parent {
+                    break;
+                }
+                filter.pop(document, top);
+                ancestors.pop();
+            }
+            let parent = ancestors.last().map(|(_, style)| style).unwrap_or_else(|| root_parent_style());
+
+            let info = ElementInfo::new(document, index as u32);
+            self.match_element(document, &info, &filter, &mut nth_cache, &mut matched);
+            let style = self.compute_style(document, &info, parent, &matched, cache);
+            *slot = Some(style.clone());
+
+            filter.push(document, &info);
+            ancestors.push((info, style));
+        }
+    }
+
+    fn compute_style(
+        &self,
+        document: &Document,
+        element: &ElementInfo,
+        parent: &Arc<ComputedStyle>,
+        matched: &[(u32, u32)],
+        cache: &mut StyleSharingCache,
+    ) -> Arc<ComputedStyle> {
+        let tag = &document.nodes[element.index as usize].tag;
+        // style="" делает стиль элемента уникальным: такие не разделяются
+        let inline = document.attribute(element.index, "style");
+        let key = inline.is_none().then(|| StyleSharingCache::key(tag, element.class, parent, matched));
+        if let Some(key) = key {
+            if let Some(shared) = cache.get(key, tag, element.class, parent, matched) {
+                return shared;
+            }
+        }
+
+        let inline_declarations = inline.map(parse_declarations).unwrap_or_default();
+        let rules = matched
+            .iter()
+            .map(|&(_, rule)| &self.stylesheet.rules[rule as usize].declarations[..]);
+        let style = Arc::new(ComputedStyle::cascade(parent, rules, &inline_declarations));
+
+        if let Some(key) = key {
+            cache.insert(key, tag, element.class, parent, matched, &style);
+        }
+        style
+    }
+}
+
+// Вычисленные стили по узлам документа: у элементов Some, у остальных None.
+// Совпадающие стили - один и тот же Arc
+pub type NodeStyles = Vec<Option<Arc<ComputedStyle>>>;
+
+// На маленьких документах запуск потоков дороже самого вычисления
+const PARALLEL_THRESHOLD: usize = 4096;
+// Задач больше, чем потоков: быстрые потоки добирают работу медленных
+const TASKS_PER_THREAD: usize = 4;
+// Предел кэша разделяемых стилей одного потока
+const MAX_SHARED_STYLES: usize = 4096;
+
+// Родительский стиль элементов верхнего уровня
+fn root_parent_style() -> &'static Arc<ComputedStyle> {
+    static STYLE: OnceLock<Arc<ComputedStyle>> = OnceLock::new();
+    STYLE.get_or_init(|| Arc::new(ComputedStyle::initial()))
+}
+
+// Задача параллельного прохода: подряд идущие поддеревья с общими предками
+struct StyleTask<'a> {
+    chain: Vec<(u32, Arc<ComputedStyle>)>,
+    first: usize,
+    out: &'a mut [Option<Arc<ComputedStyle>>],
+}
+
+// Конец поддерева узла в порядке документа (индекс после последнего потомка)
+fn subtree_end(document: &Document, index: u32) -> usize {
+    let mut node = index;
+    loop {
+        let current = &document.nodes[node as usize];
+        if current.next_sibling != NO_NODE {
+            return current.next_sibling as usize;
+        }
+        if current.parent == NO_NODE {
+            return document.nodes.len();
+        }
+        node = current.parent;
+    }
+}
+
+// Делит документ на задачи примерно по target узлов. Поддерево крупнее
+// target раскрывается: сам узел уходит в последовательную часть, его
+// дети - в задачи. Соседние мелкие поддеревья одного родителя
+// объединяются в одну задачу. Возвращает последовательные узлы и
+// участки (родитель, начало, конец), все в порядке документа
+fn split_work(document: &Document, target: usize) -> (Vec<u32>, Vec<(u32, usize, usize)>) {
+    let mut serial = Vec::new();
+    let mut ranges = Vec::new();
+    let mut pending = vec![document.root()];
+
+    while let Some(parent) = pending.pop() {
+        let mut group: Option<usize> = None;
+        for child in document.children(parent) {
+            let start = child as usize;
+            let end = subtree_end(document, child);
+            if document.nodes[start].kind == NodeKind::Element && end - start > target {
+                if let Some(group_start) = group.take() {
+                    ranges.push((parent, group_start, start));
+                }
+                serial.push(child);
+                pending.push(child);
+            } else {
+                let group_start = *group.get_or_insert(start);
+                if end - group_start >= target {
+                    ranges.push((parent, group_start, end));
+                    group = None;
+                }
+            }
+        }
+        if let Some(group_start) = group {
+            ranges.push((parent, group_start, subtree_end(document, parent)));
+        }
+    }
+
+    serial.sort_unstable();
+    ranges.sort_unstable_by_key(|&(_, first, _)| first);
+    (serial, ranges)
+}
+
+// Предки-элементы от корня до node включительно с их вычисленными стилями
+fn ancestor_chain(document: &Document, styles: &NodeStyles, node: u32) -> Vec<(u32, Arc<ComputedStyle>)> {
+    let mut chain = Vec::new();
+    let mut current = node;
+    while current != NO_NODE && document.nodes[current as usize].kind == NodeKind::Element {
+        if let Some(style) = &styles[current as usize] {
+            chain.push((current, style.clone()));
+        }
+        current = document.nodes[current as usize].parent;
+    }
+    chain.reverse();
+    chain
+}
+
+struct SharedStyle {
+    tag: LocalName,
+    class: Box<str>,
+    parent: Arc<ComputedStyle>,
+    rules: Box<[u32]>,
+    style: Arc<ComputedStyle>,
+}
+
+// Кэш разделяемых стилей: соседние элементы с одинаковыми входами каскада
+// (тег, классы, стиль родителя, совпавшие правила) получают уже
+// вычисленный стиль без повторного каскада. Один кэш на поток
+#[derive(Default)]
+struct StyleSharingCache {
+    entries: HashMap<u64, Vec<SharedStyle>>,
+    len: usize,
+}
+
+impl StyleSharingCache {
+    fn key(tag: &str, class: &str, parent: &Arc<ComputedStyle>, matched: &[(u32, u32)]) -> u64 {
+        let mut hasher = DefaultHasher::new();
+        tag.hash(&mut hasher);
+        class.hash(&mut hasher);
+        (Arc::as_ptr(parent) as usize).hash(&mut hasher);
+        for &(_, rule) in matched {
+            rule.hash(&mut hasher);
+        }
+        hasher.finish()
+    }
+
+    fn get(
+        &self,
+        key: u64,
+        tag: &LocalName,
+        class: &str,
+        parent: &Arc<ComputedStyle>,
+        matched: &[(u32, u32)],
+    ) -> Option<Arc<ComputedStyle>> {
+        self.entries.get(&key)?.iter().find_map(|entry| {
+            let same = entry.tag == *tag
+                && &*entry.class == class
+                && Arc::ptr_eq(&entry.parent, parent)
+                && entry.rules.len() == matched.len()
+                && entry.rules.iter().zip(matched).all(|(&a, &(_, b))| a == b);
+            same.then(|| entry.style.clone())
+        })
+    }
+
+    fn insert(
+        &mut self,
+        key: u64,
+        tag: &LocalName,
+        class: &str,
+        parent: &Arc<ComputedStyle>,
+        matched: &[(u32, u32)],
+        style: &Arc<ComputedStyle>,
+    ) {
+        if self.len >= MAX_SHARED_STYLES {
+            self.entries.clear();
+            self.len = 0;
+        }
+        self.entries.entry(key).or_default().push(SharedStyle {
+            tag: tag.clone(),
+            class: class.into(),
+            parent: parent.clone(),
+            rules: matched.iter().map(|&(_, rule)| rule).collect(),
+            style: style.clone(),
+        });
+        self.len += 1;
+    }
+}
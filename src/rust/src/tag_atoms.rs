@@ -0,0 +1,176 @@
+// Атомы имен тегов: известный тег - маленькое число, одинаковое в Rust и C++.
+// Порядок должен совпадать с src/cpp/tag_atoms.h; контрольная сумма списка
+// записывается в снимок, и C++ отказывается принимать снимок с другой таблицей.
+
+macro_rules! tag_atoms {
+    ($($atom:ident => $name:literal,)*) => {
+        #[repr(u16)]
+        #[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, Default)]
+        pub enum TagAtom {
+            #[default]
+            Unknown = 0,
+            $($atom,)*
+        }
+
+        const TAG_NAMES: &[&str] = &["", $($name,)*];
+
+        impl TagAtom {
+            // Имя тега в нижнем регистре; html5ever уже приводит имена к нему
+            pub fn from_name(name: &str) -> Self {
+                match name {
+                    $($name => TagAtom::$atom,)*
+                    _ => TagAtom::Unknown,
+                }
+            }
+        }
+    };
+}
+
+tag_atoms! {
+    A => "a",
+    Abbr => "abbr",
+    Address => "address",
+    Area => "area",
+    Article => "article",
+    Aside => "aside",
+    Audio => "audio",
+    B => "b",
+    Base => "base",
+    Bdi => "bdi",
+    Bdo => "bdo",
+    Big => "big",
+    Blockquote => "blockquote",
+    Body => "body",
+    Br => "br",
+    Button => "button",
+    Canvas => "canvas",
+    Caption => "caption",
+    Center => "center",
+    Cite => "cite",
+    Code => "code",
+    Col => "col",
+    Colgroup => "colgroup",
+    Data => "data",
+    Datalist => "datalist",
+    Dd => "dd",
+    Del => "del",
+    Details => "details",
+    Dfn => "dfn",
+    Dialog => "dialog",
+    Div => "div",
+    Dl => "dl",
+    Dt => "dt",
+    Em => "em",
+    Embed => "embed",
+    Fieldset => "fieldset",
+    Figcaption => "figcaption",
+    Figure => "figure",
+    Font => "font",
+    Footer => "footer",
+    Form => "form",
+    H1 => "h1",
+    H2 => "h2",
+    H3 => "h3",
+    H4 => "h4",
+    H5 => "h5",
+    H6 => "h6",
+    Head => "head",
+    Header => "header",
+    Hgroup => "hgroup",
+    Hr => "hr",
+    Html => "html",
+    I => "i",
+    Iframe => "iframe",
+    Img => "img",
+    Input => "input",
+    Ins => "ins",
+    Kbd => "kbd",
+    Label => "label",
+    Legend => "legend",
+    Li => "li",
+    Link => "link",
+    Main => "main",
+    Map => "map",
+    Mark => "mark",
+    Menu => "menu",
+    Meta => "meta",
+    Meter => "meter",
+    Nav => "nav",
+    Noembed => "noembed",
+    Noframes => "noframes",
+    Noscript => "noscript",
+    Object => "object",
+    Ol => "ol",
+    Optgroup => "optgroup",
+    Option => "option",
+    Output => "output",
+    P => "p",
+    Param => "param",
+    Picture => "picture",
+    Pre => "pre",
+    Progress => "progress",
+    Q => "q",
+    Rp => "rp",
+    Rt => "rt",
+    Ruby => "ruby",
+    S => "s",
+    Samp => "samp",
+    Script => "script",
+    Section => "section",
+    Select => "select",
+    Slot => "slot",
+    Small => "small",
+    Source => "source",
+    Span => "span",
+    Strike => "strike",
+    Strong => "strong",
+    Style => "style",
+    Sub => "sub",
+    Summary => "summary",
+    Sup => "sup",
+    Svg => "svg",
+    Table => "table",
+    Tbody => "tbody",
+    Td => "td",
+    Template => "template",
+    Textarea => "textarea",
+    Tfoot => "tfoot",
+    Th => "th",
+    Thead => "thead",
+    Time => "time",
+    Title => "title",
+    Tr => "tr",
+    Track => "track",
+    Tt => "tt",
+    U => "u",
+    Ul => "ul",
+    Var => "var",
+    Video => "video",
+    Wbr => "wbr",
+    Xmp => "xmp",
+}
+
+// FNV-1a по именам, каждое с завершающим '\0'; так же считает C++
+pub const TAG_TABLE_HASH: u32 = table_hash();
+
+const fn table_hash() -> u32 {
+    let mut hash: u32 = 0x811c9dc5;
+    let mut atom = 0;
+    while atom < TAG_NAMES.len() {
+        let bytes = TAG_NAMES[atom].as_bytes();
+        let mut i = 0;
+        while i < bytes.len() {
+            hash = (hash ^ bytes[i] as u32).wrapping_mul(0x01000193);
+            i += 1;
+        }
+        hash = hash.wrapping_mul(0x01000193);
+        atom += 1;
+    }
+    hash
+}
+
+impl TagAtom {
+    pub fn name(self) -> &'static str {
+        TAG_NAMES[self as usize]
+    }
+}
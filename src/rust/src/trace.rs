@@ -0,0 +1,300 @@
+// Трассировка этапов загрузки на стороне Rust. Устроена как src/c/trace.c:
+// каждый поток пишет завершенные отрезки в свое кольцо, экспорт собирает
+// кольца всех потоков в события формата Chrome trace_event. Время - на
+// шкале CLOCK_MONOTONIC стороны C: при включении C++ передает текущее
+// значение, и дальше оно отсчитывается от Instant (на Linux это те же часы).
+
+use std::cell::{Cell, RefCell};
+use std::fmt::Write;
+use std::future::Future;
+use std::pin::Pin;
+use std::sync::atomic::{AtomicBool, AtomicU32, Ordering};
+use std::sync::{Arc, Mutex, OnceLock};
+use std::task::{Context, Poll};
+use std::time::Instant;
+
+// Событий в кольце одного потока, как TRACE_RING_CAPACITY в C
+const RING_CAPACITY: usize = 4096;
+// Номера потоков Rust не пересекаются с номерами потоков C
+const RUST_TID_BASE: u32 = 100_000;
+
+pub const NO_NAVIGATION: u64 = 0;
+
+#[derive(Debug, Clone, Copy)]
+struct Event {
+    name: &'static str,
+    category: &'static str,
+    start_ns: u64,
+    duration_ns: u64,
+    navigation: u64,
+    bytes: u64,
+}
+
+struct RingState {
+    events: Vec<Event>,
+    // Всего записано с последней очистки
+    written: u64,
+}
+
+struct Ring {
+    tid: u32,
+    // None - поток C++, его имя в трассу пишет сторона C
+    thread_name: Option<String>,
+    alive: AtomicBool,
+    state: Mutex<RingState>,
+}
+
+// Точка отсчета: момент включения и время C в этот момент
+struct Clock {
+    origin: Instant,
+    origin_ns: u64,
+}
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+// Задается при первом включении: часы C и Instant идут одинаково
+static CLOCK: OnceLock<Clock> = OnceLock::new();
+static NEXT_TID: AtomicU32 = AtomicU32::new(RUST_TID_BASE);
+
+fn rings() -> &'static Mutex<Vec<Arc<Ring>>> {
+    static RINGS: OnceLock<Mutex<Vec<Arc<Ring>>>> = OnceLock::new();
+    RINGS.get_or_init(|| Mutex::new(Vec::new()))
+}
+
+// Отмечает кольцо завершившегося потока: его освободит следующая очистка
+struct RingOwner(Arc<Ring>);
+
+impl Drop for RingOwner {
+    fn drop(&mut self) {
+        self.0.alive.store(false, Ordering::Release);
+    }
+}
+
+thread_local! {
+    static THREAD_RING: RefCell<Option<RingOwner>> = const { RefCell::new(None) };
+    static THREAD_NAVIGATION: Cell<u64> = const { Cell::new(NO_NAVIGATION) };
+    // Номер этого потока у стороны C (trace_thread_id), 0 - поток Rust
+    static BOUND_TID: Cell<u32> = const { Cell::new(0) };
+}
+
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+// now_ns - текущее время trace_now_ns() стороны C
+pub fn set_enabled(enabled: bool, now_ns: u64) {
+    if enabled {
+        CLOCK.get_or_init(|| Clock {
+            origin: Instant::now(),
+            origin_ns: now_ns,
+        });
+    }
+    ENABLED.store(enabled, Ordering::Relaxed);
+}
+
+// Время на шкале C; 0 - трассировка выключена
+pub fn now_ns() -> u64 {
+    if !enabled() {
+        return 0;
+    }
+    match CLOCK.get() {
+        Some(clock) => clock.origin_ns + clock.origin.elapsed().as_nanos() as u64,
+        None => 0,
+    }
+}
+
+pub fn current_navigation() -> u64 {
+    THREAD_NAVIGATION.try_with(Cell::get).unwrap_or(NO_NAVIGATION)
+}
+
+pub fn set_navigation(navigation: u64) {
+    let _ = THREAD_NAVIGATION.try_with(|cell| cell.set(navigation));
+}
+
+// События потока C++ попадают в трассу под его номером у стороны C.
+// Действует, если поток еще ничего не записал
+pub fn bind_thread(tid: u32) {
+    let _ = BOUND_TID.try_with(|cell| cell.set(tid));
+}
+
+// Навигация потока до конца области видимости
+pub struct NavigationScope {
+    previous: u64,
+}
+
+impl NavigationScope {
+    pub fn enter(navigation: u64) -> Self {
+        let previous = current_navigation();
+        set_navigation(navigation);
+        Self { previous }
+    }
+}
+
+impl Drop for NavigationScope {
+    fn drop(&mut self) {
+        set_navigation(self.previous);
+    }
+}
+
+// Как memory::Tagged: задача tokio переходит между потоками, навигация
+// ставится на время каждого poll
+pub struct Traced<F> {
+    navigation: u64,
+    inner: F,
+}
+
+pub fn traced<F: Future>(navigation: u64, inner: F) -> Traced<F> {
+    Traced { navigation, inner }
+}
+
+impl<F: Future> Future for Traced<F> {
+    type Output = F::Output;
+
+    fn poll(self: Pin<&mut Self>, cx: &mut Context<'_>) -> Poll<F::Output> {
+        let _scope = NavigationScope::enter(self.navigation);
+        // inner не перемещается: Traced закреплен вместе с ним
+        unsafe { self.map_unchecked_mut(|traced| &mut traced.inner) }.poll(cx)
+    }
+}
+
+fn new_ring() -> RingOwner {
+    let bound_tid = BOUND_TID.try_with(Cell::get).unwrap_or(0);
+    let (tid, thread_name) = if bound_tid != 0 {
+        (bound_tid, None)
+    } else {
+        let tid = NEXT_TID.fetch_add(1, Ordering::Relaxed);
+        let name = match std::thread::current().name() {
+            Some(name) => format!("{} ({})", name, tid),
+            None => format!("rust-{}", tid),
+        };
+        (tid, Some(name))
+    };
+    let ring = Arc::new(Ring {
+        tid,
+        thread_name,
+        alive: AtomicBool::new(true),
+        state: Mutex::new(RingState {
+            events: Vec::new(),
+            written: 0,
+        }),
+    });
+    rings().lock().unwrap().push(Arc::clone(&ring));
+    RingOwner(ring)
+}
+
+// Завершенный отрезок текущего потока; start_ns = 0 - начало пришлось на
+// время, когда трассировка была выключена
+pub fn record(name: &'static str, category: &'static str, start_ns: u64, end_ns: u64, navigation: u64, bytes: u64) {
+    if !enabled() || start_ns == 0 {
+        return;
+    }
+    let event = Event {
+        name,
+        category,
+        start_ns,
+        duration_ns: end_ns.saturating_sub(start_ns),
+        navigation,
+        bytes,
+    };
+
+    let _ = THREAD_RING.try_with(|slot| {
+        let mut slot = slot.borrow_mut();
+        let owner = slot.get_or_insert_with(new_ring);
+        let mut state = owner.0.state.lock().unwrap();
+        let index = (state.written % RING_CAPACITY as u64) as usize;
+        if index < state.events.len() {
+            state.events[index] = event;
+        } else {
+            state.events.push(event);
+        }
+        state.written += 1;
+    });
+}
+
+// Отрезок от создания до уничтожения
+pub struct Span {
+    name: &'static str,
+    category: &'static str,
+    start_ns: u64,
+    navigation: u64,
+    bytes: u64,
+}
+
+impl Span {
+    pub fn begin(category: &'static str, name: &'static str) -> Self {
+        Self {
+            name,
+            category,
+            start_ns: now_ns(),
+            navigation: current_navigation(),
+            bytes: 0,
+        }
+    }
+
+    pub fn set_bytes(&mut self, bytes: u64) {
+        self.bytes = bytes;
+    }
+}
+
+impl Drop for Span {
+    fn drop(&mut self) {
+        if self.start_ns != 0 {
+            record(self.name, self.category, self.start_ns, now_ns(), self.navigation, self.bytes);
+        }
+    }
+}
+
+// События всех потоков через запятую, без скобок массива: C++ вставляет
+// их в общий список traceEvents (src/cpp/tracing.cpp)
+pub fn export_json(pid: u32) -> String {
+    let mut out = String::new();
+    let rings = rings().lock().unwrap();
+
+    for ring in rings.iter() {
+        let state = ring.state.lock().unwrap();
+        if let Some(thread_name) = &ring.thread_name {
+            if !out.is_empty() {
+                out.push(',');
+            }
+            let _ = write!(
+                out,
+                "{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":{}}}}}",
+                pid,
+                ring.tid,
+                serde_json::to_string(thread_name).unwrap_or_default()
+            );
+        }
+
+        let first = state.written.saturating_sub(RING_CAPACITY as u64);
+        for position in first..state.written {
+            let event = &state.events[(position % RING_CAPACITY as u64) as usize];
+            if !out.is_empty() {
+                out.push(',');
+            }
+            let _ = write!(
+                out,
+                "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"X\",\"ts\":{:.3},\"dur\":{:.3},\"pid\":{},\"tid\":{},\
+                 \"args\":{{\"navigation\":{},\"bytes\":{}}}}}",
+                event.name,
+                event.category,
+                event.start_ns as f64 / 1000.0,
+                event.duration_ns as f64 / 1000.0,
+                pid,
+                ring.tid,
+                event.navigation,
+                event.bytes
+            );
+        }
+    }
+    out
+}
+
+// Очищает кольца; кольца завершившихся потоков освобождаются
+pub fn clear() {
+    let mut rings = rings().lock().unwrap();
+    rings.retain(|ring| ring.alive.load(Ordering::Acquire));
+    for ring in rings.iter() {
+        let mut state = ring.state.lock().unwrap();
+        state.events.clear();
+        state.written = 0;
+    }
+}
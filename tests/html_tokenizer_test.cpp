@@ -0,0 +1,239 @@
+// Тесты быстрого токенизатора (src/cpp/html_tokenizer.cpp): SIMD-поиск
+// сверяется со скалярным на случайных данных, разбор - на фикстурах с
+// пограничными случаями. Без GTK и Rust, запускается через ctest.
+//
+//   html_tokenizer_test [зерно]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "html_tokenizer.h"
+
+namespace {
+    int failures = 0;
+
+    void expect_eq(const std::string& actual, const std::string& expected, std::string_view context) {
+        if (actual != expected) {
+            failures++;
+            std::fprintf(stderr, "ОШИБКА %.*s\n  ожидалось: %s\n  получено:  %s\n",
+                         static_cast<int>(context.size()), context.data(), expected.c_str(), actual.c_str());
+        }
+    }
+
+    // Токены одной строкой: <tag>, <tag/>, </tag>, T(текст), C(комментарий), D(doctype)
+    std::string dump(std::string_view html) {
+        HtmlTokenizer tokenizer(html);
+        HtmlToken token;
+        std::string out;
+        while (tokenizer.next(token)) {
+            if (!out.empty()) {
+                out += ' ';
+            }
+            switch (token.kind) {
+            case HtmlTokenKind::StartTag:
+                out += '<';
+                out += token.name;
+                out += token.self_closing ? "/>" : ">";
+                break;
+            case HtmlTokenKind::EndTag:
+                out += "</";
+                out += token.name;
+                out += '>';
+                break;
+            case HtmlTokenKind::Text:
+                out += "T(";
+                out += token.text;
+                out += ')';
+                break;
+            case HtmlTokenKind::Comment:
+                out += "C(";
+                out += token.text;
+                out += ')';
+                break;
+            case HtmlTokenKind::Doctype:
+                out += "D(";
+                out += token.text;
+                out += ')';
+                break;
+            }
+        }
+        return out;
+    }
+
+    void expect_tokens(std::string_view html, const std::string& expected) {
+        expect_eq(dump(html), expected, html);
+    }
+
+    std::string decode(std::string_view text) {
+        std::string out;
+        decode_entities(text, out);
+        return out;
+    }
+
+    void expect_decoded(std::string_view text, const std::string& expected) {
+        expect_eq(decode(text), expected, text);
+    }
+
+    // Каждая реализация против скалярной: случайные длины, невыровненные
+    // начала, маленький алфавит (попадания часты) и байты >= 0x80. Искомые
+    // символы кладутся и сразу за end - реализация не должна их видеть
+    void test_kernels(uint32_t seed) {
+        std::vector<html_scan::Kernel> kernels = html_scan::kernels();
+        html_scan::FindEither reference = kernels[0].find_either;
+        const char alphabet[] = {'a', '<', '&', '>', '"', '\'', '\n', '\0', '\x80', '\xff', '-'};
+
+        std::mt19937 random(seed);
+        std::vector<char> buffer(256 + 64);
+        for (const html_scan::Kernel& kernel : kernels) {
+            size_t mismatches = 0;
+            for (int round = 0; round < 20000; round++) {
+                // Каждый третий буфер без попаданий: проверяется проход до конца
+                bool sparse = round % 3 == 0;
+                for (char& c : buffer) {
+                    c = sparse ? 'x' : alphabet[random() % sizeof(alphabet)];
+                }
+                char a = alphabet[random() % sizeof(alphabet)];
+                char b = random() % 4 == 0 ? a : alphabet[random() % sizeof(alphabet)];
+
+                size_t offset = random() % 64;
+                size_t length = random() % 256;
+                const char* begin = buffer.data() + offset;
+                const char* end = begin + length;
+                if (sparse && length > 0) {
+                    buffer[offset + random() % length] = random() % 2 ? a : b;
+                }
+                buffer[offset + length] = a;
+
+                const char* expected = reference(begin, end, a, b);
+                const char* actual = kernel.find_either(begin, end, a, b);
+                if (actual != expected && mismatches++ < 5) {
+                    failures++;
+                    std::fprintf(stderr, "ОШИБКА %s: смещение %zu, длина %zu, '%02x'/'%02x': %td вместо %td\n",
+                                 kernel.name, offset, length, static_cast<uint8_t>(a), static_cast<uint8_t>(b),
+                                 actual - begin, expected - begin);
+                }
+            }
+            std::printf("find_either %s: %s\n", kernel.name, mismatches ? "расхождения" : "ok");
+        }
+    }
+
+    void test_raw_text() {
+        expect_tokens("<script>a</b>c</script>x", "<script> T(a</b>c) </script> T(x)");
+        expect_tokens("<script>if (a<b) x</SCRIPT>y", "<script> T(if (a<b) x) </SCRIPT> T(y)");
+        expect_tokens("<script>1</ScRiPt >2", "<script> T(1) </ScRiPt> T(2)");
+        expect_tokens("<script>1</script\t>2", "<script> T(1) </script> T(2)");
+        expect_tokens("<script>1</script/>2", "<script> T(1) </script> T(2)");
+        // Похожее имя - еще не конец
+        expect_tokens("<script>1</scripty>2</script>", "<script> T(1</scripty>2) </script>");
+        expect_tokens("<script>1</ script>2</script>", "<script> T(1</ script>2) </script>");
+        // Вход кончился посреди закрывающего тега - это текст
+        expect_tokens("<script>1</script", "<script> T(1</script)");
+        expect_tokens("<script>1</scr", "<script> T(1</scr)");
+        expect_tokens("<style>a</script>b</style>", "<style> T(a</script>b) </style>");
+        expect_tokens("<textarea><b>&amp;</textarea>", "<textarea> T(<b>&amp;) </textarea>");
+        expect_tokens("<textarea></textarea>", "<textarea> </textarea>");
+        expect_tokens("<script/>x", "<script/> T(x)");
+
+        // Конец содержимого на любом месте относительно блоков по 16 и 32 байта
+        for (size_t pad = 0; pad < 80; pad++) {
+            std::string body(pad, pad % 2 ? 'x' : '<');
+            for (std::string_view end_tag : {"</script>", "</SCRIPT>", "</sCrIpT >"}) {
+                std::string html = "<script>";
+                html += body;
+                html += end_tag;
+                html += 'y';
+                std::string expected = "<script> ";
+                if (pad) {
+                    expected += "T(";
+                    expected += body;
+                    expected += ") ";
+                }
+                expected += "</";
+                expected += end_tag.substr(2, 6);
+                expected += "> T(y)";
+                expect_tokens(html, expected);
+            }
+        }
+    }
+
+    void test_comments() {
+        expect_tokens("<!-- a -->b", "C( a ) T(b)");
+        expect_tokens("<!---->b", "C() T(b)");
+        expect_tokens("<!-->b", "C() T(b)");
+        expect_tokens("<!--->b", "C() T(b)");
+        expect_tokens("<!----->b", "C(-) T(b)");
+        expect_tokens("<!-- a --!>b", "C( a ) T(b)");
+        expect_tokens("<!-- a -- b -->c", "C( a -- b ) T(c)");
+        expect_tokens("<!-- a > b - > c -!> d -->e", "C( a > b - > c -!> d ) T(e)");
+        expect_tokens("<!-- не закрыт", "C( не закрыт)");
+        expect_tokens("<!-- a --", "C( a --)");
+        expect_tokens("<!DOCTYPE html><?xml x?><!x></>", "D(DOCTYPE html) C(xml x?) C(x) C()");
+        expect_tokens("a < b <3 <", "T(a < b <3 <)");
+
+        for (size_t pad = 0; pad < 80; pad++) {
+            std::string body(pad, 'c');
+            std::string expected = "C(";
+            expected += body;
+            expected += ") T(x)";
+            for (std::string_view end : {"-->x", "--!>x"}) {
+                std::string html = "<!--";
+                html += body;
+                html += end;
+                expect_tokens(html, expected);
+            }
+        }
+    }
+
+    void test_entities() {
+        expect_decoded("a &amp; b", "a & b");
+        expect_decoded("&lt;&gt;&quot;&apos;", "<>\"'");
+        expect_decoded("&nbsp;&mdash;&hellip;", "\xC2\xA0\xE2\x80\x94\xE2\x80\xA6");
+        expect_decoded("&#65;&#x42;&#X43;&#x00044;&#0069;", "ABCDE");
+        expect_decoded("&#x1F600;", "\xF0\x9F\x98\x80");
+        // NUL, суррогаты и коды за пределами Unicode - U+FFFD
+        expect_decoded("&#0;", "\xEF\xBF\xBD");
+        expect_decoded("&#xD800;", "\xEF\xBF\xBD");
+        expect_decoded("&#x110000;", "\xEF\xBF\xBD");
+        expect_decoded("&#999999999;", "\xEF\xBF\xBD");
+        // Не ссылки: остаются как есть
+        expect_decoded("&", "&");
+        expect_decoded("a & b", "a & b");
+        expect_decoded("&;", "&;");
+        expect_decoded("&#;", "&#;");
+        expect_decoded("&#x;", "&#x;");
+        expect_decoded("&#12a;", "&#12a;");
+        expect_decoded("&#xG;", "&#xG;");
+        expect_decoded("&amp", "&amp");
+        expect_decoded("&unknown;", "&unknown;");
+        expect_decoded("&averyverylongname;", "&averyverylongname;");
+        expect_decoded("&#65&#66;", "&#65B");
+        expect_decoded("x&&amp;y", "x&&y");
+        expect_decoded("", "");
+
+        std::string out = "pre:";
+        decode_entities("&lt;", out);
+        expect_eq(out, "pre:<", "decode_entities дописывает в out");
+    }
+}
+
+int main(int argc, char** argv) {
+    uint32_t seed = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : std::random_device()();
+    std::printf("зерно %u, реализация по умолчанию %s\n", seed, html_scan::implementation());
+
+    test_kernels(seed);
+    test_raw_text();
+    test_comments();
+    test_entities();
+
+    if (failures) {
+        std::fprintf(stderr, "%d ошибок\n", failures);
+        return 1;
+    }
+    std::printf("все тесты пройдены\n");
+    return 0;
+}